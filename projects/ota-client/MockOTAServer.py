@@ -4,6 +4,12 @@ import json
 import os
 import hashlib
 import ssl
+import socket
+import struct
+import tempfile
+import lzma
+import subprocess
+from make_delta import make_delta
 from datetime import datetime
 
 # --- Configuração do Servidor ---
@@ -20,6 +26,24 @@ KEY_FILE = "key.pem"
 # Nome do arquivo de assinatura (SIG)
 SIGNATURE_FILE = "firmware_v1.1.0.sig"
 
+# Versão anterior (em execução nos dispositivos): se a imagem existir, um patch delta para a
+# nova versão é gerado na inicialização e anunciado no manifesto (delta_from / delta_url)
+PREVIOUS_VERSION = "1.0.0"
+PREVIOUS_FIRMWARE_FILE = f"firmware_v{PREVIOUS_VERSION}.bin"
+
+# Tamanho dos blocos enviados ao cliente
+CHUNK_SIZE = 64 * 1024
+
+# Simulação de queda de link: se > 0, a primeira resposta de imagem (completa, comprimida ou
+# delta) é interrompida após esse número de bytes (para testar a retomada com Range).
+# Ex: OTA_MOCK_DROP_AFTER=1000000
+DROP_AFTER_BYTES = int(os.environ.get("OTA_MOCK_DROP_AFTER", "0"))
+
+# Simulação de corrupção: se >= 0, o byte nesse offset do firmware é invertido na primeira
+# resposta que o contém (para testar o novo download só do chunk inválido).
+# Ex: OTA_MOCK_CORRUPT_AT=5000000
+CORRUPT_AT = int(os.environ.get("OTA_MOCK_CORRUPT_AT", "-1"))
+
 # Detalhes da nova versão
 LATEST_VERSION = {
     "version": "1.1.0", 
@@ -28,9 +52,198 @@ LATEST_VERSION = {
     "hash": "6349a23f7160ae1b47ef5016c4f3929a736b5f19417d902d1dadfe5b96e668c5" 
 }
 
+DELTA_FILE = f"firmware_v{PREVIOUS_VERSION}_to_{LATEST_VERSION['version']}.delta.xz"
+DELTA_PATH = os.path.join(tempfile.gettempdir(), DELTA_FILE) # Gerado a cada inicialização
+
+# Imagem completa comprimida (xz), gerada a cada inicialização. O dicionário de 1 MiB limita
+# a memória que o cliente precisa para descomprimir (DECOMPRESS_MEMLIMIT em decompressor.h)
+COMPRESSED_FILE = f"{FIRMWARE_FILE}.xz"
+COMPRESSED_PATH = os.path.join(tempfile.gettempdir(), COMPRESSED_FILE)
+XZ_FILTERS = [{"id": lzma.FILTER_LZMA2, "preset": 6, "dict_size": 1 << 20}]
+
+# Manifesto em chunks: SHA256 de cada chunk de CHUNK_MANIFEST_SIZE bytes, em uma lista assinada
+# com a chave do firmware (formato em src/chunk_verifier.h). Gerado a cada inicialização.
+CHUNK_MANIFEST_SIZE = 1024 * 1024
+CHUNKS_FILE = f"{FIRMWARE_FILE}.chunks"
+CHUNKS_SIGNATURE_FILE = f"{CHUNKS_FILE}.sig"
+CHUNKS_PATH = os.path.join(tempfile.gettempdir(), CHUNKS_FILE)
+CHUNKS_SIGNATURE_PATH = os.path.join(tempfile.gettempdir(), CHUNKS_SIGNATURE_FILE)
+
+
+def compress_xz(data):
+    """Comprime no formato xz com a janela limitada aceita pelo cliente."""
+    return lzma.compress(data, format=lzma.FORMAT_XZ, check=lzma.CHECK_CRC64, filters=XZ_FILTERS)
+
+
+def prepare_delta():
+    """Gera o patch delta da versão anterior para a atual e o anuncia no manifesto."""
+    if not os.path.exists(PREVIOUS_FIRMWARE_FILE) or not os.path.exists(FIRMWARE_FILE):
+        return
+    with open(PREVIOUS_FIRMWARE_FILE, 'rb') as f:
+        previous = f.read()
+    with open(FIRMWARE_FILE, 'rb') as f:
+        latest = f.read()
+    patch = make_delta(previous, latest)
+    with open(DELTA_PATH, 'wb') as f:
+        f.write(compress_xz(patch))
+    LATEST_VERSION["deltas"] = [{
+        "from": PREVIOUS_VERSION,
+        "url": f"https://{SERVER_ADDRESS}:{HTTPS_PORT}/{DELTA_FILE}",
+        "compression": "xz",
+    }]
+    print(f"Patch delta {PREVIOUS_VERSION} -> {LATEST_VERSION['version']}: {len(patch)} bytes "
+          f"(imagem completa: {len(latest)} bytes)")
+
+
+def prepare_compressed():
+    """Gera a versão xz da imagem atual e a anuncia no manifesto (compression / compressed_url)."""
+    if not os.path.exists(FIRMWARE_FILE):
+        return
+    with open(FIRMWARE_FILE, 'rb') as f:
+        latest = f.read()
+    compressed = compress_xz(latest)
+    with open(COMPRESSED_PATH, 'wb') as f:
+        f.write(compressed)
+    LATEST_VERSION["compression"] = "xz"
+    LATEST_VERSION["compressed_url"] = f"https://{SERVER_ADDRESS}:{HTTPS_PORT}/{COMPRESSED_FILE}"
+    print(f"Imagem comprimida (xz): {len(compressed)} bytes ({len(latest)} bytes sem compressão)")
+
+
+def prepare_chunk_manifest():
+    """Gera e assina a lista de hashes dos chunks e a anuncia no manifesto."""
+    if not os.path.exists(FIRMWARE_FILE):
+        return
+    size = os.path.getsize(FIRMWARE_FILE)
+    count = (size + CHUNK_MANIFEST_SIZE - 1) // CHUNK_MANIFEST_SIZE
+    digests = []
+    with open(FIRMWARE_FILE, 'rb') as f:
+        for _ in range(count):
+            digests.append(hashlib.sha256(f.read(CHUNK_MANIFEST_SIZE)).digest())
+    chunk_list = b"OTACHNK1" + struct.pack("<QII", size, CHUNK_MANIFEST_SIZE, count) + b"".join(digests)
+    with open(CHUNKS_PATH, 'wb') as f:
+        f.write(chunk_list)
+    # RSA/SHA256 sobre a lista inteira, com a mesma chave da assinatura do firmware
+    result = subprocess.run(["openssl", "dgst", "-sha256", "-sign", KEY_FILE, "-out",
+                             CHUNKS_SIGNATURE_PATH, CHUNKS_PATH], capture_output=True)
+    if result.returncode != 0:
+        print(f"Manifesto em chunks não gerado (openssl): {result.stderr.decode().strip()}")
+        return
+    LATEST_VERSION["chunks_url"] = f"https://{SERVER_ADDRESS}:{HTTPS_PORT}/{CHUNKS_FILE}"
+    LATEST_VERSION["chunks_signature_url"] = f"https://{SERVER_ADDRESS}:{HTTPS_PORT}/{CHUNKS_SIGNATURE_FILE}"
+    # Os mesmos hashes embutidos no manifesto (a assinatura cobre a lista binária equivalente)
+    LATEST_VERSION["size"] = size
+    LATEST_VERSION["chunk_size"] = CHUNK_MANIFEST_SIZE
+    LATEST_VERSION["chunk_digests"] = [d.hex() for d in digests]
+    print(f"Manifesto em chunks: {count} chunks de {CHUNK_MANIFEST_SIZE} bytes")
+
+
+def parse_range(header, size):
+    """Interpreta um cabeçalho 'Range: bytes=início-fim' (um único intervalo).
+
+    Retorna (início, fim) inclusivos, None se o cabeçalho deve ser ignorado (resposta 200
+    com o arquivo inteiro) ou False se o intervalo não pode ser atendido (416).
+    """
+    if not header or not header.startswith("bytes=") or "," in header:
+        return None
+    start_str, _, end_str = header[len("bytes="):].strip().partition("-")
+    try:
+        if start_str == "":
+            # Sufixo: os últimos N bytes
+            length = int(end_str)
+            if length <= 0:
+                return False
+            return (max(size - length, 0), size - 1)
+        start = int(start_str)
+        end = int(end_str) if end_str else size - 1
+    except ValueError:
+        return None
+    if start >= size or end < start:
+        return False
+    return (start, min(end, size - 1))
+
+
 class OTAServerHandler(http.server.SimpleHTTPRequestHandler):
     """Manipulador de requisições que simula os endpoints OTA."""
 
+    # HTTP/1.1 com keep-alive: o cliente reaproveita a mesma conexão TLS entre as requisições
+    protocol_version = "HTTP/1.1"
+    dropped_once = False
+    corrupted_once = False
+
+    def serve_file(self, path, label):
+        """Envia um arquivo respeitando pedidos de Range (206 / 416)."""
+        if not os.path.exists(path):
+            self.send_error(404, f"{label} não encontrado no servidor.")
+            return
+
+        size = os.path.getsize(path)
+        byte_range = parse_range(self.headers.get("Range"), size)
+        if byte_range is False:
+            self.send_response(416)
+            self.send_header('Content-Range', f'bytes */{size}')
+            self.send_header('Content-Length', '0')
+            self.send_header('Connection', 'close')
+            self.end_headers()
+            print(f"   -> Range inválido para {path}: {self.headers.get('Range')}")
+            return
+
+        start, end = byte_range if byte_range else (0, size - 1)
+        length = end - start + 1
+        if byte_range:
+            self.send_response(206)
+            self.send_header('Content-Range', f'bytes {start}-{end}/{size}')
+        else:
+            self.send_response(200)
+        self.send_header('Content-type', 'application/octet-stream')
+        self.send_header('Content-Disposition', f'attachment; filename="{os.path.basename(path)}"')
+        self.send_header('Accept-Ranges', 'bytes')
+        self.send_header('Content-Length', str(length))
+        self.end_headers()
+
+        # Só a primeira resposta do firmware é interrompida (a retomada deve concluir)
+        drop_at = None
+        if path != SIGNATURE_FILE and 0 < DROP_AFTER_BYTES < length and not OTAServerHandler.dropped_once:
+            OTAServerHandler.dropped_once = True
+            drop_at = DROP_AFTER_BYTES
+
+        corrupt_at = None
+        if path == FIRMWARE_FILE and start <= CORRUPT_AT <= end and not OTAServerHandler.corrupted_once:
+            OTAServerHandler.corrupted_once = True
+            corrupt_at = CORRUPT_AT
+
+        sent = 0
+        with open(path, 'rb') as f:
+            f.seek(start)
+            while sent < length:
+                chunk = f.read(min(CHUNK_SIZE, length - sent))
+                if not chunk:
+                    break
+                if corrupt_at is not None and start + sent <= corrupt_at < start + sent + len(chunk):
+                    chunk = bytearray(chunk)
+                    chunk[corrupt_at - start - sent] ^= 0xFF
+                    print(f"   -> [SIMULAÇÃO] Byte {corrupt_at} corrompido.")
+                if drop_at is not None and sent + len(chunk) >= drop_at:
+                    self.wfile.write(chunk[:drop_at - sent])
+                    self.wfile.flush()
+                    print(f"   -> [SIMULAÇÃO] Conexão derrubada após {drop_at} bytes.")
+                    self.close_connection = True
+                    self.connection.shutdown(socket.SHUT_RDWR)
+                    return
+                self.wfile.write(chunk)
+                sent += len(chunk)
+
+        if byte_range:
+            print(f"   -> Bytes {start}-{end} de {path} enviados com sucesso.")
+        else:
+            print(f"   -> Arquivo {path} enviado com sucesso.")
+
+    def setup(self):
+        super().setup()
+        # Cada conexão nova é registrada, indicando se o handshake TLS foi abreviado
+        reused = getattr(self.connection, "session_reused", False)
+        print(f"[{datetime.now().strftime('%H:%M:%S')}] Nova conexão de {self.client_address[0]}:"
+              f"{self.client_address[1]} (sessão TLS {'retomada' if reused else 'completa'})")
+
     def do_GET(self):
         """Processa requisições GET."""
         
@@ -39,54 +252,56 @@ class OTAServerHandler(http.server.SimpleHTTPRequestHandler):
             print(f"[{datetime.now().strftime('%H:%M:%S')}] Cliente requisitou: {self.path}")
 
             response_json = json.dumps(LATEST_VERSION)
-            
+            # ETag do manifesto: o cliente em modo daemon repete a consulta com If-None-Match
+            # e um manifesto que não mudou é respondido com 304, sem corpo
+            etag = '"' + hashlib.sha256(response_json.encode('utf-8')).hexdigest()[:32] + '"'
+            if self.headers.get('If-None-Match') == etag:
+                self.send_response(304)
+                self.send_header('ETag', etag)
+                self.end_headers()
+                print(f"   -> Manifesto não mudou (304).")
+                return
+
             self.send_response(200)
             self.send_header('Content-type', 'application/json')
             self.send_header('Content-Length', str(len(response_json)))
-            self.send_header('Connection', 'close')
+            self.send_header('ETag', etag)
             self.end_headers()
             
-            response_json = json.dumps(LATEST_VERSION)
             self.wfile.write(response_json.encode('utf-8'))
             print(f"   -> Resposta JSON enviada: {response_json}")
             
-        # 2. Endpoint de Download do Firmware
+        # 2. Endpoint de Download do Firmware (aceita Range para retomada e segmentos paralelos)
         elif self.path == f"/{FIRMWARE_FILE}":
-            print(f"[{datetime.now().strftime('%H:%M:%S')}] Cliente requisitou download: {self.path}")
-
-            if not os.path.exists(FIRMWARE_FILE):
-                self.send_error(404, "Arquivo de firmware não encontrado no servidor.")
-                return
-
-            self.send_response(200)
-            self.send_header('Content-type', 'application/octet-stream')
-            self.send_header('Content-Disposition', f'attachment; filename="{FIRMWARE_FILE}"')
-            self.send_header('Content-Length', str(os.path.getsize(FIRMWARE_FILE)))
-            self.send_header('Connection', 'close')
-            self.end_headers()
+            print(f"[{datetime.now().strftime('%H:%M:%S')}] Cliente requisitou download: {self.path}"
+                  f" (Range: {self.headers.get('Range', '-')})")
+            self.serve_file(FIRMWARE_FILE, "Arquivo de firmware")
             
-            with open(FIRMWARE_FILE, 'rb') as f:
-                self.wfile.write(f.read())
-            print(f"   -> Arquivo {FIRMWARE_FILE} enviado com sucesso.")
-            
-        # 3. Endpoint de Download da Assinatura
-        elif self.path == f"/{SIGNATURE_FILE}":
-            print(f"[{datetime.now().strftime('%H:%M:%S')}] Cliente requisitou assinatura: {self.path}")
+        # 3. Endpoint do Patch Delta
+        elif self.path == f"/{DELTA_FILE}" and "deltas" in LATEST_VERSION:
+            print(f"[{datetime.now().strftime('%H:%M:%S')}] Cliente requisitou patch delta: {self.path}"
+                  f" (Range: {self.headers.get('Range', '-')})")
+            self.serve_file(DELTA_PATH, "Patch delta")
 
-            if not os.path.exists(SIGNATURE_FILE):
-                self.send_error(404, "Arquivo de assinatura não encontrado.")
-                return
+        # 4. Endpoint da Imagem Comprimida
+        elif self.path == f"/{COMPRESSED_FILE}" and "compressed_url" in LATEST_VERSION:
+            print(f"[{datetime.now().strftime('%H:%M:%S')}] Cliente requisitou imagem comprimida: {self.path}"
+                  f" (Range: {self.headers.get('Range', '-')})")
+            self.serve_file(COMPRESSED_PATH, "Imagem comprimida")
 
-            self.send_response(200)
-            self.send_header('Content-type', 'application/octet-stream')
-            self.send_header('Content-Disposition', f'attachment; filename="{SIGNATURE_FILE}"')
-            self.send_header('Content-Length', str(os.path.getsize(SIGNATURE_FILE))) 
-            self.send_header('Connection', 'close') 
-            self.end_headers()
+        # 5. Endpoint do Manifesto em Chunks (lista de hashes e sua assinatura)
+        elif self.path == f"/{CHUNKS_FILE}" and "chunks_url" in LATEST_VERSION:
+            print(f"[{datetime.now().strftime('%H:%M:%S')}] Cliente requisitou manifesto em chunks: {self.path}")
+            self.serve_file(CHUNKS_PATH, "Manifesto em chunks")
 
-            with open(SIGNATURE_FILE, 'rb') as f:
-                self.wfile.write(f.read())
-            print(f"   -> Arquivo {SIGNATURE_FILE} enviado com sucesso.")
+        elif self.path == f"/{CHUNKS_SIGNATURE_FILE}" and "chunks_url" in LATEST_VERSION:
+            print(f"[{datetime.now().strftime('%H:%M:%S')}] Cliente requisitou assinatura do manifesto: {self.path}")
+            self.serve_file(CHUNKS_SIGNATURE_PATH, "Assinatura do manifesto em chunks")
+
+        # 6. Endpoint de Download da Assinatura
+        elif self.path == f"/{SIGNATURE_FILE}":
+            print(f"[{datetime.now().strftime('%H:%M:%S')}] Cliente requisitou assinatura: {self.path}")
+            self.serve_file(SIGNATURE_FILE, "Arquivo de assinatura")
             
         else:
             # Para outros caminhos, usa o comportamento padrão do SimpleHTTPRequestHandler
@@ -97,10 +312,13 @@ print(f"Iniciando servidor em http://{SERVER_ADDRESS}:{HTTPS_PORT}")
 print(f"Endpoint de Versão: http://{SERVER_ADDRESS}:{HTTPS_PORT}/api/firmware/latest")
 print(f"Arquivo de Firmware: {FIRMWARE_FILE}")
 print(f"Hash SHA256 Esperado: {LATEST_VERSION['hash']}")
+prepare_delta()
+prepare_compressed()
+prepare_chunk_manifest()
 
 try:
-    # Use o HTTPServer, que lida melhor com o handshake SSL
-    httpd = http.server.HTTPServer((SERVER_ADDRESS, HTTPS_PORT), OTAServerHandler)
+    # Uma thread por conexão: o modo de download paralelo abre várias ao mesmo tempo
+    httpd = http.server.ThreadingHTTPServer((SERVER_ADDRESS, HTTPS_PORT), OTAServerHandler)
     
     # 1. Configurar o contexto SSL
     context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
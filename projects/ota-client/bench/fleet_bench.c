@@ -0,0 +1,276 @@
+#include "ota_client.h"
+#include "mock_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+// Teste de carga da frota: um servidor OTA nativo local e N dispositivos simulados, cada um
+// executando perform_ota_update em sua thread, com seu próprio diretório de staging e slots.
+//
+//   ota_fleet_bench [-n dispositivos] [-c simultâneos] [-s MB da imagem] [-d diretório]
+#define BENCH_DEFAULT_DEVICES 32
+#define BENCH_DEFAULT_IMAGE_MB 8
+#define BENCH_DEFAULT_DIR "fleet_bench"
+#define BENCH_CURRENT_VERSION "1.0.0"
+#define BENCH_NEW_VERSION "2.0.0"
+
+typedef struct {
+    int ret;
+    double seconds;            // Duração total da atualização
+    OtaStats stats;
+} DeviceResult;
+
+typedef struct {
+    const char *url;
+    int devices;
+    int next;                  // Próximo dispositivo a atualizar (protegido por lock)
+    pthread_mutex_t lock;
+    DeviceResult *results;
+} Fleet;
+
+static double now_seconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Remove os arquivos que a atualização deixou no diretório do dispositivo (a imagem gravada no
+// slot ocupa o tamanho do firmware; com milhares de dispositivos o disco enche)
+static void remove_device_dir(const char *dir) {
+    static const char *files[] = {
+        "firmware_slot_a.bin", "firmware_slot_b.bin", "firmware_slots.state",
+        "firmware_staging.bin", "firmware_staging.bin.state",
+    };
+    char path[PATH_MAX];
+
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
+static void *device_worker(void *arg) {
+    Fleet *fleet = (Fleet *)arg;
+
+    while (1) {
+        char dir[64];
+        DeviceResult *result;
+        OtaOptions options;
+        double started;
+        int index;
+
+        pthread_mutex_lock(&fleet->lock);
+        index = fleet->next < fleet->devices ? fleet->next++ : -1;
+        pthread_mutex_unlock(&fleet->lock);
+        if (index < 0) break;
+
+        result = &fleet->results[index];
+        snprintf(dir, sizeof(dir), "dev%05d", index);
+        if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+            result->ret = -1;
+            continue;
+        }
+        memset(&options, 0, sizeof(options));
+        options.work_dir = dir;
+        options.stats = &result->stats;
+
+        started = now_seconds();
+        result->ret = perform_ota_update_with_options(fleet->url, BENCH_CURRENT_VERSION, &options);
+        result->seconds = now_seconds() - started;
+        remove_device_dir(dir);
+    }
+    return NULL;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+// Imprime o texto alinhado (à esquerda ou à direita) em width colunas: printf conta bytes, não
+// caracteres UTF-8
+static void print_column(const char *text, int width, int left) {
+    int chars = 0;
+
+    for (const char *p = text; *p; p++) chars += ((unsigned char)*p & 0xC0) != 0x80;
+    if (!left) printf("%*s", width > chars ? width - chars : 0, "");
+    printf("%s", text);
+    if (left) printf("%*s", width > chars ? width - chars : 0, "");
+}
+
+// Uma linha da tabela: média, p50, p95 e máximo em ms (values é reordenado)
+static void print_distribution(const char *label, double *values, int count) {
+    double sum = 0;
+
+    if (count == 0) return;
+    qsort(values, (size_t)count, sizeof(double), compare_doubles);
+    for (int i = 0; i < count; i++) sum += values[i];
+    print_column(label, 12, 1);
+    printf(" %10.1f %10.1f %10.1f %10.1f\n", sum / count * 1e3, values[count / 2] * 1e3,
+           values[(count * 95 + 99) / 100 - 1] * 1e3, values[count - 1] * 1e3);
+}
+
+static void print_report(const Fleet *fleet, int concurrency, size_t image_size, double wall,
+                         const MockServer *server)
+{
+    static const char *stage_names[OTA_STAGE_COUNT] = {
+        "manifesto", "assinatura", "download", "hash", "aplicação",
+    };
+    double *values = malloc((size_t)fleet->devices * sizeof(double));
+    long long received = 0;
+    int ok = 0;
+
+    if (!values) return;
+    for (int i = 0; i < fleet->devices; i++) {
+        const DeviceResult *result = &fleet->results[i];
+
+        if (result->ret != 0 || result->stats.image_bytes == 0) continue;
+        received += result->stats.received_bytes;
+        values[ok++] = result->seconds;
+    }
+
+    printf("\nFrota: %d dispositivos (%d simultâneos), imagem de %.1f MB\n", fleet->devices, concurrency,
+           image_size / 1048576.0);
+    printf("Atualizados: %d/%d em %.2f s (%.1f MB/s agregados, %.1f atualizações/s)\n", ok, fleet->devices,
+           wall, received / 1048576.0 / wall, ok / wall);
+    printf("Servidor: %ld conexões, %ld requisições, %.1f MB enviados\n\n", server->connections,
+           server->requests, server->bytes_sent / 1048576.0);
+
+    print_column("etapa", 12, 1);
+    for (int i = 0; i < 4; i++) {
+        static const char *columns[] = { "média", "p50", "p95", "máx" };
+
+        printf(" ");
+        print_column(columns[i], 10, 0);
+    }
+    printf("  (ms)\n");
+    print_distribution("atualização", values, ok);
+    for (int stage = 0; stage < OTA_STAGE_COUNT; stage++) {
+        int count = 0;
+
+        for (int i = 0; i < fleet->devices; i++) {
+            const DeviceResult *result = &fleet->results[i];
+
+            if (result->ret == 0 && result->stats.image_bytes > 0) values[count++] = result->stats.seconds[stage];
+        }
+        print_distribution(stage_names[stage], values, count);
+    }
+    free(values);
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Uso: %s [-n dispositivos] [-c simultâneos] [-s MB da imagem] [-d diretório]\n", program);
+}
+
+int main(int argc, char **argv) {
+    int devices = BENCH_DEFAULT_DEVICES, concurrency = 0, image_mb = BENCH_DEFAULT_IMAGE_MB, opt;
+    const char *base_dir = BENCH_DEFAULT_DIR;
+    char url[128], path[PATH_MAX], origin[PATH_MAX];
+    pthread_t *workers;
+    MockServer server;
+    Fleet fleet;
+    double started, wall;
+    int saved_stdout, null_fd, created = 0, updated = 0;
+
+    while ((opt = getopt(argc, argv, "n:c:s:d:")) != -1) {
+        switch (opt) {
+        case 'n': devices = atoi(optarg); break;
+        case 'c': concurrency = atoi(optarg); break;
+        case 's': image_mb = atoi(optarg); break;
+        case 'd': base_dir = optarg; break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (concurrency <= 0 || concurrency > devices) concurrency = devices;
+    if (devices <= 0 || image_mb <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN); // Conexões fechadas pelo outro lado viram erros de escrita
+
+    printf("Gerando firmware de %d MB, chave e certificado...\n", image_mb);
+    if (mock_server_start(&server, (size_t)image_mb * 1024 * 1024, BENCH_NEW_VERSION) != 0) return 1;
+    snprintf(url, sizeof(url), "https://127.0.0.1:%d/api/firmware/latest", server.port);
+    printf("Servidor OTA em https://127.0.0.1:%d\n", server.port);
+
+    // O cliente lê a chave pública de ./cert.pem e a CA do TLS de ../cert.pem: os dispositivos
+    // rodam em <diretório>/run
+    snprintf(path, sizeof(path), "%s/run", base_dir);
+    if (!getcwd(origin, sizeof(origin)) || (mkdir(base_dir, 0700) != 0 && errno != EEXIST) ||
+        (mkdir(path, 0700) != 0 && errno != EEXIST) || chdir(path) != 0 || mock_server_write_certificate(&server, "cert.pem") != 0 ||
+        mock_server_write_certificate(&server, "../cert.pem") != 0) {
+        fprintf(stderr, "Falha ao preparar %s: %s\n", path, strerror(errno));
+        mock_server_stop(&server);
+        return 1;
+    }
+
+    memset(&fleet, 0, sizeof(fleet));
+    fleet.url = url;
+    fleet.devices = devices;
+    pthread_mutex_init(&fleet.lock, NULL);
+    fleet.results = calloc((size_t)devices, sizeof(DeviceResult));
+    workers = calloc((size_t)concurrency, sizeof(pthread_t));
+    if (!fleet.results || !workers) {
+        fprintf(stderr, "Falha ao alocar a frota.\n");
+        mock_server_stop(&server);
+        return 1;
+    }
+
+    printf("Atualizando %d dispositivos, %d por vez...\n", devices, concurrency);
+    fflush(stdout);
+    // O log de cada atualização iria para o terminal: só o relatório é impresso. O desvio é
+    // feito no fd 1 (o FILE stdout continua aberto) e desfeito antes do relatório
+    saved_stdout = dup(STDOUT_FILENO);
+    null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (saved_stdout < 0 || null_fd < 0 || dup2(null_fd, STDOUT_FILENO) < 0) {
+        fprintf(stderr, "Aviso: log das atualizações não silenciado: %s\n", strerror(errno));
+        if (saved_stdout >= 0) close(saved_stdout);
+        saved_stdout = -1;
+    }
+    if (null_fd >= 0) close(null_fd);
+
+    started = now_seconds();
+    while (created < concurrency && pthread_create(&workers[created], NULL, device_worker, &fleet) == 0) {
+        created++;
+    }
+    for (int i = 0; i < created; i++) pthread_join(workers[i], NULL);
+    wall = now_seconds() - started;
+
+    fflush(stdout);
+    if (saved_stdout >= 0) {
+        if (dup2(saved_stdout, STDOUT_FILENO) < 0) {
+            fprintf(stderr, "Erro ao restaurar a saída padrão: %s\n", strerror(errno));
+            close(saved_stdout);
+            mock_server_stop(&server);
+            return 1;
+        }
+        close(saved_stdout);
+    }
+    if (created < concurrency) fprintf(stderr, "Aviso: só %d threads de dispositivo foram criadas.\n", created);
+
+    print_report(&fleet, concurrency, server.image_size, wall, &server);
+    mock_server_stop(&server);
+
+    unlink("cert.pem");
+    unlink("../cert.pem");
+    if (chdir(origin) == 0) {
+        rmdir(path);
+        rmdir(base_dir);
+    }
+    for (int i = 0; i < devices; i++) updated += fleet.results[i].ret == 0;
+    free(workers);
+    free(fleet.results);
+    pthread_mutex_destroy(&fleet.lock);
+    return updated == devices ? 0 : 1;
+}
@@ -0,0 +1,384 @@
+#include "mock_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/sha.h>
+#include <openssl/x509v3.h>
+
+#define MOCK_IDLE_TIMEOUT_S 30   // Conexão keep-alive sem requisições é fechada
+
+typedef struct {
+    MockServer *server;
+    int fd;
+    SSL *ssl;
+    char buffer[MOCK_HEADER_MAX + 1];
+    size_t used;
+} Connection;
+
+// Conteúdo pseudoaleatório (xorshift): o firmware não é comprimível por acaso no caminho
+static void fill_image(unsigned char *image, size_t size) {
+    unsigned long long state = 0x9E3779B97F4A7C15ULL;
+
+    for (size_t i = 0; i < size; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        image[i] = (unsigned char)state;
+    }
+}
+
+// Certificado auto-assinado para 127.0.0.1, confiável como CA pelo cliente
+static int generate_credentials(MockServer *server) {
+    X509_NAME *name;
+    X509_EXTENSION *ext;
+
+    server->key = EVP_RSA_gen(2048);
+    server->cert = X509_new();
+    if (!server->key || !server->cert) return -1;
+
+    X509_set_version(server->cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(server->cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(server->cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(server->cert), 24 * 3600);
+    X509_set_pubkey(server->cert, server->key);
+    name = X509_get_subject_name(server->cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"127.0.0.1", -1, -1, 0);
+    X509_set_issuer_name(server->cert, name);
+
+    ext = X509V3_EXT_conf_nid(NULL, NULL, NID_basic_constraints, "critical,CA:TRUE");
+    if (!ext || X509_add_ext(server->cert, ext, -1) != 1) {
+        X509_EXTENSION_free(ext);
+        return -1;
+    }
+    X509_EXTENSION_free(ext);
+    return X509_sign(server->cert, server->key, EVP_sha256()) > 0 ? 0 : -1;
+}
+
+// Imagem, assinatura (RSA/SHA256, a mesma do `openssl dgst -sha256 -sign`) e manifesto
+static int prepare_content(MockServer *server, size_t image_size, const char *version) {
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    char hash[SHA256_DIGEST_LENGTH * 2 + 1];
+    EVP_MD_CTX *md_ctx;
+    int ret = -1;
+
+    server->image = malloc(image_size);
+    server->signature = malloc((size_t)EVP_PKEY_get_size(server->key));
+    md_ctx = EVP_MD_CTX_new();
+    if (!server->image || !server->signature || !md_ctx) goto cleanup;
+
+    fill_image(server->image, image_size);
+    server->image_size = image_size;
+    server->signature_size = (size_t)EVP_PKEY_get_size(server->key);
+    if (EVP_DigestSignInit(md_ctx, NULL, EVP_sha256(), NULL, server->key) != 1 ||
+        EVP_DigestSign(md_ctx, server->signature, &server->signature_size, server->image, image_size) != 1) {
+        goto cleanup;
+    }
+
+    SHA256(server->image, image_size, digest);
+    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) snprintf(hash + 2 * i, 3, "%02x", digest[i]);
+    server->manifest_len = (size_t)snprintf(server->manifest, sizeof(server->manifest),
+        "{\"version\": \"%s\", \"url\": \"https://127.0.0.1:%d/firmware.bin\", "
+        "\"signature_url\": \"https://127.0.0.1:%d/firmware.sig\", \"hash\": \"%s\", \"size\": %zu}",
+        version, server->port, server->port, hash, image_size);
+    ret = 0;
+
+cleanup:
+    EVP_MD_CTX_free(md_ctx);
+    return ret;
+}
+
+static int send_all(Connection *conn, const void *data, size_t len) {
+    const unsigned char *p = data;
+
+    while (len > 0) {
+        int n = SSL_write(conn->ssl, p, (int)(len < MOCK_SEND_BLOCK ? len : MOCK_SEND_BLOCK));
+
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lê até o fim do cabeçalho da próxima requisição (sobras ficam no buffer).
+ * @return size_t Tamanho do cabeçalho, ou 0 se a conexão fechou ou o cabeçalho é grande demais.
+ */
+static size_t read_request(Connection *conn) {
+    while (1) {
+        for (size_t i = 3; i < conn->used; i++) {
+            if (memcmp(conn->buffer + i - 3, "\r\n\r\n", 4) == 0) return i + 1;
+        }
+        if (conn->used == MOCK_HEADER_MAX) return 0;
+
+        int n = SSL_read(conn->ssl, conn->buffer + conn->used, (int)(MOCK_HEADER_MAX - conn->used));
+        if (n <= 0) return 0;
+        conn->used += (size_t)n;
+    }
+}
+
+// Range: bytes=<início>-[<fim>]; um Range inválido é ignorado (resposta 200)
+static int parse_range(const char *value, size_t size, size_t *start, size_t *end, int *unsatisfiable) {
+    char *p;
+
+    while (*value == ' ') value++;
+    if (strncmp(value, "bytes=", 6) != 0 || value[6] < '0' || value[6] > '9') return 0;
+    *start = (size_t)strtoull(value + 6, &p, 10);
+    if (*p != '-') return 0;
+    *end = p[1] >= '0' && p[1] <= '9' ? (size_t)strtoull(p + 1, NULL, 10) : size - 1;
+    if (*end >= size) *end = size - 1;
+    *unsatisfiable = *start >= size || *start > *end;
+    return 1;
+}
+
+/**
+ * @brief Atende uma requisição do buffer da conexão.
+ * @return int 0 para manter a conexão, -1 para fechá-la.
+ */
+static int handle_request(Connection *conn, size_t header_len) {
+    MockServer *server = conn->server;
+    char method[8] = "", path[256] = "", header[512];
+    const unsigned char *body = NULL;
+    const char *type = "application/octet-stream";
+    size_t body_len = 0, start = 0, end = 0, header_size;
+    int keep_alive = 1, ranged = 0, unsatisfiable = 0, head, ret = 0;
+    long long sent;
+
+    conn->buffer[header_len] = '\0';
+    sscanf(conn->buffer, "%7s %255s", method, path);
+    head = strcmp(method, "HEAD") == 0;
+
+    for (char *line = strstr(conn->buffer, "\r\n"); line && line[2] != '\r'; line = strstr(line + 2, "\r\n")) {
+        char *value = strchr(line + 2, ':');
+
+        if (!value) continue;
+        if (strncasecmp(line + 2, "Connection:", 11) == 0 && strncasecmp(value + 1, " close", 6) == 0) {
+            keep_alive = 0;
+        } else if (strncasecmp(line + 2, "Range:", 6) == 0 && strcmp(path, "/firmware.bin") == 0) {
+            ranged = parse_range(value + 1, server->image_size, &start, &end, &unsatisfiable);
+        }
+    }
+
+    if (strcmp(path, "/api/firmware/latest") == 0) {
+        body = (const unsigned char *)server->manifest;
+        body_len = server->manifest_len;
+        type = "application/json";
+    } else if (strcmp(path, "/firmware.bin") == 0) {
+        body = server->image;
+        body_len = server->image_size;
+    } else if (strcmp(path, "/firmware.sig") == 0) {
+        body = server->signature;
+        body_len = server->signature_size;
+    }
+
+    if (!head && strcmp(method, "GET") != 0) {
+        header_size = (size_t)snprintf(header, sizeof(header),
+            "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        body_len = 0;
+        keep_alive = 0;
+    } else if (!body) {
+        header_size = (size_t)snprintf(header, sizeof(header), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+        body_len = 0;
+    } else if (ranged && unsatisfiable) {
+        header_size = (size_t)snprintf(header, sizeof(header),
+            "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */%zu\r\nContent-Length: 0\r\n\r\n",
+            server->image_size);
+        body_len = 0;
+    } else if (ranged) {
+        header_size = (size_t)snprintf(header, sizeof(header),
+            "HTTP/1.1 206 Partial Content\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+            "Content-Range: bytes %zu-%zu/%zu\r\nAccept-Ranges: bytes\r\n\r\n",
+            type, end - start + 1, start, end, server->image_size);
+        body += start;
+        body_len = end - start + 1;
+    } else {
+        header_size = (size_t)snprintf(header, sizeof(header),
+            "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\nAccept-Ranges: bytes\r\n\r\n",
+            type, body_len);
+    }
+
+    sent = (long long)header_size;
+    if (send_all(conn, header, header_size) != 0) {
+        ret = -1;
+    } else if (!head && body_len > 0) {
+        if (send_all(conn, body, body_len) != 0) ret = -1;
+        sent += (long long)body_len;
+    }
+
+    pthread_mutex_lock(&server->lock);
+    server->requests++;
+    server->bytes_sent += sent;
+    pthread_mutex_unlock(&server->lock);
+
+    // A próxima requisição (se já chegou) vai para o início do buffer
+    conn->used -= header_len;
+    memmove(conn->buffer, conn->buffer + header_len, conn->used);
+    return ret == 0 && keep_alive ? 0 : -1;
+}
+
+static void *connection_thread(void *arg) {
+    Connection *conn = (Connection *)arg;
+    MockServer *server = conn->server;
+    size_t header_len;
+
+    conn->ssl = SSL_new(server->ssl_ctx);
+    if (conn->ssl && SSL_set_fd(conn->ssl, conn->fd) == 1 && SSL_accept(conn->ssl) == 1) {
+        while ((header_len = read_request(conn)) > 0 && handle_request(conn, header_len) == 0) {
+        }
+        SSL_shutdown(conn->ssl);
+    }
+    SSL_free(conn->ssl);
+    close(conn->fd);
+    free(conn);
+
+    pthread_mutex_lock(&server->lock);
+    if (--server->active == 0) pthread_cond_broadcast(&server->idle);
+    pthread_mutex_unlock(&server->lock);
+    return NULL;
+}
+
+static void *accept_thread(void *arg) {
+    MockServer *server = (MockServer *)arg;
+    struct timeval idle = { MOCK_IDLE_TIMEOUT_S, 0 };
+    pthread_attr_t attr;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, MOCK_THREAD_STACK);
+
+    while (!server->stop) {
+        pthread_t thread;
+        Connection *conn;
+        int fd = accept(server->listen_fd, NULL, NULL);
+
+        if (fd < 0) {
+            if (server->stop) break;
+            if (errno != EINTR) usleep(10000); // Ex: EMFILE: espera alguma conexão fechar
+            continue;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+        conn = calloc(1, sizeof(*conn));
+        if (!conn) {
+            close(fd);
+            continue;
+        }
+        conn->server = server;
+        conn->fd = fd;
+
+        pthread_mutex_lock(&server->lock);
+        server->active++;
+        server->connections++;
+        pthread_mutex_unlock(&server->lock);
+        if (pthread_create(&thread, &attr, connection_thread, conn) != 0) {
+            close(fd);
+            free(conn);
+            pthread_mutex_lock(&server->lock);
+            server->active--;
+            pthread_mutex_unlock(&server->lock);
+        }
+    }
+    pthread_attr_destroy(&attr);
+    return NULL;
+}
+
+static int open_listener(MockServer *server) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int one = 1;
+
+    server->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server->listen_fd < 0) return -1;
+    setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0; // Porta livre escolhida pelo sistema
+    if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, SOMAXCONN) != 0 ||
+        getsockname(server->listen_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        return -1;
+    }
+    server->port = ntohs(addr.sin_port);
+    return 0;
+}
+
+static void free_server(MockServer *server) {
+    if (server->listen_fd >= 0) close(server->listen_fd);
+    SSL_CTX_free(server->ssl_ctx);
+    X509_free(server->cert);
+    EVP_PKEY_free(server->key);
+    free(server->image);
+    free(server->signature);
+    pthread_cond_destroy(&server->idle);
+    pthread_mutex_destroy(&server->lock);
+}
+
+int mock_server_start(MockServer *server, size_t image_size, const char *version) {
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = -1;
+    pthread_mutex_init(&server->lock, NULL);
+    pthread_cond_init(&server->idle, NULL);
+
+    if (image_size == 0 || generate_credentials(server) != 0) {
+        fprintf(stderr, "Mock: falha ao gerar a chave e o certificado.\n");
+        goto error;
+    }
+    if (open_listener(server) != 0) {
+        perror("Mock: falha ao abrir a porta");
+        goto error;
+    }
+    if (prepare_content(server, image_size, version) != 0) {
+        fprintf(stderr, "Mock: falha ao preparar e assinar o firmware.\n");
+        goto error;
+    }
+
+    server->ssl_ctx = SSL_CTX_new(TLS_server_method());
+    if (!server->ssl_ctx || SSL_CTX_use_certificate(server->ssl_ctx, server->cert) != 1 ||
+        SSL_CTX_use_PrivateKey(server->ssl_ctx, server->key) != 1) {
+        fprintf(stderr, "Mock: falha ao configurar o TLS.\n");
+        goto error;
+    }
+    if (pthread_create(&server->acceptor, NULL, accept_thread, server) != 0) {
+        fprintf(stderr, "Mock: falha ao criar a thread de conexões.\n");
+        goto error;
+    }
+    return 0;
+
+error:
+    free_server(server);
+    return -1;
+}
+
+int mock_server_write_certificate(const MockServer *server, const char *path) {
+    FILE *fp = fopen(path, "w");
+    int ok;
+
+    if (!fp) {
+        fprintf(stderr, "Mock: não foi possível criar %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    ok = PEM_write_X509(fp, server->cert) == 1;
+    return fclose(fp) == 0 && ok ? 0 : -1;
+}
+
+void mock_server_stop(MockServer *server) {
+    server->stop = 1;
+    shutdown(server->listen_fd, SHUT_RDWR); // Acorda o accept
+    pthread_join(server->acceptor, NULL);
+
+    // As conexões ociosas fecham sozinhas em MOCK_IDLE_TIMEOUT_S
+    pthread_mutex_lock(&server->lock);
+    while (server->active > 0) pthread_cond_wait(&server->idle, &server->lock);
+    pthread_mutex_unlock(&server->lock);
+    free_server(server);
+}
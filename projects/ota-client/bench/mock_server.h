@@ -0,0 +1,59 @@
+#ifndef MOCK_SERVER_H
+#define MOCK_SERVER_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include <openssl/ssl.h>
+
+// Servidor OTA nativo para testes de carga: HTTPS (HTTP/1.1 com keep-alive), uma thread por
+// conexão, servindo o manifesto, o firmware (com Range) e a assinatura a partir da memória.
+// A chave RSA e o certificado são gerados na inicialização: o mesmo par serve ao TLS e à
+// assinatura do firmware, como no Servidor Mock em Python.
+#define MOCK_HEADER_MAX (16 * 1024)
+#define MOCK_SEND_BLOCK (64 * 1024)
+#define MOCK_THREAD_STACK (256 * 1024)   // Milhares de conexões simultâneas: pilhas pequenas
+
+typedef struct {
+    SSL_CTX *ssl_ctx;
+    EVP_PKEY *key;
+    X509 *cert;
+    int listen_fd;
+    int port;
+    pthread_t acceptor;
+    volatile int stop;
+    // Conteúdo servido
+    unsigned char *image;
+    size_t image_size;
+    unsigned char *signature;
+    size_t signature_size;
+    char manifest[1024];
+    size_t manifest_len;
+    // Estatísticas (protegidas por lock)
+    pthread_mutex_t lock;
+    pthread_cond_t idle;               // active chegou a 0
+    int active;                        // Conexões abertas
+    long connections;
+    long requests;
+    long long bytes_sent;
+} MockServer;
+
+/**
+ * @brief Gera a imagem, a chave e o certificado, e começa a aceitar conexões em 127.0.0.1.
+ * @param image_size Tamanho do firmware servido.
+ * @param version Versão anunciada no manifesto.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int mock_server_start(MockServer *server, size_t image_size, const char *version);
+
+/**
+ * @brief Grava o certificado do servidor (CA e chave pública confiáveis para o cliente).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int mock_server_write_certificate(const MockServer *server, const char *path);
+
+/**
+ * @brief Para de aceitar conexões, espera as abertas terminarem e libera o servidor.
+ */
+void mock_server_stop(MockServer *server);
+
+#endif // MOCK_SERVER_H
@@ -0,0 +1,120 @@
+"""Gera patches delta no formato aplicado pelo cliente OTA (src/delta_patch.h).
+
+Uso: python3 make_delta.py <imagem_atual> <nova_imagem> <saida.delta>
+
+O patch é uma sequência de operações COPY (trecho da imagem atual) e DATA (bytes novos).
+Os blocos alinhados da imagem atual são indexados; a nova imagem é percorrida procurando
+cada bloco no índice, e cada coincidência é estendida para frente e para trás. Trechos
+deslocados (inserções/remoções) são reencontrados em no máximo BLOCK_SIZE bytes.
+"""
+
+import struct
+import sys
+
+MAGIC = b"OTADELT1"
+OP_END = 0x00
+OP_COPY = 0x01
+OP_DATA = 0x02
+
+BLOCK_SIZE = 64            # Granularidade do índice da imagem atual
+MIN_COPY = 24              # Cópias menores custam mais que os próprios bytes (cabeçalho de 17)
+COMPARE_STEP = 4096        # Extensão das coincidências em blocos (comparação em C)
+
+
+def _extend_forward(old, new, o, n):
+    """Quantos bytes coincidem a partir de old[o] e new[n]."""
+    length = 0
+    while True:
+        a = old[o + length:o + length + COMPARE_STEP]
+        b = new[n + length:n + length + COMPARE_STEP]
+        if not a or not b:
+            return length
+        if a == b and len(a) == len(b):
+            length += len(a)
+            continue
+        limit = min(len(a), len(b))
+        i = 0
+        while i < limit and a[i] == b[i]:
+            i += 1
+        return length + i
+
+
+def make_delta(old, new):
+    """Retorna o patch (bytes) que transforma old em new."""
+    index = {}
+    for offset in range(0, len(old) - BLOCK_SIZE + 1, BLOCK_SIZE):
+        index.setdefault(old[offset:offset + BLOCK_SIZE], offset)
+
+    ops = []                 # (OP_COPY, offset, tamanho) ou (OP_DATA, início, fim) em new
+    literal_start = 0
+    n = 0
+    while n + BLOCK_SIZE <= len(new):
+        o = index.get(new[n:n + BLOCK_SIZE])
+        if o is None:
+            n += 1
+            continue
+
+        # Estende para trás sobre os bytes ainda não emitidos
+        back = 0
+        while back < n - literal_start and back < o and old[o - back - 1] == new[n - back - 1]:
+            back += 1
+        start_new, start_old = n - back, o - back
+        length = back + _extend_forward(old, new, o, n)
+        if length < MIN_COPY:
+            n += 1
+            continue
+
+        if start_new > literal_start:
+            ops.append((OP_DATA, literal_start, start_new))
+        ops.append((OP_COPY, start_old, length))
+        n = start_new + length
+        literal_start = n
+
+    if literal_start < len(new):
+        ops.append((OP_DATA, literal_start, len(new)))
+
+    out = bytearray(MAGIC + struct.pack("<QQ", len(old), len(new)))
+    for op in ops:
+        if op[0] == OP_COPY:
+            out += struct.pack("<BQQ", OP_COPY, op[1], op[2])
+        else:
+            out += struct.pack("<BQ", OP_DATA, op[2] - op[1])
+            out += new[op[1]:op[2]]
+    out.append(OP_END)
+    return bytes(out)
+
+
+def apply_delta(old, patch):
+    """Aplicação de referência (usada para validar o patch gerado)."""
+    assert patch[:8] == MAGIC
+    old_size, new_size = struct.unpack_from("<QQ", patch, 8)
+    assert old_size == len(old)
+    out = bytearray()
+    pos = 24
+    while patch[pos] != OP_END:
+        if patch[pos] == OP_COPY:
+            offset, length = struct.unpack_from("<QQ", patch, pos + 1)
+            out += old[offset:offset + length]
+            pos += 17
+        else:
+            (length,) = struct.unpack_from("<Q", patch, pos + 1)
+            out += patch[pos + 9:pos + 9 + length]
+            pos += 9 + length
+    assert len(out) == new_size
+    return bytes(out)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 4:
+        print(__doc__)
+        sys.exit(1)
+    with open(sys.argv[1], "rb") as f:
+        old_image = f.read()
+    with open(sys.argv[2], "rb") as f:
+        new_image = f.read()
+    patch = make_delta(old_image, new_image)
+    assert apply_delta(old_image, patch) == new_image
+    with open(sys.argv[3], "wb") as f:
+        f.write(patch)
+    print(f"Patch: {len(patch)} bytes ({len(new_image)} bytes na nova imagem, "
+          f"{100.0 * len(patch) / max(len(new_image), 1):.2f}%)")
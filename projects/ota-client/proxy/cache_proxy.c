@@ -0,0 +1,535 @@
+#include "content_store.h"
+#include "manifest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+// Proxy OTA da rede local: consulta o manifesto do upstream, baixa cada imagem nova uma única
+// vez, verifica hash e assinatura e a guarda pelo SHA256 (content_store). Os dispositivos da
+// rede local recebem um manifesto que aponta para o proxy e baixam a imagem dele, com Range e
+// sendfile (cópia zero: os bytes vão do page cache para o socket sem passar pelo processo).
+//
+//   ota_cache_proxy [-u manifesto do upstream] [-a endereço] [-p porta] [-d diretório do cache] [-k chaves confiáveis]
+//
+// O proxy serve HTTP sem TLS: com TLS, os bytes precisariam ser cifrados no processo e o
+// sendfile deixaria de ser possível (exceto com kTLS). A autenticidade das imagens não depende
+// do transporte: os dispositivos verificam o hash e a assinatura de cada uma, como antes. O
+// manifesto, porém, não é assinado: quem controla a rede local pode anunciar uma imagem antiga
+// (assinada) com um número de versão novo e fazer os dispositivos voltarem a ela. Por isso o
+// proxy deve atender só um segmento confiável (-a limita a escuta à interface desse segmento).
+#define PROXY_DEFAULT_UPSTREAM "https://127.0.0.1:8443/api/firmware/latest"
+#define PROXY_DEFAULT_ADDRESS "0.0.0.0"
+#define PROXY_DEFAULT_PORT 8080
+#define PROXY_DEFAULT_CACHE_DIR "ota_cache"
+#define PROXY_DEFAULT_TRUST "cert.pem"
+#define PROXY_MANIFEST_TTL_S 60          // O upstream é consultado no máximo uma vez por intervalo
+#define PROXY_RETRY_AFTER_S 60           // Resposta aos dispositivos enquanto a primeira imagem é baixada
+#define PROXY_HEADER_MAX (16 * 1024)
+#define PROXY_IDLE_TIMEOUT_S 30
+#define PROXY_THREAD_STACK (256 * 1024)
+#define PROXY_VERSION_MAX 64
+#define PROXY_URL_MAX 1024
+#define PROXY_HOST_MAX 256
+
+// Versão anunciada pelo upstream (cópia dos campos do manifesto usados pelo proxy)
+typedef struct {
+    int valid;
+    char version[PROXY_VERSION_MAX];
+    char hash[CONTENT_HASH_HEX + 1];
+    size_t size;
+    char url[PROXY_URL_MAX];
+    char signature_url[PROXY_URL_MAX];
+} Release;
+
+typedef struct {
+    const char *upstream_url;
+    int port;
+    ContentStore store;
+    pthread_mutex_t lock;
+    NetworkContext poll_net;   // Consultas ao manifesto (só quem marcou polling usa)
+    NetworkContext fetch_net;  // Download das imagens (só a thread de busca usa)
+    char etag[MANIFEST_ETAG_MAX];
+    time_t checked_at;
+    Release release;           // Última versão já armazenada: é a que os dispositivos recebem
+    Release pending;           // Versão sendo baixada (fetching = 1)
+    int fetching;
+    int polling;               // Uma consulta ao upstream em curso (fora do lock)
+} Proxy;
+
+typedef struct {
+    Proxy *proxy;
+    int fd;
+    char buffer[PROXY_HEADER_MAX + 1];
+    size_t used;
+} Connection;
+
+static volatile sig_atomic_t stop_requested;
+
+static void handle_stop(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+// Copia um campo do manifesto; falha se ele não existe ou não cabe
+static int copy_field(char *out, size_t out_size, const char *value) {
+    if (!value || strlen(value) >= out_size) return -1;
+    strcpy(out, value);
+    return 0;
+}
+
+/**
+ * @brief Lê a versão anunciada em um manifesto do upstream.
+ * @return int 0 em caso de sucesso, -1 se o manifesto é inválido ou incompleto.
+ */
+static int parse_release(char *response_json, Release *release) {
+    OtaManifest manifest;
+
+    memset(release, 0, sizeof(*release));
+    if (manifest_parse(response_json, strlen(response_json), &manifest) != 0 ||
+        copy_field(release->version, sizeof(release->version), manifest.version) != 0 ||
+        copy_field(release->hash, sizeof(release->hash), manifest.hash) != 0 ||
+        copy_field(release->url, sizeof(release->url), manifest.url) != 0 ||
+        copy_field(release->signature_url, sizeof(release->signature_url), manifest.signature_url) != 0) {
+        return -1;
+    }
+    // A versão é repetida no manifesto gerado pelo proxy: só caracteres que dispensam escape
+    for (const char *p = release->version; *p; p++) {
+        if (!strchr("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789.-+_~", *p)) return -1;
+    }
+    release->size = (size_t)manifest.size;
+    release->valid = 1;
+    return 0;
+}
+
+static void *fetch_thread(void *arg) {
+    Proxy *proxy = (Proxy *)arg;
+    Release *pending = &proxy->pending;
+    int ok = content_store_fetch(&proxy->store, &proxy->fetch_net, pending->hash, pending->size,
+                                 pending->url, pending->signature_url) == 0;
+
+    pthread_mutex_lock(&proxy->lock);
+    if (ok) {
+        proxy->release = *pending;
+        printf("Proxy: versão %s disponível para a rede local.\n", pending->version);
+    } else {
+        proxy->etag[0] = '\0'; // A próxima consulta relê o manifesto e tenta de novo
+    }
+    proxy->fetching = 0;
+    pthread_mutex_unlock(&proxy->lock);
+    return NULL;
+}
+
+/**
+ * @brief Versão a anunciar aos dispositivos. Consulta o upstream (If-None-Match) se a última
+ * consulta expirou; uma versão nova é baixada em segundo plano e, enquanto isso, os dispositivos
+ * continuam recebendo a anterior.
+ * @return int 0 se há uma versão armazenada, 1 se a primeira ainda está sendo buscada, -1 se não há nenhuma.
+ */
+static int current_release(Proxy *proxy, Release *release) {
+    time_t now = time(NULL);
+    char etag[MANIFEST_ETAG_MAX];
+    char *response_json = NULL;
+    Release candidate;
+    int polled, ret;
+
+    pthread_mutex_lock(&proxy->lock);
+    // Uma consulta por vez, feita fora do lock (pode levar até o timeout da rede): as outras
+    // conexões recebem a versão armazenada sem esperar o upstream
+    if (proxy->polling || proxy->fetching ||
+        (proxy->release.valid && now - proxy->checked_at < PROXY_MANIFEST_TTL_S)) {
+        *release = proxy->release;
+        ret = release->valid ? 0 : proxy->polling || proxy->fetching ? 1 : -1;
+        pthread_mutex_unlock(&proxy->lock);
+        return ret;
+    }
+    proxy->polling = 1;
+    proxy->checked_at = now;
+    memcpy(etag, proxy->etag, sizeof(etag));
+    pthread_mutex_unlock(&proxy->lock);
+
+    polled = check_version_if_modified(&proxy->poll_net, proxy->upstream_url, etag, sizeof(etag), &response_json);
+
+    pthread_mutex_lock(&proxy->lock);
+    proxy->polling = 0;
+    memcpy(proxy->etag, etag, sizeof(etag));
+    if (polled < 0) {
+        fprintf(stderr, "Proxy: falha ao consultar o upstream %s.\n", proxy->upstream_url);
+    } else if (polled == 0 && parse_release(response_json, &candidate) != 0) {
+        fprintf(stderr, "Proxy: manifesto do upstream inválido.\n");
+        proxy->etag[0] = '\0';
+    } else if (polled == 0 && proxy->release.valid && strcasecmp(candidate.hash, proxy->release.hash) == 0) {
+        proxy->release = candidate; // Mesma imagem (ex: URLs do upstream mudaram)
+    } else if (polled == 0) {
+        pthread_t thread;
+
+        proxy->pending = candidate;
+        proxy->fetching = 1;
+        if (pthread_create(&thread, NULL, fetch_thread, proxy) == 0) {
+            pthread_detach(thread);
+        } else {
+            proxy->fetching = 0;
+            proxy->etag[0] = '\0';
+        }
+    }
+    *release = proxy->release;
+    ret = release->valid ? 0 : proxy->fetching ? 1 : -1;
+    pthread_mutex_unlock(&proxy->lock);
+    free(response_json);
+    return ret;
+}
+
+static int send_all(int fd, const char *data, size_t len, int flags) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL | flags);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Cópia zero: o kernel envia o trecho do arquivo direto do page cache
+static int send_file(int fd, int file_fd, off_t offset, size_t len) {
+    while (len > 0) {
+        ssize_t n = sendfile(fd, file_fd, &offset, len);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lê até o fim do cabeçalho da próxima requisição (sobras ficam no buffer).
+ * @return size_t Tamanho do cabeçalho, ou 0 se a conexão fechou ou o cabeçalho é grande demais.
+ */
+static size_t read_request(Connection *conn) {
+    while (1) {
+        for (size_t i = 3; i < conn->used; i++) {
+            if (memcmp(conn->buffer + i - 3, "\r\n\r\n", 4) == 0) return i + 1;
+        }
+        if (conn->used == PROXY_HEADER_MAX) return 0;
+
+        ssize_t n = recv(conn->fd, conn->buffer + conn->used, PROXY_HEADER_MAX - conn->used, 0);
+        if (n <= 0) return 0;
+        conn->used += (size_t)n;
+    }
+}
+
+// Range: bytes=<início>-[<fim>]; um Range inválido é ignorado (resposta 200)
+static int parse_range(const char *value, size_t size, size_t *start, size_t *end, int *unsatisfiable) {
+    char *p;
+
+    while (*value == ' ') value++;
+    if (strncmp(value, "bytes=", 6) != 0 || value[6] < '0' || value[6] > '9') return 0;
+    *start = (size_t)strtoull(value + 6, &p, 10);
+    if (*p != '-') return 0;
+    *end = p[1] >= '0' && p[1] <= '9' ? (size_t)strtoull(p + 1, NULL, 10) : size - 1;
+    if (*end >= size) *end = size - 1;
+    *unsatisfiable = size == 0 || *start >= size || *start > *end;
+    return 1;
+}
+
+// Endereço do proxy nas URLs do manifesto: o Host pedido pelo dispositivo ou, sem ele, o
+// endereço local da conexão
+static void advertised_host(const Connection *conn, const char *host, char *out) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    size_t len = host ? strcspn(host, "\r") : 0;
+
+    if (len > 0 && len < PROXY_HOST_MAX && strspn(host, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                                      "0123456789.-:[]") == len) {
+        memcpy(out, host, len);
+        out[len] = '\0';
+    } else if (getsockname(conn->fd, (struct sockaddr *)&addr, &addr_len) == 0) {
+        char ip[INET_ADDRSTRLEN] = "127.0.0.1";
+
+        inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+        snprintf(out, PROXY_HOST_MAX, "%s:%d", ip, ntohs(addr.sin_port));
+    } else {
+        snprintf(out, PROXY_HOST_MAX, "127.0.0.1:%d", conn->proxy->port);
+    }
+}
+
+// Manifesto para a rede local: a imagem e a assinatura vêm do cache. Deltas, imagens comprimidas
+// e chunks do upstream não são repassados: na rede local a imagem completa é barata.
+static int send_manifest(Connection *conn, int head, const char *host, const char *if_none_match) {
+    char header[512], body[1024], server_host[PROXY_HOST_MAX], etag[40], lower_hash[CONTENT_HASH_HEX + 1];
+    size_t header_size, body_size;
+    Release release;
+    int state = current_release(conn->proxy, &release);
+
+    if (state > 0) {
+        header_size = (size_t)snprintf(header, sizeof(header),
+            "HTTP/1.1 503 Service Unavailable\r\nRetry-After: %d\r\nContent-Length: 0\r\n\r\n", PROXY_RETRY_AFTER_S);
+        return send_all(conn->fd, header, header_size, 0);
+    }
+    if (state < 0) {
+        header_size = (size_t)snprintf(header, sizeof(header), "HTTP/1.1 502 Bad Gateway\r\nContent-Length: 0\r\n\r\n");
+        return send_all(conn->fd, header, header_size, 0);
+    }
+
+    for (int i = 0; i <= CONTENT_HASH_HEX; i++) lower_hash[i] = (char)tolower((unsigned char)release.hash[i]);
+    // A imagem identifica o manifesto: o daemon dos dispositivos consulta com If-None-Match
+    snprintf(etag, sizeof(etag), "\"%.32s\"", lower_hash);
+    if (if_none_match && strncmp(if_none_match, etag, strlen(etag)) == 0) {
+        header_size = (size_t)snprintf(header, sizeof(header), "HTTP/1.1 304 Not Modified\r\nETag: %s\r\n\r\n", etag);
+        return send_all(conn->fd, header, header_size, 0);
+    }
+
+    advertised_host(conn, host, server_host);
+    body_size = (size_t)snprintf(body, sizeof(body),
+        "{\"version\": \"%s\", \"url\": \"http://%s/sha256/%s\", \"signature_url\": \"http://%s/sha256/%s.sig\", "
+        "\"hash\": \"%s\", \"size\": %zu}", release.version, server_host, lower_hash, server_host, lower_hash,
+        lower_hash, release.size);
+    header_size = (size_t)snprintf(header, sizeof(header),
+        "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %zu\r\nETag: %s\r\n\r\n",
+        body_size, etag);
+    if (send_all(conn->fd, header, header_size, head ? 0 : MSG_MORE) != 0) return -1;
+    return head ? 0 : send_all(conn->fd, body, body_size, 0);
+}
+
+// Imagem ou assinatura do cache (/sha256/<hash>[.sig]), com Range e sendfile
+static int send_object(Connection *conn, const char *name, int head, const char *range) {
+    char header[512], path[PATH_MAX];
+    const char *suffix = strlen(name) >= CONTENT_HASH_HEX ? name + CONTENT_HASH_HEX : NULL;
+    size_t header_size, size, length = 0, start = 0, end = 0;
+    int ranged = 0, unsatisfiable = 0, file_fd = -1, ret;
+    struct stat st;
+
+    if (suffix && (strcmp(suffix, "") == 0 || strcmp(suffix, ".sig") == 0)) {
+        char hash[CONTENT_HASH_HEX + 1];
+
+        memcpy(hash, name, CONTENT_HASH_HEX);
+        hash[CONTENT_HASH_HEX] = '\0';
+        if (content_store_path(&conn->proxy->store, hash, suffix, path) == 0) file_fd = open(path, O_RDONLY);
+    }
+    if (file_fd < 0 || fstat(file_fd, &st) != 0) {
+        if (file_fd >= 0) close(file_fd);
+        header_size = (size_t)snprintf(header, sizeof(header), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+        return send_all(conn->fd, header, header_size, 0);
+    }
+
+    size = (size_t)st.st_size;
+    if (range) ranged = parse_range(range, size, &start, &end, &unsatisfiable);
+    if (ranged && unsatisfiable) {
+        header_size = (size_t)snprintf(header, sizeof(header),
+            "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */%zu\r\nContent-Length: 0\r\n\r\n", size);
+    } else if (ranged) {
+        length = end - start + 1;
+        header_size = (size_t)snprintf(header, sizeof(header),
+            "HTTP/1.1 206 Partial Content\r\nContent-Type: application/octet-stream\r\nContent-Length: %zu\r\n"
+            "Content-Range: bytes %zu-%zu/%zu\r\nAccept-Ranges: bytes\r\n\r\n", length, start, end, size);
+    } else {
+        header_size = (size_t)snprintf(header, sizeof(header),
+            "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: %zu\r\n"
+            "Accept-Ranges: bytes\r\n\r\n", size);
+        length = size;
+    }
+
+    // MSG_MORE: o cabeçalho segue no mesmo segmento TCP que o início do arquivo
+    if (head) length = 0;
+    ret = send_all(conn->fd, header, header_size, length > 0 ? MSG_MORE : 0);
+    if (ret == 0 && length > 0) ret = send_file(conn->fd, file_fd, (off_t)start, length);
+    close(file_fd);
+    return ret;
+}
+
+/**
+ * @brief Atende uma requisição do buffer da conexão.
+ * @return int 0 para manter a conexão, -1 para fechá-la.
+ */
+static int handle_request(Connection *conn, size_t header_len) {
+    char method[8] = "", path[256] = "", header[128];
+    const char *range = NULL, *host = NULL, *if_none_match = NULL;
+    int keep_alive = 1, head, ret;
+
+    conn->buffer[header_len] = '\0';
+    sscanf(conn->buffer, "%7s %255s", method, path);
+    head = strcmp(method, "HEAD") == 0;
+
+    for (char *line = strstr(conn->buffer, "\r\n"); line && line[2] != '\r'; line = strstr(line + 2, "\r\n")) {
+        char *value = strchr(line + 2, ':');
+
+        if (!value) continue;
+        for (value++; *value == ' '; value++) {
+        }
+        if (strncasecmp(line + 2, "Connection:", 11) == 0 && strncasecmp(value, "close", 5) == 0) {
+            keep_alive = 0;
+        } else if (strncasecmp(line + 2, "Range:", 6) == 0) {
+            range = value;
+        } else if (strncasecmp(line + 2, "Host:", 5) == 0) {
+            host = value;
+        } else if (strncasecmp(line + 2, "If-None-Match:", 14) == 0) {
+            if_none_match = value;
+        }
+    }
+
+    if (!head && strcmp(method, "GET") != 0) {
+        size_t header_size = (size_t)snprintf(header, sizeof(header),
+            "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+
+        send_all(conn->fd, header, header_size, 0);
+        ret = -1;
+    } else if (strcmp(path, "/api/firmware/latest") == 0) {
+        ret = send_manifest(conn, head, host, if_none_match);
+    } else if (strncmp(path, "/sha256/", 8) == 0) {
+        ret = send_object(conn, path + 8, head, range);
+    } else {
+        size_t header_size = (size_t)snprintf(header, sizeof(header), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+
+        ret = send_all(conn->fd, header, header_size, 0);
+    }
+
+    // A próxima requisição (se já chegou) vai para o início do buffer
+    conn->used -= header_len;
+    memmove(conn->buffer, conn->buffer + header_len, conn->used);
+    return ret == 0 && keep_alive ? 0 : -1;
+}
+
+static void *connection_thread(void *arg) {
+    Connection *conn = (Connection *)arg;
+    size_t header_len;
+
+    while ((header_len = read_request(conn)) > 0 && handle_request(conn, header_len) == 0) {
+    }
+    close(conn->fd);
+    free(conn);
+    return NULL;
+}
+
+static int open_listener(const char *address, int port) {
+    struct sockaddr_in addr;
+    int one = 1, fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    if (inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+        fprintf(stderr, "Endereço de escuta inválido: %s\n", address);
+        errno = EINVAL;
+        return -1;
+    }
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Uso: %s [-u manifesto do upstream] [-a endereço] [-p porta] [-d diretório do cache]"
+            " [-k chaves confiáveis]\n", program);
+    fprintf(stderr, "        -a  endereço IPv4 de escuta: a interface do segmento dos dispositivos (padrão: %s)\n",
+            PROXY_DEFAULT_ADDRESS);
+}
+
+int main(int argc, char **argv) {
+    const char *cache_dir = PROXY_DEFAULT_CACHE_DIR, *trust_path = PROXY_DEFAULT_TRUST;
+    const char *address = PROXY_DEFAULT_ADDRESS;
+    struct timeval idle = { PROXY_IDLE_TIMEOUT_S, 0 };
+    struct sigaction action;
+    pthread_attr_t attr;
+    TrustStore trust;
+    Proxy proxy;
+    int listen_fd, opt;
+
+    memset(&proxy, 0, sizeof(proxy));
+    proxy.upstream_url = PROXY_DEFAULT_UPSTREAM;
+    proxy.port = PROXY_DEFAULT_PORT;
+    while ((opt = getopt(argc, argv, "u:a:p:d:k:")) != -1) {
+        switch (opt) {
+        case 'u': proxy.upstream_url = optarg; break;
+        case 'a': address = optarg; break;
+        case 'p': proxy.port = atoi(optarg); break;
+        case 'd': cache_dir = optarg; break;
+        case 'k': trust_path = optarg; break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind < argc || proxy.port <= 0 || proxy.port > 65535) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // Sem SA_RESTART: o sinal interrompe o accept
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+    signal(SIGPIPE, SIG_IGN); // sendfile para um dispositivo que fechou a conexão
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    if (trust_store_load(&trust, trust_path) != 0) return 1;
+    if (content_store_init(&proxy.store, cache_dir, &trust) != 0 || network_context_init(&proxy.poll_net) != 0) {
+        trust_store_free(&trust);
+        return 1;
+    }
+    if (network_context_init(&proxy.fetch_net) != 0) {
+        network_context_cleanup(&proxy.poll_net);
+        trust_store_free(&trust);
+        return 1;
+    }
+    pthread_mutex_init(&proxy.lock, NULL);
+
+    listen_fd = open_listener(address, proxy.port);
+    if (listen_fd < 0) {
+        perror("Erro ao abrir a porta do proxy");
+        return 1;
+    }
+    printf("Proxy OTA em http://%s:%d/api/firmware/latest (upstream: %s, cache: %s)\n", address, proxy.port,
+           proxy.upstream_url, cache_dir);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, PROXY_THREAD_STACK);
+    while (!stop_requested) {
+        pthread_t thread;
+        Connection *conn;
+        int fd = accept(listen_fd, NULL, NULL);
+
+        if (fd < 0) {
+            if (errno != EINTR) usleep(10000); // Ex: EMFILE: espera alguma conexão fechar
+            continue;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+        conn = calloc(1, sizeof(*conn));
+        if (!conn) {
+            close(fd);
+            continue;
+        }
+        conn->proxy = &proxy;
+        conn->fd = fd;
+        if (pthread_create(&thread, &attr, connection_thread, conn) != 0) {
+            close(fd);
+            free(conn);
+        }
+    }
+
+    // Conexões e a busca em andamento terminam junto com o processo: o cache só publica
+    // imagens completas e verificadas
+    printf("Proxy OTA encerrado.\n");
+    pthread_attr_destroy(&attr);
+    close(listen_fd);
+    return 0;
+}
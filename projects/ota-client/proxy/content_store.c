@@ -0,0 +1,185 @@
+#include "content_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Imagem sendo baixada do upstream: cada bloco vai para o arquivo temporário e para o verificador
+typedef struct {
+    int fd;
+    FirmwareVerifier verifier;
+    size_t position;
+} FetchTarget;
+
+int content_store_init(ContentStore *store, const char *root, const TrustStore *trust) {
+    memset(store, 0, sizeof(*store));
+    if (strlen(root) >= sizeof(store->root) - CONTENT_HASH_HEX - 16) {
+        fprintf(stderr, "Diretório do cache muito longo: %s\n", root);
+        return -1;
+    }
+    if (mkdir(root, 0755) != 0 && errno != EEXIST) {
+        perror("Erro ao criar o diretório do cache");
+        return -1;
+    }
+    strcpy(store->root, root);
+    store->trust = trust;
+    pthread_mutex_init(&store->lock, NULL);
+    return 0;
+}
+
+int content_store_path(const ContentStore *store, const char *hash, const char *suffix, char *path) {
+    char name[CONTENT_HASH_HEX + 1];
+    int n;
+
+    if (strlen(hash) != CONTENT_HASH_HEX) return -1;
+    for (int i = 0; i < CONTENT_HASH_HEX; i++) {
+        if (!isxdigit((unsigned char)hash[i])) return -1;
+        name[i] = (char)tolower((unsigned char)hash[i]);
+    }
+    name[CONTENT_HASH_HEX] = '\0';
+    n = snprintf(path, PATH_MAX, "%s/%s%s", store->root, name, suffix);
+    if (n < 0 || n >= PATH_MAX) {
+        fprintf(stderr, "Cache: caminho muito longo no diretório %s.\n", store->root);
+        return -1;
+    }
+    return 0;
+}
+
+static int write_all(int fd, const unsigned char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int fetch_sink(const unsigned char *data, size_t len, size_t offset, void *userdata) {
+    FetchTarget *target = (FetchTarget *)userdata;
+
+    // Range ignorado numa retomada: o arquivo recomeça do zero
+    if (offset == 0 && target->position > 0) {
+        if (firmware_verifier_reset(&target->verifier) != 0 || ftruncate(target->fd, 0) != 0 ||
+            lseek(target->fd, 0, SEEK_SET) != 0) {
+            return -1;
+        }
+        target->position = 0;
+    }
+    if (offset != target->position) return -1;
+    if (write_all(target->fd, data, len) != 0) {
+        perror("Erro ao gravar a imagem no cache");
+        return -1;
+    }
+    target->position += len;
+    return firmware_verifier_update(&target->verifier, data, len);
+}
+
+// Grava a assinatura com arquivo temporário, fsync e rename
+static int publish_signature(const char *path, const DownloadBuffer *signature) {
+    char tmp_path[PATH_MAX + 8];
+    int fd, ret = -1;
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.part", path);
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    if (write_all(fd, signature->data, signature->size) == 0 && fsync(fd) == 0) ret = 0;
+    close(fd);
+    if (ret == 0 && rename(tmp_path, path) != 0) ret = -1;
+    if (ret != 0) unlink(tmp_path);
+    return ret;
+}
+
+// Os renames só são duráveis depois do fsync do diretório
+static void sync_store_dir(const ContentStore *store) {
+    int fd = open(store->root, O_RDONLY | O_DIRECTORY);
+
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/**
+ * @brief Baixa e verifica a imagem; só publica os arquivos se hash e assinatura conferem.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+static int fetch_verified(ContentStore *store, NetworkContext *net, const char *hash, size_t size,
+                          const char *image_url, const char *signature_url,
+                          const char *image_path, const char *signature_path)
+{
+    char part_path[PATH_MAX + 8];
+    DownloadBuffer signature = {0};
+    FetchTarget target;
+    int ret = -1;
+
+    memset(&target, 0, sizeof(target));
+    snprintf(part_path, sizeof(part_path), "%s.part", image_path);
+    target.fd = open(part_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (target.fd < 0) {
+        perror("Erro ao criar a imagem no cache");
+        return -1;
+    }
+    if (firmware_verifier_init(&target.verifier, store->trust) != 0) goto cleanup;
+
+    printf("Cache: baixando do upstream a imagem %s...\n", hash);
+    if (download_firmware(net, signature_url, &signature) != 0 ||
+        download_firmware_stream(net, image_url, 0, fetch_sink, &target) != 0) {
+        fprintf(stderr, "Cache: falha ao baixar a imagem %s do upstream.\n", hash);
+        goto cleanup;
+    }
+    if (size > 0 && target.position != size) {
+        fprintf(stderr, "Cache: imagem com %zu bytes; o manifesto anuncia %zu.\n", target.position, size);
+        goto cleanup;
+    }
+    if (firmware_verifier_final(&target.verifier, hash, signature.data, signature.size) != 1) {
+        fprintf(stderr, "Cache: imagem %s rejeitada na verificação.\n", hash);
+        goto cleanup;
+    }
+
+    // A imagem é publicada por último: sua presença indica que a assinatura também está lá
+    if (fsync(target.fd) != 0 || publish_signature(signature_path, &signature) != 0 ||
+        rename(part_path, image_path) != 0) {
+        perror("Erro ao publicar a imagem no cache");
+        goto cleanup;
+    }
+    sync_store_dir(store);
+    printf("Cache: imagem %s verificada e armazenada (%zu bytes).\n", hash, target.position);
+    ret = 0;
+
+cleanup:
+    firmware_verifier_free(&target.verifier);
+    close(target.fd);
+    if (ret != 0) unlink(part_path);
+    if (signature.data) free(signature.data);
+    return ret;
+}
+
+int content_store_fetch(ContentStore *store, NetworkContext *net, const char *hash, size_t size,
+                        const char *image_url, const char *signature_url)
+{
+    char image_path[PATH_MAX], signature_path[PATH_MAX];
+    int ret = 0;
+
+    if (content_store_path(store, hash, "", image_path) != 0 ||
+        content_store_path(store, hash, ".sig", signature_path) != 0) {
+        fprintf(stderr, "Cache: hash inválido no manifesto: %s\n", hash);
+        return -1;
+    }
+
+    // Quem chega durante uma busca espera por ela e encontra a imagem já armazenada
+    pthread_mutex_lock(&store->lock);
+    if (access(image_path, R_OK) != 0 || access(signature_path, R_OK) != 0) {
+        ret = fetch_verified(store, net, hash, size, image_url, signature_url, image_path, signature_path);
+    }
+    pthread_mutex_unlock(&store->lock);
+    return ret;
+}
@@ -0,0 +1,46 @@
+#ifndef CONTENT_STORE_H
+#define CONTENT_STORE_H
+
+#include <limits.h>
+#include <pthread.h>
+#include "network_manager.h"
+#include "security_manager.h"
+
+// Armazenamento endereçado por conteúdo do proxy: cada imagem é guardada com o nome do seu
+// SHA256 (<raiz>/<hash>, assinatura em <raiz>/<hash>.sig). Uma imagem só entra no
+// armazenamento depois de verificada (hash e assinatura), então o que está lá pode ser servido
+// sem nova verificação, e versões iguais anunciadas por URLs diferentes ocupam um único arquivo.
+#define CONTENT_HASH_HEX (SHA256_HASH_SIZE * 2)
+
+typedef struct {
+    char root[PATH_MAX];
+    const TrustStore *trust;
+    pthread_mutex_t lock;      // Uma busca no upstream por vez: pedidos simultâneos esperam por ela
+} ContentStore;
+
+/**
+ * @brief Prepara o armazenamento (cria o diretório raiz, se necessário).
+ * @param trust Chaves confiáveis para a assinatura das imagens (devem viver tanto quanto o armazenamento).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int content_store_init(ContentStore *store, const char *root, const TrustStore *trust);
+
+/**
+ * @brief Monta o caminho de um objeto do armazenamento.
+ * @param hash SHA256 em hex (maiúsculas ou minúsculas; o nome usa minúsculas).
+ * @param suffix "" para a imagem, ".sig" para a assinatura.
+ * @return int 0 em caso de sucesso, -1 se o hash não é um SHA256 em hex ou o caminho não cabe em PATH_MAX.
+ */
+int content_store_path(const ContentStore *store, const char *hash, const char *suffix, char *path);
+
+/**
+ * @brief Garante que a imagem está no armazenamento: se ainda não está, baixa a assinatura e a
+ * imagem do upstream, verifica as duas e só então publica os arquivos (rename atômico).
+ * @param net Contexto de rede do upstream (nenhuma outra thread pode usá-lo durante a chamada).
+ * @param size Tamanho anunciado no manifesto (0 = não informado).
+ * @return int 0 se a imagem está disponível, -1 em caso de falha (nada é publicado).
+ */
+int content_store_fetch(ContentStore *store, NetworkContext *net, const char *hash, size_t size,
+                        const char *image_url, const char *signature_url);
+
+#endif // CONTENT_STORE_H
@@ -0,0 +1,258 @@
+#include "chunk_verifier.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+
+enum {
+    CHUNK_PENDING = 0,         // Ainda faltam bytes
+    CHUNK_QUEUED,              // Completo, na fila ou sendo verificado
+    CHUNK_VALID,
+    CHUNK_INVALID
+};
+
+static uint64_t read_u64_le(const unsigned char *p) {
+    uint64_t value = 0;
+
+    for (int i = 7; i >= 0; i--) value = (value << 8) | p[i];
+    return value;
+}
+
+static uint32_t read_u32_le(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+int chunk_list_parse(const unsigned char *data, size_t len, ChunkList *list) {
+    uint64_t expected_count;
+
+    if (len < CHUNK_LIST_HEADER_SIZE || memcmp(data, CHUNK_LIST_MAGIC, 8) != 0) {
+        fprintf(stderr, "Lista de chunks: cabeçalho inválido.\n");
+        return -1;
+    }
+    list->image_size = read_u64_le(data + 8);
+    list->chunk_size = read_u32_le(data + 16);
+    list->count = read_u32_le(data + 20);
+    list->digests = data + CHUNK_LIST_HEADER_SIZE;
+
+    if (list->chunk_size == 0 || list->image_size == 0) {
+        fprintf(stderr, "Lista de chunks: tamanhos inválidos.\n");
+        return -1;
+    }
+    expected_count = (list->image_size + list->chunk_size - 1) / list->chunk_size;
+    if (expected_count != list->count ||
+        len - CHUNK_LIST_HEADER_SIZE != (size_t)list->count * SHA256_HASH_SIZE) {
+        fprintf(stderr, "Lista de chunks: %u chunks não cobrem uma imagem de %llu bytes.\n",
+                list->count, (unsigned long long)list->image_size);
+        return -1;
+    }
+    return 0;
+}
+
+void chunk_list_write_header(unsigned char *out, uint64_t image_size, uint32_t chunk_size, uint32_t count) {
+    memcpy(out, CHUNK_LIST_MAGIC, 8);
+    for (int i = 0; i < 8; i++) out[8 + i] = (unsigned char)(image_size >> (8 * i));
+    for (int i = 0; i < 4; i++) out[16 + i] = (unsigned char)(chunk_size >> (8 * i));
+    for (int i = 0; i < 4; i++) out[20 + i] = (unsigned char)(count >> (8 * i));
+}
+
+static size_t chunk_length(const ChunkList *list, uint32_t index) {
+    uint64_t start = (uint64_t)index * list->chunk_size;
+    uint64_t left = list->image_size - start;
+
+    return left < list->chunk_size ? (size_t)left : list->chunk_size;
+}
+
+// Relê o chunk do destino e compara seu SHA256 com o da lista
+static int chunk_matches(ChunkVerifier *cv, EVP_MD_CTX *md_ctx, unsigned char *block, uint32_t index) {
+    unsigned char digest[SHA256_HASH_SIZE];
+    unsigned int digest_len = 0;
+    off_t offset = (off_t)index * cv->list.chunk_size;
+    size_t left = chunk_length(&cv->list, index);
+
+    if (EVP_DigestInit_ex(md_ctx, EVP_sha256(), NULL) != 1) return 0;
+    while (left > 0) {
+        ssize_t n = pread(cv->fd, block, left < CHUNK_VERIFY_BLOCK ? left : CHUNK_VERIFY_BLOCK, offset);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            fprintf(stderr, "Erro ao reler o chunk %u: %s\n", index, n < 0 ? strerror(errno) : "arquivo curto");
+            return 0;
+        }
+        if (EVP_DigestUpdate(md_ctx, block, (size_t)n) != 1) return 0;
+        offset += n;
+        left -= (size_t)n;
+    }
+    if (EVP_DigestFinal_ex(md_ctx, digest, &digest_len) != 1 || digest_len != SHA256_HASH_SIZE) return 0;
+    return memcmp(digest, cv->list.digests + (size_t)index * SHA256_HASH_SIZE, SHA256_HASH_SIZE) == 0;
+}
+
+static void *verify_worker(void *arg) {
+    ChunkVerifier *cv = (ChunkVerifier *)arg;
+    EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+    unsigned char *block = malloc(CHUNK_VERIFY_BLOCK);
+
+    pthread_mutex_lock(&cv->lock);
+    while (1) {
+        uint32_t index;
+        int valid;
+
+        while (!cv->stop && cv->queue_len == 0) pthread_cond_wait(&cv->work, &cv->lock);
+        if (cv->stop) break;
+        index = cv->queue[cv->queue_head];
+        cv->queue_head = (cv->queue_head + 1) % cv->list.count;
+        cv->queue_len--;
+        pthread_mutex_unlock(&cv->lock);
+
+        // O hash é calculado fora do lock: as threads verificam chunks diferentes ao mesmo tempo
+        valid = md_ctx && block && chunk_matches(cv, md_ctx, block, index);
+
+        pthread_mutex_lock(&cv->lock);
+        cv->status[index] = valid ? CHUNK_VALID : CHUNK_INVALID;
+        if (valid) {
+            cv->verified++;
+        } else {
+            cv->bad++;
+        }
+        if (--cv->outstanding == 0) pthread_cond_broadcast(&cv->idle);
+    }
+    pthread_mutex_unlock(&cv->lock);
+
+    free(block);
+    EVP_MD_CTX_free(md_ctx);
+    return NULL;
+}
+
+int chunk_verifier_init(ChunkVerifier *cv, const ChunkList *list, int fd) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cores < 1 ? 1 : cores > CHUNK_VERIFY_THREADS ? CHUNK_VERIFY_THREADS : (int)cores;
+
+    memset(cv, 0, sizeof(*cv));
+    cv->list = *list;
+    cv->fd = fd;
+    cv->received = calloc(list->count, sizeof(uint32_t));
+    cv->status = calloc(list->count, 1);
+    cv->queue = calloc(list->count, sizeof(uint32_t));
+    if (!cv->received || !cv->status || !cv->queue) {
+        fprintf(stderr, "Falha ao alocar o estado dos chunks.\n");
+        free(cv->received);
+        free(cv->status);
+        free(cv->queue);
+        return -1;
+    }
+    pthread_mutex_init(&cv->lock, NULL);
+    pthread_cond_init(&cv->work, NULL);
+    pthread_cond_init(&cv->idle, NULL);
+
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&cv->threads[i], NULL, verify_worker, cv) != 0) break;
+        cv->thread_count++;
+    }
+    if (cv->thread_count == 0) {
+        fprintf(stderr, "Falha ao criar as threads de verificação.\n");
+        chunk_verifier_free(cv);
+        return -1;
+    }
+    return 0;
+}
+
+int chunk_verifier_received(ChunkVerifier *cv, size_t offset, size_t len) {
+    int ret = 0;
+
+    if (offset > cv->list.image_size || len > cv->list.image_size - offset) {
+        fprintf(stderr, "Firmware maior que o tamanho do manifesto (%llu bytes).\n",
+                (unsigned long long)cv->list.image_size);
+        return -1;
+    }
+
+    pthread_mutex_lock(&cv->lock);
+    while (len > 0) {
+        uint32_t index = (uint32_t)(offset / cv->list.chunk_size);
+        size_t in_chunk = cv->list.chunk_size - offset % cv->list.chunk_size;
+        size_t take = len < in_chunk ? len : in_chunk;
+        size_t total = chunk_length(&cv->list, index);
+
+        if (cv->status[index] != CHUNK_PENDING || cv->received[index] + take > total) {
+            fprintf(stderr, "Chunk %u recebido em duplicidade.\n", index);
+            ret = -1;
+            break;
+        }
+        cv->received[index] += (uint32_t)take;
+        if (cv->received[index] == total) {
+            cv->status[index] = CHUNK_QUEUED;
+            cv->queue[(cv->queue_head + cv->queue_len) % cv->list.count] = index;
+            cv->queue_len++;
+            cv->outstanding++;
+            pthread_cond_signal(&cv->work);
+        }
+        offset += take;
+        len -= take;
+    }
+    // Aborto antecipado: vários chunks inválidos indicam uma imagem errada, não um erro pontual
+    if (cv->bad > CHUNK_MAX_BAD) {
+        fprintf(stderr, "%u chunks inválidos: download abortado.\n", cv->bad);
+        ret = -1;
+    }
+    pthread_mutex_unlock(&cv->lock);
+    return ret;
+}
+
+uint32_t chunk_verifier_wait(ChunkVerifier *cv) {
+    uint32_t bad;
+
+    pthread_mutex_lock(&cv->lock);
+    while (cv->outstanding > 0) pthread_cond_wait(&cv->idle, &cv->lock);
+    bad = cv->bad;
+    pthread_mutex_unlock(&cv->lock);
+    return bad;
+}
+
+int chunk_verifier_rearm(ChunkVerifier *cv, uint32_t index, size_t *offset, size_t *length) {
+    int rearmed = 0;
+
+    pthread_mutex_lock(&cv->lock);
+    if (index < cv->list.count && cv->status[index] == CHUNK_INVALID) {
+        cv->status[index] = CHUNK_PENDING;
+        cv->received[index] = 0;
+        cv->bad--;
+        *offset = (size_t)index * cv->list.chunk_size;
+        *length = chunk_length(&cv->list, index);
+        rearmed = 1;
+    }
+    pthread_mutex_unlock(&cv->lock);
+    return rearmed;
+}
+
+int chunk_verifier_complete(ChunkVerifier *cv) {
+    return chunk_verifier_wait(cv) == 0 && cv->verified == cv->list.count;
+}
+
+void chunk_verifier_reset(ChunkVerifier *cv) {
+    chunk_verifier_wait(cv);
+    pthread_mutex_lock(&cv->lock);
+    memset(cv->received, 0, cv->list.count * sizeof(uint32_t));
+    memset(cv->status, CHUNK_PENDING, cv->list.count);
+    cv->verified = 0;
+    cv->bad = 0;
+    pthread_mutex_unlock(&cv->lock);
+}
+
+void chunk_verifier_free(ChunkVerifier *cv) {
+    pthread_mutex_lock(&cv->lock);
+    cv->stop = 1;
+    pthread_cond_broadcast(&cv->work);
+    pthread_mutex_unlock(&cv->lock);
+    for (int i = 0; i < cv->thread_count; i++) pthread_join(cv->threads[i], NULL);
+
+    pthread_cond_destroy(&cv->idle);
+    pthread_cond_destroy(&cv->work);
+    pthread_mutex_destroy(&cv->lock);
+    free(cv->received);
+    free(cv->status);
+    free(cv->queue);
+    cv->received = NULL;
+    cv->status = NULL;
+    cv->queue = NULL;
+    cv->thread_count = 0;
+}
@@ -0,0 +1,107 @@
+#ifndef CHUNK_VERIFIER_H
+#define CHUNK_VERIFIER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "security_manager.h"
+
+// Manifesto em chunks (árvore de Merkle de dois níveis): a imagem é dividida em chunks de
+// tamanho fixo e a lista com o SHA256 de cada um é assinada. A lista é a raiz: uma assinatura
+// válida sobre ela autentica todos os chunks, então cada chunk é verificado assim que termina
+// de chegar (em qualquer ordem, em várias threads) e um chunk corrompido é baixado de novo
+// sozinho, sem esperar o fim da imagem nem repetir o download inteiro.
+//
+// Formato da lista (inteiros little-endian):
+//   "OTACHNK1" | u64 tamanho da imagem | u32 tamanho do chunk | u32 número de chunks
+//   | SHA256 de cada chunk (32 bytes cada, em ordem)
+#define CHUNK_LIST_MAGIC "OTACHNK1"
+#define CHUNK_LIST_HEADER_SIZE 24
+#define CHUNK_VERIFY_THREADS 4          // Máximo de threads de verificação (limitado aos núcleos)
+#define CHUNK_VERIFY_BLOCK (64 * 1024)  // Leitura dos chunks gravados
+#define CHUNK_MAX_BAD 4                 // Mais chunks inválidos que isso: a fonte está errada, aborta
+
+typedef struct {
+    uint64_t image_size;
+    uint32_t chunk_size;
+    uint32_t count;
+    const unsigned char *digests;  // count * SHA256_HASH_SIZE bytes, dentro da lista baixada
+} ChunkList;
+
+typedef struct {
+    ChunkList list;
+    int fd;                        // Destino do firmware (os chunks são relidos com pread)
+    uint32_t *received;            // Bytes já gravados de cada chunk
+    unsigned char *status;         // Estado de cada chunk (pendente, na fila, válido, inválido)
+    uint32_t *queue;               // Chunks completos aguardando verificação (fila circular)
+    uint32_t queue_head;
+    uint32_t queue_len;
+    uint32_t verified;
+    uint32_t bad;
+    uint32_t outstanding;          // Na fila ou sendo verificados
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t work;           // Há chunks na fila (ou stop)
+    pthread_cond_t idle;           // outstanding chegou a 0
+    pthread_t threads[CHUNK_VERIFY_THREADS];
+    int thread_count;
+} ChunkVerifier;
+
+/**
+ * @brief Valida a estrutura da lista de chunks (a assinatura é verificada pelo chamador).
+ * @param list Aponta para dentro de data, que deve continuar alocado.
+ * @return int 0 em caso de sucesso, -1 se a lista é inválida.
+ */
+int chunk_list_parse(const unsigned char *data, size_t len, ChunkList *list);
+
+/**
+ * @brief Grava o cabeçalho da lista (CHUNK_LIST_HEADER_SIZE bytes), para remontar a forma
+ * assinada de uma lista recebida embutida no manifesto.
+ */
+void chunk_list_write_header(unsigned char *out, uint64_t image_size, uint32_t chunk_size, uint32_t count);
+
+/**
+ * @brief Inicia as threads de verificação sobre o destino do firmware.
+ * @param fd Destino onde os chunks são gravados (aberto para leitura).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int chunk_verifier_init(ChunkVerifier *cv, const ChunkList *list, int fd);
+
+/**
+ * @brief Registra bytes gravados no destino; chunks completos entram na fila de verificação.
+ * @return int 0 em caso de sucesso, -1 se os bytes estão fora da imagem ou se já há mais de
+ * CHUNK_MAX_BAD chunks inválidos (o download deve ser abortado).
+ */
+int chunk_verifier_received(ChunkVerifier *cv, size_t offset, size_t len);
+
+/**
+ * @brief Espera a verificação de todos os chunks já completos.
+ * @return uint32_t Número de chunks inválidos.
+ */
+uint32_t chunk_verifier_wait(ChunkVerifier *cv);
+
+/**
+ * @brief Se o chunk é inválido, volta-o a pendente para ser baixado de novo.
+ * @param offset Início do chunk na imagem.
+ * @param length Tamanho do chunk.
+ * @return int 1 se o chunk foi rearmado, 0 se ele não estava inválido.
+ */
+int chunk_verifier_rearm(ChunkVerifier *cv, uint32_t index, size_t *offset, size_t *length);
+
+/**
+ * @brief Indica se todos os chunks foram recebidos e verificados.
+ * @return int 1 se a imagem inteira é válida, 0 caso contrário.
+ */
+int chunk_verifier_complete(ChunkVerifier *cv);
+
+/**
+ * @brief Descarta o progresso (o download recomeçou do byte 0).
+ */
+void chunk_verifier_reset(ChunkVerifier *cv);
+
+/**
+ * @brief Encerra as threads e libera o estado.
+ */
+void chunk_verifier_free(ChunkVerifier *cv);
+
+#endif // CHUNK_VERIFIER_H
@@ -0,0 +1,120 @@
+#include "decompressor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int compression_from_name(const char *name, CompressionType *type) {
+    if (!name || strcmp(name, "none") == 0) {
+        *type = COMPRESSION_NONE;
+    } else if (strcmp(name, "xz") == 0) {
+        *type = COMPRESSION_XZ;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static const char *lzma_error_message(lzma_ret ret) {
+    switch (ret) {
+    case LZMA_MEMLIMIT_ERROR: return "janela de compressão maior que o limite de memória";
+    case LZMA_FORMAT_ERROR:   return "não é um arquivo xz";
+    case LZMA_OPTIONS_ERROR:  return "opções de compressão não suportadas";
+    case LZMA_DATA_ERROR:     return "dados corrompidos";
+    case LZMA_BUF_ERROR:      return "fluxo truncado";
+    case LZMA_MEM_ERROR:      return "sem memória";
+    default:                  return "erro interno";
+    }
+}
+
+static int start_decoder(Decompressor *dec) {
+    lzma_stream init = LZMA_STREAM_INIT;
+    lzma_ret ret;
+
+    dec->strm = init;
+    dec->finished = 0;
+    ret = lzma_stream_decoder(&dec->strm, DECOMPRESS_MEMLIMIT, 0);
+    if (ret != LZMA_OK) {
+        fprintf(stderr, "Erro ao iniciar a descompressão xz: %s\n", lzma_error_message(ret));
+        return -1;
+    }
+    return 0;
+}
+
+int decompressor_init(Decompressor *dec, CompressionType type, DecompressorOutput output, void *userdata) {
+    memset(dec, 0, sizeof(*dec));
+    dec->type = type;
+    dec->output = output;
+    dec->userdata = userdata;
+    if (type == COMPRESSION_NONE) return 0;
+
+    dec->out_buffer = malloc(DECOMPRESS_CHUNK_SIZE);
+    if (!dec->out_buffer) {
+        fprintf(stderr, "Falha ao alocar o buffer de descompressão.\n");
+        return -1;
+    }
+    if (start_decoder(dec) != 0) {
+        free(dec->out_buffer);
+        dec->out_buffer = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int decompressor_reset(Decompressor *dec) {
+    if (dec->type == COMPRESSION_NONE) return 0;
+    lzma_end(&dec->strm);
+    return start_decoder(dec);
+}
+
+int decompressor_feed(Decompressor *dec, const unsigned char *data, size_t len) {
+    if (dec->type == COMPRESSION_NONE) return dec->output(data, len, dec->userdata);
+    if (len == 0) return 0;
+    if (dec->finished) {
+        fprintf(stderr, "Descompressão: dados após o fim do fluxo xz.\n");
+        return -1;
+    }
+
+    dec->strm.next_in = data;
+    dec->strm.avail_in = len;
+    do {
+        lzma_ret ret;
+        size_t produced;
+
+        dec->strm.next_out = dec->out_buffer;
+        dec->strm.avail_out = DECOMPRESS_CHUNK_SIZE;
+        ret = lzma_code(&dec->strm, LZMA_RUN);
+        produced = DECOMPRESS_CHUNK_SIZE - dec->strm.avail_out;
+
+        if (ret != LZMA_OK && ret != LZMA_STREAM_END) {
+            fprintf(stderr, "Erro na descompressão xz: %s\n", lzma_error_message(ret));
+            return -1;
+        }
+        if (produced > 0 && dec->output(dec->out_buffer, produced, dec->userdata) != 0) return -1;
+        if (ret == LZMA_STREAM_END) {
+            dec->finished = 1;
+            if (dec->strm.avail_in > 0) {
+                fprintf(stderr, "Descompressão: dados após o fim do fluxo xz.\n");
+                return -1;
+            }
+            break;
+        }
+        // Buffer de saída cheio: pode haver mais saída pendente mesmo sem entrada nova
+    } while (dec->strm.avail_in > 0 || dec->strm.avail_out == 0);
+
+    return 0;
+}
+
+int decompressor_finish(const Decompressor *dec) {
+    if (dec->type != COMPRESSION_NONE && !dec->finished) {
+        fprintf(stderr, "Descompressão: fluxo xz truncado.\n");
+        return -1;
+    }
+    return 0;
+}
+
+void decompressor_free(Decompressor *dec) {
+    if (dec->type != COMPRESSION_NONE) lzma_end(&dec->strm);
+    free(dec->out_buffer);
+    dec->out_buffer = NULL;
+    dec->type = COMPRESSION_NONE;
+}
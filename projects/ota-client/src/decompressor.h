@@ -0,0 +1,70 @@
+#ifndef DECOMPRESSOR_H
+#define DECOMPRESSOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <lzma.h>
+
+// Descompressão em streaming entre a rede e as etapas de gravação/verificação. A memória é
+// limitada: um buffer de saída fixo mais a janela (dicionário) do xz, que o decodificador
+// recusa se passar de DECOMPRESS_MEMLIMIT (imagens devem ser comprimidas com dicionário
+// pequeno, ex: xz --lzma2=preset=6,dict=1MiB).
+#define DECOMPRESS_CHUNK_SIZE (64 * 1024)
+#define DECOMPRESS_MEMLIMIT (8 * 1024 * 1024)
+
+typedef enum {
+    COMPRESSION_NONE = 0,
+    COMPRESSION_XZ
+} CompressionType;
+
+/**
+ * @brief Destino dos bytes descomprimidos (em ordem).
+ * @return int 0 para continuar, -1 para abortar.
+ */
+typedef int (*DecompressorOutput)(const unsigned char *data, size_t len, void *userdata);
+
+typedef struct {
+    CompressionType type;
+    lzma_stream strm;
+    int finished;              // Fim do fluxo comprimido alcançado
+    DecompressorOutput output;
+    void *userdata;
+    unsigned char *out_buffer;
+} Decompressor;
+
+/**
+ * @brief Converte o nome anunciado no manifesto ("xz", "none").
+ * @return int 0 se o formato é suportado, -1 caso contrário.
+ */
+int compression_from_name(const char *name, CompressionType *type);
+
+/**
+ * @brief Prepara a descompressão.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int decompressor_init(Decompressor *dec, CompressionType type, DecompressorOutput output, void *userdata);
+
+/**
+ * @brief Recomeça do início do fluxo comprimido (o download foi reiniciado).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int decompressor_reset(Decompressor *dec);
+
+/**
+ * @brief Descomprime um bloco recebido, entregando a saída em pedaços de até DECOMPRESS_CHUNK_SIZE.
+ * @return int 0 em caso de sucesso, -1 se os dados são inválidos ou o destino falhou.
+ */
+int decompressor_feed(Decompressor *dec, const unsigned char *data, size_t len);
+
+/**
+ * @brief Confirma que o fluxo comprimido terminou por completo.
+ * @return int 0 em caso de sucesso, -1 se está truncado.
+ */
+int decompressor_finish(const Decompressor *dec);
+
+/**
+ * @brief Libera o estado do decodificador.
+ */
+void decompressor_free(Decompressor *dec);
+
+#endif // DECOMPRESSOR_H
@@ -0,0 +1,193 @@
+#include "delta_patch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define DELTA_OP_END  0x00
+#define DELTA_OP_COPY 0x01
+#define DELTA_OP_DATA 0x02
+
+enum {
+    DELTA_STATE_HEADER,        // Esperando o cabeçalho
+    DELTA_STATE_OP,            // Esperando o próximo cabeçalho de operação
+    DELTA_STATE_DATA,          // Repassando os bytes de uma operação DATA
+    DELTA_STATE_DONE           // END recebido
+};
+
+static uint64_t read_u64_le(const unsigned char *p) {
+    uint64_t value = 0;
+
+    for (int i = 7; i >= 0; i--) value = (value << 8) | p[i];
+    return value;
+}
+
+int delta_patcher_init(DeltaPatcher *patcher, const char *old_image_path, uint64_t old_size,
+                       DeltaOutput output, void *userdata)
+{
+    struct stat st;
+
+    memset(patcher, 0, sizeof(*patcher));
+    patcher->output = output;
+    patcher->userdata = userdata;
+
+    patcher->old_fd = open(old_image_path, O_RDONLY | O_CLOEXEC);
+    if (patcher->old_fd < 0) {
+        fprintf(stderr, "Delta: não foi possível abrir a imagem atual (%s): %s\n",
+                old_image_path, strerror(errno));
+        return -1;
+    }
+    patcher->old_size = old_size;
+    if (old_size == 0) {
+        // Partições não têm st_size, e o fim do dispositivo não é o fim da imagem
+        if (fstat(patcher->old_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            fprintf(stderr, "Delta: tamanho da imagem atual desconhecido (%s).\n", old_image_path);
+            delta_patcher_free(patcher);
+            return -1;
+        }
+        patcher->old_size = (uint64_t)st.st_size;
+    }
+
+    patcher->copy_buffer = malloc(DELTA_COPY_BLOCK);
+    if (!patcher->copy_buffer) {
+        fprintf(stderr, "Delta: falha ao alocar o buffer de cópia.\n");
+        delta_patcher_free(patcher);
+        return -1;
+    }
+    delta_patcher_reset(patcher);
+    return 0;
+}
+
+void delta_patcher_reset(DeltaPatcher *patcher) {
+    patcher->state = DELTA_STATE_HEADER;
+    patcher->pending_len = 0;
+    patcher->pending_need = DELTA_HEADER_SIZE;
+    patcher->written = 0;
+    patcher->new_size = 0;
+    patcher->data_left = 0;
+}
+
+// Copia um trecho da imagem atual para a saída, em blocos do buffer fixo
+static int apply_copy(DeltaPatcher *patcher, uint64_t offset, uint64_t length) {
+    if (offset > patcher->old_size || length > patcher->old_size - offset ||
+        length > patcher->new_size - patcher->written) {
+        fprintf(stderr, "Delta: COPY fora dos limites (offset %llu, tamanho %llu).\n",
+                (unsigned long long)offset, (unsigned long long)length);
+        return -1;
+    }
+
+    while (length > 0) {
+        size_t want = length < DELTA_COPY_BLOCK ? (size_t)length : DELTA_COPY_BLOCK;
+        ssize_t n = pread(patcher->old_fd, patcher->copy_buffer, want, (off_t)offset);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            fprintf(stderr, "Delta: erro ao ler a imagem atual: %s\n", n < 0 ? strerror(errno) : "arquivo curto");
+            return -1;
+        }
+        if (patcher->output(patcher->copy_buffer, (size_t)n, patcher->userdata) != 0) return -1;
+        offset += (uint64_t)n;
+        length -= (uint64_t)n;
+        patcher->written += (uint64_t)n;
+    }
+    return 0;
+}
+
+// Executa o cabeçalho ou a operação completa em pending
+static int process_pending(DeltaPatcher *patcher) {
+    const unsigned char *p = patcher->pending;
+
+    if (patcher->state == DELTA_STATE_HEADER) {
+        if (memcmp(p, DELTA_MAGIC, 8) != 0) {
+            fprintf(stderr, "Delta: cabeçalho inválido.\n");
+            return -1;
+        }
+        if (read_u64_le(p + 8) != patcher->old_size) {
+            fprintf(stderr, "Delta: patch gerado para outra imagem (tamanho %llu, atual %llu).\n",
+                    (unsigned long long)read_u64_le(p + 8), (unsigned long long)patcher->old_size);
+            return -1;
+        }
+        patcher->new_size = read_u64_le(p + 16);
+        patcher->state = DELTA_STATE_OP;
+        return 0;
+    }
+
+    switch (p[0]) {
+    case DELTA_OP_COPY:
+        return apply_copy(patcher, read_u64_le(p + 1), read_u64_le(p + 9));
+    case DELTA_OP_DATA:
+        patcher->data_left = read_u64_le(p + 1);
+        if (patcher->data_left > patcher->new_size - patcher->written) {
+            fprintf(stderr, "Delta: DATA ultrapassa o tamanho da nova imagem.\n");
+            return -1;
+        }
+        if (patcher->data_left > 0) patcher->state = DELTA_STATE_DATA;
+        return 0;
+    case DELTA_OP_END:
+        patcher->state = DELTA_STATE_DONE;
+        return 0;
+    default:
+        fprintf(stderr, "Delta: operação desconhecida (0x%02x).\n", p[0]);
+        return -1;
+    }
+}
+
+int delta_patcher_feed(DeltaPatcher *patcher, const unsigned char *data, size_t len) {
+    while (len > 0) {
+        size_t take;
+
+        if (patcher->state == DELTA_STATE_DONE) {
+            fprintf(stderr, "Delta: dados após o fim do patch.\n");
+            return -1;
+        }
+
+        // Bytes literais vão direto do buffer da rede para a saída
+        if (patcher->state == DELTA_STATE_DATA) {
+            take = patcher->data_left < len ? (size_t)patcher->data_left : len;
+            if (patcher->output(data, take, patcher->userdata) != 0) return -1;
+            patcher->written += take;
+            patcher->data_left -= take;
+            if (patcher->data_left == 0) patcher->state = DELTA_STATE_OP;
+            data += take;
+            len -= take;
+            continue;
+        }
+
+        // O tamanho de uma operação depende do seu primeiro byte
+        if (patcher->state == DELTA_STATE_OP && patcher->pending_len == 0) {
+            patcher->pending_need = data[0] == DELTA_OP_COPY ? 17 : data[0] == DELTA_OP_DATA ? 9 : 1;
+        }
+
+        take = patcher->pending_need - patcher->pending_len;
+        if (take > len) take = len;
+        memcpy(patcher->pending + patcher->pending_len, data, take);
+        patcher->pending_len += take;
+        data += take;
+        len -= take;
+
+        if (patcher->pending_len == patcher->pending_need) {
+            patcher->pending_len = 0;
+            if (process_pending(patcher) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+int delta_patcher_finish(const DeltaPatcher *patcher) {
+    if (patcher->state != DELTA_STATE_DONE || patcher->written != patcher->new_size) {
+        fprintf(stderr, "Delta: patch incompleto (%llu de %llu bytes reconstruídos).\n",
+                (unsigned long long)patcher->written, (unsigned long long)patcher->new_size);
+        return -1;
+    }
+    return 0;
+}
+
+void delta_patcher_free(DeltaPatcher *patcher) {
+    if (patcher->old_fd >= 0) close(patcher->old_fd);
+    free(patcher->copy_buffer);
+    patcher->old_fd = -1;
+    patcher->copy_buffer = NULL;
+}
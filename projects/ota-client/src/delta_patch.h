@@ -0,0 +1,75 @@
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Patch delta em streaming: o novo firmware é reconstruído a partir da imagem atual e de uma
+// sequência de operações que chega pela rede. Diferente do bsdiff (três fluxos separados),
+// cada operação traz seus dados logo em seguida, então o patch é aplicado à medida que é
+// baixado, lendo a imagem atual por pread() e sem carregar nenhuma das imagens na RAM.
+//
+// Formato (inteiros little-endian):
+//   Cabeçalho: "OTADELT1" | u64 tamanho da imagem atual | u64 tamanho da nova imagem
+//   0x01 COPY: u64 offset | u64 tamanho   -> copia bytes da imagem atual
+//   0x02 DATA: u64 tamanho | bytes        -> bytes novos, copiados como estão
+//   0x00 END                              -> fim do patch
+#define DELTA_MAGIC "OTADELT1"
+#define DELTA_HEADER_SIZE 24
+#define DELTA_COPY_BLOCK (16 * 1024)   // Buffer fixo para as leituras da imagem atual
+
+/**
+ * @brief Destino dos bytes reconstruídos (em ordem, a partir do byte 0 da nova imagem).
+ * @return int 0 para continuar, -1 para abortar.
+ */
+typedef int (*DeltaOutput)(const unsigned char *data, size_t len, void *userdata);
+
+typedef struct {
+    int old_fd;                // Imagem atual (partição em uso)
+    uint64_t old_size;         // Tamanho da imagem, não da partição que a contém
+    uint64_t new_size;         // Declarado no cabeçalho
+    uint64_t written;          // Bytes da nova imagem já produzidos
+    uint64_t data_left;        // Bytes restantes da operação DATA corrente
+    int state;
+    unsigned char pending[DELTA_HEADER_SIZE]; // Cabeçalho ou operação recebidos pela metade
+    size_t pending_len;
+    size_t pending_need;
+    DeltaOutput output;
+    void *userdata;
+    unsigned char *copy_buffer;
+} DeltaPatcher;
+
+/**
+ * @brief Prepara a aplicação de um patch sobre a imagem atual.
+ * @param old_image_path Imagem atual (arquivo ou partição).
+ * @param old_size Tamanho da imagem atual; 0 = o tamanho do arquivo. Numa partição o fim do
+ * dispositivo não é o fim da imagem, então o tamanho precisa ser informado.
+ * @param output Recebe os bytes da nova imagem.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int delta_patcher_init(DeltaPatcher *patcher, const char *old_image_path, uint64_t old_size,
+                       DeltaOutput output, void *userdata);
+
+/**
+ * @brief Recomeça do início do patch (o download foi reiniciado).
+ */
+void delta_patcher_reset(DeltaPatcher *patcher);
+
+/**
+ * @brief Processa um bloco do patch (blocos podem cortar operações em qualquer ponto).
+ * @return int 0 em caso de sucesso, -1 se o patch é inválido ou o destino falhou.
+ */
+int delta_patcher_feed(DeltaPatcher *patcher, const unsigned char *data, size_t len);
+
+/**
+ * @brief Confirma que o patch terminou (END) e produziu exatamente a nova imagem.
+ * @return int 0 em caso de sucesso, -1 se o patch está incompleto.
+ */
+int delta_patcher_finish(const DeltaPatcher *patcher);
+
+/**
+ * @brief Libera o buffer e fecha a imagem atual.
+ */
+void delta_patcher_free(DeltaPatcher *patcher);
+
+#endif // DELTA_PATCH_H
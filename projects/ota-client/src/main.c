@@ -1,19 +1,54 @@
 #include "ota_client.h"
+#include "ota_daemon.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 // Para testes, o servidor precisa expor um endpoint que retorne um JSON no formato:
 // {"version": "1.1.0", "url": "https://seu-servidor.com/firmware/v1.1.0.bin", "hash": "a228f411..."}
 // E um arquivo binário de firmware na URL.
 
-#define CURRENT_FIRMWARE_VERSION "1.0.0" 
+#define CURRENT_FIRMWARE_VERSION "1.0.0"
 // URL de exemplo (use HTTPS para segurança real)
 #define VERSION_CHECK_ENDPOINT "https://127.0.0.1:8443/api/firmware/latest"
 
-int main() {
+static void usage(const char *program) {
+    fprintf(stderr, "Uso: %s                     atualização única, em primeiro plano\n", program);
+    fprintf(stderr, "     %s -d [-i segundos] [-r KB/s] [-w HH:MM-HH:MM[,...]]\n", program);
+    fprintf(stderr, "        -d  modo daemon: consulta o manifesto periodicamente e baixa em segundo plano\n");
+    fprintf(stderr, "        -i  intervalo máximo entre consultas (padrão: %d s)\n", OTA_DAEMON_POLL_INTERVAL_S);
+    fprintf(stderr, "        -r  limite de banda do download (padrão: sem limite)\n");
+    fprintf(stderr, "        -w  janelas diárias de download, hora local (padrão: qualquer horário)\n");
+}
+
+int main(int argc, char **argv) {
+    OtaDaemonConfig daemon_config;
+    int daemon_mode = 0, opt;
+
+    ota_daemon_config_init(&daemon_config, VERSION_CHECK_ENDPOINT, CURRENT_FIRMWARE_VERSION);
+    while ((opt = getopt(argc, argv, "di:r:w:")) != -1) {
+        switch (opt) {
+        case 'd': daemon_mode = 1; break;
+        case 'i': daemon_config.poll_interval_s = atoi(optarg); break;
+        case 'r': daemon_config.max_recv_speed = atoll(optarg) * 1024; break;
+        case 'w':
+            if (ota_daemon_parse_windows(&daemon_config, optarg) != 0) return 2;
+            break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind < argc || daemon_config.poll_interval_s <= 0 || daemon_config.max_recv_speed < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
     printf("Cliente de Atualização OTA para Linux Embarcado\n");
     printf("----------------------------------------------\n");
 
+    if (daemon_mode) {
+        return ota_daemon_run(&daemon_config) == 0 ? 0 : 1;
+    }
+
     // Exemplo de uso:
     int result = perform_ota_update(VERSION_CHECK_ENDPOINT, CURRENT_FIRMWARE_VERSION);
 
@@ -0,0 +1,432 @@
+#include "manifest.h"
+#include <stdio.h>
+#include <string.h>
+
+#define DIGEST_SIZE 32                 // SHA256
+
+typedef enum {
+    FIELD_STRING,
+    FIELD_U64,
+    FIELD_U32
+} FieldType;
+
+// Campo conhecido de um objeto: nome da chave e onde o valor é gravado
+typedef struct {
+    const char *name;
+    size_t offset;
+    FieldType type;
+} FieldSpec;
+
+static const FieldSpec manifest_fields[] = {
+    { "version",              offsetof(OtaManifest, version),              FIELD_STRING },
+    { "url",                  offsetof(OtaManifest, url),                  FIELD_STRING },
+    { "signature_url",        offsetof(OtaManifest, signature_url),        FIELD_STRING },
+    { "hash",                 offsetof(OtaManifest, hash),                 FIELD_STRING },
+    { "size",                 offsetof(OtaManifest, size),                 FIELD_U64 },
+    { "compression",          offsetof(OtaManifest, compression),          FIELD_STRING },
+    { "compressed_url",       offsetof(OtaManifest, compressed_url),       FIELD_STRING },
+    { "chunks_url",           offsetof(OtaManifest, chunks_url),           FIELD_STRING },
+    { "chunks_signature_url", offsetof(OtaManifest, chunks_signature_url), FIELD_STRING },
+    { "chunk_size",           offsetof(OtaManifest, chunk_size),           FIELD_U32 },
+};
+
+static const FieldSpec delta_fields[] = {
+    { "from",        offsetof(ManifestDelta, from),        FIELD_STRING },
+    { "url",         offsetof(ManifestDelta, url),         FIELD_STRING },
+    { "compression", offsetof(ManifestDelta, compression), FIELD_STRING },
+};
+
+static const FieldSpec component_fields[] = {
+    { "name",          offsetof(ManifestComponent, name),          FIELD_STRING },
+    { "version",       offsetof(ManifestComponent, version),       FIELD_STRING },
+    { "url",           offsetof(ManifestComponent, url),           FIELD_STRING },
+    { "signature_url", offsetof(ManifestComponent, signature_url), FIELD_STRING },
+    { "hash",          offsetof(ManifestComponent, hash),          FIELD_STRING },
+    { "size",          offsetof(ManifestComponent, size),          FIELD_U64 },
+};
+
+#define FIELD_COUNT(fields) (sizeof(fields) / sizeof((fields)[0]))
+
+typedef struct {
+    char *start;
+    char *p;                           // Próximo caractere a ler
+    char *end;
+    const char *error;                 // Primeiro erro encontrado
+    ManifestDelta legacy_delta;        // delta_from / delta_url / delta_compression
+} ManifestParser;
+
+typedef int (*MemberHandler)(ManifestParser *parser, const char *key, void *target);
+typedef int (*ElementHandler)(ManifestParser *parser, void *target);
+
+static int fail(ManifestParser *parser, const char *message) {
+    if (!parser->error) parser->error = message;
+    return -1;
+}
+
+static void skip_whitespace(ManifestParser *parser) {
+    while (parser->p < parser->end &&
+           (*parser->p == ' ' || *parser->p == '\t' || *parser->p == '\n' || *parser->p == '\r')) {
+        parser->p++;
+    }
+}
+
+// Consome o caractere esperado (após espaços)
+static int expect(ManifestParser *parser, char c) {
+    skip_whitespace(parser);
+    if (parser->p >= parser->end || *parser->p != c) return fail(parser, "caractere inesperado");
+    parser->p++;
+    return 0;
+}
+
+// Consome c se for o próximo caractere (após espaços)
+static int accept(ManifestParser *parser, char c) {
+    skip_whitespace(parser);
+    if (parser->p < parser->end && *parser->p == c) {
+        parser->p++;
+        return 1;
+    }
+    return 0;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int read_hex4(const char *p, unsigned *value) {
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hex_value(p[i]);
+        if (digit < 0) return -1;
+        *value = (*value << 4) | (unsigned)digit;
+    }
+    return 0;
+}
+
+// Grava o code point em UTF-8; a saída nunca passa da entrada (\uXXXX tem 6 bytes, o UTF-8 até 3)
+static char *write_utf8(char *out, unsigned cp) {
+    if (cp < 0x80) {
+        *out++ = (char)cp;
+    } else if (cp < 0x800) {
+        *out++ = (char)(0xC0 | (cp >> 6));
+        *out++ = (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *out++ = (char)(0xE0 | (cp >> 12));
+        *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = (char)(0x80 | (cp & 0x3F));
+    } else {
+        *out++ = (char)(0xF0 | (cp >> 18));
+        *out++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+        *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = (char)(0x80 | (cp & 0x3F));
+    }
+    return out;
+}
+
+/**
+ * @brief Lê uma string JSON decodificando-a no próprio buffer: a saída é escrita por cima da
+ * entrada (nunca à frente dela) e termina com NUL.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+static int parse_string(ManifestParser *parser, char **value, size_t *len) {
+    char *out;
+
+    if (expect(parser, '"') != 0) return fail(parser, "string esperada");
+    *value = out = parser->p;
+
+    while (parser->p < parser->end) {
+        char c = *parser->p++;
+
+        if (c == '"') {
+            *out = '\0';
+            *len = (size_t)(out - *value);
+            return 0;
+        }
+        if ((unsigned char)c < 0x20) return fail(parser, "caractere de controle em string");
+        if (c != '\\') {
+            *out++ = c;
+            continue;
+        }
+
+        if (parser->p >= parser->end) break;
+        c = *parser->p++;
+        switch (c) {
+        case '"': case '\\': case '/': *out++ = c; break;
+        case 'b': *out++ = '\b'; break;
+        case 'f': *out++ = '\f'; break;
+        case 'n': *out++ = '\n'; break;
+        case 'r': *out++ = '\r'; break;
+        case 't': *out++ = '\t'; break;
+        case 'u': {
+            unsigned cp, low;
+
+            if (parser->end - parser->p < 4 || read_hex4(parser->p, &cp) != 0) {
+                return fail(parser, "escape \\u inválido");
+            }
+            parser->p += 4;
+            // Par substituto (UTF-16): \uD8xx\uDCxx vira um único code point
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                if (parser->end - parser->p < 6 || parser->p[0] != '\\' || parser->p[1] != 'u' ||
+                    read_hex4(parser->p + 2, &low) != 0 || low < 0xDC00 || low > 0xDFFF) {
+                    return fail(parser, "par substituto incompleto");
+                }
+                parser->p += 6;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                return fail(parser, "par substituto incompleto");
+            }
+            out = write_utf8(out, cp);
+            break;
+        }
+        default:
+            return fail(parser, "escape inválido");
+        }
+    }
+    return fail(parser, "string não terminada");
+}
+
+static int parse_u64(ManifestParser *parser, uint64_t *value) {
+    uint64_t result = 0;
+    char *digits;
+
+    skip_whitespace(parser);
+    digits = parser->p;
+    while (parser->p < parser->end && *parser->p >= '0' && *parser->p <= '9') {
+        unsigned digit = (unsigned)(*parser->p - '0');
+
+        if (result > (UINT64_MAX - digit) / 10) return fail(parser, "número muito grande");
+        result = result * 10 + digit;
+        parser->p++;
+    }
+    if (parser->p == digits) return fail(parser, "número inteiro esperado");
+    *value = result;
+    return 0;
+}
+
+static int skip_value(ManifestParser *parser, int depth);
+
+// Percorre os membros de um objeto, entregando cada valor ao handler
+static int parse_object(ManifestParser *parser, MemberHandler handler, void *target) {
+    if (expect(parser, '{') != 0) return fail(parser, "objeto esperado");
+    if (accept(parser, '}')) return 0;
+
+    do {
+        char *key;
+        size_t key_len;
+
+        if (parse_string(parser, &key, &key_len) != 0 || expect(parser, ':') != 0) return -1;
+        if (handler(parser, key, target) != 0) return -1;
+    } while (accept(parser, ','));
+
+    return expect(parser, '}');
+}
+
+// Percorre os elementos de um array
+static int parse_array(ManifestParser *parser, ElementHandler handler, void *target) {
+    if (expect(parser, '[') != 0) return fail(parser, "array esperado");
+    if (accept(parser, ']')) return 0;
+
+    do {
+        if (handler(parser, target) != 0) return -1;
+    } while (accept(parser, ','));
+
+    return expect(parser, ']');
+}
+
+// Consome um valor sem interpretá-lo (chaves desconhecidas)
+static int skip_value(ManifestParser *parser, int depth) {
+    char *text;
+    size_t len;
+
+    if (depth > MANIFEST_MAX_DEPTH) return fail(parser, "aninhamento excessivo");
+    skip_whitespace(parser);
+    if (parser->p >= parser->end) return fail(parser, "valor esperado");
+
+    switch (*parser->p) {
+    case '"':
+        return parse_string(parser, &text, &len);
+    case '{':
+        parser->p++;
+        if (accept(parser, '}')) return 0;
+        do {
+            if (parse_string(parser, &text, &len) != 0 || expect(parser, ':') != 0 ||
+                skip_value(parser, depth + 1) != 0) {
+                return -1;
+            }
+        } while (accept(parser, ','));
+        return expect(parser, '}');
+    case '[':
+        parser->p++;
+        if (accept(parser, ']')) return 0;
+        do {
+            if (skip_value(parser, depth + 1) != 0) return -1;
+        } while (accept(parser, ','));
+        return expect(parser, ']');
+    default:
+        // Número ou literal (true, false, null)
+        text = parser->p;
+        while (parser->p < parser->end &&
+               (strchr("+-.eE", *parser->p) || (*parser->p >= '0' && *parser->p <= '9') ||
+                (*parser->p >= 'a' && *parser->p <= 'z'))) {
+            parser->p++;
+        }
+        return parser->p == text ? fail(parser, "valor inválido") : 0;
+    }
+}
+
+// Grava o valor se a chave for um dos campos conhecidos; retorna 1 se consumiu o valor
+static int parse_known_field(ManifestParser *parser, const char *key, void *target,
+                             const FieldSpec *fields, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        char *field = (char *)target + fields[i].offset;
+        uint64_t number;
+        char *text;
+        size_t len;
+
+        if (strcmp(key, fields[i].name) != 0) continue;
+        switch (fields[i].type) {
+        case FIELD_STRING:
+            if (parse_string(parser, &text, &len) != 0) return -1;
+            *(const char **)field = text;
+            return 1;
+        case FIELD_U64:
+            if (parse_u64(parser, &number) != 0) return -1;
+            *(uint64_t *)field = number;
+            return 1;
+        case FIELD_U32:
+            if (parse_u64(parser, &number) != 0) return -1;
+            if (number > UINT32_MAX) return fail(parser, "número muito grande");
+            *(uint32_t *)field = (uint32_t)number;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int parse_fields(ManifestParser *parser, const char *key, void *target,
+                        const FieldSpec *fields, size_t count)
+{
+    int found = parse_known_field(parser, key, target, fields, count);
+
+    if (found < 0) return -1;
+    return found ? 0 : skip_value(parser, 0);
+}
+
+static int delta_member(ManifestParser *parser, const char *key, void *target) {
+    return parse_fields(parser, key, target, delta_fields, FIELD_COUNT(delta_fields));
+}
+
+static int component_member(ManifestParser *parser, const char *key, void *target) {
+    return parse_fields(parser, key, target, component_fields, FIELD_COUNT(component_fields));
+}
+
+static int delta_element(ManifestParser *parser, void *target) {
+    OtaManifest *manifest = (OtaManifest *)target;
+    ManifestDelta extra;
+
+    // Entradas além da capacidade são lidas e descartadas
+    if (manifest->delta_count == MANIFEST_MAX_DELTAS) {
+        memset(&extra, 0, sizeof(extra));
+        return parse_object(parser, delta_member, &extra);
+    }
+    return parse_object(parser, delta_member, &manifest->deltas[manifest->delta_count++]);
+}
+
+static int component_element(ManifestParser *parser, void *target) {
+    OtaManifest *manifest = (OtaManifest *)target;
+    ManifestComponent extra;
+
+    if (manifest->component_count == MANIFEST_MAX_COMPONENTS) {
+        memset(&extra, 0, sizeof(extra));
+        return parse_object(parser, component_member, &extra);
+    }
+    return parse_object(parser, component_member, &manifest->components[manifest->component_count++]);
+}
+
+/**
+ * @brief Lê "chunk_digests" (array de hashes em hex) convertendo cada hash para binário a
+ * partir da posição do '[': cada entrada ocupa ao menos 66 bytes de texto e produz 32, então a
+ * escrita nunca alcança o texto ainda não lido.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+static int parse_chunk_digests(ManifestParser *parser, OtaManifest *manifest) {
+    unsigned char *out;
+
+    skip_whitespace(parser);
+    if (parser->p >= parser->end || *parser->p != '[') return fail(parser, "lista de hashes esperada");
+    out = (unsigned char *)parser->p++;
+    manifest->chunk_digests = out;
+    manifest->chunk_count = 0;
+    if (accept(parser, ']')) return 0;
+
+    do {
+        char *hex;
+        size_t len;
+
+        if (parse_string(parser, &hex, &len) != 0) return -1;
+        if (len != DIGEST_SIZE * 2) return fail(parser, "hash de chunk com tamanho inválido");
+        for (size_t i = 0; i < DIGEST_SIZE; i++) {
+            int high = hex_value(hex[2 * i]);
+            int low = hex_value(hex[2 * i + 1]);
+
+            if (high < 0 || low < 0) return fail(parser, "hash de chunk inválido");
+            out[i] = (unsigned char)(high << 4 | low);
+        }
+        out += DIGEST_SIZE;
+        manifest->chunk_count++;
+    } while (accept(parser, ','));
+
+    return expect(parser, ']');
+}
+
+static int manifest_member(ManifestParser *parser, const char *key, void *target) {
+    OtaManifest *manifest = (OtaManifest *)target;
+    int found;
+
+    if (strcmp(key, "deltas") == 0) return parse_array(parser, delta_element, manifest);
+    if (strcmp(key, "components") == 0) return parse_array(parser, component_element, manifest);
+    if (strcmp(key, "chunk_digests") == 0) return parse_chunk_digests(parser, manifest);
+    // Formato antigo de patch único: "delta_from", "delta_url", "delta_compression"
+    if (strncmp(key, "delta_", 6) == 0) {
+        found = parse_known_field(parser, key + 6, &parser->legacy_delta, delta_fields, FIELD_COUNT(delta_fields));
+        if (found != 0) return found < 0 ? -1 : 0;
+    }
+    return parse_fields(parser, key, manifest, manifest_fields, FIELD_COUNT(manifest_fields));
+}
+
+int manifest_parse(char *json, size_t len, OtaManifest *manifest) {
+    ManifestParser parser;
+
+    memset(manifest, 0, sizeof(*manifest));
+    memset(&parser, 0, sizeof(parser));
+    parser.start = parser.p = json;
+    parser.end = json + len;
+
+    if (parse_object(&parser, manifest_member, manifest) != 0) {
+        fprintf(stderr, "Manifesto: JSON inválido na posição %ld (%s).\n",
+                (long)(parser.p - parser.start), parser.error ? parser.error : "erro desconhecido");
+        return -1;
+    }
+    skip_whitespace(&parser);
+    if (parser.p != parser.end) {
+        fprintf(stderr, "Manifesto: dados após o fim do JSON (posição %ld).\n", (long)(parser.p - parser.start));
+        return -1;
+    }
+
+    if (parser.legacy_delta.url && manifest->delta_count < MANIFEST_MAX_DELTAS) {
+        manifest->deltas[manifest->delta_count++] = parser.legacy_delta;
+    }
+    return 0;
+}
+
+const ManifestDelta *manifest_find_delta(const OtaManifest *manifest, const char *from_version) {
+    for (size_t i = 0; i < manifest->delta_count; i++) {
+        const ManifestDelta *delta = &manifest->deltas[i];
+
+        if (delta->from && delta->url && strcmp(delta->from, from_version) == 0) return delta;
+    }
+    return NULL;
+}
@@ -0,0 +1,72 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Manifesto OTA (JSON) lido em uma única passada, sem alocações: as strings são decodificadas
+// no próprio buffer da resposta (escapes resolvidos, terminador NUL no lugar das aspas) e os
+// campos do manifesto apontam para dentro dele. Os hashes de chunks em "chunk_digests" são
+// convertidos para binário também no lugar, então mesmo listas com milhares de entradas não
+// custam nenhuma alocação. O buffer é modificado e deve viver tanto quanto o manifesto.
+//
+// Chaves desconhecidas (e valores aninhados nelas) são ignoradas.
+#define MANIFEST_MAX_DELTAS 8
+#define MANIFEST_MAX_COMPONENTS 16
+#define MANIFEST_MAX_DEPTH 32          // Aninhamento máximo aceito em valores ignorados
+
+// Patch delta a partir de uma versão anterior ("deltas": [{"from", "url", "compression"}])
+typedef struct {
+    const char *from;
+    const char *url;
+    const char *compression;           // NULL = sem compressão
+} ManifestDelta;
+
+// Componente adicional do sistema ("components": [{...}]), ex: bootloader, modem
+typedef struct {
+    const char *name;
+    const char *version;
+    const char *url;
+    const char *signature_url;
+    const char *hash;
+    uint64_t size;
+} ManifestComponent;
+
+typedef struct {
+    const char *version;
+    const char *url;
+    const char *signature_url;
+    const char *hash;
+    uint64_t size;                     // Tamanho da imagem (0 = não informado)
+    // Imagem comprimida
+    const char *compression;
+    const char *compressed_url;
+    // Patches delta (as chaves antigas delta_from/delta_url/delta_compression viram uma entrada)
+    ManifestDelta deltas[MANIFEST_MAX_DELTAS];
+    size_t delta_count;
+    ManifestComponent components[MANIFEST_MAX_COMPONENTS];
+    size_t component_count;
+    // Manifesto em chunks: lista externa (chunks_url) ou embutida (chunk_digests)
+    const char *chunks_url;
+    const char *chunks_signature_url;
+    uint32_t chunk_size;
+    const unsigned char *chunk_digests; // chunk_count * 32 bytes binários, dentro do buffer
+    size_t chunk_count;
+} OtaManifest;
+
+/**
+ * @brief Analisa o manifesto em uma passada, preenchendo os campos no próprio buffer.
+ * @param json Resposta do servidor (modificada pela análise).
+ * @param len Tamanho da resposta.
+ * @param manifest Campos ausentes ficam NULL / 0.
+ * @return int 0 em caso de sucesso, -1 se o JSON é inválido.
+ */
+int manifest_parse(char *json, size_t len, OtaManifest *manifest);
+
+/**
+ * @brief Escolhe o patch delta que parte da versão informada.
+ * @return const ManifestDelta* O patch, ou NULL se não há nenhum para essa versão.
+ */
+const ManifestDelta *manifest_find_delta(const OtaManifest *manifest, const char *from_version);
+
+#endif // MANIFEST_H
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <curl/curl.h>
 
 // Função de callback para libcurl para armazenar dados baixados na memória
@@ -24,61 +25,476 @@ static size_t write_callback(void *contents, size_t size, size_t nmemb, void *us
     return realsize;
 }
 
-// Função utilitária para download HTTP/HTTPS genérico
-static int perform_download(const char *url, DownloadBuffer *buffer) {
-    CURL *curl_handle;
-    CURLcode res;
+// Uma transferência em streaming (o arquivo inteiro ou um segmento dele)
+typedef struct {
+    CURL *handle;
+    DownloadSink sink;
+    void *userdata;
+    curl_off_t requested;      // Início pedido no cabeçalho Range (0 = desde o início)
+    curl_off_t position;       // Offset absoluto do próximo byte (-1 = resposta ainda não chegou)
+    curl_off_t end;            // Último byte do segmento (-1 = até o fim do arquivo)
+    int require_range;         // Segmentos exigem 206: um 200 traria o arquivo inteiro
+    int failures;              // Tentativas seguidas sem progresso
+    int aborted;               // O sink (ou a validação da resposta) abortou: não adianta repetir
+} StreamTarget;
 
-    buffer->data = malloc(1); // Inicializa com 1 byte
-    buffer->size = 0;
+// Callback do modo streaming: repassa o bloco do buffer do libcurl direto ao destino,
+// junto com seu offset no arquivo
+static size_t stream_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    StreamTarget *target = (StreamTarget *)userp;
 
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    curl_handle = curl_easy_init();
-
-    if (curl_handle) {
-        curl_easy_setopt(curl_handle, CURLOPT_URL, url);
-        curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)buffer);
-        curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "ota-client/1.0");
-        // Habilitar a verificação de certificados SSL (segurança)
-        curl_easy_setopt(curl_handle, CURLOPT_USE_SSL, CURLUSESSL_ALL);
-        // Opcional: Definir o CA bundle para sistemas embarcados
-        // curl_easy_setopt(curl_handle, CURLOPT_CAINFO, "/etc/ssl/certs/ca-certificates.crt");
-
-        curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0L); // verificação de hostname desabilitada em ambiente de teste
-        curl_easy_setopt(curl_handle, CURLOPT_CAINFO, "../cert.pem");
-        curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 1L);
-        res = curl_easy_perform(curl_handle);
-
-        if (res != CURLE_OK) {
-            fprintf(stderr, "download falhou: %s\n", curl_easy_strerror(res));
-            free(buffer->data);
-            buffer->data = NULL;
-            buffer->size = 0;
-            return -1;
+    if (target->position < 0) {
+        long code = 0;
+
+        curl_easy_getinfo(target->handle, CURLINFO_RESPONSE_CODE, &code);
+        if (code == 206) {
+            target->position = target->requested;
+        } else if (target->require_range) {
+            fprintf(stderr, "Servidor ignorou o pedido de Range (HTTP %ld).\n", code);
+            target->aborted = 1;
+            return 0;
+        } else {
+            // Range ignorado: o arquivo recomeça do byte 0 (o sink descarta o que já tinha)
+            target->position = 0;
         }
+    }
 
-        curl_easy_cleanup(curl_handle);
+    if (target->sink((const unsigned char *)contents, realsize, (size_t)target->position,
+                     target->userdata) != 0) {
+        target->aborted = 1;
+        return 0; // Sinaliza erro para libcurl (CURLE_WRITE_ERROR)
+    }
+    target->position += (curl_off_t)realsize;
+    return realsize;
+}
+
+// Progresso das transferências: fecha a janela de download (CURLE_ABORTED_BY_CALLBACK)
+static int gate_callback(void *userp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal,
+                         curl_off_t ulnow)
+{
+    NetworkContext *ctx = (NetworkContext *)userp;
+
+    (void)dltotal;
+    (void)dlnow;
+    (void)ultotal;
+    (void)ulnow;
+    return ctx->gate(ctx->gate_userdata) ? 0 : 1;
+}
+
+// Opções comuns a todas as requisições
+static void configure_handle(NetworkContext *ctx, CURL *curl_handle, const char *url,
+                             size_t (*callback)(void *, size_t, size_t, void *), void *userdata)
+{
+    // Conexões, sessões TLS e DNS vêm do cache compartilhado do contexto
+    curl_easy_setopt(curl_handle, CURLOPT_SHARE, ctx->share);
+    // HTTP/2 negociado via ALPN quando o servidor suporta (senão HTTP/1.1 com keep-alive)
+    curl_easy_setopt(curl_handle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    // Segmentos paralelos esperam por uma conexão HTTP/2 existente em vez de abrir outras
+    curl_easy_setopt(curl_handle, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(curl_handle, CURLOPT_URL, url);
+    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, callback);
+    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, userdata);
+    curl_easy_setopt(curl_handle, CURLOPT_BUFFERSIZE, (long)DOWNLOAD_CHUNK_SIZE);
+    curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "ota-client/1.0");
+    // Vários clientes podem rodar em threads do mesmo processo: nada de sinais (SIGALRM/SIGPIPE)
+    curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1L);
+    // Respostas de erro (404, 500...) não podem ser tratadas como firmware
+    curl_easy_setopt(curl_handle, CURLOPT_FAILONERROR, 1L);
+    // Um link parado (sem RST) também conta como queda: aborta para retomar
+    curl_easy_setopt(curl_handle, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(curl_handle, CURLOPT_LOW_SPEED_TIME, (long)DOWNLOAD_STALL_TIMEOUT_S);
+    // Limite de banda: o download não disputa o link com o tráfego da aplicação
+    if (ctx->max_recv_speed > 0) {
+        curl_easy_setopt(curl_handle, CURLOPT_MAX_RECV_SPEED_LARGE, (curl_off_t)ctx->max_recv_speed);
+    }
+    if (ctx->gate) {
+        curl_easy_setopt(curl_handle, CURLOPT_XFERINFOFUNCTION, gate_callback);
+        curl_easy_setopt(curl_handle, CURLOPT_XFERINFODATA, ctx);
+        curl_easy_setopt(curl_handle, CURLOPT_NOPROGRESS, 0L);
     }
+    // Habilitar a verificação de certificados SSL (segurança)
+    curl_easy_setopt(curl_handle, CURLOPT_USE_SSL, CURLUSESSL_ALL);
+    // Opcional: Definir o CA bundle para sistemas embarcados
+    // curl_easy_setopt(curl_handle, CURLOPT_CAINFO, "/etc/ssl/certs/ca-certificates.crt");
+
+    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0L); // verificação de hostname desabilitada em ambiente de teste
+    curl_easy_setopt(curl_handle, CURLOPT_CAINFO, "../cert.pem");
+    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 1L);
+}
+
+// Contabiliza as conexões que a última transferência precisou abrir e os bytes recebidos
+static void count_transfer(NetworkContext *ctx, CURL *curl_handle) {
+    long connects = 0;
+    curl_off_t received = 0;
+
+    curl_easy_getinfo(curl_handle, CURLINFO_NUM_CONNECTS, &connects);
+    curl_easy_getinfo(curl_handle, CURLINFO_SIZE_DOWNLOAD_T, &received);
+    ctx->requests++;
+    ctx->connections += connects;
+    ctx->received_bytes += (long long)received;
+}
+
+// Prepara o handle persistente para uma nova requisição: as opções voltam ao padrão, mas
+// conexões abertas, sessões TLS e o cache DNS são mantidos
+static CURL *reuse_handle(NetworkContext *ctx, const char *url,
+                          size_t (*callback)(void *, size_t, size_t, void *), void *userdata)
+{
+    curl_easy_reset(ctx->handle);
+    configure_handle(ctx, ctx->handle, url, callback, userdata);
+    return ctx->handle;
+}
+
+int network_context_init(NetworkContext *ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+        fprintf(stderr, "Falha ao inicializar o libcurl.\n");
+        return -1;
+    }
+
+    ctx->share = curl_share_init();
+    ctx->handle = curl_easy_init();
+    ctx->multi = curl_multi_init();
+    if (!ctx->share || !ctx->handle || !ctx->multi) {
+        fprintf(stderr, "Falha ao criar o contexto de rede.\n");
+        network_context_cleanup(ctx);
+        return -1;
+    }
+
+    // Uso em uma única thread: o compartilhamento dispensa funções de lock
+    curl_share_setopt(ctx->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    curl_share_setopt(ctx->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(ctx->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    // Com HTTP/2 os segmentos paralelos viram streams de uma mesma conexão
+    curl_multi_setopt(ctx->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    return 0;
+}
+
+void network_context_cleanup(NetworkContext *ctx) {
+    // Os handles que usam o share precisam ser liberados antes dele
+    if (ctx->multi) curl_multi_cleanup(ctx->multi);
+    if (ctx->handle) curl_easy_cleanup(ctx->handle);
+    if (ctx->share) curl_share_cleanup(ctx->share);
+    ctx->multi = NULL;
+    ctx->handle = NULL;
+    ctx->share = NULL;
     curl_global_cleanup();
-    
+}
+
+// Função utilitária para download HTTP/HTTPS genérico
+static int perform_transfer(NetworkContext *ctx, const char *url,
+                            size_t (*callback)(void *, size_t, size_t, void *), void *userdata)
+{
+    CURL *curl_handle = reuse_handle(ctx, url, callback, userdata);
+    CURLcode res = curl_easy_perform(curl_handle);
+
+    count_transfer(ctx, curl_handle);
+    if (res != CURLE_OK) {
+        fprintf(stderr, "download falhou: %s\n", curl_easy_strerror(res));
+        return -1;
+    }
+    return 0;
+}
+
+static int perform_download(NetworkContext *ctx, const char *url, DownloadBuffer *buffer) {
+    buffer->data = malloc(1); // Inicializa com 1 byte
+    buffer->size = 0;
+    if (!buffer->data) return -1;
+
+    if (perform_transfer(ctx, url, write_callback, buffer) != 0) {
+        free(buffer->data);
+        buffer->data = NULL;
+        buffer->size = 0;
+        return -1;
+    }
     return 0;
 }
 
-int check_version_availability(const char *url, char **json_response) {
+int check_version_availability(NetworkContext *ctx, const char *url, char **json_response) {
     DownloadBuffer buffer = {0};
-    
-    if (perform_download(url, &buffer) != 0) {
+
+    if (perform_download(ctx, url, &buffer) != 0) {
         *json_response = NULL;
         return -1;
     }
 
     // Retorna a string JSON (o chamador deve liberar)
     *json_response = (char *)buffer.data;
-    
+
     return 0;
 }
 
-int download_firmware(const char *url, DownloadBuffer *buffer) {
-    return perform_download(url, buffer);
+int check_version_if_modified(NetworkContext *ctx, const char *url, char *etag, size_t etag_size,
+                              char **json_response)
+{
+    DownloadBuffer buffer = {0};
+    struct curl_slist *headers = NULL;
+    struct curl_header *header;
+    CURL *curl_handle;
+    CURLcode res;
+    long code = 0;
+
+    *json_response = NULL;
+    buffer.data = malloc(1);
+    if (!buffer.data) return -1;
+
+    curl_handle = reuse_handle(ctx, url, write_callback, &buffer);
+    if (etag[0]) {
+        char condition[MANIFEST_ETAG_MAX + 32];
+
+        snprintf(condition, sizeof(condition), "If-None-Match: %s", etag);
+        headers = curl_slist_append(NULL, condition);
+        curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
+    }
+    res = curl_easy_perform(curl_handle);
+    count_transfer(ctx, curl_handle);
+    curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, NULL);
+    curl_slist_free_all(headers);
+    if (res != CURLE_OK) {
+        fprintf(stderr, "download falhou: %s\n", curl_easy_strerror(res));
+        free(buffer.data);
+        return -1;
+    }
+
+    curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &code);
+    if (code == 304) {
+        free(buffer.data);
+        return 1;
+    }
+
+    // Um ETag longo demais não é guardado: a próxima consulta baixa o manifesto inteiro
+    etag[0] = '\0';
+    if (curl_easy_header(curl_handle, "ETag", 0, CURLH_HEADER, -1, &header) == CURLHE_OK &&
+        strlen(header->value) < etag_size) {
+        strcpy(etag, header->value);
+    }
+    *json_response = (char *)buffer.data;
+    return 0;
+}
+
+int download_firmware(NetworkContext *ctx, const char *url, DownloadBuffer *buffer) {
+    return perform_download(ctx, url, buffer);
+}
+
+// Decide se uma transferência interrompida deve ser retomada, contando só as falhas sem progresso
+static int should_retry(StreamTarget *target, curl_off_t started_at, CURLcode res) {
+    // Janela de download fechada: repetir só prolongaria a transferência
+    if (target->aborted || res == CURLE_ABORTED_BY_CALLBACK) return 0;
+    if (target->position > started_at) target->failures = 0;
+    if (++target->failures > DOWNLOAD_MAX_RETRIES) return 0;
+
+    fprintf(stderr, "download interrompido (%s); retomando a partir do byte %lld (tentativa %d/%d).\n",
+            curl_easy_strerror(res), (long long)(target->position >= 0 ? target->position : started_at),
+            target->failures, DOWNLOAD_MAX_RETRIES);
+    return 1;
+}
+
+// Transferência sequencial de [offset, end] (end -1 = até o fim), retomada após quedas
+static int perform_stream(NetworkContext *ctx, const char *url, curl_off_t offset, curl_off_t end,
+                          DownloadSink sink, void *userdata)
+{
+    StreamTarget target;
+    curl_off_t next = offset;
+    CURLcode res;
+    int ret = -1;
+
+    memset(&target, 0, sizeof(target));
+    target.sink = sink;
+    target.userdata = userdata;
+    target.end = end;
+    target.require_range = end >= 0; // Um 200 traria o arquivo inteiro, não o trecho
+    target.handle = reuse_handle(ctx, url, stream_callback, &target);
+
+    while (1) {
+        char range[64];
+        long code = 0;
+
+        target.requested = next;
+        target.position = -1;
+        // Range: bytes=<next>- (CURLOPT_RESUME_FROM recusaria um 200; aqui o sink recomeça do zero)
+        if (end >= 0) {
+            snprintf(range, sizeof(range), "%lld-%lld", (long long)next, (long long)end);
+        } else {
+            snprintf(range, sizeof(range), "%lld-", (long long)next);
+        }
+        curl_easy_setopt(target.handle, CURLOPT_RANGE, next > 0 || end >= 0 ? range : NULL);
+        res = curl_easy_perform(target.handle);
+        count_transfer(ctx, target.handle);
+        if (res == CURLE_OK && (end < 0 || target.position == end + 1)) {
+            ret = 0;
+            break;
+        }
+
+        // 416 ao retomar: o arquivo parcial já está completo (a verificação decide se é válido)
+        curl_easy_getinfo(target.handle, CURLINFO_RESPONSE_CODE, &code);
+        if (res == CURLE_HTTP_RETURNED_ERROR && code == 416 && next > 0 && end < 0) {
+            ret = 0;
+            break;
+        }
+        if (res == CURLE_OK || !should_retry(&target, next, res)) {
+            fprintf(stderr, "download falhou: %s\n",
+                    res == CURLE_OK ? "resposta menor que o trecho pedido" : curl_easy_strerror(res));
+            break;
+        }
+        if (target.position >= 0) next = target.position;
+        sleep(DOWNLOAD_RETRY_DELAY_S);
+    }
+    return ret;
+}
+
+int download_firmware_stream(NetworkContext *ctx, const char *url, size_t offset,
+                             DownloadSink sink, void *userdata)
+{
+    return perform_stream(ctx, url, (curl_off_t)offset, -1, sink, userdata);
+}
+
+int download_firmware_range(NetworkContext *ctx, const char *url, size_t offset, size_t length,
+                            DownloadSink sink, void *userdata)
+{
+    if (length == 0) return 0;
+    return perform_stream(ctx, url, (curl_off_t)offset, (curl_off_t)(offset + length - 1), sink, userdata);
+}
+
+// Pede ao segmento os bytes que ainda faltam ([início, fim])
+static void set_segment_range(StreamTarget *segment, curl_off_t start) {
+    char range[64];
+
+    snprintf(range, sizeof(range), "%lld-%lld", (long long)start, (long long)segment->end);
+    segment->requested = start;
+    segment->position = -1;
+    curl_easy_setopt(segment->handle, CURLOPT_RANGE, range);
+}
+
+static size_t discard_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    (void)contents;
+    (void)userp;
+    return size * nmemb;
+}
+
+int get_remote_file_info(NetworkContext *ctx, const char *url, size_t *size, int *accepts_ranges) {
+    // Pede só o primeiro byte: um 206 prova o suporte a Range e traz o tamanho em Content-Range
+    // (GET em vez de HEAD, que muitos servidores respondem sem considerar o Range)
+    CURL *curl_handle = reuse_handle(ctx, url, discard_callback, NULL);
+    curl_off_t length = -1;
+    long code = 0;
+    struct curl_header *header;
+    CURLcode res;
+
+    *accepts_ranges = 0;
+    curl_easy_setopt(curl_handle, CURLOPT_RANGE, "0-0");
+    res = curl_easy_perform(curl_handle);
+    count_transfer(ctx, curl_handle);
+    if (res != CURLE_OK) {
+        fprintf(stderr, "Falha ao consultar o tamanho do arquivo: %s\n", curl_easy_strerror(res));
+        return -1;
+    }
+
+    curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &code);
+    curl_easy_getinfo(curl_handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+    if (length < 0) return -1;
+
+    *size = (size_t)length;
+    *accepts_ranges = code == 206;
+    // Em um 206 Content-Length é o tamanho do trecho; o total vem de Content-Range
+    if (code == 206 &&
+        curl_easy_header(curl_handle, "Content-Range", 0, CURLH_HEADER, -1, &header) == CURLHE_OK) {
+        const char *slash = strchr(header->value, '/');
+        if (slash && slash[1] != '*') *size = (size_t)strtoull(slash + 1, NULL, 10);
+        else *accepts_ranges = 0;
+    }
+    return 0;
+}
+
+int download_firmware_parallel(NetworkContext *ctx, const char *url, size_t size, int segments,
+                               DownloadSink sink, void *userdata)
+{
+    StreamTarget *parts;
+    CURLM *multi = ctx->multi;
+    curl_off_t segment_size;
+    int running = 0, pending, failed = 0;
+
+    // Sem bytes não há Range válido (o último segmento pediria "bytes=0--1")
+    if (size == 0) {
+        fprintf(stderr, "Download em segmentos exige um tamanho conhecido e maior que zero.\n");
+        return -1;
+    }
+    if (segments < 1) segments = 1;
+    if ((size_t)segments > size) segments = (int)size;
+    segment_size = ((curl_off_t)size + segments - 1) / segments;
+
+    parts = calloc((size_t)segments, sizeof(StreamTarget));
+    if (!parts) {
+        fprintf(stderr, "Falha ao alocar os segmentos do download.\n");
+        return -1;
+    }
+
+    pending = segments;
+
+    for (int i = 0; i < segments; i++) {
+        StreamTarget *part = &parts[i];
+        curl_off_t start = (curl_off_t)i * segment_size;
+
+        part->end = start + segment_size - 1;
+        if (part->end >= (curl_off_t)size) part->end = (curl_off_t)size - 1;
+        part->sink = sink;
+        part->userdata = userdata;
+        part->require_range = 1;
+        part->handle = curl_easy_init();
+        if (!part->handle) {
+            failed = 1;
+            break;
+        }
+        configure_handle(ctx, part->handle, url, stream_callback, part);
+        // O limite vale por handle: os segmentos dividem o total
+        if (ctx->max_recv_speed > 0) {
+            curl_off_t speed = (curl_off_t)ctx->max_recv_speed / segments;
+
+            curl_easy_setopt(part->handle, CURLOPT_MAX_RECV_SPEED_LARGE, speed > 0 ? speed : (curl_off_t)1);
+        }
+        curl_easy_setopt(part->handle, CURLOPT_PRIVATE, part);
+        set_segment_range(part, start);
+        curl_multi_add_handle(multi, part->handle);
+    }
+
+    while (!failed && pending > 0) {
+        CURLMsg *msg;
+        int left;
+
+        curl_multi_perform(multi, &running);
+        while ((msg = curl_multi_info_read(multi, &left)) != NULL) {
+            StreamTarget *part;
+            char *private_data = NULL;
+            curl_off_t started_at;
+
+            if (msg->msg != CURLMSG_DONE) continue;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &private_data);
+            part = (StreamTarget *)private_data;
+            curl_multi_remove_handle(multi, part->handle);
+            count_transfer(ctx, part->handle);
+            started_at = part->requested;
+
+            if (msg->data.result == CURLE_OK && part->position == part->end + 1) {
+                pending--;
+                continue;
+            }
+            // Um segmento interrompido recomeça de onde parou, sem afetar os outros
+            if (msg->data.result == CURLE_OK || !should_retry(part, started_at, msg->data.result)) {
+                fprintf(stderr, "download do segmento %lld-%lld falhou: %s\n",
+                        (long long)started_at, (long long)part->end, curl_easy_strerror(msg->data.result));
+                failed = 1;
+                break;
+            }
+            set_segment_range(part, part->position >= 0 ? part->position : started_at);
+            curl_multi_add_handle(multi, part->handle);
+        }
+        if (!failed && pending > 0) curl_multi_poll(multi, NULL, 0, 1000, NULL);
+    }
+
+    for (int i = 0; i < segments; i++) {
+        if (!parts[i].handle) continue;
+        curl_multi_remove_handle(multi, parts[i].handle);
+        curl_easy_cleanup(parts[i].handle);
+    }
+    free(parts);
+    return failed ? -1 : 0;
 }
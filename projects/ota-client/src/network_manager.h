@@ -2,6 +2,7 @@
 #define NETWORK_MANAGER_H
 
 #include <stddef.h>
+#include <curl/curl.h>
 
 // Estrutura para manter o buffer de dados baixados e seu tamanho
 typedef struct {
@@ -9,13 +10,79 @@ typedef struct {
     size_t size;
 } DownloadBuffer;
 
+// Tamanho do buffer de recepção do libcurl: no modo streaming cada bloco é entregue ao
+// destino direto desse buffer, então o pico de memória do download não depende da imagem
+#define DOWNLOAD_CHUNK_SIZE (64 * 1024)
+
+// Quedas de link: cada transferência é retomada (Range) a partir do último byte recebido.
+// O limite conta apenas tentativas seguidas sem nenhum progresso.
+#define DOWNLOAD_MAX_RETRIES 5
+#define DOWNLOAD_RETRY_DELAY_S 2
+#define DOWNLOAD_STALL_TIMEOUT_S 30   // Sem nenhum byte por esse tempo = link caído
+
+// Tamanho máximo de um ETag guardado entre consultas ao manifesto
+#define MANIFEST_ETAG_MAX 128
+
+/**
+ * @brief Consultada durante as transferências: retornar 0 interrompe a transferência em curso
+ * (sem novas tentativas), como uma queda de link, e o que já foi gravado pode ser retomado depois.
+ */
+typedef int (*TransferGate)(void *userdata);
+
+/**
+ * @brief Destino dos blocos de um download em streaming.
+ * @param offset Posição do bloco no arquivo. No modo sequencial os blocos chegam em ordem; um
+ * offset 0 após dados já entregues indica que o servidor ignorou o Range e o arquivo recomeçou.
+ * @return int 0 para continuar, -1 para abortar a transferência.
+ */
+typedef int (*DownloadSink)(const unsigned char *data, size_t len, size_t offset, void *userdata);
+
+// Contexto de rede de uma atualização: todas as requisições (manifesto, assinatura, firmware)
+// passam pelo mesmo handle, mantendo a conexão aberta entre elas. O share guarda o cache de
+// conexões, as sessões TLS (um handshake novo é abreviado) e o DNS, também usados pelos
+// segmentos paralelos. Em links de satélite cada handshake completo custa segundos.
+typedef struct {
+    CURL *handle;              // Requisições sequenciais
+    CURLSH *share;             // Conexões, sessões TLS e DNS compartilhados
+    CURLM *multi;              // Download em segmentos paralelos
+    long requests;             // Transferências realizadas
+    long connections;          // Conexões novas que elas precisaram abrir
+    long long received_bytes;  // Corpo das respostas recebido (incluindo retomadas)
+    // Configuráveis após network_context_init (valem para as requisições seguintes)
+    long long max_recv_speed;  // Limite de recepção em bytes/s, somando os segmentos (0 = sem limite)
+    TransferGate gate;         // Opcional: janela em que as transferências podem continuar
+    void *gate_userdata;
+} NetworkContext;
+
+/**
+ * @brief Cria o contexto de rede (chama curl_global_init).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int network_context_init(NetworkContext *ctx);
+
+/**
+ * @brief Fecha as conexões e libera o contexto de rede.
+ */
+void network_context_cleanup(NetworkContext *ctx);
+
 /**
  * @brief Verifica se uma nova versão está disponível.
  * * @param url URL do endpoint de verificação de versão (retorna JSON, ex: {"version": "1.1.0", "url": "...", "hash": "..."}).
  * @param json_response Ponteiro para onde armazenar a string de resposta JSON. Deve ser liberado pelo chamador.
  * @return int 0 em caso de sucesso, -1 em caso de falha.
  */
-int check_version_availability(const char *url, char **json_response);
+int check_version_availability(NetworkContext *ctx, const char *url, char **json_response);
+
+/**
+ * @brief Consulta o manifesto apenas se ele mudou desde a última resposta (If-None-Match): um
+ * manifesto igual custa uma requisição, sem corpo.
+ * @param etag Entrada: ETag da última resposta ("" = nenhuma). Saída: ETag da resposta nova
+ * ("" se o servidor não enviou um).
+ * @param json_response Recebe o manifesto novo (o chamador deve liberar); NULL se não mudou.
+ * @return int 0 se o manifesto foi recebido, 1 se não mudou (304), -1 em caso de falha.
+ */
+int check_version_if_modified(NetworkContext *ctx, const char *url, char *etag, size_t etag_size,
+                              char **json_response);
 
 /**
  * @brief Baixa um arquivo de firmware de uma URL.
@@ -23,6 +90,45 @@ int check_version_availability(const char *url, char **json_response);
  * @param buffer Ponteiro para a estrutura DownloadBuffer para armazenar os dados.
  * @return int 0 em caso de sucesso, -1 em caso de falha.
  */
-int download_firmware(const char *url, DownloadBuffer *buffer);
+int download_firmware(NetworkContext *ctx, const char *url, DownloadBuffer *buffer);
+
+/**
+ * @brief Baixa um arquivo em streaming, entregando cada bloco ao destino sem acumulá-lo em memória.
+ * Quedas no meio da transferência são retomadas com Range a partir do último byte recebido.
+ * @param url URL direta do arquivo de firmware.
+ * @param offset Byte inicial (tamanho já persistido de um download anterior; 0 = desde o início).
+ * @param sink Função que consome os blocos (grava em disco, atualiza o hash...).
+ * @param userdata Contexto repassado ao sink.
+ * @return int 0 em caso de sucesso, -1 em caso de falha (inclusive se o sink abortar).
+ */
+int download_firmware_stream(NetworkContext *ctx, const char *url, size_t offset,
+                             DownloadSink sink, void *userdata);
+
+/**
+ * @brief Baixa apenas o trecho [offset, offset + length) de um arquivo (ex: um chunk que
+ * falhou na verificação), com as mesmas retomadas do modo streaming.
+ * @return int 0 em caso de sucesso, -1 em caso de falha (inclusive se o servidor ignorar o Range).
+ */
+int download_firmware_range(NetworkContext *ctx, const char *url, size_t offset, size_t length,
+                            DownloadSink sink, void *userdata);
+
+/**
+ * @brief Consulta o tamanho de um arquivo remoto e se o servidor atende pedidos de Range.
+ * @param size Tamanho total do arquivo.
+ * @param accepts_ranges 1 se o servidor respondeu 206 a um pedido de Range, 0 caso contrário.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int get_remote_file_info(NetworkContext *ctx, const char *url, size_t *size, int *accepts_ranges);
+
+/**
+ * @brief Baixa um arquivo em segmentos paralelos (curl_multi), um Range por conexão.
+ * Os blocos chegam fora de ordem: o sink deve gravá-los em seus offsets. Cada segmento
+ * interrompido é retomado de onde parou, sem afetar os demais.
+ * @param size Tamanho total (get_remote_file_info), maior que zero.
+ * @param segments Número de conexões simultâneas.
+ * @return int 0 em caso de sucesso, -1 em caso de falha (inclusive size == 0).
+ */
+int download_firmware_parallel(NetworkContext *ctx, const char *url, size_t size, int segments,
+                               DownloadSink sink, void *userdata);
 
 #endif // NETWORK_MANAGER_H
@@ -1,158 +1,864 @@
 #include "ota_client.h"
 #include "network_manager.h"
 #include "security_manager.h"
+#include "delta_patch.h"
+#include "decompressor.h"
+#include "chunk_verifier.h"
+#include "manifest.h"
+#include "partition_writer.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <pthread.h>
 
 // --- Configurações de Segurança ---
 // Caminho simulado para a chave pública (incorporada no cliente)
 #define PUBLIC_KEY_PATH "cert.pem" 
 
-// (Atenção: Para um projeto real, você usaria uma biblioteca JSON robusta como Jansson.
-// Aqui, faremos uma análise JSON muito simplificada para manter o código leve).
+// Arquivos da atualização, dentro do diretório de trabalho (OtaOptions.work_dir)
+// Destino do firmware baixado (ex: em /data): a imagem só chega ao slot inativo depois de verificada
+#define FIRMWARE_STAGING_PATH "firmware_staging.bin"
+
+// Slots A/B (partições, ex: /dev/mmcblk0p2 e /dev/mmcblk0p3) e o arquivo com o slot ativo
+#define FIRMWARE_SLOT_A_PATH "firmware_slot_a.bin"
+#define FIRMWARE_SLOT_B_PATH "firmware_slot_b.bin"
+#define FIRMWARE_SLOT_CONTROL_PATH "firmware_slots.state"
+
+// Imagem em execução antes da primeira atualização A/B (depois, a base dos patches delta é o
+// slot em execução)
+#define CURRENT_FIRMWARE_PATH "firmware_current.bin"
+
+// Progresso persistido do download ("<hash esperado> <bytes gravados>"), usado para retomar
+// após queda de energia ou reinício; só é atualizado depois de um fsync do firmware
+#define FIRMWARE_STATE_PATH FIRMWARE_STAGING_PATH ".state"
+#define FIRMWARE_CHECKPOINT_BYTES (1024 * 1024)
+
+// Conexões simultâneas no download do firmware (1 = sequencial). Com mais de uma, o arquivo é
+// dividido em segmentos baixados em paralelo (exige suporte a Range no servidor).
+#ifndef OTA_DOWNLOAD_SEGMENTS
+#define OTA_DOWNLOAD_SEGMENTS 1
+#endif
+
+// Chaves confiáveis: lidas uma vez por processo e compartilhadas por todas as atualizações
+static TrustStore trust_store;
+static int trust_store_loaded;
+static pthread_mutex_t trust_store_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Caminhos de uma atualização, já com o diretório de trabalho
+typedef struct {
+    char staging[PATH_MAX];
+    char state[PATH_MAX];
+    char state_tmp[PATH_MAX];
+    char slots[PARTITION_SLOT_COUNT][PATH_MAX];
+    char slot_control[PATH_MAX];
+    char current[PATH_MAX];
+} OtaPaths;
+
+// Estado do download em streaming: cada bloco vai para o disco e para o verificador
+typedef struct {
+    int fd;
+    const OtaPaths *paths;
+    int parallel;              // Segmentos fora de ordem: o hash é calculado ao final, relendo o arquivo
+    int discard;               // Firmware rejeitado (ou parcial não retomável): remover ao final
+    size_t position;           // Bytes gravados em sequência desde o início do arquivo
+    size_t checkpoint;         // Bytes já confirmados no arquivo de estado
+    // Etapas opcionais entre a rede e o destino: rede -> descompressão -> patch delta -> disco
+    Decompressor *decompressor;
+    DeltaPatcher *patcher;     // Modo delta: os blocos baixados são um patch, não a imagem
+    size_t payload_position;   // Bytes do payload (patch e/ou imagem comprimida) já recebidos
+    // Manifesto em chunks: cada chunk é verificado ao chegar, no lugar do hash da imagem inteira
+    ChunkVerifier *chunks;
+    const char *expected_hash;
+    FirmwareVerifier verifier;
+    OtaStats *stats;
+} FirmwareStream;
+
+static double now_seconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void add_stage_time(OtaStats *stats, OtaStage stage, double started) {
+    stats->seconds[stage] += now_seconds() - started;
+}
+
+// O hash é calculado durante a recepção: o tempo gasto nele sai do tempo de download
+static void add_download_time(OtaStats *stats, double started, double hash_before) {
+    add_stage_time(stats, OTA_STAGE_DOWNLOAD, started);
+    stats->seconds[OTA_STAGE_DOWNLOAD] -= stats->seconds[OTA_STAGE_HASH] - hash_before;
+}
+
+// Inclui um bloco no hash da imagem, contabilizando o tempo gasto
+static int hash_firmware_block(FirmwareStream *stream, const unsigned char *data, size_t len) {
+    double started = now_seconds();
+    int ret = firmware_verifier_update(&stream->verifier, data, len);
+
+    add_stage_time(stream->stats, OTA_STAGE_HASH, started);
+    return ret;
+}
+
+static int write_all(int fd, const unsigned char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int pwrite_all(int fd, const unsigned char *data, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, data, len, offset);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
 
 /**
- * @brief Simplesmente extrai um valor associado a uma chave de uma string JSON (muito frágil, apenas para exemplo).
- * @param json String JSON.
- * @param key Chave a ser procurada.
- * @return char* O valor (string) ou NULL se não encontrado. Deve ser liberado.
+ * @brief Obtém as chaves confiáveis, carregando-as de PUBLIC_KEY_PATH na primeira chamada (uma
+ * falha não é memorizada: a próxima atualização tenta de novo).
+ * @return const TrustStore* As chaves, ou NULL em caso de falha.
  */
-static char *simple_json_extract(const char *json, const char *key) {
-    char search_key[128];
-    // Formato: "chave":
-    sprintf(search_key, "\"%s\":", key);
-    
-    char *start = strstr(json, search_key);
-    if (!start) return NULL;
+static const TrustStore *trusted_keys(void) {
+    const TrustStore *keys;
 
-    start += strlen(search_key);
+    pthread_mutex_lock(&trust_store_lock);
+    if (!trust_store_loaded && trust_store_load(&trust_store, PUBLIC_KEY_PATH) == 0) {
+        trust_store_loaded = 1;
+    }
+    keys = trust_store_loaded ? &trust_store : NULL;
+    pthread_mutex_unlock(&trust_store_lock);
+    return keys;
+}
 
-    // Pular espaços e aspas iniciais
-    while (*start == ' ' || *start == '\t') start++;
-    if (*start == '"') start++;
-    
-    char *end = start;
-    // Procurar pelo terminador da string de valor (aspas, vírgula, ou chave de fechamento)
-    while (*end != '"' && *end != ',' && *end != '}' && *end != '\0') end++;
-    
-    // Alocar e copiar a string extraída
-    size_t len = end - start;
-    char *value = malloc(len + 1);
-    if (!value) return NULL;
-    
-    strncpy(value, start, len);
-    value[len] = '\0';
+/**
+ * @brief Lê o progresso persistido de um download anterior do mesmo firmware.
+ * @return size_t Bytes já gravados e sincronizados (0 se não há estado ou é de outra versão).
+ */
+static size_t load_checkpoint(const FirmwareStream *stream) {
+    char hash[SHA256_HASH_SIZE * 2 + 1];
+    unsigned long long offset = 0;
+    FILE *fp = fopen(stream->paths->state, "r");
+
+    if (!fp) return 0;
+    if (fscanf(fp, "%64s %llu", hash, &offset) != 2 || strcmp(hash, stream->expected_hash) != 0) offset = 0;
+    fclose(fp);
+    return (size_t)offset;
+}
+
+/**
+ * @brief Sincroniza o firmware no disco e só então registra quantos bytes podem ser retomados.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+static int save_checkpoint(FirmwareStream *stream) {
+    FILE *fp;
+
+    // Com etapas intermediárias o estado delas não pode ser persistido: só a imagem pura é retomável
+    if (stream->parallel || stream->decompressor || stream->patcher ||
+        stream->position == stream->checkpoint) {
+        return 0;
+    }
+    if (fsync(stream->fd) != 0) {
+        perror("Erro ao sincronizar o firmware no disco");
+        return -1;
+    }
+
+    // Escreve ao lado e renomeia: o estado nunca fica pela metade
+    fp = fopen(stream->paths->state_tmp, "w");
+    if (!fp) return -1;
+    fprintf(fp, "%s %zu\n", stream->expected_hash, stream->position);
+    if (fflush(fp) != 0 || fsync(fileno(fp)) != 0) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    if (rename(stream->paths->state_tmp, stream->paths->state) != 0) return -1;
+
+    stream->checkpoint = stream->position;
+    return 0;
+}
+
+/**
+ * @brief Inclui no hash os bytes [0, len) já gravados no destino, lendo em blocos fixos.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+static int hash_written_firmware(FirmwareStream *stream, size_t len) {
+    unsigned char block[16 * 1024];
+    size_t done = 0;
+
+    while (done < len) {
+        size_t want = len - done < sizeof(block) ? len - done : sizeof(block);
+        ssize_t n = pread(stream->fd, block, want, (off_t)done);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            fprintf(stderr, "Erro ao reler o firmware gravado: %s\n", n < 0 ? strerror(errno) : "arquivo curto");
+            return -1;
+        }
+        if (hash_firmware_block(stream, block, (size_t)n) != 0) return -1;
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Volta o destino ao byte 0 e descarta o hash (o download recomeçou ou trocou de modo).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+static int rewind_firmware(FirmwareStream *stream) {
+    if (lseek(stream->fd, 0, SEEK_SET) < 0 ||
+        (ftruncate(stream->fd, 0) != 0 && errno != EINVAL) || // Partição: EINVAL, apenas sobrescreve
+        firmware_verifier_reset(&stream->verifier) != 0) {
+        perror("Erro ao reiniciar o destino do firmware");
+        return -1;
+    }
+    if (stream->chunks) chunk_verifier_reset(stream->chunks);
+    stream->position = 0;
+    stream->checkpoint = 0;
+    stream->discard = 0;
+    return 0;
+}
+
+// Grava o próximo trecho da nova imagem e o inclui no hash
+static int write_firmware(FirmwareStream *stream, const unsigned char *data, size_t len) {
+    if (write_all(stream->fd, data, len) != 0) {
+        perror("Erro ao gravar o firmware");
+        return -1;
+    }
+    if (stream->chunks) {
+        if (chunk_verifier_received(stream->chunks, stream->position, len) != 0) {
+            stream->discard = 1; // Imagem errada: nada do que foi gravado deve ser retomado
+            return -1;
+        }
+    } else if (hash_firmware_block(stream, data, len) != 0) {
+        return -1;
+    }
+    stream->position += len;
+
+    if (stream->position - stream->checkpoint >= FIRMWARE_CHECKPOINT_BYTES) {
+        return save_checkpoint(stream);
+    }
+    return 0;
+}
+
+// Grava um bloco fora de ordem no seu offset (segmentos paralelos e chunks baixados de novo)
+static int store_firmware_at(FirmwareStream *stream, const unsigned char *data, size_t len, size_t offset) {
+    if (pwrite_all(stream->fd, data, len, (off_t)offset) != 0) {
+        perror("Erro ao gravar o firmware");
+        return -1;
+    }
+    if (stream->chunks && chunk_verifier_received(stream->chunks, offset, len) != 0) {
+        stream->discard = 1;
+        return -1;
+    }
+    return 0;
+}
+
+// Sink dos chunks baixados de novo após falharem na verificação
+static int chunk_repair_sink(const unsigned char *data, size_t len, size_t offset, void *userdata) {
+    return store_firmware_at((FirmwareStream *)userdata, data, len, offset);
+}
+
+// Sink do download: grava o bloco no destino e, no modo sequencial, o inclui no hash
+static int firmware_sink(const unsigned char *data, size_t len, size_t offset, void *userdata) {
+    FirmwareStream *stream = (FirmwareStream *)userdata;
 
-    return value;
+    if (stream->parallel) return store_firmware_at(stream, data, len, offset);
+
+    if (offset != stream->position) {
+        // O servidor ignorou o Range e reenviou o arquivo desde o início
+        if (offset != 0) {
+            fprintf(stderr, "Bloco fora de ordem no download (offset %zu, esperado %zu).\n",
+                    offset, stream->position);
+            return -1;
+        }
+        printf("   Servidor não aceitou retomar; baixando desde o início.\n");
+        if (rewind_firmware(stream) != 0) return -1;
+    }
+    return write_firmware(stream, data, len);
+}
+
+// Saída do aplicador do patch: os bytes reconstruídos seguem o mesmo caminho da imagem completa
+static int delta_output(const unsigned char *data, size_t len, void *userdata) {
+    return write_firmware((FirmwareStream *)userdata, data, len);
+}
+
+// Saída da descompressão (ou o próprio payload, se não comprimido)
+static int decoded_output(const unsigned char *data, size_t len, void *userdata) {
+    FirmwareStream *stream = (FirmwareStream *)userdata;
+
+    if (stream->patcher) return delta_patcher_feed(stream->patcher, data, len);
+    return write_firmware(stream, data, len);
 }
 
+// Sink dos payloads transformados: cada bloco atravessa as etapas assim que chega
+static int payload_sink(const unsigned char *data, size_t len, size_t offset, void *userdata) {
+    FirmwareStream *stream = (FirmwareStream *)userdata;
+
+    if (offset != stream->payload_position) {
+        if (offset != 0) {
+            fprintf(stderr, "Bloco fora de ordem no download (offset %zu, esperado %zu).\n",
+                    offset, stream->payload_position);
+            return -1;
+        }
+        // Servidor ignorou o Range: o payload recomeça, e todas as etapas também
+        if (stream->decompressor && decompressor_reset(stream->decompressor) != 0) return -1;
+        if (stream->patcher) delta_patcher_reset(stream->patcher);
+        if (rewind_firmware(stream) != 0) return -1;
+        stream->payload_position = 0;
+    }
+
+    if (stream->decompressor) {
+        if (decompressor_feed(stream->decompressor, data, len) != 0) return -1;
+    } else if (decoded_output(data, len, stream) != 0) {
+        return -1;
+    }
+    stream->payload_position += len;
+    return 0;
+}
+
+/**
+ * @brief Abre o destino do firmware, retomando o download anterior da mesma versão se houver.
+ * O arquivo de staging é criado; uma partição é apenas sobrescrita.
+ * @param chunk_list Manifesto em chunks autenticado (NULL: verificação pelo hash da imagem).
+ * @param chunks Verificador dos chunks, iniciado sobre o destino quando há manifesto.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+static int open_firmware_target(FirmwareStream *stream, const char *path, const ChunkList *chunk_list,
+                                ChunkVerifier *chunks)
+{
+    size_t resume_at = load_checkpoint(stream);
+
+    stream->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC | (resume_at > 0 ? 0 : O_TRUNC), 0600);
+    if (stream->fd < 0) {
+        fprintf(stderr, "Erro ao abrir o destino do firmware (%s): %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (chunk_list) {
+        if (chunk_verifier_init(chunks, chunk_list, stream->fd) != 0) return -1;
+        stream->chunks = chunks;
+    }
+    if (resume_at == 0) return 0;
+
+    // Com o manifesto em chunks, os bytes já gravados são verificados em paralelo, chunk a
+    // chunk; um chunk inválido será baixado de novo no final
+    if (stream->chunks) {
+        printf("   Retomando download anterior a partir do byte %zu.\n", resume_at);
+        if (lseek(stream->fd, (off_t)resume_at, SEEK_SET) < 0 ||
+            chunk_verifier_received(stream->chunks, 0, resume_at) != 0) {
+            return -1;
+        }
+        stream->position = resume_at;
+        stream->checkpoint = resume_at;
+        return 0;
+    }
+
+    // O hash não pode ser persistido: os bytes já gravados são relidos do disco (muito mais
+    // barato que baixá-los de novo)
+    printf("   Retomando download anterior a partir do byte %zu.\n", resume_at);
+    if (hash_written_firmware(stream, resume_at) != 0 ||
+        lseek(stream->fd, (off_t)resume_at, SEEK_SET) < 0) {
+        // Estado inconsistente com o arquivo: recomeça do zero
+        if (ftruncate(stream->fd, 0) != 0 && errno != EINVAL) return -1;
+        lseek(stream->fd, 0, SEEK_SET);
+        firmware_verifier_reset(&stream->verifier);
+        unlink(stream->paths->state);
+        return 0;
+    }
+    stream->position = resume_at;
+    stream->checkpoint = resume_at;
+    return 0;
+}
+
+/**
+ * @brief Baixa o firmware para o destino: retoma o download anterior, ou usa segmentos
+ * paralelos quando configurado e suportado pelo servidor, ou baixa sequencialmente.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+static int fetch_firmware(NetworkContext *net, FirmwareStream *stream, const char *url) {
+    size_t size = 0;
+    int accepts_ranges = 0;
+
+    if (OTA_DOWNLOAD_SEGMENTS > 1 && stream->position == 0 &&
+        get_remote_file_info(net, url, &size, &accepts_ranges) == 0 && accepts_ranges && size > 0) {
+        printf("   Download em %d segmentos paralelos (%zu bytes).\n", OTA_DOWNLOAD_SEGMENTS, size);
+        stream->parallel = 1;
+        unlink(stream->paths->state); // Um arquivo com lacunas não pode ser retomado
+        if (download_firmware_parallel(net, url, size, OTA_DOWNLOAD_SEGMENTS, firmware_sink, stream) != 0) {
+            stream->discard = 1;
+            return -1;
+        }
+        // Regular: descarta sobras de um download maior; partição: ftruncate falha com EINVAL
+        if (ftruncate(stream->fd, (off_t)size) != 0 && errno != EINVAL) {
+            perror("Erro ao ajustar o tamanho do firmware");
+            return -1;
+        }
+        stream->position = size;
+        // Com o manifesto em chunks, cada chunk já foi verificado ao ficar completo
+        return stream->chunks ? 0 : hash_written_firmware(stream, size);
+    }
+
+    if (download_firmware_stream(net, url, stream->position, firmware_sink, stream) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Baixa um payload transformado (patch delta e/ou imagem comprimida) e reconstrói a
+ * nova imagem no destino. Não é retomável entre execuções (o estado das etapas se perde).
+ * @param old_image_path Imagem atual, base do patch (NULL: o payload é a imagem completa).
+ * @param old_image_size Tamanho da imagem atual (0 = o tamanho do arquivo).
+ * @param compression Compressão do payload.
+ * @return int 0 em caso de sucesso, -1 em caso de falha (o chamador recorre à imagem pura).
+ */
+static int fetch_payload(NetworkContext *net, FirmwareStream *stream, const char *url,
+                         const char *old_image_path, size_t old_image_size, CompressionType compression)
+{
+    DeltaPatcher patcher;
+    Decompressor decompressor;
+    int ret = -1;
+
+    if (decompressor_init(&decompressor, compression, decoded_output, stream) != 0) {
+        return -1;
+    }
+    if (old_image_path &&
+        delta_patcher_init(&patcher, old_image_path, old_image_size, delta_output, stream) != 0) {
+        decompressor_free(&decompressor);
+        return -1;
+    }
+    stream->decompressor = compression != COMPRESSION_NONE ? &decompressor : NULL;
+    stream->patcher = old_image_path ? &patcher : NULL;
+    stream->payload_position = 0;
+
+    if (download_firmware_stream(net, url, 0, payload_sink, stream) == 0 &&
+        decompressor_finish(&decompressor) == 0 &&
+        (!stream->patcher || delta_patcher_finish(&patcher) == 0)) {
+        if (fsync(stream->fd) != 0) {
+            perror("Erro ao sincronizar o firmware no disco");
+        } else {
+            printf("   Payload de %zu bytes processado: imagem de %zu bytes gravada.\n",
+                   stream->payload_position, stream->position);
+            ret = 0;
+        }
+    }
+
+    if (stream->patcher) delta_patcher_free(&patcher);
+    decompressor_free(&decompressor);
+    stream->patcher = NULL;
+    stream->decompressor = NULL;
+    return ret;
+}
+
+/**
+ * @brief Conclui a verificação pelo manifesto em chunks: espera as threads de verificação e
+ * baixa de novo, por Range, apenas os chunks inválidos.
+ * @return int 1 se todos os chunks são válidos, 0 ou -1 caso contrário.
+ */
+static int verify_firmware_chunks(NetworkContext *net, FirmwareStream *stream, const char *firmware_url) {
+    ChunkVerifier *chunks = stream->chunks;
+
+    printf("5. Verificando %u chunks de %u bytes contra o manifesto assinado (threads de verificação: %d)...\n",
+           chunks->list.count, chunks->list.chunk_size, chunks->thread_count);
+    if (stream->position != chunks->list.image_size) {
+        printf("❌ Tamanho do firmware (%zu bytes) difere do manifesto (%llu bytes).\n",
+               stream->position, (unsigned long long)chunks->list.image_size);
+        return 0;
+    }
+
+    for (int round = 0; chunk_verifier_wait(chunks) > 0; round++) {
+        if (round == DOWNLOAD_MAX_RETRIES) {
+            printf("❌ Chunks continuam inválidos após %d tentativas.\n", DOWNLOAD_MAX_RETRIES);
+            return 0;
+        }
+        for (uint32_t i = 0; i < chunks->list.count; i++) {
+            size_t offset, length;
+
+            if (!chunk_verifier_rearm(chunks, i, &offset, &length)) continue;
+            printf("   Chunk %u inválido; baixando novamente os bytes %zu-%zu.\n", i, offset, offset + length - 1);
+            if (download_firmware_range(net, firmware_url, offset, length, chunk_repair_sink, stream) != 0) {
+                return -1;
+            }
+        }
+    }
+    if (!chunk_verifier_complete(chunks)) return 0;
+    if (fsync(stream->fd) != 0) {
+        perror("Erro ao sincronizar o firmware no disco");
+        return -1;
+    }
+    printf("✅ Integridade e autenticidade verificadas: %u chunks correspondem ao manifesto assinado.\n",
+           chunks->list.count);
+    return 1;
+}
+
+/**
+ * @brief Conclui a verificação de integridade e autenticidade do firmware gravado.
+ * @param firmware_url Imagem sem compressão, de onde chunks inválidos são baixados de novo.
+ * @return int 1 se válido, 0 ou -1 caso contrário.
+ */
+static int verify_firmware_stream(NetworkContext *net, FirmwareStream *stream, const char *firmware_url,
+                                  const char *firmware_hash, const DownloadBuffer *signature)
+{
+    double started = now_seconds();
+    int ret;
+
+    if (stream->chunks) {
+        // Os hashes dos chunks ainda pendentes (e os reparos) são o fim da etapa de hash
+        ret = verify_firmware_chunks(net, stream, firmware_url);
+        add_stage_time(stream->stats, OTA_STAGE_HASH, started);
+        return ret;
+    }
+
+    printf("5. Verificando integridade (SHA256) e autenticidade (%s)... Hash esperado: %s\n",
+           PUBLIC_KEY_PATH, firmware_hash);
+    ret = firmware_verifier_final(&stream->verifier, firmware_hash, signature->data, signature->size);
+    add_stage_time(stream->stats, OTA_STAGE_SIGNATURE, started);
+    return ret;
+}
+
+/**
+ * @brief Obtém e autentica o manifesto em chunks (lista assinada com a mesma chave do firmware).
+ * Os hashes vêm embutidos no manifesto (chunk_digests) ou de uma lista externa (chunks_url).
+ * @param list_buffer Recebe a lista; deve continuar alocada enquanto chunk_list for usada.
+ * @return int 0 em caso de sucesso, -1 se o manifesto não pode ser usado.
+ */
+static int fetch_chunk_list(NetworkContext *net, const OtaManifest *manifest, const TrustStore *trust,
+                            DownloadBuffer *list_buffer, ChunkList *chunk_list)
+{
+    DownloadBuffer list_signature = {0};
+    int ret = -1;
+
+    if (manifest->chunk_count > 0 && manifest->chunk_size > 0 && manifest->size > 0 &&
+        manifest->chunk_count <= UINT32_MAX) {
+        // Lista embutida: a forma assinada (cabeçalho + hashes) é remontada, sem baixar nada
+        list_buffer->size = CHUNK_LIST_HEADER_SIZE + manifest->chunk_count * SHA256_HASH_SIZE;
+        list_buffer->data = malloc(list_buffer->size);
+        if (!list_buffer->data) goto cleanup;
+        chunk_list_write_header(list_buffer->data, manifest->size, manifest->chunk_size,
+                                (uint32_t)manifest->chunk_count);
+        memcpy(list_buffer->data + CHUNK_LIST_HEADER_SIZE, manifest->chunk_digests,
+               manifest->chunk_count * SHA256_HASH_SIZE);
+    } else {
+        printf("   Baixando o manifesto em chunks...\n");
+        if (download_firmware(net, manifest->chunks_url, list_buffer) != 0) goto cleanup;
+    }
+    if (download_firmware(net, manifest->chunks_signature_url, &list_signature) != 0) goto cleanup;
+    if (chunk_list_parse(list_buffer->data, list_buffer->size, chunk_list) != 0) goto cleanup;
+    // A assinatura cobre a lista inteira (a raiz): os hashes dos chunks herdam a autenticidade
+    if (verify_firmware_signature(list_buffer->data, list_buffer->size, list_signature.data,
+                                  list_signature.size, trust) != 1) {
+        goto cleanup;
+    }
+    printf("   Manifesto autenticado: %u chunks de %u bytes.\n", chunk_list->count, chunk_list->chunk_size);
+    ret = 0;
+
+cleanup:
+    if (list_signature.data) free(list_signature.data);
+    return ret;
+}
+
+// Remove o firmware do staging: rejeitado (para nunca ser aplicado por engano) ou já gravado no slot
+static void discard_firmware_target(int fd, const OtaPaths *paths) {
+    struct stat st;
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) unlink(paths->staging);
+    unlink(paths->state);
+    close(fd);
+}
+
+// Monta um caminho dentro do diretório de trabalho (NULL = diretório atual)
+static int work_path(char *out, const char *work_dir, const char *name) {
+    int n = work_dir ? snprintf(out, PATH_MAX, "%s/%s", work_dir, name) : snprintf(out, PATH_MAX, "%s", name);
+
+    if (n < 0 || n >= PATH_MAX) {
+        fprintf(stderr, "Caminho muito longo no diretório de trabalho: %s\n", work_dir);
+        return -1;
+    }
+    return 0;
+}
+
+static int build_paths(OtaPaths *paths, const char *work_dir) {
+    return work_path(paths->staging, work_dir, FIRMWARE_STAGING_PATH) != 0 ||
+           work_path(paths->state, work_dir, FIRMWARE_STATE_PATH) != 0 ||
+           work_path(paths->state_tmp, work_dir, FIRMWARE_STATE_PATH ".tmp") != 0 ||
+           work_path(paths->slots[0], work_dir, FIRMWARE_SLOT_A_PATH) != 0 ||
+           work_path(paths->slots[1], work_dir, FIRMWARE_SLOT_B_PATH) != 0 ||
+           work_path(paths->slot_control, work_dir, FIRMWARE_SLOT_CONTROL_PATH) != 0 ||
+           work_path(paths->current, work_dir, CURRENT_FIRMWARE_PATH) != 0 ? -1 : 0;
+}
 
 int perform_ota_update(const char *version_check_url, const char *current_version) {
+    return perform_ota_update_with_options(version_check_url, current_version, NULL);
+}
+
+int perform_ota_update_with_options(const char *version_check_url, const char *current_version,
+                                    const OtaOptions *options)
+{
     char *response_json = NULL;
-    char *new_version = NULL;
-    char *firmware_url = NULL;
-    char *signature_url = NULL; 
-    char *firmware_hash = NULL;
+    OtaManifest manifest;      // Campos apontam para dentro de response_json
+    const ManifestDelta *delta = NULL;
+    CompressionType delta_type = COMPRESSION_NONE, image_type = COMPRESSION_NONE;
+    int verified = 0, fetched;
     
-    DownloadBuffer firmware_buffer = {0};
     DownloadBuffer signature_buffer = {0}; // Novo buffer para a assinatura
+    DownloadBuffer chunk_list_buffer = {0};
+    ChunkList chunk_list;
+    ChunkVerifier chunk_verifier;
+    int use_chunks = 0;
+    FirmwareStream stream = { .fd = -1 };
+    NetworkContext net; // Uma conexão (e uma sessão TLS) para toda a atualização
+    const TrustStore *trust;
+    PartitionSlots slots;
+    PartitionWriteStats write_stats;
+    const char *current_image;
+    size_t current_image_size = 0;
+    int target_slot;
+    OtaPaths paths;
+    OtaStats stats;
+    double started = now_seconds(), hash_before;
     
     int ret = -1; // Status inicial de falha
 
+    memset(&stats, 0, sizeof(stats));
     printf("--- Iniciando Cliente OTA (Versão Atual: %s) ---\n", current_version);
 
+    trust = trusted_keys();
+    if (!trust || build_paths(&paths, options ? options->work_dir : NULL) != 0 ||
+        network_context_init(&net) != 0) {
+        return -1;
+    }
+    stream.paths = &paths;
+    stream.stats = &stats;
+    if (options) {
+        net.max_recv_speed = options->max_recv_speed;
+        net.gate = options->download_allowed;
+        net.gate_userdata = options->userdata;
+    }
+
     // 1. Verificação de Versão e Obtenção de URLs
     printf("1. Verificando nova versão em: %s\n", version_check_url);
 
-    if (check_version_availability(version_check_url, &response_json) != 0 || response_json == NULL) {
+    if (check_version_availability(&net, version_check_url, &response_json) != 0 || response_json == NULL) {
         fprintf(stderr, "Erro ao verificar a disponibilidade da versão.\n");
         goto cleanup;
     }
 
-    // 2. Análise do JSON
-    printf("   Resposta do servidor: %s\n", response_json);
-    
-    new_version = simple_json_extract(response_json, "version");
-    firmware_url = simple_json_extract(response_json, "url");
-    signature_url = simple_json_extract(response_json, "signature_url"); // Extrai URL da assinatura
-    firmware_hash = simple_json_extract(response_json, "hash");
+    // 2. Análise do JSON (uma passada, sem alocações: os campos apontam para a resposta)
+    // Manifestos com listas de chunks podem ter centenas de KB: só o início vai para o log
+    printf("   Resposta do servidor (%zu bytes): %.512s%s\n", strlen(response_json), response_json,
+           strlen(response_json) > 512 ? "..." : "");
 
-    if (!new_version || !firmware_url || !signature_url || !firmware_hash) {
+    if (manifest_parse(response_json, strlen(response_json), &manifest) != 0) {
+        goto cleanup;
+    }
+    if (!manifest.version || !manifest.url || !manifest.signature_url || !manifest.hash) {
         fprintf(stderr, "Erro: Falha ao analisar JSON (version, url, signature_url ou hash ausentes).\n");
         goto cleanup;
     }
+    add_stage_time(&stats, OTA_STAGE_MANIFEST, started);
 
     // 3. Comparação de Versão
-    if (strcmp(new_version, current_version) <= 0) {
+    if (strcmp(manifest.version, current_version) <= 0) {
         printf("☑️ Versão atual (%s) é a mais recente. Nenhuma atualização necessária.\n", current_version);
         ret = 0;
         goto cleanup;
     }
 
-    printf("2. Nova versão disponível: %s\n", new_version);
-    printf("   URL de download do Firmware: %s\n", firmware_url);
-    printf("   URL de download da Assinatura: %s\n", signature_url);
-
-    // 4. Download do Firmware
-    printf("3. Baixando o firmware...\n");
-    if (download_firmware(firmware_url, &firmware_buffer) != 0) {
-        fprintf(stderr, "Erro ao baixar o firmware.\n");
+    if (partition_slots_load(&slots, paths.slots[0], paths.slots[1], paths.slot_control, current_version) != 0) {
         goto cleanup;
     }
-    printf("   Download do Firmware concluído. Tamanho: %zu bytes.\n", firmware_buffer.size);
-    
-    // 5. Download da Assinatura
-    printf("4. Baixando a assinatura digital...\n");
-    if (download_firmware(signature_url, &signature_buffer) != 0) { // Reutiliza a função de download
+    // O outro slot tem uma imagem que ainda não rodou: gravar agora exigiria usar o slot em execução
+    if (PARTITION_UPDATE_PENDING(&slots)) {
+        printf("☑️ Versão %s já gravada no slot %c, aguardando o reinício.\n",
+               slots.versions[slots.active], PARTITION_SLOT_NAME(slots.active));
+        if (strcmp(manifest.version, slots.versions[slots.active]) != 0) {
+            printf("   A versão %s será gravada depois que o sistema iniciar no slot %c.\n",
+                   manifest.version, PARTITION_SLOT_NAME(slots.active));
+        }
+        ret = 0;
+        goto cleanup;
+    }
+    target_slot = !slots.booted;
+
+    // Base dos patches delta: a imagem do slot em execução, com o tamanho registrado na gravação
+    // (o patch é escolhido pela versão atual, então ela precisa ser a desse slot). Antes da
+    // primeira atualização, a imagem de fábrica; sem base confiável, só a imagem completa serve.
+    current_image = NULL;
+    if (!slots.versions[slots.booted][0]) {
+        if (access(paths.current, R_OK) == 0) current_image = paths.current;
+    } else if (strcmp(slots.versions[slots.booted], current_version) == 0 && slots.image_sizes[slots.booted] > 0) {
+        current_image = slots.slot_paths[slots.booted];
+        current_image_size = slots.image_sizes[slots.booted];
+    }
+
+    printf("2. Nova versão disponível: %s\n", manifest.version);
+    printf("   Slot em execução: %c (%s); a nova versão será gravada no slot %c.\n", PARTITION_SLOT_NAME(slots.booted),
+           slots.versions[slots.booted][0] ? slots.versions[slots.booted] : "imagem de fábrica",
+           PARTITION_SLOT_NAME(target_slot));
+    printf("   URL de download do Firmware: %s\n", manifest.url);
+    printf("   URL de download da Assinatura: %s\n", manifest.signature_url);
+
+    // 4. Download da Assinatura (antes do firmware: a verificação termina junto com o download)
+    printf("3. Baixando a assinatura digital...\n");
+    started = now_seconds();
+    if (download_firmware(&net, manifest.signature_url, &signature_buffer) != 0) { // Reutiliza a função de download
         fprintf(stderr, "Erro ao baixar a assinatura.\n");
         goto cleanup;
     }
     printf("   Download da Assinatura concluído. Tamanho: %zu bytes.\n", signature_buffer.size);
 
-    // 6. Verificação de Integridade (SHA256)
-    printf("5. Verificando integridade (SHA256)... Hash esperado: %s\n", firmware_hash);
-    if (verify_firmware_integrity(firmware_buffer.data, firmware_buffer.size, firmware_hash) != 1) {
-        fprintf(stderr, "❌ Falha na verificação de integridade SHA256. Atualização abortada.\n");
+    if (manifest.chunks_signature_url && (manifest.chunk_count > 0 || manifest.chunks_url)) {
+        use_chunks = fetch_chunk_list(&net, &manifest, trust, &chunk_list_buffer, &chunk_list) == 0;
+        if (!use_chunks) printf("   Manifesto em chunks rejeitado; verificando pelo hash da imagem.\n");
+    }
+    add_stage_time(&stats, OTA_STAGE_SIGNATURE, started);
+
+    // 5. Download do Firmware em streaming para o destino, com hash incremental
+    stream.expected_hash = manifest.hash;
+    if (firmware_verifier_init(&stream.verifier, trust) != 0) {
+        goto cleanup;
+    }
+    if (open_firmware_target(&stream, paths.staging, use_chunks ? &chunk_list : NULL,
+                             &chunk_verifier) != 0) {
         goto cleanup;
     }
 
-    // 7. Verificação de Autenticidade (Assinatura Digital)
-    printf("6. Verificando autenticidade (Assinatura Digital - %s)...", PUBLIC_KEY_PATH);
+    // 5a. Patch delta, quando o servidor oferece um a partir da versão atual (um download
+    // interrompido da imagem completa tem prioridade: retomá-lo já está pela metade)
+    delta = current_image ? manifest_find_delta(&manifest, current_version) : NULL;
+    if (delta && stream.position == 0 && compression_from_name(delta->compression, &delta_type) == 0) {
+        printf("4. Baixando o patch delta %s -> %s para %s...\n", delta->from, manifest.version, paths.staging);
+        started = now_seconds();
+        hash_before = stats.seconds[OTA_STAGE_HASH];
+        fetched = fetch_payload(&net, &stream, delta->url, current_image, current_image_size, delta_type) == 0;
+        add_download_time(&stats, started, hash_before);
+        if (fetched) {
+            verified = verify_firmware_stream(&net, &stream, manifest.url, manifest.hash, &signature_buffer) == 1;
+        }
+        if (!verified) {
+            printf("   Patch delta não aplicado; recorrendo à imagem completa.\n");
+            if (rewind_firmware(&stream) != 0) goto cleanup;
+        }
+    }
+
+    // 5b. Imagem completa comprimida, descomprimida em streaming (formatos não suportados
+    // pelo cliente são ignorados)
+    if (!verified && manifest.compressed_url && stream.position == 0 &&
+        compression_from_name(manifest.compression, &image_type) == 0 && image_type != COMPRESSION_NONE) {
+        printf("4. Baixando o firmware comprimido (%s) para %s...\n", manifest.compression, paths.staging);
+        started = now_seconds();
+        hash_before = stats.seconds[OTA_STAGE_HASH];
+        fetched = fetch_payload(&net, &stream, manifest.compressed_url, NULL, 0, image_type) == 0;
+        add_download_time(&stats, started, hash_before);
+        if (fetched) {
+            verified = verify_firmware_stream(&net, &stream, manifest.url, manifest.hash, &signature_buffer) == 1;
+        }
+        if (!verified) {
+            printf("   Imagem comprimida não aplicada; recorrendo à imagem sem compressão.\n");
+            if (rewind_firmware(&stream) != 0) goto cleanup;
+        }
+    }
+
+    // 5c. Imagem completa sem compressão (retomável e com segmentos paralelos)
+    if (!verified) {
+        printf("4. Baixando o firmware para %s...\n", paths.staging);
+        started = now_seconds();
+        hash_before = stats.seconds[OTA_STAGE_HASH];
+        if (fetch_firmware(&net, &stream, manifest.url) != 0) {
+            fprintf(stderr, "Erro ao baixar o firmware.\n");
+            goto cleanup;
+        }
+        if (fsync(stream.fd) != 0) {
+            perror("Erro ao sincronizar o firmware no disco");
+            goto cleanup;
+        }
+        add_download_time(&stats, started, hash_before);
+        printf("   Download do Firmware concluído. Tamanho: %zu bytes.\n", stream.position);
+
+        // 6. Verificação de Integridade (SHA256) e Autenticidade (Assinatura Digital)
+        if (verify_firmware_stream(&net, &stream, manifest.url, manifest.hash, &signature_buffer) != 1) {
+            fprintf(stderr, "❌ Falha na verificação do firmware. Atualização abortada.\n");
+            stream.discard = 1;
+            goto cleanup;
+        }
+    }
     
-    // Chamada à função de segurança aprimorada (OpenSSL)
-    // OBS: Esta função precisa ser implementada em security_manager.c
-    if (verify_firmware_signature(
-        firmware_buffer.data, firmware_buffer.size, 
-        signature_buffer.data, signature_buffer.size, 
-        PUBLIC_KEY_PATH) != 1) 
-    {
-        fprintf(stderr, "❌ Falha na autenticação da assinatura digital. Atualização abortada.\n");
+    // 8. Aplicação da Atualização: gravação no slot inativo, releitura e troca do slot ativo
+    printf("6. Atualização segura e autêntica. Gravando o novo firmware no slot %c (%s)...\n",
+           PARTITION_SLOT_NAME(target_slot), slots.slot_paths[target_slot]);
+    started = now_seconds();
+    if (partition_write_image(&slots, target_slot, stream.fd, stream.position, manifest.hash, &write_stats) != 0) {
+        fprintf(stderr, "❌ Falha ao gravar o slot %c. O sistema continua no slot %c.\n",
+                PARTITION_SLOT_NAME(target_slot), PARTITION_SLOT_NAME(slots.booted));
         goto cleanup;
     }
-    
-    // 8. Aplicação da Atualização
-    printf("7. Atualização segura e autêntica. Aplicando o novo firmware...\n");
-    printf("   [SIMULAÇÃO] Firmware escrito com sucesso em /dev/fw_partition...\n");
-    printf("   [SIMULAÇÃO] Sistema será reiniciado para Versão %s...\n", new_version);
+    printf("   %zu bytes gravados, %zu já iguais no slot (%s, %u sincronizações); releitura confere com o hash.\n",
+           write_stats.written, write_stats.skipped, write_stats.direct ? "O_DIRECT" : "buffered", write_stats.syncs);
+    if (partition_set_active(&slots, target_slot, manifest.version, stream.position) != 0) {
+        goto cleanup;
+    }
+    add_stage_time(&stats, OTA_STAGE_APPLY, started);
+    printf("   Slot %c ativo: o sistema iniciará na Versão %s no próximo boot.\n",
+           PARTITION_SLOT_NAME(target_slot), manifest.version);
+    stats.image_bytes = stream.position;
 
+    // O staging já foi copiado para o slot: nada mais a retomar
+    discard_firmware_target(stream.fd, &paths);
+    stream.fd = -1;
     ret = 0; // Sucesso
     
 cleanup:
-    // Limpeza de buffers
-    if (firmware_buffer.data) {
-        free(firmware_buffer.data);
+    // As threads de verificação releem o destino: param antes de ele ser fechado
+    if (stream.chunks) chunk_verifier_free(stream.chunks);
+    if (stream.fd >= 0) {
+        if (stream.discard) {
+            discard_firmware_target(stream.fd, &paths);
+        } else {
+            // Falha de rede: mantém o que já foi gravado para a próxima tentativa retomar
+            save_checkpoint(&stream);
+            close(stream.fd);
+        }
     }
+    firmware_verifier_free(&stream.verifier);
+
+    // Limpeza de buffers
     if (signature_buffer.data) {
         free(signature_buffer.data);
     }
+    if (chunk_list_buffer.data) free(chunk_list_buffer.data);
+
+    printf("   Rede: %ld requisições, %ld conexões abertas, %lld bytes recebidos.\n",
+           net.requests, net.connections, net.received_bytes);
+    printf("   Tempos (ms): manifesto %.1f, assinatura %.1f, download %.1f, hash %.1f, aplicação %.1f.\n",
+           stats.seconds[OTA_STAGE_MANIFEST] * 1e3, stats.seconds[OTA_STAGE_SIGNATURE] * 1e3,
+           stats.seconds[OTA_STAGE_DOWNLOAD] * 1e3, stats.seconds[OTA_STAGE_HASH] * 1e3,
+           stats.seconds[OTA_STAGE_APPLY] * 1e3);
+    stats.received_bytes = net.received_bytes;
+    stats.requests = net.requests;
+    stats.connections = net.connections;
+    if (options && options->stats) *options->stats = stats;
+    network_context_cleanup(&net);
 
-    // Limpeza de strings alocadas (funções json_extract e network_manager)
+    // Os campos do manifesto apontam para dentro da resposta: nada mais a liberar
     if (response_json) free(response_json);
-    if (new_version) free(new_version);
-    if (firmware_url) free(firmware_url);
-    if (signature_url) free(signature_url);
-    if (firmware_hash) free(firmware_hash);
 
     printf("--- Processo OTA Concluído ---\n");
 
@@ -1,6 +1,36 @@
 #ifndef OTA_CLIENT_H
 #define OTA_CLIENT_H
 
+#include <stddef.h>
+
+// Etapas de uma atualização, medidas em OtaStats
+typedef enum {
+    OTA_STAGE_MANIFEST = 0,    // Consulta e análise do manifesto
+    OTA_STAGE_SIGNATURE,       // Download da assinatura e autenticação (imagem e manifesto em chunks)
+    OTA_STAGE_DOWNLOAD,        // Download do firmware, sem o tempo do hash calculado durante a recepção
+    OTA_STAGE_HASH,            // SHA256 da imagem (incremental, releituras e verificação dos chunks)
+    OTA_STAGE_APPLY,           // Gravação no slot inativo, releitura e troca do slot ativo
+    OTA_STAGE_COUNT
+} OtaStage;
+
+typedef struct {
+    double seconds[OTA_STAGE_COUNT];
+    size_t image_bytes;        // Tamanho da imagem aplicada (0 se nada foi aplicado)
+    long long received_bytes;  // Bytes recebidos da rede, em todas as requisições
+    long requests;
+    long connections;
+} OtaStats;
+
+typedef struct {
+    const char *work_dir;      // Diretório do staging, do estado e dos slots (NULL = diretório atual)
+    OtaStats *stats;           // Opcional: recebe as métricas da atualização
+    long long max_recv_speed;  // Limite de banda dos downloads em bytes/s (0 = sem limite)
+    // Opcional: consultada durante os downloads; ao retornar 0 o download é interrompido e o que
+    // já foi gravado fica no staging, para a próxima chamada retomar
+    int (*download_allowed)(void *userdata);
+    void *userdata;
+} OtaOptions;
+
 /**
  * @brief Executa o processo completo de verificação e atualização OTA.
  * * @param version_check_url URL para verificar a nova versão (JSON).
@@ -9,4 +39,13 @@
  */
 int perform_ota_update(const char *version_check_url, const char *current_version);
 
+/**
+ * @brief Igual a perform_ota_update, com diretório de trabalho e métricas. Várias atualizações
+ * podem rodar ao mesmo tempo em threads diferentes, cada uma com seu diretório de trabalho.
+ * @param options NULL = padrões de perform_ota_update.
+ * @return int 0 em caso de sucesso (atualização concluída ou não necessária), -1 em caso de falha.
+ */
+int perform_ota_update_with_options(const char *version_check_url, const char *current_version,
+                                    const OtaOptions *options);
+
 #endif // OTA_CLIENT_H
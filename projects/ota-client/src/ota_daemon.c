@@ -0,0 +1,267 @@
+#include "ota_daemon.h"
+#include "ota_client.h"
+#include "network_manager.h"
+#include "manifest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SECONDS_PER_DAY (24 * 3600)
+
+static volatile sig_atomic_t stop_requested;
+
+static void handle_stop(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+// Estado do daemon consultado durante os downloads (OtaOptions.download_allowed)
+typedef struct {
+    const OtaDaemonConfig *config;
+    time_t checked_at;         // A janela é reavaliada no máximo uma vez por segundo
+    int allowed;
+    unsigned int seed;         // Jitter (rand_r)
+} DaemonState;
+
+void ota_daemon_config_init(OtaDaemonConfig *config, const char *version_check_url, const char *current_version) {
+    memset(config, 0, sizeof(*config));
+    config->version_check_url = version_check_url;
+    config->current_version = current_version;
+    config->poll_interval_s = OTA_DAEMON_POLL_INTERVAL_S;
+    config->max_backoff_s = OTA_DAEMON_MAX_BACKOFF_S;
+}
+
+// "HH:MM" em minutos desde 00:00; end aponta para o caractere seguinte
+static int parse_clock(const char *text, char **end) {
+    long hours = strtol(text, end, 10), minutes;
+
+    if (*end == text || **end != ':' || hours < 0 || hours > 23) return -1;
+    text = *end + 1;
+    minutes = strtol(text, end, 10);
+    if (*end - text != 2 || minutes < 0 || minutes > 59) return -1;
+    return (int)(hours * 60 + minutes);
+}
+
+int ota_daemon_parse_windows(OtaDaemonConfig *config, const char *spec) {
+    const char *p = spec;
+
+    config->window_count = 0;
+    while (*p) {
+        OtaWindow *window;
+        char *end;
+
+        if (config->window_count == OTA_DAEMON_MAX_WINDOWS) {
+            fprintf(stderr, "Erro: no máximo %d janelas de download.\n", OTA_DAEMON_MAX_WINDOWS);
+            return -1;
+        }
+        window = &config->windows[config->window_count];
+        window->start = parse_clock(p, &end);
+        if (window->start < 0 || *end != '-') goto invalid;
+        window->end = parse_clock(end + 1, &end);
+        if (window->end < 0 || window->end == window->start || (*end != ',' && *end != '\0')) goto invalid;
+        config->window_count++;
+        p = *end == ',' ? end + 1 : end;
+    }
+    if (config->window_count > 0) return 0;
+
+invalid:
+    fprintf(stderr, "Erro: janela de download inválida em \"%s\" (formato HH:MM-HH:MM[,...]).\n", spec);
+    return -1;
+}
+
+static int seconds_of_day(time_t now) {
+    struct tm local;
+
+    localtime_r(&now, &local);
+    return local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+}
+
+static int window_contains(const OtaWindow *window, int minute) {
+    if (window->start < window->end) return minute >= window->start && minute < window->end;
+    return minute >= window->start || minute < window->end; // Atravessa a meia-noite
+}
+
+// Segundos até a próxima janela abrir (0 = alguma janela está aberta agora)
+static int seconds_until_window(const OtaDaemonConfig *config, time_t now) {
+    int now_s = seconds_of_day(now), best = SECONDS_PER_DAY;
+
+    if (config->window_count == 0) return 0;
+    for (int i = 0; i < config->window_count; i++) {
+        int wait;
+
+        if (window_contains(&config->windows[i], now_s / 60)) return 0;
+        wait = (config->windows[i].start * 60 - now_s + SECONDS_PER_DAY) % SECONDS_PER_DAY;
+        if (wait < best) best = wait;
+    }
+    return best;
+}
+
+// Chamada pelo libcurl durante os downloads: a janela fechou ou o daemon vai parar
+static int download_allowed(void *userdata) {
+    DaemonState *state = (DaemonState *)userdata;
+    time_t now = time(NULL);
+
+    if (now != state->checked_at) {
+        state->checked_at = now;
+        state->allowed = seconds_until_window(state->config, now) == 0;
+    }
+    return state->allowed && !stop_requested;
+}
+
+// Metade fixa e metade aleatória: as consultas da frota se espalham, sem intervalos curtos demais
+static int jittered(DaemonState *state, int delay) {
+    if (delay < 2) return delay;
+    return delay / 2 + rand_r(&state->seed) % (delay / 2 + 1);
+}
+
+// Backoff exponencial após falhas seguidas, limitado por max_backoff_s (começa no intervalo das
+// consultas, se ele for menor que OTA_DAEMON_RETRY_BASE_S)
+static int backoff_delay(const OtaDaemonConfig *config, int failures) {
+    long delay = config->poll_interval_s < OTA_DAEMON_RETRY_BASE_S ? config->poll_interval_s : OTA_DAEMON_RETRY_BASE_S;
+
+    while (--failures > 0 && delay < config->max_backoff_s) delay *= 2;
+    return delay < config->max_backoff_s ? (int)delay : config->max_backoff_s;
+}
+
+// Dorme pelo tempo pedido ou até um sinal de parada (sleep retorna antes ao ser interrompido)
+static void daemon_sleep(int seconds) {
+    unsigned int remaining = seconds > 0 ? (unsigned int)seconds : 0;
+
+    while (remaining > 0 && !stop_requested) remaining = sleep(remaining);
+}
+
+/**
+ * @brief Consulta o manifesto se ele mudou desde a última consulta.
+ * @param available Recebe a versão anunciada (mantida se o manifesto não mudou).
+ * @return int 0 se o manifesto foi lido, 1 se não mudou, -1 em caso de falha.
+ */
+static int poll_manifest(NetworkContext *net, const char *url, char *etag, char *available) {
+    char *response_json = NULL;
+    OtaManifest manifest;
+    int ret = check_version_if_modified(net, url, etag, MANIFEST_ETAG_MAX, &response_json);
+
+    if (ret != 0) return ret;
+    if (manifest_parse(response_json, strlen(response_json), &manifest) != 0 || !manifest.version ||
+        strlen(manifest.version) >= OTA_DAEMON_VERSION_MAX) {
+        fprintf(stderr, "Daemon: manifesto inválido.\n");
+        etag[0] = '\0'; // A próxima consulta baixa o manifesto inteiro
+        free(response_json);
+        return -1;
+    }
+    strcpy(available, manifest.version);
+    free(response_json);
+    return 0;
+}
+
+/**
+ * @brief Baixa (com limite de banda, dentro da janela), verifica e aplica a versão nova.
+ * @return int 1 se foi aplicada, 0 se o download foi interrompido pela janela ou por um sinal
+ * (ou a atualização não era mais necessária), -1 em caso de falha.
+ */
+static int run_update(const OtaDaemonConfig *config, DaemonState *state, const char *current_version) {
+    OtaOptions options;
+    OtaStats stats;
+
+    memset(&options, 0, sizeof(options));
+    memset(&stats, 0, sizeof(stats));
+    options.work_dir = config->work_dir;
+    options.stats = &stats;
+    options.max_recv_speed = config->max_recv_speed;
+    options.download_allowed = download_allowed;
+    options.userdata = state;
+    state->checked_at = 0;
+
+    if (perform_ota_update_with_options(config->version_check_url, current_version, &options) == 0) {
+        return stats.image_bytes > 0;
+    }
+    if (!download_allowed(state)) {
+        printf("Daemon: download interrompido (janela encerrada ou parada); será retomado depois.\n");
+        return 0;
+    }
+    return -1;
+}
+
+int ota_daemon_run(const OtaDaemonConfig *config) {
+    struct sigaction action;
+    NetworkContext net; // Consultas ao manifesto (as atualizações usam um contexto próprio)
+    DaemonState state;
+    char etag[MANIFEST_ETAG_MAX] = "";
+    char current[OTA_DAEMON_VERSION_MAX], available[OTA_DAEMON_VERSION_MAX] = "";
+    char staged[OTA_DAEMON_VERSION_MAX] = ""; // Gravada no slot inativo, roda após o reinício
+    int failures = 0;
+
+    if (strlen(config->current_version) >= sizeof(current)) {
+        fprintf(stderr, "Erro: versão atual muito longa.\n");
+        return -1;
+    }
+    strcpy(current, config->current_version);
+
+    // Sem SA_RESTART: o sinal interrompe o sleep entre as consultas
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+    // O log vai para um pipe (journald, syslog): uma linha por vez
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    memset(&state, 0, sizeof(state));
+    state.config = config;
+    state.seed = (unsigned int)time(NULL) ^ (unsigned int)getpid();
+    if (network_context_init(&net) != 0) return -1;
+
+    printf("--- Daemon OTA (Versão Atual: %s) ---\n", current);
+    printf("   Consultas a cada %d s no máximo; limite de banda: ", config->poll_interval_s);
+    if (config->max_recv_speed > 0) printf("%lld KB/s", config->max_recv_speed / 1024);
+    else printf("nenhum");
+    printf("; %d janela(s) de download.\n", config->window_count);
+
+    while (!stop_requested) {
+        int polled = poll_manifest(&net, config->version_check_url, etag, available);
+        int ok = polled >= 0, delay;
+        int wait = -1; // Segundos até a janela de download, se uma versão nova espera por ela
+
+        if (polled < 0) fprintf(stderr, "Daemon: falha ao consultar o manifesto em %s.\n", config->version_check_url);
+        else if (polled == 1) printf("Daemon: manifesto não mudou (304).\n");
+
+        if (ok && available[0] && strcmp(available, current) > 0 && staged[0]) {
+            // O único slot livre já tem uma imagem esperando o boot: nada a gravar até o reinício
+            if (strcmp(available, staged) != 0) {
+                printf("Daemon: versão %s disponível; a versão %s aguarda o reinício.\n", available, staged);
+            }
+        } else if (ok && available[0] && strcmp(available, current) > 0) {
+            wait = seconds_until_window(config, time(NULL));
+            if (wait > 0) {
+                printf("Daemon: versão %s disponível; download quando a janela abrir (em %d s).\n", available, wait);
+            } else {
+                int updated;
+
+                printf("Daemon: versão %s disponível; baixando em segundo plano.\n", available);
+                updated = run_update(config, &state, current);
+                if (updated < 0) ok = 0;
+                if (updated == 1) {
+                    // current continua sendo a versão em execução (é ela que identifica o slot em uso)
+                    strcpy(staged, available);
+                    printf("Daemon: versão %s gravada no slot inativo; ativa no próximo boot.\n", staged);
+                }
+            }
+        }
+
+        failures = ok ? 0 : failures + 1;
+        delay = jittered(&state, failures ? backoff_delay(config, failures) : config->poll_interval_s);
+        if (wait > 0) {
+            // A frota não começa toda no mesmo segundo da abertura da janela
+            wait += rand_r(&state.seed) % (OTA_DAEMON_WINDOW_SPREAD_S + 1);
+            if (wait < delay) delay = wait;
+        }
+        if (failures) fprintf(stderr, "Daemon: %d falha(s) seguida(s); nova tentativa em %d s.\n", failures, delay);
+        daemon_sleep(delay);
+    }
+
+    network_context_cleanup(&net);
+    printf("--- Daemon OTA encerrado ---\n");
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef OTA_DAEMON_H
+#define OTA_DAEMON_H
+
+// Modo daemon: o manifesto é consultado periodicamente com If-None-Match (um manifesto igual
+// custa uma requisição, sem corpo), com jitter para que a frota não consulte o servidor ao
+// mesmo tempo e backoff exponencial após falhas. Uma versão nova é baixada em segundo plano
+// com limite de banda e só dentro das janelas permitidas: ao fechar a janela o download é
+// interrompido e retomado na próxima. Com a imagem completa, segue para a verificação e a
+// gravação no slot inativo (perform_ota_update_with_options).
+#define OTA_DAEMON_MAX_WINDOWS 8
+#define OTA_DAEMON_POLL_INTERVAL_S 3600      // Intervalo máximo entre consultas ao manifesto
+#define OTA_DAEMON_RETRY_BASE_S 60           // Primeiro intervalo após uma falha (dobra a cada falha seguida)
+#define OTA_DAEMON_MAX_BACKOFF_S (6 * 3600)  // Teto do backoff
+#define OTA_DAEMON_WINDOW_SPREAD_S 300       // Início espalhado na abertura da janela
+#define OTA_DAEMON_VERSION_MAX 64
+
+// Janela diária de download em minutos desde 00:00 (hora local); end < start atravessa a meia-noite
+typedef struct {
+    int start;
+    int end;
+} OtaWindow;
+
+typedef struct {
+    const char *version_check_url;
+    const char *current_version;
+    const char *work_dir;            // NULL = diretório atual
+    int poll_interval_s;
+    int max_backoff_s;
+    long long max_recv_speed;        // Limite do download em bytes/s (0 = sem limite)
+    OtaWindow windows[OTA_DAEMON_MAX_WINDOWS];
+    int window_count;                // 0 = qualquer horário
+} OtaDaemonConfig;
+
+/**
+ * @brief Preenche a configuração com os padrões (sem limite de banda, qualquer horário).
+ */
+void ota_daemon_config_init(OtaDaemonConfig *config, const char *version_check_url, const char *current_version);
+
+/**
+ * @brief Lê as janelas de download no formato "HH:MM-HH:MM[,HH:MM-HH:MM...]" (ex: "01:00-05:30").
+ * @return int 0 em caso de sucesso, -1 se o formato é inválido.
+ */
+int ota_daemon_parse_windows(OtaDaemonConfig *config, const char *spec);
+
+/**
+ * @brief Executa o daemon até receber SIGTERM ou SIGINT.
+ * @return int 0 ao encerrar por sinal, -1 se o daemon não pôde iniciar.
+ */
+int ota_daemon_run(const OtaDaemonConfig *config);
+
+#endif // OTA_DAEMON_H
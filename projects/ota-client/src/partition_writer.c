@@ -0,0 +1,324 @@
+#define _GNU_SOURCE // O_DIRECT
+#include "partition_writer.h"
+#include "security_manager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+
+// Identificador do boot atual; vazio se o kernel não o expõe
+static void read_boot_id(char *boot_id, size_t size) {
+    FILE *fp = fopen(PARTITION_BOOT_ID_PATH, "r");
+
+    boot_id[0] = '\0';
+    if (!fp) return;
+    if (!fgets(boot_id, (int)size, fp)) boot_id[0] = '\0';
+    boot_id[strcspn(boot_id, "\n")] = '\0';
+    fclose(fp);
+}
+
+static int slot_from_name(const char *name) {
+    return (name[0] == 'a' || name[0] == 'b') && name[1] == '\0' ? name[0] - 'a' : -1;
+}
+
+static int parse_control(PartitionSlots *slots, FILE *fp) {
+    char line[256], key[16], value[PARTITION_VERSION_MAX], version[PARTITION_VERSION_MAX];
+    unsigned long long image_size;
+    int fields, slot;
+
+    slots->active = slots->booted = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        fields = sscanf(line, "%15s %63s %63s %llu", key, value, version, &image_size);
+        if (fields < 1) continue;
+        if ((slot = slot_from_name(key)) >= 0) {
+            // Formato antigo: só o slot ativo, que é o em execução
+            slots->active = slots->booted = slot;
+            if (fields >= 2) snprintf(slots->versions[slot], sizeof(slots->versions[slot]), "%s", value);
+        } else if (fields >= 2 && strcmp(key, "active") == 0) {
+            slots->active = slot_from_name(value);
+        } else if (fields >= 2 && strcmp(key, "booted") == 0) {
+            slots->booted = slot_from_name(value);
+        } else if (fields >= 2 && strcmp(key, "staged_boot") == 0) {
+            snprintf(slots->staged_boot, sizeof(slots->staged_boot), "%s", value);
+        } else if (fields >= 3 && strcmp(key, "slot") == 0 && (slot = slot_from_name(value)) >= 0) {
+            snprintf(slots->versions[slot], sizeof(slots->versions[slot]), "%s", version);
+            if (fields == 4) slots->image_sizes[slot] = (size_t)image_size;
+        } else {
+            return -1;
+        }
+    }
+    return slots->active >= 0 && slots->booted >= 0 ? 0 : -1;
+}
+
+int partition_slots_load(PartitionSlots *slots, const char *slot_a, const char *slot_b, const char *control_path,
+                         const char *running_version)
+{
+    char boot_id[PARTITION_BOOT_ID_MAX];
+    FILE *fp;
+    int ret;
+
+    memset(slots, 0, sizeof(*slots));
+    slots->slot_paths[0] = slot_a;
+    slots->slot_paths[1] = slot_b;
+    slots->control_path = control_path;
+
+    fp = fopen(control_path, "r");
+    if (!fp) return errno == ENOENT ? 0 : -1; // Nunca atualizado: o sistema roda do slot A
+    ret = parse_control(slots, fp);
+    fclose(fp);
+    if (ret != 0) {
+        fprintf(stderr, "Arquivo de controle dos slots inválido (%s).\n", control_path);
+        return -1;
+    }
+
+    if (!PARTITION_UPDATE_PENDING(slots)) return 0;
+    if (running_version && strcmp(running_version, slots->versions[slots->active]) == 0) {
+        slots->booted = slots->active; // Reiniciou na imagem nova
+        return 0;
+    }
+    read_boot_id(boot_id, sizeof(boot_id));
+    if (boot_id[0] && slots->staged_boot[0] && strcmp(boot_id, slots->staged_boot) != 0) {
+        fprintf(stderr, "Slot %c não chegou a rodar: o sistema reiniciou no slot %c, que volta a ser o ativo.\n",
+                PARTITION_SLOT_NAME(slots->active), PARTITION_SLOT_NAME(slots->booted));
+        slots->active = slots->booted;
+    }
+    return 0;
+}
+
+// Lê até len bytes a partir de offset; menos que len só no fim do arquivo
+static ssize_t read_at(int fd, unsigned char *buf, size_t len, off_t offset) {
+    size_t done = 0;
+
+    while (done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, offset + (off_t)done);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
+
+static int write_at(int fd, const unsigned char *buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, offset);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+// Ponto de sincronização: sem O_DIRECT, as páginas já gravadas saem do cache (a RAM é pouca e
+// elas não serão lidas de novo até a releitura, que deve vir do dispositivo)
+static int sync_slot(int fd, int direct, off_t start, off_t len, PartitionWriteStats *stats) {
+    if (fdatasync(fd) != 0) return -1;
+    if (!direct) posix_fadvise(fd, start, len, POSIX_FADV_DONTNEED);
+    stats->syncs++;
+    return 0;
+}
+
+/**
+ * @brief Relê a imagem gravada no slot e compara seu SHA256 com o esperado.
+ * @return int 1 se corresponde, 0 caso contrário, -1 em caso de erro.
+ */
+static int verify_slot(int fd, size_t size, unsigned char *buffer, const char *expected_hash) {
+    EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+    unsigned char digest[SHA256_HASH_SIZE];
+    unsigned int digest_len = 0;
+    int ret = -1;
+
+    if (!md_ctx || EVP_DigestInit_ex(md_ctx, EVP_sha256(), NULL) != 1) goto cleanup;
+    for (size_t offset = 0; offset < size; offset += PARTITION_IO_SIZE) {
+        size_t len = size - offset < PARTITION_IO_SIZE ? size - offset : PARTITION_IO_SIZE;
+        size_t aligned = (len + PARTITION_ALIGN - 1) & ~(size_t)(PARTITION_ALIGN - 1);
+        ssize_t n = read_at(fd, buffer, aligned, (off_t)offset);
+
+        if (n < (ssize_t)len) {
+            fprintf(stderr, "Erro ao reler o slot: %s\n", n < 0 ? strerror(errno) : "slot menor que a imagem");
+            goto cleanup;
+        }
+        if (EVP_DigestUpdate(md_ctx, buffer, len) != 1) goto cleanup;
+    }
+    if (EVP_DigestFinal_ex(md_ctx, digest, &digest_len) != 1 || digest_len != SHA256_HASH_SIZE) goto cleanup;
+    ret = sha256_matches_hex(digest, expected_hash);
+
+cleanup:
+    EVP_MD_CTX_free(md_ctx);
+    return ret;
+}
+
+int partition_write_image(const PartitionSlots *slots, int slot, int source_fd, size_t size,
+                          const char *expected_hash, PartitionWriteStats *stats)
+{
+    const char *path = slots->slot_paths[slot];
+    unsigned char *image = NULL, *current = NULL;
+    off_t batch_start = 0, pending = 0;
+    struct stat st;
+    int fd, ret = -1;
+
+    memset(stats, 0, sizeof(*stats));
+    if (slot == slots->booted) {
+        fprintf(stderr, "Recusando gravar no slot em execução (%c).\n", PARTITION_SLOT_NAME(slot));
+        return -1;
+    }
+    if (PARTITION_UPDATE_PENDING(slots)) {
+        fprintf(stderr, "Recusando gravar: o slot %c aguarda o reinício.\n", PARTITION_SLOT_NAME(slots->active));
+        return -1;
+    }
+
+    // O_DIRECT: a imagem vai direto ao dispositivo, sem dobrar no page cache. Sistemas de
+    // arquivos sem suporte (ex: tmpfs) recusam com EINVAL: as escritas passam a ser buffered
+    stats->direct = 1;
+    fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC | O_DIRECT, 0600);
+    if (fd < 0 && errno == EINVAL) {
+        stats->direct = 0;
+        fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    }
+    if (fd < 0) {
+        fprintf(stderr, "Erro ao abrir o slot %c (%s): %s\n", PARTITION_SLOT_NAME(slot), path, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) != 0) goto cleanup;
+    // Partições não têm st_size: o tamanho vem do fim do dispositivo
+    if (!S_ISREG(st.st_mode)) {
+        off_t end = lseek(fd, 0, SEEK_END);
+
+        if (end < 0 || (unsigned long long)end < size) {
+            fprintf(stderr, "Imagem de %zu bytes não cabe no slot %c (%lld bytes).\n",
+                    size, PARTITION_SLOT_NAME(slot), (long long)end);
+            goto cleanup;
+        }
+    }
+
+    if (posix_memalign((void **)&image, PARTITION_ALIGN, PARTITION_IO_SIZE) != 0 ||
+        posix_memalign((void **)&current, PARTITION_ALIGN, PARTITION_IO_SIZE) != 0) {
+        fprintf(stderr, "Falha ao alocar os buffers de gravação.\n");
+        goto cleanup;
+    }
+    posix_fadvise(source_fd, 0, (off_t)size, POSIX_FADV_SEQUENTIAL);
+
+    for (size_t offset = 0; offset < size; offset += PARTITION_IO_SIZE) {
+        size_t len = size - offset < PARTITION_IO_SIZE ? size - offset : PARTITION_IO_SIZE;
+        // O último bloco é completado com zeros até o alinhamento (em arquivo, truncado depois)
+        size_t aligned = (len + PARTITION_ALIGN - 1) & ~(size_t)(PARTITION_ALIGN - 1);
+        ssize_t n = read_at(source_fd, image, len, (off_t)offset);
+
+        if (n != (ssize_t)len) {
+            fprintf(stderr, "Erro ao ler a imagem verificada: %s\n", n < 0 ? strerror(errno) : "arquivo curto");
+            goto cleanup;
+        }
+        memset(image + len, 0, aligned - len);
+
+        // Bloco já igual no slot (ex: gravação anterior interrompida): ler custa muito menos
+        // que gravar, tanto em tempo quanto em desgaste da flash
+        n = read_at(fd, current, aligned, (off_t)offset);
+        if (n >= (ssize_t)len && memcmp(image, current, len) == 0) {
+            stats->skipped += len;
+            continue;
+        }
+
+        if (write_at(fd, image, aligned, (off_t)offset) != 0) {
+            if (errno != EINVAL || !stats->direct) goto write_error;
+            // O_DIRECT aceito na abertura mas não na escrita: segue buffered
+            if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT) != 0 ||
+                write_at(fd, image, aligned, (off_t)offset) != 0) {
+                goto write_error;
+            }
+            stats->direct = 0;
+        }
+        stats->written += len;
+        if (pending == 0) batch_start = (off_t)offset;
+        pending = (off_t)(offset + aligned) - batch_start;
+        if (pending >= PARTITION_SYNC_BYTES) {
+            if (sync_slot(fd, stats->direct, batch_start, pending, stats) != 0) goto write_error;
+            pending = 0;
+        }
+    }
+
+    // Arquivo: descarta o preenchimento do último bloco e sobras de uma imagem maior
+    if (S_ISREG(st.st_mode) && ftruncate(fd, (off_t)size) != 0) goto write_error;
+    if (fsync(fd) != 0) goto write_error;
+    stats->syncs++;
+    if (!stats->direct) posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+
+    // Releitura: confirma o que o dispositivo realmente guardou, não o que foi enviado a ele
+    ret = verify_slot(fd, size, current, expected_hash) == 1 ? 0 : -1;
+    if (ret != 0) fprintf(stderr, "❌ Releitura do slot %c não corresponde ao hash esperado.\n", PARTITION_SLOT_NAME(slot));
+    goto cleanup;
+
+write_error:
+    fprintf(stderr, "Erro ao gravar o slot %c (%s): %s\n", PARTITION_SLOT_NAME(slot), path, strerror(errno));
+cleanup:
+    free(image);
+    free(current);
+    close(fd);
+    return ret;
+}
+
+// Sincroniza o diretório do arquivo, para que um rename sobreviva a uma queda de energia
+static int sync_parent_dir(const char *path) {
+    char dir[PATH_MAX];
+    const char *slash = strrchr(path, '/');
+    int fd, ret;
+
+    if (!slash) {
+        snprintf(dir, sizeof(dir), ".");
+    } else {
+        snprintf(dir, sizeof(dir), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+    }
+    fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ret = fsync(fd);
+    close(fd);
+    return ret;
+}
+
+int partition_set_active(PartitionSlots *slots, int slot, const char *version, size_t image_size) {
+    char tmp_path[PATH_MAX], boot_id[PARTITION_BOOT_ID_MAX];
+    FILE *fp;
+
+    read_boot_id(boot_id, sizeof(boot_id));
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", slots->control_path);
+    fp = fopen(tmp_path, "w");
+    if (!fp) {
+        perror("Erro ao criar o arquivo de controle dos slots");
+        return -1;
+    }
+    fprintf(fp, "active %c\nbooted %c\n", 'a' + slot, 'a' + slots->booted);
+    if (boot_id[0]) fprintf(fp, "staged_boot %s\n", boot_id);
+    for (int i = 0; i < PARTITION_SLOT_COUNT; i++) {
+        const char *slot_version = i == slot ? version : slots->versions[i];
+        size_t slot_size = i == slot ? image_size : slots->image_sizes[i];
+
+        if (slot_version[0]) fprintf(fp, "slot %c %s %zu\n", 'a' + i, slot_version, slot_size);
+    }
+    if (fflush(fp) != 0 || fsync(fileno(fp)) != 0) {
+        perror("Erro ao sincronizar o arquivo de controle dos slots");
+        fclose(fp);
+        unlink(tmp_path);
+        return -1;
+    }
+    fclose(fp);
+
+    // rename é atômico: o arquivo de controle aponta para o slot antigo ou para o novo
+    if (rename(tmp_path, slots->control_path) != 0 || sync_parent_dir(slots->control_path) != 0) {
+        perror("Erro ao trocar o slot ativo");
+        return -1;
+    }
+    slots->active = slot;
+    snprintf(slots->versions[slot], sizeof(slots->versions[slot]), "%s", version);
+    slots->image_sizes[slot] = image_size;
+    snprintf(slots->staged_boot, sizeof(slots->staged_boot), "%s", boot_id);
+    return 0;
+}
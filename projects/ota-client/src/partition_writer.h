@@ -0,0 +1,88 @@
+#ifndef PARTITION_WRITER_H
+#define PARTITION_WRITER_H
+
+#include <stddef.h>
+
+// Atualização A/B: o firmware já verificado é gravado no slot inativo, relido do dispositivo
+// para confirmar o hash e só então o slot ativo é trocado, de forma atômica. O slot ativo (o que
+// o bootloader inicia) só passa a ser o slot em execução depois do reinício: até lá, a imagem
+// gravada está pendente e novas atualizações são recusadas, pois o único slot livre seria o
+// que está rodando. Assim o slot em execução nunca é tocado, e uma falha em qualquer ponto
+// (inclusive queda de energia) mantém o sistema no firmware atual.
+//
+// Os slots podem ser partições (ex: /dev/mmcblk0p2 e /dev/mmcblk0p3) ou, nos testes, arquivos
+// comuns e loop devices.
+#define PARTITION_SLOT_COUNT 2
+#define PARTITION_IO_SIZE (1024 * 1024)         // Escritas grandes e alinhadas (blocos de apagamento da eMMC)
+#define PARTITION_ALIGN 4096                    // Alinhamento de buffers, offsets e tamanhos no O_DIRECT
+#define PARTITION_SYNC_BYTES (8 * 1024 * 1024)  // fdatasync a cada 8 MB gravados
+#define PARTITION_VERSION_MAX 64
+#define PARTITION_BOOT_ID_MAX 64
+// Muda a cada boot do kernel: distingue "ainda não reiniciou" de "reiniciou no slot antigo"
+#define PARTITION_BOOT_ID_PATH "/proc/sys/kernel/random/boot_id"
+
+typedef struct {
+    const char *slot_paths[PARTITION_SLOT_COUNT];
+    const char *control_path;                 // Estado persistido dos slots (ver partition_slots_load)
+    int active;                               // Slot que o bootloader inicia: 0 = A, 1 = B
+    int booted;                               // Slot em execução (difere de active com uma imagem pendente)
+    char versions[PARTITION_SLOT_COUNT][PARTITION_VERSION_MAX]; // Vazio se o slot nunca foi gravado pelo cliente
+    size_t image_sizes[PARTITION_SLOT_COUNT]; // Tamanho da imagem gravada (0 se desconhecido): a partição é maior
+    char staged_boot[PARTITION_BOOT_ID_MAX];  // Boot em que o slot ativo foi gravado
+} PartitionSlots;
+
+typedef struct {
+    size_t written;            // Bytes efetivamente gravados
+    size_t skipped;            // Bytes que já estavam iguais no slot (não regravados: menos desgaste)
+    unsigned syncs;            // Pontos de sincronização (fdatasync)
+    int direct;                // 1 se as escritas usaram O_DIRECT
+} PartitionWriteStats;
+
+// Letra do slot para mensagens e para o arquivo de controle
+#define PARTITION_SLOT_NAME(slot) ("AB"[(slot)])
+
+// Imagem gravada no slot ativo e ainda não iniciada
+#define PARTITION_UPDATE_PENDING(slots) ((slots)->active != (slots)->booted)
+
+/**
+ * @brief Lê o estado dos slots. Sem arquivo de controle (primeira atualização), o sistema roda
+ * do slot A. Uma imagem pendente deixa de ser pendente quando a versão em execução é a dela
+ * (o sistema reiniciou no slot novo) ou quando o boot mudou sem que ela rodasse (o bootloader
+ * voltou ao slot anterior, que continua em execução e volta a ser o ativo).
+ * @param slot_a Caminho do slot A (partição ou arquivo).
+ * @param slot_b Caminho do slot B.
+ * @param control_path Arquivo de controle (ex: em /data, ou lido pelo bootloader): linhas
+ * "active <a|b>", "booted <a|b>", "staged_boot <id>" e "slot <a|b> <versão> <bytes>". O formato
+ * antigo ("<a|b> <versão>") é lido como slot ativo já em execução.
+ * @param running_version Versão do firmware em execução.
+ * @return int 0 em caso de sucesso, -1 se o arquivo de controle é inválido.
+ */
+int partition_slots_load(PartitionSlots *slots, const char *slot_a, const char *slot_b, const char *control_path,
+                         const char *running_version);
+
+/**
+ * @brief Copia a imagem para o slot: escritas de PARTITION_IO_SIZE com O_DIRECT (ou buffered
+ * com descarte do cache, se o sistema de arquivos não suporta O_DIRECT), fdatasync a cada
+ * PARTITION_SYNC_BYTES e releitura do slot inteiro, comparando o SHA256 com o esperado.
+ * Blocos que já estão iguais no slot não são regravados.
+ * @param slot Slot de destino (nunca o em execução, nem o ativo com uma imagem pendente).
+ * @param source_fd Imagem verificada (lida com pread).
+ * @param size Tamanho da imagem.
+ * @param expected_hash String hex do SHA256 esperado.
+ * @param stats Recebe as estatísticas da gravação.
+ * @return int 0 em caso de sucesso, -1 em caso de falha (o slot em execução não foi alterado).
+ */
+int partition_write_image(const PartitionSlots *slots, int slot, int source_fd, size_t size,
+                          const char *expected_hash, PartitionWriteStats *stats);
+
+/**
+ * @brief Troca o slot ativo de forma atômica (arquivo temporário, fsync, rename e fsync do
+ * diretório): após uma queda de energia vale o slot antigo ou o novo, nunca um estado parcial.
+ * O slot fica pendente até o sistema reiniciar nele (o em execução continua registrado).
+ * @param version Versão gravada no slot.
+ * @param image_size Tamanho da imagem gravada (a base dos patches delta quando o slot estiver em execução).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int partition_set_active(PartitionSlots *slots, int slot, const char *version, size_t image_size);
+
+#endif // PARTITION_WRITER_H
@@ -6,17 +6,113 @@
 #include <openssl/evp.h>
 #include <openssl/x509.h>
 #include <openssl/pem.h>
+#include <openssl/err.h>
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
 
 /**
  * Converte uma string hexadecimal em um array de bytes.
  * @param hex_str A string hexadecimal (ex: "a1b2c3d4...").
  * @param byte_array O array de bytes de saída.
  * @param len O tamanho (em bytes) do array de saída.
+ * @return int 0 em caso de sucesso, -1 se há um caractere que não é hex.
  */
-static void hex_to_bytes(const char *hex_str, unsigned char *byte_array, size_t len) {
+static int hex_to_bytes(const char *hex_str, unsigned char *byte_array, size_t len) {
     for (size_t i = 0; i < len; i++) {
-        sscanf(hex_str + 2 * i, "%2hhx", &byte_array[i]);
+        int high = hex_value(hex_str[2 * i]);
+        int low = high < 0 ? -1 : hex_value(hex_str[2 * i + 1]);
+
+        if (low < 0) return -1;
+        byte_array[i] = (unsigned char)(high << 4 | low);
+    }
+    return 0;
+}
+
+int trust_store_load(TrustStore *store, const char *public_key_path) {
+    FILE *fp;
+    X509 *cert;
+
+    memset(store, 0, sizeof(*store));
+    fp = fopen(public_key_path, "r");
+    if (!fp) {
+        fprintf(stderr, "Erro de segurança: Não foi possível abrir a chave pública (%s).\n", public_key_path);
+        return -1;
+    }
+
+    // Como geramos um certificado X509 (cert.pem), extraímos a chave pública dele. Vários
+    // certificados concatenados permitem aceitar a chave nova e a antiga durante uma rotação.
+    while (store->key_count < TRUST_MAX_KEYS && (cert = PEM_read_X509(fp, NULL, NULL, NULL)) != NULL) {
+        EVP_PKEY *pub_key = X509_get_pubkey(cert);
+
+        X509_free(cert);
+        if (!pub_key) {
+            fprintf(stderr, "Erro de segurança: Falha ao extrair chave pública do certificado.\n");
+            continue;
+        }
+        store->keys[store->key_count++] = pub_key;
+    }
+    fclose(fp); // Fecha o arquivo assim que a leitura terminar
+    ERR_clear_error(); // O fim do arquivo também é reportado como erro do PEM_read_X509
+
+    if (store->key_count == 0) {
+        fprintf(stderr, "Erro de segurança: Falha ao ler certificado X509.\n");
+        return -1;
+    }
+    return 0;
+}
+
+void trust_store_free(TrustStore *store) {
+    for (int i = 0; i < store->key_count; i++) EVP_PKEY_free(store->keys[i]);
+    store->key_count = 0;
+}
+
+int sha256_matches_hex(const unsigned char *digest, const char *expected_hash) {
+    unsigned char expected_hash_bytes[SHA256_HASH_SIZE];
+
+    if (strlen(expected_hash) != SHA256_HASH_SIZE * 2 ||
+        hex_to_bytes(expected_hash, expected_hash_bytes, SHA256_HASH_SIZE) != 0) {
+        fprintf(stderr, "Erro: Hash esperado inválido (deve ter %d dígitos hex).\n", SHA256_HASH_SIZE * 2);
+        return -1;
+    }
+    return memcmp(digest, expected_hash_bytes, SHA256_HASH_SIZE) == 0;
+}
+
+/**
+ * Verifica a assinatura RSA/SHA256 sobre um hash já calculado, com cada chave confiável:
+ * o mesmo resultado de EVP_DigestVerify sem percorrer os dados uma segunda vez.
+ * @return int 1 se alguma chave valida a assinatura, 0 caso contrário, -1 em caso de erro.
+ */
+static int verify_digest_signature(const TrustStore *trust, const unsigned char *digest,
+                                   const unsigned char *signature, size_t sig_len)
+{
+    int ret = 0;
+
+    for (int i = 0; i < trust->key_count && ret != 1; i++) {
+        EVP_PKEY_CTX *pkey_ctx = EVP_PKEY_CTX_new(trust->keys[i], NULL);
+
+        if (!pkey_ctx || EVP_PKEY_verify_init(pkey_ctx) != 1 ||
+            EVP_PKEY_CTX_set_signature_md(pkey_ctx, EVP_sha256()) != 1) {
+            fprintf(stderr, "Erro de segurança: Falha ao preparar a verificação da assinatura.\n");
+            EVP_PKEY_CTX_free(pkey_ctx);
+            return -1;
+        }
+        // Assinaturas de tamanho errado para a chave também retornam < 0: apenas não valem para ela
+        ret = EVP_PKEY_verify(pkey_ctx, signature, sig_len, digest, SHA256_HASH_SIZE) == 1;
+        EVP_PKEY_CTX_free(pkey_ctx);
+    }
+    ERR_clear_error();
+
+    if (ret == 1) {
+        printf("✅ Assinatura digital válida. Autenticidade confirmada.\n");
+    } else {
+        printf("❌ Assinatura digital inválida.\n");
     }
+    return ret;
 }
 
 int generate_sha256_hash(const unsigned char *data, size_t len, unsigned char *output) {
@@ -29,96 +125,103 @@ int generate_sha256_hash(const unsigned char *data, size_t len, unsigned char *o
 
 int verify_firmware_integrity(const unsigned char *data, size_t len, const char *expected_hash) {
     unsigned char generated_hash[SHA256_HASH_SIZE];
-    unsigned char expected_hash_bytes[SHA256_HASH_SIZE];
+    int match;
 
     // 1. Gerar o hash do firmware
     if (generate_sha256_hash(data, len, generated_hash) != 0) {
         return -1; // Erro na geração do hash
     }
 
-    // 2. Converter o hash esperado de string hex para bytes
-    if (strlen(expected_hash) != SHA256_HASH_SIZE * 2) {
-        fprintf(stderr, "Erro: Tamanho do hash esperado é inválido.\n");
-        return -1;
-    }
-    hex_to_bytes(expected_hash, expected_hash_bytes, SHA256_HASH_SIZE);
-
-    // 3. Comparar os hashes
-    if (memcmp(generated_hash, expected_hash_bytes, SHA256_HASH_SIZE) == 0) {
+    // 2. Comparar com o hash esperado (string hex)
+    match = sha256_matches_hex(generated_hash, expected_hash);
+    if (match == 1) {
         printf("✅ Integridade verificada: Hashes correspondem.\n");
-        return 1;
-    } else {
+    } else if (match == 0) {
         printf("❌ Falha na verificação de integridade: Hashes NÃO correspondem.\n");
         // Opcional: imprimir os hashes para debug
         printf("   Gerado: ");
         for (int i = 0; i < SHA256_HASH_SIZE; i++) printf("%02x", generated_hash[i]);
         printf("\n");
         printf("   Esperado: %s\n", expected_hash);
-        return 0;
     }
+    return match;
 }
 
 int verify_firmware_signature(const unsigned char *firmware_data, size_t firmware_len,
                               const unsigned char *signature, size_t sig_len,
-                              const char *public_key_path) 
+                              const TrustStore *trust)
 {
-    FILE *fp = NULL;
-    EVP_PKEY *pub_key = NULL;
-    EVP_MD_CTX *md_ctx = NULL;
-    int ret = 0; // Assume falha
+    unsigned char digest[SHA256_HASH_SIZE];
 
-    // 1. Carregar a Chave Pública (do arquivo cert.pem)
-    fp = fopen(public_key_path, "r");
-    if (!fp) {
-        fprintf(stderr, "Erro de segurança: Não foi possível abrir a chave pública (%s).\n", public_key_path);
+    // Um único SHA256 sobre os dados, verificado com cada chave (e não um EVP_DigestVerify por chave)
+    if (generate_sha256_hash(firmware_data, firmware_len, digest) != 0) return -1;
+    return verify_digest_signature(trust, digest, signature, sig_len);
+}
+
+int firmware_verifier_init(FirmwareVerifier *verifier, const TrustStore *trust) {
+    memset(verifier, 0, sizeof(*verifier));
+    verifier->trust = trust;
+
+    verifier->hash_ctx = EVP_MD_CTX_new();
+    if (!verifier->hash_ctx || EVP_DigestInit_ex(verifier->hash_ctx, EVP_sha256(), NULL) != 1) {
+        fprintf(stderr, "Erro ao iniciar o hash SHA256.\n");
+        firmware_verifier_free(verifier);
         return -1;
     }
-    
-    // Ler a chave pública a partir do arquivo PEM/Certificado
-    // Usamos PEM_read_PUBKEY ou PEM_read_X509, dependendo do formato.
-    // Como geramos um certificado X509 (cert.pem), vamos extrair a chave pública dele.
-    X509 *cert = PEM_read_X509(fp, NULL, NULL, NULL);
-    fclose(fp); // Fecha o arquivo assim que a leitura terminar
-    
-    if (!cert) {
-        fprintf(stderr, "Erro de segurança: Falha ao ler certificado X509.\n");
+    return 0;
+}
+
+int firmware_verifier_update(FirmwareVerifier *verifier, const unsigned char *data, size_t len) {
+    if (EVP_DigestUpdate(verifier->hash_ctx, data, len) != 1) {
+        fprintf(stderr, "Erro ao atualizar o hash SHA256.\n");
         return -1;
     }
+    verifier->total += len;
+    return 0;
+}
 
-    pub_key = X509_get_pubkey(cert);
-    if (!pub_key) {
-        fprintf(stderr, "Erro de segurança: Falha ao extrair chave pública do certificado.\n");
-        X509_free(cert);
+int firmware_verifier_reset(FirmwareVerifier *verifier) {
+    if (EVP_DigestInit_ex(verifier->hash_ctx, EVP_sha256(), NULL) != 1) {
+        fprintf(stderr, "Erro ao reiniciar o hash SHA256.\n");
         return -1;
     }
+    verifier->total = 0;
+    return 0;
+}
 
-    // 2. Configurar o contexto de verificação (usando SHA256)
-    md_ctx = EVP_MD_CTX_new();
-    if (!md_ctx) { goto cleanup; }
+int firmware_verifier_final(FirmwareVerifier *verifier, const char *expected_hash,
+                            const unsigned char *signature, size_t sig_len)
+{
+    unsigned char generated_hash[SHA256_HASH_SIZE];
+    unsigned int hash_len = 0;
+    int match;
 
-    // 3. Inicializar a verificação (RSA/SHA256)
-    if (EVP_DigestVerifyInit(md_ctx, NULL, EVP_sha256(), NULL, pub_key) != 1) { goto cleanup; }
+    if (EVP_DigestFinal_ex(verifier->hash_ctx, generated_hash, &hash_len) != 1 ||
+        hash_len != SHA256_HASH_SIZE) {
+        fprintf(stderr, "Erro ao gerar hash SHA256.\n");
+        return -1;
+    }
 
-    // 4. Alimentar os dados (payload do firmware)
-    if (EVP_DigestVerifyUpdate(md_ctx, firmware_data, firmware_len) != 1) { goto cleanup; }
+    // 1. Integridade: compara com o hash publicado no JSON
+    match = sha256_matches_hex(generated_hash, expected_hash);
+    if (match != 1) {
+        if (match == 0) {
+            printf("❌ Falha na verificação de integridade: Hashes NÃO correspondem.\n");
+            printf("   Gerado: ");
+            for (int i = 0; i < SHA256_HASH_SIZE; i++) printf("%02x", generated_hash[i]);
+            printf("\n");
+            printf("   Esperado: %s\n", expected_hash);
+        }
+        return match;
+    }
+    printf("✅ Integridade verificada: Hashes correspondem.\n");
 
-    // 5. Verificar a Assinatura (compara o que foi calculado com o conteúdo do signature_buffer)
-    ret = EVP_DigestVerifyFinal(md_ctx, signature, sig_len); 
+    // 2. Autenticidade: a assinatura é verificada sobre o hash já calculado
+    return verify_digest_signature(verifier->trust, generated_hash, signature, sig_len);
+}
 
-    if (ret == 1) {
-        printf("✅ Assinatura digital válida. Autenticidade confirmada.\n");
-    } else if (ret == 0) {
-        // Retorno 0 significa que a assinatura NÃO CORRESPONDE, mas o processo foi concluído.
-        printf("❌ Assinatura digital inválida.\n");
-    } else {
-        // Retorno -1 significa um erro interno (Ex: EVP_DigestVerifyFinal falhou)
-        fprintf(stderr, "Erro de segurança: Erro interno durante a verificação da assinatura.\n");
-    }
-    
-cleanup:
-    if (md_ctx) EVP_MD_CTX_free(md_ctx);
-    if (pub_key) EVP_PKEY_free(pub_key);
-    if (cert) X509_free(cert);
-    
-    return ret == 1 ? 1 : (ret == 0 ? 0 : -1);
-}
\ No newline at end of file
+void firmware_verifier_free(FirmwareVerifier *verifier) {
+    if (verifier->hash_ctx) EVP_MD_CTX_free(verifier->hash_ctx);
+    verifier->hash_ctx = NULL;
+    verifier->trust = NULL;
+}
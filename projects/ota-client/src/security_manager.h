@@ -2,10 +2,49 @@
 #define SECURITY_MANAGER_H
 
 #include <stddef.h>
+#include <openssl/evp.h>
 
 // Tamanho esperado do hash SHA256 (256 bits / 8 = 32 bytes)
 #define SHA256_HASH_SIZE 32
 
+// Máximo de chaves confiáveis (certificados concatenados no mesmo PEM, ex: rotação de chaves)
+#define TRUST_MAX_KEYS 4
+
+// Chaves públicas confiáveis, lidas do PEM uma única vez e compartilhadas por todas as
+// verificações: o arquivo não é reaberto nem o X509 reanalisado a cada assinatura. Uma
+// assinatura é aceita se qualquer uma das chaves a valida.
+typedef struct {
+    EVP_PKEY *keys[TRUST_MAX_KEYS];
+    int key_count;
+} TrustStore;
+
+// Verificação incremental: o firmware é alimentado em blocos à medida que chega da rede.
+// Um único SHA256 serve às duas camadas (o hash é comparado com o esperado e a assinatura
+// RSA é verificada sobre ele), então a imagem é percorrida uma só vez e nunca fica na RAM.
+typedef struct {
+    EVP_MD_CTX *hash_ctx;
+    const TrustStore *trust;   // Compartilhado: não pertence ao verificador
+    size_t total;              // Bytes processados
+} FirmwareVerifier;
+
+/**
+ * @brief Carrega as chaves públicas de todos os certificados X509 do arquivo PEM.
+ * @param public_key_path Caminho do PEM (incorporado no cliente).
+ * @return int 0 em caso de sucesso (ao menos uma chave), -1 em caso de falha.
+ */
+int trust_store_load(TrustStore *store, const char *public_key_path);
+
+/**
+ * @brief Libera as chaves carregadas.
+ */
+void trust_store_free(TrustStore *store);
+
+/**
+ * @brief Compara um SHA256 binário com sua forma hex (maiúsculas ou minúsculas).
+ * @return int 1 se são iguais, 0 caso contrário, -1 se expected_hash não é um SHA256 em hex.
+ */
+int sha256_matches_hex(const unsigned char *digest, const char *expected_hash);
+
 /**
  * @brief Gera o hash SHA256 de um buffer de dados.
  * * @param data Ponteiro para os dados.
@@ -25,16 +64,51 @@ int generate_sha256_hash(const unsigned char *data, size_t len, unsigned char *o
 int verify_firmware_integrity(const unsigned char *data, size_t len, const char *expected_hash);
 
 /**
- * @brief Verifica se a assinatura digital corresponde aos dados e à chave pública.
+ * @brief Verifica se a assinatura digital corresponde aos dados e a uma das chaves confiáveis.
  * @param firmware_data Dados do firmware (payload).
  * @param firmware_len Tamanho dos dados.
  * @param signature Assinatura digital (conteúdo do .sig).
  * @param sig_len Tamanho da assinatura.
- * @param public_key_path Caminho para a chave pública (incorporada no cliente).
+ * @param trust Chaves confiáveis já carregadas.
  * @return int 1 se a assinatura for válida, 0 caso contrário, -1 em caso de erro.
  */
 int verify_firmware_signature(const unsigned char *firmware_data, size_t firmware_len,
                               const unsigned char *signature, size_t sig_len,
-                              const char *public_key_path) ;
+                              const TrustStore *trust);
+
+/**
+ * @brief Prepara a verificação incremental.
+ * @param verifier Contexto a inicializar.
+ * @param trust Chaves confiáveis já carregadas (devem viver tanto quanto o verificador).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int firmware_verifier_init(FirmwareVerifier *verifier, const TrustStore *trust);
+
+/**
+ * @brief Alimenta um bloco do firmware (na ordem em que os bytes chegam).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int firmware_verifier_update(FirmwareVerifier *verifier, const unsigned char *data, size_t len);
+
+/**
+ * @brief Descarta os blocos já alimentados (o download recomeçou do início).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int firmware_verifier_reset(FirmwareVerifier *verifier);
+
+/**
+ * @brief Conclui as duas verificações depois do último bloco.
+ * @param expected_hash String hex do hash esperado.
+ * @param signature Assinatura digital (conteúdo do .sig).
+ * @param sig_len Tamanho da assinatura.
+ * @return int 1 se hash e assinatura forem válidos, 0 caso contrário, -1 em caso de erro.
+ */
+int firmware_verifier_final(FirmwareVerifier *verifier, const char *expected_hash,
+                            const unsigned char *signature, size_t sig_len);
+
+/**
+ * @brief Libera o contexto (pode ser chamado após falha em qualquer etapa).
+ */
+void firmware_verifier_free(FirmwareVerifier *verifier);
 
 #endif // SECURITY_MANAGER_H
@@ -1,13 +1,10 @@
+#define _POSIX_C_SOURCE 199309L // clock_gettime
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
-
-// Definição da enumeração para os estados operacionais do atuador 
-typedef enum {
-    OCIOSO, // 0
-    ATIVO,  // 1
-    FALHA   // 2
-} ESTADO_ATUADOR;
+#include <time.h>
+#include "banco_atuadores.h" // ESTADO_ATUADOR, LIMITE_FALHA e o banco de atuadores (SoA)
 
 // Definição da estrutura Atuador 
 // Todos os campos utilizam tipos de dados de largura fixa (<stdint.h>)
@@ -24,9 +21,6 @@ typedef struct {
 // evitando otimizações indevidas pelo compilador.
 volatile uint32_t tempo_simulado_ms = 0;
 
-// Limite de feedback para detecção de falha 
-#define LIMITE_FALHA 1000
-
 // Inicializa a estrutura do atuador
 // Usa ponteiro para modificar a estrutura original (passagem por referência) 
 void inicializa_atuador(Atuador *a, uint8_t id, uint8_t pino) {
@@ -100,6 +94,99 @@ void imprime_status(const Atuador *a) {
     }
 }
 
+// Quantidade de canais da simulação do banco 
+// Não é múltipla de 8: os últimos 4 canais passam pelo laço escalar da varredura
+#define CANAIS_BANCO 4100
+// Ciclos de varredura cronometrados 
+#define CICLOS_BANCO 10000
+
+// Gera leituras normais (0 a 899) com um gerador congruente linear (sequência reproduzível) 
+static void gera_leituras_normais(int16_t *leituras, uint32_t quantidade, uint32_t *semente) {
+    for (uint32_t i = 0; i < quantidade; i++) {
+        *semente = *semente * 1103515245u + 12345u;
+        leituras[i] = (int16_t)((*semente >> 16) % 900);
+    }
+}
+
+// Imprime os canais que entraram em FALHA em um ciclo do banco 
+static void imprime_novas_falhas(const BancoAtuadores *banco, const uint32_t *novas_falhas, uint32_t quantidade) {
+    printf("  - %lu nova(s) falha(s) neste ciclo.\n", (unsigned long)quantidade);
+    for (uint32_t k = 0; k < quantidade; k++) {
+        uint32_t i = novas_falhas[k];
+        printf("  *** ATENÇÃO: Atuador %u (Pino %u) entrou em estado de FALHA! Leitura %d (Limite: %d) ***\n",
+               banco->id_atuador[i], banco->pino_controle[i], banco->valor_leitura[i], banco->limite_falha[i]);
+    }
+}
+
+// Simula o monitoramento de milhares de canais com o banco de atuadores (SoA) 
+// Retorna 0 em caso de sucesso ou -1 se faltar memória 
+static int simula_banco_atuadores(void) {
+    BancoAtuadores banco;
+    int16_t *leituras;
+    uint32_t *novas_falhas;
+    uint32_t semente = 1, quantidade, ativos = 0, falhas = 0;
+    struct timespec inicio, fim;
+    double us_por_ciclo;
+    int ret = 0;
+
+    if (banco_inicializa(&banco, CANAIS_BANCO) != 0) return -1;
+    leituras = malloc(CANAIS_BANCO * sizeof(*leituras));
+    novas_falhas = malloc(CANAIS_BANCO * sizeof(*novas_falhas));
+    if (leituras == NULL || novas_falhas == NULL) {
+        ret = -1;
+        goto cleanup;
+    }
+
+    // Canais com IDs 1 a CANAIS_BANCO; o canal de índice 10 é mais sensível (limite 500) 
+    for (uint32_t i = 0; i < CANAIS_BANCO; i++) {
+        banco_adiciona_atuador(&banco, (uint16_t)(i + 1), (uint8_t)(i % 64), i == 10 ? 500 : LIMITE_FALHA);
+        banco_ativa_atuador(&banco, i, tempo_simulado_ms);
+    }
+    printf("\n>>> BANCO DE ATUADORES (SoA): %lu canais ATIVOS, varredura %s <<<\n",
+           (unsigned long)banco.quantidade, banco_implementacao());
+
+    // Ciclo 1: todas as leituras dentro dos limites 
+    printf("\n* Ciclo 1: leituras normais.\n");
+    gera_leituras_normais(leituras, CANAIS_BANCO, &semente);
+    imprime_novas_falhas(&banco, novas_falhas, banco_processa_feedback(&banco, leituras, novas_falhas));
+
+    // Ciclo 2: leituras acima do limite em canais de blocos diferentes (inclusive no fim do banco) 
+    printf("\n* Ciclo 2: leituras de falha nos canais de índice 3, 10, 2049 e 4099.\n");
+    leituras[3] = 1200;
+    leituras[10] = 600; // Acima do limite próprio (500), abaixo de LIMITE_FALHA
+    leituras[2049] = 1500;
+    leituras[4099] = 1001;
+    imprime_novas_falhas(&banco, novas_falhas, banco_processa_feedback(&banco, leituras, novas_falhas));
+
+    // Ciclo 3: as mesmas leituras não repetem falhas já registradas 
+    printf("\n* Ciclo 3: mesmas leituras.\n");
+    imprime_novas_falhas(&banco, novas_falhas, banco_processa_feedback(&banco, leituras, novas_falhas));
+
+    // Cronometra a varredura com leituras normais 
+    gera_leituras_normais(leituras, CANAIS_BANCO, &semente);
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    quantidade = 0;
+    for (uint32_t ciclo = 0; ciclo < CICLOS_BANCO; ciclo++) {
+        quantidade += banco_processa_feedback(&banco, leituras, novas_falhas);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+    us_por_ciclo = ((fim.tv_sec - inicio.tv_sec) * 1e6 + (fim.tv_nsec - inicio.tv_nsec) / 1e3) / CICLOS_BANCO;
+    printf("\n* %d ciclos de varredura: %.2f us por ciclo (%.2f ns por canal), %lu nova(s) falha(s).\n",
+           CICLOS_BANCO, us_por_ciclo, us_por_ciclo * 1e3 / CANAIS_BANCO, (unsigned long)quantidade);
+
+    for (uint32_t i = 0; i < banco.quantidade; i++) {
+        if (banco.estado_atual[i] == ATIVO) ativos++;
+        else if (banco.estado_atual[i] == FALHA) falhas++;
+    }
+    printf("  Estados finais do banco: %lu ATIVO, %lu FALHA.\n", (unsigned long)ativos, (unsigned long)falhas);
+
+cleanup:
+    free(leituras);
+    free(novas_falhas);
+    banco_libera(&banco);
+    return ret;
+}
+
 
 // função principal
 int main() {
@@ -140,5 +227,11 @@ int main() {
     imprime_status(&motor);
     imprime_status(&valvula);
 
+    // Monitoramento em lote de milhares de canais 
+    if (simula_banco_atuadores() != 0) {
+        printf("Erro: memória insuficiente para o banco de atuadores.\n");
+        return 1;
+    }
+
     return 0;
 }
@@ -0,0 +1,149 @@
+#include "banco_atuadores.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Seleção da implementação vetorial em tempo de compilação
+// SSE2 faz parte de todo x86-64; no ARM, a extração da máscara usa vaddv_u8 (só AArch64)
+// Sem nenhum dos dois, a varredura inteira usa o laço escalar
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define BANCO_SIMD_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define BANCO_SIMD_NEON
+#endif
+
+// Canais comparados por instrução: 8 leituras de 16 bits em um registrador de 128 bits
+#define CANAIS_POR_VETOR 8
+
+int banco_inicializa(BancoAtuadores *banco, uint32_t capacidade) {
+    memset(banco, 0, sizeof(*banco));
+    banco->id_atuador = calloc(capacidade, sizeof(*banco->id_atuador));
+    banco->pino_controle = calloc(capacidade, sizeof(*banco->pino_controle));
+    banco->estado_atual = calloc(capacidade, sizeof(*banco->estado_atual));
+    banco->tempo_ativacao_ms = calloc(capacidade, sizeof(*banco->tempo_ativacao_ms));
+    banco->valor_leitura = calloc(capacidade, sizeof(*banco->valor_leitura));
+    banco->limite_falha = calloc(capacidade, sizeof(*banco->limite_falha));
+
+    if (!banco->id_atuador || !banco->pino_controle || !banco->estado_atual ||
+        !banco->tempo_ativacao_ms || !banco->valor_leitura || !banco->limite_falha) {
+        banco_libera(banco);
+        return -1;
+    }
+    banco->capacidade = capacidade;
+    return 0;
+}
+
+void banco_libera(BancoAtuadores *banco) {
+    free(banco->id_atuador);
+    free(banco->pino_controle);
+    free(banco->estado_atual);
+    free(banco->tempo_ativacao_ms);
+    free(banco->valor_leitura);
+    free(banco->limite_falha);
+    memset(banco, 0, sizeof(*banco));
+}
+
+int32_t banco_adiciona_atuador(BancoAtuadores *banco, uint16_t id, uint8_t pino, int16_t limite_falha) {
+    uint32_t i = banco->quantidade;
+
+    if (i == banco->capacidade) return -1;
+    banco->id_atuador[i] = id;
+    banco->pino_controle[i] = pino;
+    banco->estado_atual[i] = OCIOSO; // Mesmo estado inicial de inicializa_atuador
+    banco->tempo_ativacao_ms[i] = 0;
+    banco->valor_leitura[i] = 0;
+    banco->limite_falha[i] = limite_falha;
+    banco->quantidade++;
+    return (int32_t)i;
+}
+
+int banco_ativa_atuador(BancoAtuadores *banco, uint32_t indice, uint32_t tempo_atual) {
+    if (indice >= banco->quantidade || banco->estado_atual[indice] != OCIOSO) return -1;
+    banco->estado_atual[indice] = ATIVO;
+    banco->tempo_ativacao_ms[indice] = tempo_atual;
+    return 0;
+}
+
+// Mesma regra de processa_feedback, canal a canal (fim da varredura e alvos sem SIMD)
+static uint32_t processa_trecho_escalar(BancoAtuadores *banco, const int16_t *leituras,
+                                        uint32_t inicio, uint32_t *novas_falhas, uint32_t n) {
+    for (uint32_t i = inicio; i < banco->quantidade; i++) {
+        banco->valor_leitura[i] = leituras[i];
+        if (leituras[i] > banco->limite_falha[i]) {
+            if (banco->estado_atual[i] != FALHA) novas_falhas[n++] = i;
+            banco->estado_atual[i] = FALHA;
+        }
+    }
+    return n;
+}
+
+#if defined(BANCO_SIMD_SSE2) || defined(BANCO_SIMD_NEON)
+// Converte a máscara de novas falhas de um bloco (bit k = canal base + k) em índices
+static uint32_t anota_novas_falhas(unsigned int mascara, uint32_t base, uint32_t *novas_falhas, uint32_t n) {
+    while (mascara) {
+        novas_falhas[n++] = base + (uint32_t)__builtin_ctz(mascara);
+        mascara &= mascara - 1; // Apaga o bit menos significativo
+    }
+    return n;
+}
+#endif
+
+uint32_t banco_processa_feedback(BancoAtuadores *banco, const int16_t *leituras, uint32_t *novas_falhas) {
+    uint32_t n = 0, i = 0;
+
+#if defined(BANCO_SIMD_SSE2)
+    const __m128i falha = _mm_set1_epi8(FALHA);
+
+    for (; i + CANAIS_POR_VETOR <= banco->quantidade; i += CANAIS_POR_VETOR) {
+        __m128i leitura = _mm_loadu_si128((const __m128i *)(leituras + i));
+        __m128i limite = _mm_loadu_si128((const __m128i *)(banco->limite_falha + i));
+        __m128i estados = _mm_loadl_epi64((const __m128i *)(banco->estado_atual + i));
+        // 0xFFFF nos canais acima do limite, reduzido a 0xFF por canal (bytes 0 a 7)
+        __m128i acima = _mm_cmpgt_epi16(leitura, limite);
+        __m128i acima8 = _mm_packs_epi16(acima, acima);
+        __m128i novas = _mm_andnot_si128(_mm_cmpeq_epi8(estados, falha), acima8);
+        unsigned int mascara = (unsigned int)_mm_movemask_epi8(novas) & 0xFF;
+
+        _mm_storeu_si128((__m128i *)(banco->valor_leitura + i), leitura);
+        // Os estados só são regravados quando algum canal do bloco entrou em FALHA agora
+        if (mascara) {
+            estados = _mm_or_si128(_mm_andnot_si128(acima8, estados), _mm_and_si128(acima8, falha));
+            _mm_storel_epi64((__m128i *)(banco->estado_atual + i), estados);
+            n = anota_novas_falhas(mascara, i, novas_falhas, n);
+        }
+    }
+#elif defined(BANCO_SIMD_NEON)
+    static const uint8_t pesos_bits[CANAIS_POR_VETOR] = {1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x8_t pesos = vld1_u8(pesos_bits);
+    const uint8x8_t falha = vdup_n_u8(FALHA);
+
+    for (; i + CANAIS_POR_VETOR <= banco->quantidade; i += CANAIS_POR_VETOR) {
+        int16x8_t leitura = vld1q_s16(leituras + i);
+        int16x8_t limite = vld1q_s16(banco->limite_falha + i);
+        uint8x8_t estados = vld1_u8(banco->estado_atual + i);
+        // 0xFF nos canais acima do limite; a soma dos pesos desses canais forma a máscara
+        uint8x8_t acima8 = vmovn_u16(vcgtq_s16(leitura, limite));
+        uint8x8_t novas = vbic_u8(acima8, vceq_u8(estados, falha));
+        unsigned int mascara = vaddv_u8(vand_u8(novas, pesos));
+
+        vst1q_s16(banco->valor_leitura + i, leitura);
+        if (mascara) {
+            vst1_u8(banco->estado_atual + i, vbsl_u8(acima8, falha, estados));
+            n = anota_novas_falhas(mascara, i, novas_falhas, n);
+        }
+    }
+#endif
+
+    return processa_trecho_escalar(banco, leituras, i, novas_falhas, n);
+}
+
+const char *banco_implementacao(void) {
+#if defined(BANCO_SIMD_SSE2)
+    return "SSE2";
+#elif defined(BANCO_SIMD_NEON)
+    return "NEON";
+#else
+    return "escalar";
+#endif
+}
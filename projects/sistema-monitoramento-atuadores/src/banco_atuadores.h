@@ -0,0 +1,59 @@
+#ifndef BANCO_ATUADORES_H
+#define BANCO_ATUADORES_H
+
+#include <stdint.h>
+
+// Definição da enumeração para os estados operacionais do atuador
+typedef enum {
+    OCIOSO, // 0
+    ATIVO,  // 1
+    FALHA   // 2
+} ESTADO_ATUADOR;
+
+// Limite de feedback para detecção de falha
+#define LIMITE_FALHA 1000
+
+// Banco de atuadores em estrutura de arrays (SoA)
+// Cada campo fica em um array contínuo: a varredura do feedback lê só as leituras, os limites e
+// os estados, de forma sequencial, 8 canais de 16 bits por instrução SIMD (SSE2/NEON).
+// Com uma struct Atuador por canal, a maior parte de cada linha de cache seria de campos que a
+// varredura não usa.
+// Os ids têm 16 bits (o uint8_t da struct Atuador não comporta milhares de canais) e o estado
+// ocupa 1 byte por canal (valores de ESTADO_ATUADOR).
+typedef struct {
+    uint32_t capacidade;
+    uint32_t quantidade;
+    uint16_t *id_atuador;
+    uint8_t *pino_controle;
+    uint8_t *estado_atual;
+    uint32_t *tempo_ativacao_ms;
+    int16_t *valor_leitura;
+    int16_t *limite_falha;       // Leituras acima do limite do canal levam à FALHA
+} BancoAtuadores;
+
+// Aloca o banco para até 'capacidade' canais
+// Retorna 0 em caso de sucesso ou -1 se faltar memória
+int banco_inicializa(BancoAtuadores *banco, uint32_t capacidade);
+
+// Libera os arrays do banco
+void banco_libera(BancoAtuadores *banco);
+
+// Adiciona um canal OCIOSO ao banco
+// Retorna o índice do canal ou -1 se o banco estiver cheio
+int32_t banco_adiciona_atuador(BancoAtuadores *banco, uint16_t id, uint8_t pino, int16_t limite_falha);
+
+// Ativa um canal OCIOSO (canais ATIVOS ou em FALHA não mudam)
+// Retorna 0 se o canal foi ativado ou -1 caso contrário
+int banco_ativa_atuador(BancoAtuadores *banco, uint32_t indice, uint32_t tempo_atual);
+
+// Processa o feedback de todos os canais em uma única passada: grava as leituras, compara cada
+// uma com o limite do canal e muda para FALHA os canais acima dele
+// 'leituras' tem um valor por canal; 'novas_falhas' deve ter espaço para banco->quantidade índices
+// e recebe só os canais que entraram em FALHA neste ciclo (os que já estavam não se repetem)
+// Retorna o número de novas falhas
+uint32_t banco_processa_feedback(BancoAtuadores *banco, const int16_t *leituras, uint32_t *novas_falhas);
+
+// Nome da implementação da varredura escolhida na compilação ("SSE2", "NEON" ou "escalar")
+const char *banco_implementacao(void);
+
+#endif // BANCO_ATUADORES_H
@@ -0,0 +1,68 @@
+#include "histogram.h"
+#include <string.h>
+
+// Índice do bucket: linear até 2^HIST_SUB_BITS, depois HIST_HALF buckets por potência de 2
+static int bucket_index(uint64_t value) {
+    int msb, shift;
+
+    if (value < (1u << HIST_SUB_BITS)) return (int)value;
+    msb = 63 - __builtin_clzll(value);
+    shift = msb - (HIST_SUB_BITS - 1);
+    return (1 << HIST_SUB_BITS) + (msb - HIST_SUB_BITS) * HIST_HALF +
+           (int)((value >> shift) - HIST_HALF);
+}
+
+// Maior valor que cai no bucket
+static uint64_t bucket_upper(int index) {
+    int group, sub, shift;
+
+    if (index < (1 << HIST_SUB_BITS)) return (uint64_t)index;
+    group = (index - (1 << HIST_SUB_BITS)) / HIST_HALF;
+    sub = (index - (1 << HIST_SUB_BITS)) % HIST_HALF;
+    shift = group + 1;
+    return ((uint64_t)(HIST_HALF + sub + 1) << shift) - 1;
+}
+
+void hist_init(Histogram *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void hist_record(Histogram *h, uint64_t value) {
+    h->counts[bucket_index(value)]++;
+    h->total++;
+    h->sum += (double)value;
+    if (value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+}
+
+void hist_merge(Histogram *dst, const Histogram *src) {
+    for (int i = 0; i < HIST_BUCKETS; i++) dst->counts[i] += src->counts[i];
+    dst->total += src->total;
+    dst->sum += src->sum;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+uint64_t hist_percentile(const Histogram *h, double p) {
+    uint64_t rank, seen = 0;
+
+    if (h->total == 0) return 0;
+    rank = (uint64_t)(p / 100.0 * (double)h->total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > h->total) rank = h->total;
+
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            // O limite do bucket nunca passa do maior valor visto
+            uint64_t upper = bucket_upper(i);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+double hist_mean(const Histogram *h) {
+    return h->total ? h->sum / (double)h->total : 0.0;
+}
@@ -0,0 +1,47 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+// Histograma log-linear no estilo HDR: valores abaixo de 2^HIST_SUB_BITS têm bucket próprio;
+// acima disso cada potência de 2 é dividida em 2^(HIST_SUB_BITS-1) buckets, o que mantém o
+// erro relativo abaixo de 1/64 (~1,6%) em toda a faixa com memória fixa (sem alocação).
+#define HIST_SUB_BITS 7
+#define HIST_HALF (1 << (HIST_SUB_BITS - 1))
+#define HIST_BUCKETS ((1 << HIST_SUB_BITS) + (64 - HIST_SUB_BITS) * HIST_HALF)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+} Histogram;
+
+/**
+ * @brief Zera o histograma.
+ */
+void hist_init(Histogram *h);
+
+/**
+ * @brief Registra um valor (ex.: latência em nanossegundos).
+ */
+void hist_record(Histogram *h, uint64_t value);
+
+/**
+ * @brief Soma os contadores de src em dst (histogramas por thread -> total).
+ */
+void hist_merge(Histogram *dst, const Histogram *src);
+
+/**
+ * @brief Valor no percentil p (0 a 100): limite superior do bucket que contém o percentil.
+ * @return uint64_t Valor estimado (0 se o histograma está vazio).
+ */
+uint64_t hist_percentile(const Histogram *h, double p);
+
+/**
+ * @brief Média exata dos valores registrados.
+ */
+double hist_mean(const Histogram *h);
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "histogram.h"
+
+// Gerador de carga em malha fechada: cada conexão mantém até `pipeline` mensagens em voo e
+// envia uma nova a cada resposta completa. Como o servidor é um echo, a resposta de cada
+// mensagem é reconhecida pela contagem de bytes, sem parsing.
+
+#define BENCH_MAX_EVENTS 256
+#define BENCH_MAX_PIPELINE 64
+#define BENCH_RECV_BUFFER (64 * 1024)
+
+typedef struct {
+    const char *host;
+    int port;
+    int connections;    // Total de conexões (divididas entre as threads)
+    int threads;
+    int duration;       // Segundos de medição
+    int warmup;         // Segundos iniciais descartados
+    size_t msg_size;    // Payload de cada mensagem
+    int pipeline;       // Mensagens em voo por conexão
+    int framed;         // 1: prefixa cada mensagem com 4 bytes de tamanho (porta :framed)
+} BenchConfig;
+
+typedef struct {
+    int fd;
+    int connected;
+    size_t to_send;         // Bytes enfileirados e ainda não escritos
+    uint64_t sent_total;    // Bytes escritos (posição no stream de mensagens idênticas)
+    uint64_t recv_total;
+    uint64_t completed;     // Mensagens com resposta completa
+    uint64_t stamps[BENCH_MAX_PIPELINE]; // Instante de envio das mensagens em voo (FIFO)
+    int stamp_head;
+    int inflight;
+} BenchConn;
+
+typedef struct {
+    int id;
+    const BenchConfig *config;
+    pthread_t thread;
+    BenchConn *conns;
+    int nconns;
+    unsigned char *msgbuf;  // `pipeline` cópias da mensagem, para escrever várias de uma vez
+    size_t msg_len;         // Tamanho de uma mensagem no fio (cabeçalho incluído)
+    Histogram hist;
+    uint64_t messages;      // Respostas completas após o aquecimento
+    uint64_t bytes;
+    int connect_errors;
+    int io_errors;
+} BenchThread;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s [-H host] [-p porta] [-c conexões] [-t threads] [-d segundos] [-W segundos]\n"
+            "          [-m bytes] [-P profundidade] [-f]\n"
+            "  -H host        Endereço IPv4 do servidor (padrão: 127.0.0.1)\n"
+            "  -p porta       Porta do servidor (padrão: 8080)\n"
+            "  -c conexões    Conexões simultâneas (padrão: 1000)\n"
+            "  -t threads     Threads geradoras de carga (padrão: 1)\n"
+            "  -d segundos    Duração da medição (padrão: 10)\n"
+            "  -W segundos    Aquecimento descartado antes da medição (padrão: 1)\n"
+            "  -m bytes       Tamanho do payload de cada mensagem (padrão: 64)\n"
+            "  -P profund.    Mensagens em voo por conexão, 1 a %d (padrão: 1)\n"
+            "  -f             Mensagens com prefixo de tamanho de 4 bytes (porta :framed)\n",
+            prog, BENCH_MAX_PIPELINE);
+}
+
+// Enfileira uma nova mensagem e registra o instante de envio
+static void queue_message(BenchThread *t, BenchConn *c, uint64_t now) {
+    c->stamps[(c->stamp_head + c->inflight) % BENCH_MAX_PIPELINE] = now;
+    c->inflight++;
+    c->to_send += t->msg_len;
+}
+
+// Escreve o máximo possível dos bytes enfileirados. Retorna -1 em erro.
+static int flush_conn(BenchThread *t, BenchConn *c) {
+    size_t buflen = t->msg_len * (size_t)t->config->pipeline;
+
+    while (c->to_send > 0) {
+        size_t off = (size_t)(c->sent_total % t->msg_len);
+        size_t len = buflen - off;
+        ssize_t n;
+
+        if (len > c->to_send) len = c->to_send;
+        n = send(c->fd, t->msgbuf + off, len, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        c->sent_total += (uint64_t)n;
+        c->to_send -= (size_t)n;
+    }
+    return 0;
+}
+
+// Lê as respostas e conta as mensagens completas. Retorna -1 em erro ou desconexão.
+static int read_conn(BenchThread *t, BenchConn *c, unsigned char *scratch, int measuring) {
+    while (1) {
+        ssize_t n = recv(c->fd, scratch, BENCH_RECV_BUFFER, 0);
+        uint64_t now;
+
+        if (n == 0) return -1;
+        if (n == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            if (errno == EINTR) continue;
+            return -1;
+        }
+
+        c->recv_total += (uint64_t)n;
+        if (measuring) t->bytes += (uint64_t)n;
+        now = now_ns();
+        while (c->inflight > 0 && c->recv_total >= (c->completed + 1) * t->msg_len) {
+            if (measuring) {
+                hist_record(&t->hist, now - c->stamps[c->stamp_head]);
+                t->messages++;
+            }
+            c->stamp_head = (c->stamp_head + 1) % BENCH_MAX_PIPELINE;
+            c->inflight--;
+            c->completed++;
+            queue_message(t, c, now);
+        }
+    }
+}
+
+static int start_connect(BenchConn *c, int epfd, const struct sockaddr_in *addr) {
+    struct epoll_event ev;
+    int one = 1;
+
+    c->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (c->fd < 0) return -1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(c->fd, (const struct sockaddr *)addr, sizeof(*addr)) == -1 && errno != EINPROGRESS) {
+        close(c->fd);
+        c->fd = -1;
+        return -1;
+    }
+
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP;
+    ev.data.ptr = c;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev) == -1) {
+        close(c->fd);
+        c->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+static void fail_conn(BenchThread *t, BenchConn *c, int epfd) {
+    if (c->connected) t->io_errors++;
+    else t->connect_errors++;
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+}
+
+static void *bench_thread_main(void *arg) {
+    BenchThread *t = arg;
+    const BenchConfig *cfg = t->config;
+    struct epoll_event events[BENCH_MAX_EVENTS];
+    struct sockaddr_in addr;
+    unsigned char *scratch = malloc(BENCH_RECV_BUFFER);
+    uint64_t start, measure_from, deadline;
+    int epfd = epoll_create1(0);
+
+    if (!scratch || epfd < 0) {
+        perror("Erro ao preparar a thread de carga");
+        free(scratch);
+        if (epfd >= 0) close(epfd);
+        return NULL;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(cfg->port);
+    inet_pton(AF_INET, cfg->host, &addr.sin_addr);
+
+    for (int i = 0; i < t->nconns; i++) {
+        if (start_connect(&t->conns[i], epfd, &addr) != 0) t->connect_errors++;
+    }
+
+    start = now_ns();
+    measure_from = start + (uint64_t)cfg->warmup * 1000000000ull;
+    deadline = measure_from + (uint64_t)cfg->duration * 1000000000ull;
+
+    while (1) {
+        uint64_t now = now_ns();
+        int n;
+
+        if (now >= deadline) break;
+        n = epoll_wait(epfd, events, BENCH_MAX_EVENTS, 100);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("Erro no epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            BenchConn *c = events[i].data.ptr;
+            int measuring = now_ns() >= measure_from;
+
+            if (c->fd < 0) continue;
+
+            if (!c->connected && (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0 || (events[i].events & (EPOLLERR | EPOLLHUP))) {
+                    fail_conn(t, c, epfd);
+                    continue;
+                }
+                c->connected = 1;
+                for (int k = 0; k < cfg->pipeline; k++) queue_message(t, c, now_ns());
+            }
+
+            if ((events[i].events & (EPOLLIN | EPOLLRDHUP)) && read_conn(t, c, scratch, measuring) != 0) {
+                fail_conn(t, c, epfd);
+                continue;
+            }
+            if (flush_conn(t, c) != 0) fail_conn(t, c, epfd);
+        }
+    }
+
+    for (int i = 0; i < t->nconns; i++) {
+        if (t->conns[i].fd >= 0) close(t->conns[i].fd);
+    }
+    close(epfd);
+    free(scratch);
+    return NULL;
+}
+
+// Monta `pipeline` cópias da mensagem (cabeçalho big-endian opcional + payload)
+static unsigned char *build_messages(const BenchConfig *cfg, size_t *msg_len) {
+    size_t header = cfg->framed ? 4 : 0;
+    unsigned char *buf;
+
+    *msg_len = header + cfg->msg_size;
+    buf = malloc(*msg_len * (size_t)cfg->pipeline);
+    if (!buf) return NULL;
+
+    for (int k = 0; k < cfg->pipeline; k++) {
+        unsigned char *m = buf + (size_t)k * *msg_len;
+        if (cfg->framed) {
+            uint32_t len = (uint32_t)cfg->msg_size;
+            m[0] = (unsigned char)(len >> 24);
+            m[1] = (unsigned char)(len >> 16);
+            m[2] = (unsigned char)(len >> 8);
+            m[3] = (unsigned char)len;
+        }
+        for (size_t j = 0; j < cfg->msg_size; j++) m[header + j] = (unsigned char)('a' + j % 26);
+    }
+    return buf;
+}
+
+int main(int argc, char *argv[]) {
+    BenchConfig cfg = { "127.0.0.1", 8080, 1000, 1, 10, 1, 64, 1, 0 };
+    BenchThread *threads;
+    BenchConn *conns;
+    Histogram total;
+    uint64_t messages = 0, bytes = 0;
+    int connect_errors = 0, io_errors = 0, opt, next = 0;
+    struct in_addr tmp;
+
+    while ((opt = getopt(argc, argv, "H:p:c:t:d:W:m:P:fh")) != -1) {
+        switch (opt) {
+            case 'H': cfg.host = optarg; break;
+            case 'p': cfg.port = atoi(optarg); break;
+            case 'c': cfg.connections = atoi(optarg); break;
+            case 't': cfg.threads = atoi(optarg); break;
+            case 'd': cfg.duration = atoi(optarg); break;
+            case 'W': cfg.warmup = atoi(optarg); break;
+            case 'm': cfg.msg_size = strtoul(optarg, NULL, 10); break;
+            case 'P': cfg.pipeline = atoi(optarg); break;
+            case 'f': cfg.framed = 1; break;
+            default:
+                print_usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (inet_pton(AF_INET, cfg.host, &tmp) != 1 || cfg.connections < 1 || cfg.threads < 1 ||
+        cfg.duration < 1 || cfg.warmup < 0 || cfg.msg_size < 1 ||
+        cfg.pipeline < 1 || cfg.pipeline > BENCH_MAX_PIPELINE) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (cfg.threads > cfg.connections) cfg.threads = cfg.connections;
+
+    threads = calloc((size_t)cfg.threads, sizeof(BenchThread));
+    conns = calloc((size_t)cfg.connections, sizeof(BenchConn));
+    if (!threads || !conns) {
+        perror("Erro ao alocar as conexões");
+        return EXIT_FAILURE;
+    }
+
+    printf("Carga: %d conexões, %d threads, %zu bytes/mensagem, pipeline %d%s, %ds (+%ds aquecimento) em %s:%d\n",
+           cfg.connections, cfg.threads, cfg.msg_size, cfg.pipeline, cfg.framed ? ", framed" : "",
+           cfg.duration, cfg.warmup, cfg.host, cfg.port);
+
+    for (int i = 0; i < cfg.threads; i++) {
+        BenchThread *t = &threads[i];
+
+        t->id = i;
+        t->config = &cfg;
+        t->conns = conns + next;
+        t->nconns = cfg.connections / cfg.threads + (i < cfg.connections % cfg.threads);
+        next += t->nconns;
+        for (int k = 0; k < t->nconns; k++) t->conns[k].fd = -1;
+        hist_init(&t->hist);
+        t->msgbuf = build_messages(&cfg, &t->msg_len);
+        if (!t->msgbuf || pthread_create(&t->thread, NULL, bench_thread_main, t) != 0) {
+            fprintf(stderr, "Erro ao iniciar a thread de carga %d\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    hist_init(&total);
+    for (int i = 0; i < cfg.threads; i++) {
+        pthread_join(threads[i].thread, NULL);
+        hist_merge(&total, &threads[i].hist);
+        messages += threads[i].messages;
+        bytes += threads[i].bytes;
+        connect_errors += threads[i].connect_errors;
+        io_errors += threads[i].io_errors;
+        free(threads[i].msgbuf);
+    }
+
+    printf("Conexões com falha: %d no connect, %d durante a carga\n", connect_errors, io_errors);
+    printf("Throughput: %.0f msgs/s, %.2f MiB/s (respostas)\n",
+           (double)messages / cfg.duration, (double)bytes / cfg.duration / (1024.0 * 1024.0));
+    if (total.total > 0) {
+        printf("Latência (us): min %.1f  média %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+               total.min / 1000.0, hist_mean(&total) / 1000.0,
+               hist_percentile(&total, 50.0) / 1000.0, hist_percentile(&total, 90.0) / 1000.0,
+               hist_percentile(&total, 99.0) / 1000.0, hist_percentile(&total, 99.9) / 1000.0,
+               total.max / 1000.0);
+    }
+
+    free(conns);
+    free(threads);
+    return (messages > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,177 @@
+#include "admin.h"
+#include "metrics.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static const Worker *admin_workers;
+static int admin_num_workers;
+static int admin_fd = -1;
+static pthread_t admin_thread;
+
+// Cria o socket de escuta: TCP apenas em loopback (as métricas não devem ficar expostas)
+// ou socket Unix (permissões do sistema de arquivos controlam o acesso)
+static int create_admin_socket(const char *address) {
+    int fd;
+
+    if (strncmp(address, "unix:", 5) == 0) {
+        struct sockaddr_un addr;
+        const char *path = address + 5;
+
+        if (strlen(path) >= sizeof(addr.sun_path)) {
+            fprintf(stderr, "Caminho do socket administrativo longo demais: %s\n", path);
+            return -1;
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            perror("Erro ao criar o socket administrativo");
+            return -1;
+        }
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path);
+        unlink(path); // Socket deixado por uma execução anterior
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            perror("Erro no bind do socket administrativo");
+            close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_in addr;
+        int port = atoi(address), optval = 1;
+
+        if (port <= 0 || port > 65535) {
+            fprintf(stderr, "Endereço administrativo inválido: %s\n", address);
+            return -1;
+        }
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            perror("Erro ao criar o socket administrativo");
+            return -1;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+        // Durante um hot restart o processo antigo e o novo escutam na mesma porta
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval));
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            perror("Erro no bind da porta administrativa");
+            close(fd);
+            return -1;
+        }
+    }
+
+    if (listen(fd, 16) < 0) {
+        perror("Erro no listen do socket administrativo");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Atende uma requisição HTTP/1.0 (uma por conexão)
+static void handle_admin_client(int fd, char *body) {
+    char request[1024], header[256];
+    size_t len = 0, body_len = 0;
+    const char *status = "200 OK";
+    struct timeval tv = { 2, 0 };
+
+    // Clientes lentos não podem prender a thread administrativa
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    while (len < sizeof(request) - 1) {
+        ssize_t n = read(fd, request + len, sizeof(request) - 1 - len);
+        if (n <= 0) break;
+        len += (size_t)n;
+        request[len] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+    }
+    request[len] = '\0';
+
+    if (strncmp(request, "GET /metrics", 12) == 0 && (request[12] == ' ' || request[12] == '?')) {
+        body_len = metrics_render(admin_workers, admin_num_workers, body, ADMIN_BUFFER_SIZE);
+    } else {
+        status = "404 Not Found";
+        body_len = (size_t)snprintf(body, ADMIN_BUFFER_SIZE, "Use GET /metrics\n");
+    }
+
+    snprintf(header, sizeof(header),
+             "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+             "Content-Length: %zu\r\nConnection: close\r\n\r\n", status, body_len);
+    if (write_all(fd, header, strlen(header)) == 0) write_all(fd, body, body_len);
+}
+
+static void *admin_main(void *arg) {
+    char *body = malloc(ADMIN_BUFFER_SIZE);
+
+    (void)arg;
+    if (!body) {
+        log_error("Erro ao alocar o buffer do endpoint administrativo.");
+        return NULL;
+    }
+
+    while (1) {
+        int fd = accept(admin_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno == EINVAL) break; // admin_stop()
+            log_error("Erro no accept administrativo: %s", strerror(errno));
+            break;
+        }
+        handle_admin_client(fd, body);
+        close(fd);
+    }
+    free(body);
+    return NULL;
+}
+
+int admin_start(const char *address, const Worker *workers, int num_workers) {
+    int rc;
+
+    admin_workers = workers;
+    admin_num_workers = num_workers;
+    admin_fd = create_admin_socket(address);
+    if (admin_fd < 0) return -1;
+
+    rc = pthread_create(&admin_thread, NULL, admin_main, NULL);
+    if (rc != 0) {
+        fprintf(stderr, "Erro ao criar a thread administrativa: %s\n", strerror(rc));
+        close(admin_fd);
+        admin_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void admin_stop(void) {
+    if (admin_fd < 0) return;
+
+    // shutdown() em um socket de escuta acorda o accept() bloqueado (EINVAL)
+    shutdown(admin_fd, SHUT_RDWR);
+    pthread_join(admin_thread, NULL);
+    close(admin_fd);
+    admin_fd = -1;
+}
@@ -0,0 +1,24 @@
+#ifndef ADMIN_H
+#define ADMIN_H
+
+#include "worker.h"
+
+// Endpoint administrativo: uma thread própria, fora dos workers, responde GET /metrics
+// (texto do Prometheus) numa porta TCP local ou num socket Unix.
+#define ADMIN_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief Cria o socket administrativo e inicia a thread que o atende.
+ * @param address "porta" (escuta em 127.0.0.1) ou "unix:/caminho/do/socket".
+ * @param workers Workers cujos contadores são agregados (devem permanecer válidos).
+ * @param num_workers Número de workers.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int admin_start(const char *address, const Worker *workers, int num_workers);
+
+/**
+ * @brief Encerra a thread administrativa (antes de liberar os workers).
+ */
+void admin_stop(void);
+
+#endif // ADMIN_H
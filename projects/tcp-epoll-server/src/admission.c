@@ -0,0 +1,111 @@
+#include "admission.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SLOT_MASK (ADMISSION_SHARD_SLOTS - 1)
+
+// Espalha os bits do IP: os bits altos escolhem o shard e os seguintes o slot inicial
+static uint32_t ip_hash(uint32_t ip) {
+    return ip * 0x9E3779B1u;
+}
+
+static AdmissionShard *shard_of(const Admission *a, uint32_t hash) {
+    return &a->shards[hash >> 26];
+}
+
+int admission_init(Admission *a, uint32_t max_conns, uint32_t max_per_ip) {
+    memset(a, 0, sizeof(*a));
+    a->max_conns = max_conns;
+    a->max_per_ip = max_per_ip;
+    if (max_per_ip == 0) return 0;
+
+    a->shards = calloc(ADMISSION_SHARDS, sizeof(AdmissionShard));
+    if (!a->shards) {
+        perror("Erro ao alocar a tabela de conexões por IP");
+        return -1;
+    }
+    for (int i = 0; i < ADMISSION_SHARDS; i++) pthread_mutex_init(&a->shards[i].lock, NULL);
+    return 0;
+}
+
+void admission_destroy(Admission *a) {
+    if (a->shards) {
+        for (int i = 0; i < ADMISSION_SHARDS; i++) pthread_mutex_destroy(&a->shards[i].lock);
+        free(a->shards);
+        a->shards = NULL;
+    }
+}
+
+// Contagem por IP: incrementa a entrada do IP (criando-a se preciso) sem passar do limite
+static int ip_acquire(Admission *a, uint32_t ip) {
+    uint32_t hash = ip_hash(ip);
+    AdmissionShard *s = shard_of(a, hash);
+    uint32_t i = (hash >> 8) & SLOT_MASK;
+    int rc = -1;
+
+    pthread_mutex_lock(&s->lock);
+    while (s->slots[i].ip != 0 && s->slots[i].ip != ip) i = (i + 1) & SLOT_MASK;
+
+    if (s->slots[i].ip == ip) {
+        if (s->slots[i].count < a->max_per_ip) {
+            s->slots[i].count++;
+            rc = 0;
+        }
+    } else if (s->used < ADMISSION_SHARD_SLOTS - 1) { // Mantém um slot livre para terminar a sondagem
+        s->slots[i].ip = ip;
+        s->slots[i].count = 1;
+        s->used++;
+        rc = 0;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return rc;
+}
+
+static void ip_release(Admission *a, uint32_t ip) {
+    uint32_t hash = ip_hash(ip);
+    AdmissionShard *s = shard_of(a, hash);
+    uint32_t i = (hash >> 8) & SLOT_MASK, j;
+
+    pthread_mutex_lock(&s->lock);
+    while (s->slots[i].ip != 0 && s->slots[i].ip != ip) i = (i + 1) & SLOT_MASK;
+    if (s->slots[i].ip != ip || --s->slots[i].count > 0) {
+        pthread_mutex_unlock(&s->lock);
+        return;
+    }
+
+    // Remoção com deslocamento para trás: puxa as entradas seguintes da mesma sequência
+    // de sondagem para o buraco, sem marcadores de remoção
+    s->slots[i].ip = 0;
+    s->used--;
+    for (j = (i + 1) & SLOT_MASK; s->slots[j].ip != 0; j = (j + 1) & SLOT_MASK) {
+        uint32_t home = (ip_hash(s->slots[j].ip) >> 8) & SLOT_MASK;
+
+        // A entrada em j pode ocupar i se seu slot inicial não está no intervalo (i, j]
+        if (((j - home) & SLOT_MASK) >= ((j - i) & SLOT_MASK)) {
+            s->slots[i] = s->slots[j];
+            s->slots[j].ip = 0;
+            i = j;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+int admission_acquire(Admission *a, uint32_t ip) {
+    if (a->max_conns > 0) {
+        if (__atomic_add_fetch(&a->active, 1, __ATOMIC_RELAXED) > a->max_conns) {
+            __atomic_sub_fetch(&a->active, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+    }
+    if (a->shards && ip_acquire(a, ip) != 0) {
+        if (a->max_conns > 0) __atomic_sub_fetch(&a->active, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    return 0;
+}
+
+void admission_release(Admission *a, uint32_t ip) {
+    if (a->max_conns > 0) __atomic_sub_fetch(&a->active, 1, __ATOMIC_RELAXED);
+    if (a->shards) ip_release(a, ip);
+}
@@ -0,0 +1,56 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+// Controle de admissão compartilhado pelos workers: limite global de conexões (um contador
+// atômico) e limite por IP de origem. A tabela por IP é dividida em shards, cada um com
+// seu próprio lock, para que accepts simultâneos em workers diferentes raramente disputem.
+#define ADMISSION_SHARDS 64
+#define ADMISSION_SHARD_SLOTS 4096  // IPs distintos por shard (potência de 2)
+
+typedef struct {
+    uint32_t ip;               // IPv4 em ordem de rede (0 = slot livre)
+    uint32_t count;
+} AdmissionEntry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t used;
+    AdmissionEntry slots[ADMISSION_SHARD_SLOTS]; // Endereçamento aberto (sondagem linear)
+} AdmissionShard;
+
+typedef struct Admission {
+    uint32_t max_conns;        // 0 = sem limite global
+    uint32_t max_per_ip;       // 0 = sem limite por IP
+    uint32_t active;           // Conexões admitidas (atômico)
+    AdmissionShard *shards;    // NULL quando não há limite por IP
+} Admission;
+
+/**
+ * @brief Inicializa o controle de admissão.
+ * @param max_conns Limite de conexões simultâneas no servidor (0 = sem limite).
+ * @param max_per_ip Limite de conexões simultâneas por IP (0 = sem limite).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int admission_init(Admission *a, uint32_t max_conns, uint32_t max_per_ip);
+
+/**
+ * @brief Libera a tabela por IP.
+ */
+void admission_destroy(Admission *a);
+
+/**
+ * @brief Tenta admitir uma nova conexão do IP (chamado logo após o accept).
+ * @param ip IPv4 de origem em ordem de rede.
+ * @return int 0 se admitida (liberar com admission_release), -1 se algum limite foi atingido.
+ */
+int admission_acquire(Admission *a, uint32_t ip);
+
+/**
+ * @brief Libera a vaga de uma conexão admitida ao fechá-la.
+ */
+void admission_release(Admission *a, uint32_t ip);
+
+#endif // ADMISSION_H
@@ -0,0 +1,94 @@
+#include "buffer_pool.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int buffer_pool_init(BufferPool *pool, const size_t *sizes, int nsizes) {
+    memset(pool, 0, sizeof(*pool));
+    if (nsizes < 1 || nsizes > POOL_MAX_CLASSES) return -1;
+
+    for (int i = 0; i < nsizes; i++) {
+        PoolClass *pc = &pool->classes[i];
+
+        if (sizes[i] < sizeof(void *) || (i > 0 && sizes[i] <= sizes[i - 1])) {
+            fprintf(stderr, "Classes do pool devem ser crescentes (%zu).\n", sizes[i]);
+            return -1;
+        }
+        pc->chunk_size = sizes[i];
+        pc->chunks_per_slab = POOL_SLAB_BYTES / sizes[i];
+        if (pc->chunks_per_slab == 0) pc->chunks_per_slab = 1;
+    }
+    pool->nclasses = nsizes;
+    return 0;
+}
+
+void buffer_pool_destroy(BufferPool *pool) {
+    for (int i = 0; i < pool->nclasses; i++) {
+        PoolClass *pc = &pool->classes[i];
+        for (size_t s = 0; s < pc->nslabs; s++) free(pc->slabs[s]);
+        free(pc->slabs);
+    }
+    memset(pool, 0, sizeof(*pool));
+}
+
+// Aloca um novo slab para a classe e o fatia na lista livre
+static int grow_class(PoolClass *pc) {
+    unsigned char *slab;
+
+    if (pc->nslabs == pc->slabs_capacity) {
+        size_t cap = pc->slabs_capacity ? pc->slabs_capacity * 2 : 16;
+        void **slabs = realloc(pc->slabs, cap * sizeof(void *));
+        if (!slabs) return -1;
+        pc->slabs = slabs;
+        pc->slabs_capacity = cap;
+    }
+
+    slab = malloc(pc->chunk_size * pc->chunks_per_slab);
+    if (!slab) return -1;
+    pc->slabs[pc->nslabs++] = slab;
+
+    for (size_t i = 0; i < pc->chunks_per_slab; i++) {
+        void *chunk = slab + i * pc->chunk_size;
+        *(void **)chunk = pc->free_list;
+        pc->free_list = chunk;
+    }
+    pc->total += pc->chunks_per_slab;
+    return 0;
+}
+
+static PoolClass *find_class(BufferPool *pool, size_t size) {
+    for (int i = 0; i < pool->nclasses; i++) {
+        if (pool->classes[i].chunk_size >= size) return &pool->classes[i];
+    }
+    return &pool->classes[pool->nclasses - 1];
+}
+
+void *buffer_pool_alloc(BufferPool *pool, size_t size, size_t *chunk_size) {
+    PoolClass *pc = find_class(pool, size);
+    void *chunk;
+
+    if (!pc->free_list && grow_class(pc) != 0) {
+        log_error("Pool de buffers sem memória (classe %zu).", pc->chunk_size);
+        return NULL;
+    }
+
+    chunk = pc->free_list;
+    pc->free_list = *(void **)chunk;
+    __atomic_store_n(&pc->in_use, pc->in_use + 1, __ATOMIC_RELAXED);
+    *chunk_size = pc->chunk_size;
+    return chunk;
+}
+
+void buffer_pool_free(BufferPool *pool, void *chunk, size_t chunk_size) {
+    PoolClass *pc = find_class(pool, chunk_size);
+
+    if (!chunk) return;
+    *(void **)chunk = pc->free_list;
+    pc->free_list = chunk;
+    __atomic_store_n(&pc->in_use, pc->in_use - 1, __ATOMIC_RELAXED);
+}
+
+size_t buffer_pool_max_chunk(const BufferPool *pool) {
+    return pool->classes[pool->nclasses - 1].chunk_size;
+}
@@ -0,0 +1,62 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+
+#define POOL_MAX_CLASSES 4
+// Cada slab é um único malloc fatiado em chunks da mesma classe
+#define POOL_SLAB_BYTES (256 * 1024)
+
+// Classe de tamanho: lista livre de chunks de tamanho fixo
+typedef struct {
+    size_t chunk_size;
+    size_t chunks_per_slab;
+    void *free_list;          // Lista ligada intrusiva (o próprio chunk guarda o próximo)
+    void **slabs;             // Slabs alocados (liberados apenas em buffer_pool_destroy)
+    size_t nslabs;
+    size_t slabs_capacity;
+    size_t total;             // Chunks existentes
+    size_t in_use;            // Chunks emprestados
+} PoolClass;
+
+// Pool de buffers por worker (sem locks: usado apenas pela thread do worker).
+// Alocar e devolver um chunk é um push/pop na lista livre; o malloc só acontece
+// quando uma classe precisa de um novo slab, fora do regime estável.
+typedef struct {
+    PoolClass classes[POOL_MAX_CLASSES];
+    int nclasses;
+} BufferPool;
+
+/**
+ * @brief Inicializa o pool com as classes de tamanho informadas.
+ * @param sizes Tamanhos dos chunks em ordem crescente (ex.: 4K, 16K, 64K).
+ * @param nsizes Número de classes (1 a POOL_MAX_CLASSES).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int buffer_pool_init(BufferPool *pool, const size_t *sizes, int nsizes);
+
+/**
+ * @brief Libera todos os slabs (chunks emprestados deixam de ser válidos).
+ */
+void buffer_pool_destroy(BufferPool *pool);
+
+/**
+ * @brief Empresta o menor chunk com pelo menos size bytes (ou o maior, se size exceder todos).
+ * @param size Tamanho desejado.
+ * @param chunk_size Saída: tamanho real do chunk (necessário para devolvê-lo).
+ * @return void* Chunk, ou NULL se não houver memória.
+ */
+void *buffer_pool_alloc(BufferPool *pool, size_t size, size_t *chunk_size);
+
+/**
+ * @brief Devolve um chunk à lista livre da sua classe.
+ * @param chunk_size Tamanho retornado por buffer_pool_alloc().
+ */
+void buffer_pool_free(BufferPool *pool, void *chunk, size_t chunk_size);
+
+/**
+ * @brief Tamanho do maior chunk do pool.
+ */
+size_t buffer_pool_max_chunk(const BufferPool *pool);
+
+#endif // BUFFER_POOL_H
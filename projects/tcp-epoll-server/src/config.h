@@ -0,0 +1,98 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stddef.h>
+#include "buffer_pool.h"
+#include "framing.h"
+
+#define MAX_EVENTS 64
+// Máximo de accepts por despertar em cada socket de escuta (-A): uma rajada de conexões
+// novas não monopoliza o loop enquanto as conexões existentes esperam
+#define ACCEPT_BUDGET_DEFAULT 64
+#define SERVER_PORT 8080
+#define MAX_LISTENERS 4
+
+// Limite padrão de mensagens de log por segundo (configurável com -L, 0 = sem limite)
+#define LOG_DEFAULT_RATE_LIMIT 10000
+
+// Classes de tamanho padrão do pool de buffers (configuráveis com -b)
+#define POOL_DEFAULT_SIZES { 4 * 1024, 16 * 1024, 64 * 1024 }
+
+// Motor io_uring: profundidade do anel de submissão e buffers fornecidos por worker
+// (cada buffer fornecido tem o tamanho da menor classe do pool)
+#define URING_ENTRIES 1024
+#define URING_BUFFERS 1024
+// Máximo de envios encadeados (IOSQE_IO_LINK) submetidos de uma vez por conexão
+#define URING_MAX_LINKED_SENDS 32
+// Máximo de buffers fornecidos retidos por uma conexão (recebidos e ainda não ecoados):
+// nesse limite o recv da conexão para até um envio terminar
+#define URING_CONN_BUFFERS 64
+
+// Caminho zero-copy: tamanho do pipe de splice por conexão e tamanho mínimo de um
+// envio MSG_ZEROCOPY (abaixo disso o custo de pinagem/notificação supera a cópia)
+#define SPLICE_PIPE_SIZE (256 * 1024)
+#define PIPE_CACHE_SIZE 64
+#define ZEROCOPY_MIN_BYTES (16 * 1024)
+// Prazo para as conclusões MSG_ZEROCOPY de uma conexão fechada chegarem; depois dele o
+// socket é abortado (RST) para que o kernel solte as páginas do buffer
+#define ZC_RETIRE_TIMEOUT_MS (10 * 1000)
+
+// Caminho framed: maior payload aceito em um quadro (limitado também ao maior chunk do pool,
+// que guarda o quadro incompleto). Quadros maiores fecham a conexão.
+#define FRAME_MAX_PAYLOAD (60 * 1024)
+
+// Timers (motor epoll): resolução do timing wheel, timeout de conexão ociosa (-i),
+// prazo para completar um quadro já iniciado (-r) e período da manutenção do worker
+#define TIMER_TICK_MS 10
+#define IDLE_TIMEOUT_DEFAULT_MS (60 * 1000)
+#define READ_DEADLINE_DEFAULT_MS (5 * 1000)
+#define HOUSEKEEPING_INTERVAL_MS 1000
+
+// Desligamento gracioso (SIGTERM): prazo padrão (-g) para esvaziar as conexões antes de
+// fechá-las à força, e quanto o processo antigo espera a confirmação do novo no handoff (-u)
+#define DRAIN_TIMEOUT_DEFAULT_MS (30 * 1000)
+#define HANDOFF_ACK_TIMEOUT_MS (10 * 1000)
+
+// A fila de saída por conexão usa chunks do pool e é limitada ao maior chunk.
+// Acima deste percentual a conexão para de ler do cliente (backpressure)
+#define OUTPUT_HIGH_WATER_PCT 75
+// Abaixo deste percentual a leitura é retomada
+#define OUTPUT_LOW_WATER_PCT 25
+
+struct EventLoopOps;
+struct Admission;
+
+// Caminho de dados do echo, escolhido por socket de escuta
+typedef enum {
+    DATA_PATH_COPY,     // read() para o espaço do usuário e write() de volta
+    DATA_PATH_SPLICE,   // splice() socket -> pipe -> socket, sem passar pelo espaço do usuário
+    DATA_PATH_ZEROCOPY, // read() + send(MSG_ZEROCOPY), com conclusões pela fila de erros
+    DATA_PATH_FRAMED    // Quadros com prefixo de tamanho, tratados em lote pelo frame_handler
+} DataPath;
+
+typedef struct {
+    int port;
+    DataPath data_path;
+} ListenerConfig;
+
+// Configuração do servidor (preenchida a partir da linha de comando em server.c)
+typedef struct {
+    ListenerConfig listeners[MAX_LISTENERS]; // Portas TCP de escuta e caminho de dados de cada uma
+    int num_listeners;
+    int num_workers;   // Número de workers (uma thread + epoll + socket SO_REUSEPORT cada)
+    int pin_cpus;      // 1 para fixar cada worker em uma CPU (worker i -> CPU i % ncpus)
+    int stats_interval; // Intervalo (s) para imprimir o contador de conexões por worker (0 = desligado)
+    const struct EventLoopOps *loop; // Motor de eventos usado pelos workers (epoll ou io_uring)
+    size_t pool_sizes[POOL_MAX_CLASSES]; // Classes de tamanho do pool de buffers (crescentes)
+    int pool_nclasses;
+    uint32_t idle_timeout_ms;  // Fecha conexões sem atividade por este tempo (0 = desligado)
+    uint32_t read_deadline_ms; // Prazo para receber o restante de um quadro (0 = desligado)
+    FrameHandler frame_handler; // Handler dos listeners framed (padrão: frame_echo_handler)
+    void *frame_ctx;            // Contexto passado ao frame_handler
+    uint32_t drain_timeout_ms;  // Prazo para esvaziar as conexões no desligamento
+    const char *handoff_path;   // Socket Unix do hot restart (NULL = desligado)
+    uint32_t accept_budget;     // Accepts por despertar em cada socket de escuta
+    struct Admission *admission; // Limites de conexões, global e por IP (NULL = sem limites)
+} ServerConfig;
+
+#endif // CONFIG_H
@@ -0,0 +1,218 @@
+#include "connection.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+int conn_table_init(ConnectionTable *table) {
+    struct rlimit rl;
+
+    // O maior fd possível é limitado por RLIMIT_NOFILE
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur == RLIM_INFINITY) {
+        rl.rlim_cur = 65536;
+    }
+
+    table->size = (int)rl.rlim_cur;
+    table->conns = calloc(table->size, sizeof(Connection));
+    if (!table->conns) {
+        perror("Erro ao alocar a tabela de conexões");
+        table->size = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void conn_table_destroy(ConnectionTable *table) {
+    free(table->conns);
+    table->conns = NULL;
+    table->size = 0;
+}
+
+// Próxima geração da entrada (0 fica reservado para os eventos que não são de clientes)
+static void next_generation(Connection *c) {
+    uint32_t generation = __atomic_load_n(&c->generation, __ATOMIC_RELAXED) + 1;
+
+    if (generation == 0) generation = 1;
+    __atomic_store_n(&c->generation, generation, __ATOMIC_RELEASE);
+}
+
+Connection *conn_open(ConnectionTable *table, int fd, int owner) {
+    if (fd < 0 || fd >= table->size) return NULL;
+
+    Connection *c = &table->conns[fd];
+
+    // A geração (primeiro campo) sobrevive à reinicialização: eventos antigos de outro
+    // worker podem estar lendo-a agora
+    memset((char *)c + offsetof(Connection, fd), 0, sizeof(*c) - offsetof(Connection, fd));
+    next_generation(c);
+    c->fd = fd;
+    c->owner = owner;
+    c->in_use = 1;
+    return c;
+}
+
+Connection *conn_get(ConnectionTable *table, int fd, int owner, uint32_t generation) {
+    Connection *c;
+
+    if (fd < 0 || fd >= table->size) return NULL;
+    c = &table->conns[fd];
+    // Com a geração do evento, a entrada só pode ter sido escrita por este worker
+    if (__atomic_load_n(&c->generation, __ATOMIC_ACQUIRE) != generation) return NULL;
+    if (!c->in_use || c->owner != owner) return NULL;
+    return c;
+}
+
+void conn_release(BufferPool *pool, Connection *c) {
+    next_generation(c);
+    buffer_pool_free(pool, c->out.data, c->out.capacity);
+    c->out.data = NULL;
+    c->out.capacity = 0;
+    c->out.head = 0;
+    c->out.len = 0;
+    c->out.hold = 0;
+    buffer_pool_free(pool, c->in.data, c->in.capacity);
+    c->in.data = NULL;
+    c->in.capacity = 0;
+    c->in.len = 0;
+    c->in_use = 0;
+}
+
+// Troca o chunk por um maior, copiando os bytes pendentes para o início
+static int ring_grow(BufferPool *pool, RingBuffer *rb, size_t needed) {
+    struct iovec iov[2];
+    size_t new_capacity, off = 0;
+    unsigned char *data = buffer_pool_alloc(pool, needed, &new_capacity);
+    int iovcnt;
+
+    if (!data) return -1;
+    if (new_capacity <= rb->capacity || rb->hold > 0) {
+        // Já estamos no maior chunk, ou o kernel ainda lê o chunk atual (MSG_ZEROCOPY)
+        buffer_pool_free(pool, data, new_capacity);
+        return -1;
+    }
+
+    iovcnt = ring_peek(rb, iov);
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(data + off, iov[i].iov_base, iov[i].iov_len);
+        off += iov[i].iov_len;
+    }
+    buffer_pool_free(pool, rb->data, rb->capacity);
+    rb->data = data;
+    rb->capacity = new_capacity;
+    rb->head = 0;
+    return 0;
+}
+
+size_t ring_push(BufferPool *pool, RingBuffer *rb, const void *data, size_t len) {
+    size_t space, tail, first;
+
+    if (!rb->data) {
+        rb->data = buffer_pool_alloc(pool, len, &rb->capacity);
+        if (!rb->data) {
+            rb->capacity = 0;
+            return 0;
+        }
+        rb->head = 0;
+        rb->len = 0;
+    } else if (rb->capacity - rb->len - rb->hold < len) {
+        ring_grow(pool, rb, rb->len + len);
+    }
+
+    space = rb->capacity - rb->len - rb->hold;
+    if (len > space) len = space;
+
+    // Copia em até dois pedaços: até o fim do buffer e depois do início
+    tail = (rb->head + rb->len) % rb->capacity;
+    first = rb->capacity - tail;
+    if (first > len) first = len;
+    memcpy(rb->data + tail, data, first);
+    memcpy(rb->data, (const unsigned char *)data + first, len - first);
+    rb->len += len;
+
+    return len;
+}
+
+int ring_peek(const RingBuffer *rb, struct iovec iov[2]) {
+    size_t first;
+
+    if (rb->len == 0) return 0;
+
+    first = rb->capacity - rb->head;
+    if (first >= rb->len) {
+        iov[0].iov_base = rb->data + rb->head;
+        iov[0].iov_len = rb->len;
+        return 1;
+    }
+    iov[0].iov_base = rb->data + rb->head;
+    iov[0].iov_len = first;
+    iov[1].iov_base = rb->data;
+    iov[1].iov_len = rb->len - first;
+    return 2;
+}
+
+void ring_consume(BufferPool *pool, RingBuffer *rb, size_t n) {
+    if (n > rb->len) n = rb->len;
+    rb->head = (rb->head + n) % rb->capacity;
+    rb->len -= n;
+
+    // Conexões ociosas não mantêm memória de buffer
+    if (rb->len == 0 && rb->hold == 0) {
+        buffer_pool_free(pool, rb->data, rb->capacity);
+        rb->data = NULL;
+        rb->capacity = 0;
+        rb->head = 0;
+    }
+}
+
+void ring_consume_hold(RingBuffer *rb, size_t n) {
+    if (n > rb->len) n = rb->len;
+    rb->head = (rb->head + n) % rb->capacity;
+    rb->len -= n;
+    rb->hold += n;
+}
+
+void ring_release_hold(BufferPool *pool, RingBuffer *rb, size_t n) {
+    if (n > rb->hold) n = rb->hold;
+    rb->hold -= n;
+    if (rb->data) ring_consume(pool, rb, 0);
+}
+
+int ring_reserve(BufferPool *pool, RingBuffer *rb, size_t size) {
+    if (rb->data) return 0;
+    rb->data = buffer_pool_alloc(pool, size, &rb->capacity);
+    if (!rb->data) {
+        rb->capacity = 0;
+        return -1;
+    }
+    rb->head = 0;
+    rb->len = 0;
+    rb->hold = 0;
+    return 0;
+}
+
+int ring_space(const RingBuffer *rb, struct iovec iov[2]) {
+    size_t space, tail, first;
+
+    if (!rb->data) return 0;
+    space = rb->capacity - rb->len - rb->hold;
+    if (space == 0) return 0;
+
+    // O espaço livre termina onde começa a região retida (head - hold)
+    tail = (rb->head + rb->len) % rb->capacity;
+    first = rb->capacity - tail;
+    if (first >= space) {
+        iov[0].iov_base = rb->data + tail;
+        iov[0].iov_len = space;
+        return 1;
+    }
+    iov[0].iov_base = rb->data + tail;
+    iov[0].iov_len = first;
+    iov[1].iov_base = rb->data;
+    iov[1].iov_len = space - first;
+    return 2;
+}
+
+void ring_commit(RingBuffer *rb, size_t n) {
+    rb->len += n;
+}
@@ -0,0 +1,155 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include "buffer_pool.h"
+#include "timer_wheel.h"
+
+// Buffer circular de saída: bytes que o kernel ainda não aceitou no write().
+// A memória é emprestada do pool do worker apenas enquanto há dados pendentes e cresce
+// de classe em classe (ex.: 4K -> 16K -> 64K) até o maior chunk do pool.
+typedef struct {
+    unsigned char *data; // NULL enquanto a conexão não tem dados pendentes
+    size_t capacity;     // Tamanho do chunk emprestado (0 quando data == NULL)
+    size_t head;         // Posição do primeiro byte pendente
+    size_t len;          // Quantidade de bytes pendentes
+    size_t hold;         // Bytes já enviados antes de head ainda referenciados pelo kernel (MSG_ZEROCOPY)
+} RingBuffer;
+
+// Buffer linear de entrada do caminho framed: guarda o quadro incompleto (e quadros
+// ainda não despachados por backpressure) até o restante chegar
+typedef struct {
+    unsigned char *data; // NULL enquanto não há bytes guardados
+    size_t capacity;
+    size_t len;
+} InputBuffer;
+
+// Pipe usado pelo caminho splice, emprestado por uma conexão enquanto há dados nele
+typedef struct {
+    int fds[2];          // [0] leitura, [1] escrita
+    size_t capacity;
+} SplicePipe;
+
+struct ZcState;
+
+// Estado de uma conexão de cliente
+typedef struct Connection {
+    uint32_t generation; // Muda a cada abertura e liberação da entrada (nunca 0 em uso)
+    int fd;
+    int in_use;
+    int owner;           // Id do worker que aceitou a conexão
+    uint32_t events;     // Máscara atualmente registrada no epoll
+    int read_paused;     // 1 quando a fila de saída passou do high-water mark
+    int peer_closed;     // 1 quando o cliente encerrou o envio (read == 0 / EPOLLRDHUP)
+    int data_path;       // DataPath do listener que aceitou a conexão
+    uint32_t peer_ip;    // IPv4 do cliente (ordem de rede), para o limite por IP
+    RingBuffer out;
+    InputBuffer in;      // Caminho framed
+
+    // Timers (motor epoll). A atividade só atualiza last_active; o timer de ociosidade
+    // confere o carimbo ao expirar e se rearma pelo tempo restante.
+    uint64_t last_active;  // Relógio em cache do worker no último evento (ms)
+    TimerNode idle_timer;
+    TimerNode read_timer;  // Prazo para completar um quadro iniciado (caminho framed)
+
+    // Caminho splice: pipe emprestado do cache do worker enquanto pipe_len > 0
+    SplicePipe pipe;
+    size_t pipe_len;
+
+    // Caminho MSG_ZEROCOPY
+    uint32_t zc_next_id;   // Id do próximo envio (o kernel numera os envios de cada socket)
+    struct ZcState *zc;    // Envios aguardando conclusão (emprestado do pool enquanto houver)
+    int retired;           // Fechada pelo servidor, fd aberto só até as últimas conclusões
+
+    // Lista das conexões abertas (ou aposentadas) do worker
+    struct Connection *next;
+    struct Connection *prev;
+} Connection;
+
+// Tabela plana de conexões indexada pelo fd, compartilhada por todos os workers sem locks.
+// Uma entrada só é escrita pelo worker dono do fd, mas um evento antigo de um worker pode
+// se referir a um fd que ele já fechou e que outro worker (ou ele mesmo) aceitou de novo:
+// por isso o evento leva a geração da entrada, e conn_get() confere geração e dono.
+typedef struct {
+    Connection *conns;
+    int size;
+} ConnectionTable;
+
+/**
+ * @brief Aloca a tabela de conexões com uma entrada por fd possível (RLIMIT_NOFILE).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int conn_table_init(ConnectionTable *table);
+
+/**
+ * @brief Libera a tabela de conexões. Os buffers pertencem aos pools dos workers.
+ */
+void conn_table_destroy(ConnectionTable *table);
+
+/**
+ * @brief Reserva a entrada do fd na tabela para o worker owner, com uma nova geração.
+ * @return Connection* A conexão inicializada, ou NULL se o fd estiver fora da tabela.
+ */
+Connection *conn_open(ConnectionTable *table, int fd, int owner);
+
+/**
+ * @brief Retorna a conexão associada ao fd se ela ainda é a mesma do evento: em uso, do
+ * worker owner e com a geração registrada no evento (NULL caso contrário).
+ */
+Connection *conn_get(ConnectionTable *table, int fd, int owner, uint32_t generation);
+
+/**
+ * @brief Devolve os buffers da conexão ao pool e marca a entrada como livre (não fecha o fd).
+ * A geração muda aqui, antes do close(): eventos antigos deixam de encontrar a entrada.
+ */
+void conn_release(BufferPool *pool, Connection *c);
+
+/**
+ * @brief Copia dados para o final do buffer circular, emprestando ou trocando o chunk
+ * por um maior se necessário.
+ * @return size_t Número de bytes copiados (menor que len se o maior chunk encher).
+ */
+size_t ring_push(BufferPool *pool, RingBuffer *rb, const void *data, size_t len);
+
+/**
+ * @brief Preenche até dois iovecs com os bytes pendentes (o buffer pode dar a volta).
+ * @return int Número de iovecs preenchidos (0 se vazio).
+ */
+int ring_peek(const RingBuffer *rb, struct iovec iov[2]);
+
+/**
+ * @brief Descarta n bytes do início do buffer. Quando esvazia (e nada está retido), o chunk volta ao pool.
+ */
+void ring_consume(BufferPool *pool, RingBuffer *rb, size_t n);
+
+/**
+ * @brief Avança n bytes enviados com MSG_ZEROCOPY: saem da fila, mas ficam retidos (hold)
+ * até a conclusão, pois o kernel ainda lê essas páginas.
+ */
+void ring_consume_hold(RingBuffer *rb, size_t n);
+
+/**
+ * @brief Libera n bytes retidos (os mais antigos). Devolve o chunk se a fila estiver vazia.
+ */
+void ring_release_hold(BufferPool *pool, RingBuffer *rb, size_t n);
+
+/**
+ * @brief Garante um chunk de pelo menos size bytes para leitura direta no buffer.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int ring_reserve(BufferPool *pool, RingBuffer *rb, size_t size);
+
+/**
+ * @brief Preenche até dois iovecs com o espaço livre após os dados pendentes.
+ * @return int Número de iovecs preenchidos (0 se cheio).
+ */
+int ring_space(const RingBuffer *rb, struct iovec iov[2]);
+
+/**
+ * @brief Confirma n bytes escritos diretamente no espaço retornado por ring_space().
+ */
+void ring_commit(RingBuffer *rb, size_t n);
+
+#endif // CONNECTION_H
@@ -0,0 +1,332 @@
+#define _GNU_SOURCE
+#include "data_path.h"
+#include "log.h"
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
+// --- splice ---
+
+// Empresta um pipe do cache do worker (ou cria um novo com SPLICE_PIPE_SIZE)
+static int pipe_acquire(Worker *w, SplicePipe *p) {
+    int size;
+
+    if (w->npipes > 0) {
+        *p = w->pipe_cache[--w->npipes];
+        if (w->npipes < w->npipes_low) w->npipes_low = w->npipes;
+        return 0;
+    }
+
+    if (pipe2(p->fds, O_NONBLOCK | O_CLOEXEC) == -1) {
+        log_error("Erro ao criar o pipe de splice: %s", strerror(errno));
+        return -1;
+    }
+    // Se o limite do sistema (pipe-max-size) impedir, mantém o tamanho padrão
+    size = fcntl(p->fds[1], F_SETPIPE_SZ, SPLICE_PIPE_SIZE);
+    if (size == -1) size = fcntl(p->fds[1], F_GETPIPE_SZ);
+    p->capacity = size > 0 ? (size_t)size : 4096;
+    return 0;
+}
+
+// Devolve um pipe vazio ao cache; pipes com dados (conexão fechada no meio) são descartados
+static void pipe_release(Worker *w, SplicePipe *p, int empty) {
+    if (empty && w->npipes < PIPE_CACHE_SIZE) {
+        w->pipe_cache[w->npipes++] = *p;
+    } else {
+        close(p->fds[0]);
+        close(p->fds[1]);
+    }
+    memset(p, 0, sizeof(*p));
+}
+
+void pipe_cache_trim(Worker *w) {
+    // npipes_low pipes ficaram no cache durante todo o período: não foram necessários
+    int unused = w->npipes_low;
+
+    while (unused-- > 0 && w->npipes > 0) {
+        SplicePipe *p = &w->pipe_cache[--w->npipes];
+        close(p->fds[0]);
+        close(p->fds[1]);
+    }
+    w->npipes_low = w->npipes;
+}
+
+int splice_flush(Worker *w, Connection *c) {
+    while (c->pipe_len > 0) {
+        ssize_t n = splice(c->pipe.fds[0], NULL, c->fd, NULL, c->pipe_len,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            c->pipe_len -= (size_t)n;
+            COUNTER_ADD(w->bytes_relayed, (uint64_t)n);
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            COUNTER_ADD(w->write_eagain, 1);
+            return 0;
+        } else {
+            log_warn("Erro ao ecoar dados (splice) no FD %d: %s", c->fd, strerror(errno));
+            return -1;
+        }
+    }
+
+    // Conexões ociosas não mantêm pipe
+    if (c->pipe.capacity) pipe_release(w, &c->pipe, 1);
+    return 0;
+}
+
+int splice_read(Worker *w, Connection *c) {
+    while (!c->read_paused) {
+        ssize_t n;
+
+        if (!c->pipe.capacity && pipe_acquire(w, &c->pipe) != 0) return -1;
+
+        n = splice(c->fd, NULL, c->pipe.fds[1], NULL, c->pipe.capacity - c->pipe_len,
+                   SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            COUNTER_ADD(w->bytes_received, (uint64_t)n);
+            c->pipe_len += (size_t)n;
+            if (splice_flush(w, c) != 0) return -1;
+            // O pipe só continua emprestado se o socket de saída não aceitou tudo
+            if (c->pipe.capacity && c->pipe_len >= c->pipe.capacity) c->read_paused = 1;
+        } else if (n == 0) {
+            // O cliente performou um shutdown ordenado
+            c->peer_closed = 1;
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // EAGAIN também ocorre com o pipe sem slots livres (o limite é em páginas, não em
+            // bytes). Com dados no pipe, espera o socket de saída drenar antes de ler de novo.
+            COUNTER_ADD(w->read_eagain, 1);
+            if (c->pipe_len > 0) c->read_paused = 1;
+            break;
+        } else {
+            log_warn("Erro ao ler dados (splice) no FD %d: %s", c->fd, strerror(errno));
+            return -1;
+        }
+    }
+
+    if (c->pipe_len == 0 && c->pipe.capacity) pipe_release(w, &c->pipe, 1);
+    return 0;
+}
+
+// --- MSG_ZEROCOPY ---
+
+int zc_enable(int fd) {
+    int one = 1;
+    return setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one));
+}
+
+// Registra um envio na fila de conclusões (done = 1 para escritas copiadas)
+static int zc_push(Worker *w, Connection *c, size_t len, uint32_t id, int done) {
+    ZcState *zc = c->zc;
+    ZcEntry *e;
+
+    if (!zc) {
+        size_t chunk_size;
+        zc = buffer_pool_alloc(&w->pool, sizeof(ZcState), &chunk_size);
+        if (!zc) return -1;
+        // O pool entrega a maior classe se nenhuma comporta o pedido (validado em -b)
+        if (chunk_size < sizeof(ZcState)) {
+            buffer_pool_free(&w->pool, zc, chunk_size);
+            return -1;
+        }
+        zc->chunk_size = chunk_size;
+        zc->head = 0;
+        zc->count = 0;
+        c->zc = zc;
+    }
+
+    e = &zc->entries[(zc->head + zc->count) % ZC_MAX_INFLIGHT];
+    e->len = len;
+    e->id = id;
+    e->done = done;
+    zc->count++;
+    return 0;
+}
+
+// Libera, em ordem, os envios concluídos do início da fila
+static void zc_reap(Worker *w, Connection *c) {
+    ZcState *zc = c->zc;
+
+    if (!zc) return;
+    while (zc->count > 0 && zc->entries[zc->head].done) {
+        ring_release_hold(&w->pool, &c->out, zc->entries[zc->head].len);
+        zc->head = (zc->head + 1) % ZC_MAX_INFLIGHT;
+        zc->count--;
+    }
+    if (zc->count == 0) {
+        buffer_pool_free(&w->pool, zc, zc->chunk_size);
+        c->zc = NULL;
+    }
+}
+
+int zc_flush(Worker *w, Connection *c) {
+    struct iovec iov[2];
+    int iovcnt;
+
+    while ((iovcnt = ring_peek(&c->out, iov)) > 0) {
+        int zerocopy = c->out.len >= ZEROCOPY_MIN_BYTES;
+        ssize_t bytes_sent;
+
+        // Com envios em voo, toda escrita precisa de uma entrada na fila
+        if ((zerocopy || c->out.hold > 0) && c->zc && c->zc->count == ZC_MAX_INFLIGHT) return 0;
+
+        if (zerocopy) {
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = (size_t)iovcnt;
+            bytes_sent = sendmsg(c->fd, &msg, MSG_ZEROCOPY);
+            // ENOBUFS: limite de memória de notificações (optmem_max) esgotado, envia copiando
+            if (bytes_sent == -1 && errno == ENOBUFS) {
+                zerocopy = 0;
+                bytes_sent = writev(c->fd, iov, iovcnt);
+            }
+        } else {
+            bytes_sent = writev(c->fd, iov, iovcnt);
+        }
+
+        if (bytes_sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                COUNTER_ADD(w->write_eagain, 1);
+                return 0;
+            }
+            if (errno == EINTR) continue;
+            log_warn("Erro ao ecoar dados (send) no FD %d: %s", c->fd, strerror(errno));
+            return -1;
+        }
+        COUNTER_ADD(w->bytes_relayed, (uint64_t)bytes_sent);
+
+        if (zerocopy || c->out.hold > 0) {
+            // O kernel numera os envios MSG_ZEROCOPY bem-sucedidos de cada socket a partir de 0
+            uint32_t id = zerocopy ? c->zc_next_id++ : 0;
+            if (zc_push(w, c, (size_t)bytes_sent, id, !zerocopy) != 0) return -1;
+            ring_consume_hold(&c->out, (size_t)bytes_sent);
+        } else {
+            ring_consume(&w->pool, &c->out, (size_t)bytes_sent);
+        }
+    }
+    return 0;
+}
+
+int zc_read(Worker *w, Connection *c) {
+    struct iovec iov[2];
+
+    while (!c->read_paused) {
+        int iovcnt;
+        ssize_t bytes_read;
+
+        if (ring_reserve(&w->pool, &c->out, buffer_pool_max_chunk(&w->pool)) != 0) return -1;
+        iovcnt = ring_space(&c->out, iov);
+        if (iovcnt == 0) {
+            // Fila cheia (ou retida pelo kernel): espera escrita ou conclusões
+            c->read_paused = 1;
+            break;
+        }
+
+        bytes_read = readv(c->fd, iov, iovcnt);
+        if (bytes_read > 0) {
+            COUNTER_ADD(w->bytes_received, (uint64_t)bytes_read);
+            ring_commit(&c->out, (size_t)bytes_read);
+            if (zc_flush(w, c) != 0) return -1;
+            if (c->out.len + c->out.hold >= w->out_high_water) c->read_paused = 1;
+        } else if (bytes_read == 0) {
+            c->peer_closed = 1;
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            COUNTER_ADD(w->read_eagain, 1);
+            break;
+        } else {
+            log_warn("Erro ao ler dados (read) no FD %d: %s", c->fd, strerror(errno));
+            return -1;
+        }
+    }
+
+    // Devolve o chunk reservado se nada ficou pendente
+    if (c->out.data) ring_consume(&w->pool, &c->out, 0);
+    return 0;
+}
+
+// Marca como concluídos os envios com id no intervalo [lo, hi] (com wraparound)
+static void zc_mark_done(Worker *w, Connection *c, uint32_t lo, uint32_t hi, int copied) {
+    ZcState *zc = c->zc;
+    uint32_t count = hi - lo + 1;
+
+    COUNTER_ADD(w->zc_sends, count);
+    if (copied) COUNTER_ADD(w->zc_copied, count);
+    if (!zc) return;
+
+    for (int i = 0; i < zc->count; i++) {
+        ZcEntry *e = &zc->entries[(zc->head + i) % ZC_MAX_INFLIGHT];
+        if (!e->done && e->id - lo < count) e->done = 1;
+    }
+}
+
+int zc_complete(Worker *w, Connection *c) {
+    char control[128];
+    struct msghdr msg;
+    struct cmsghdr *cm;
+    int err = 0;
+    socklen_t err_len = sizeof(err);
+
+    while (1) {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(c->fd, &msg, MSG_ERRQUEUE) == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            log_warn("Erro ao ler conclusões MSG_ZEROCOPY no FD %d: %s", c->fd, strerror(errno));
+            return -1;
+        }
+
+        for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            struct sock_extended_err *serr;
+
+            if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+                !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) continue;
+
+            serr = (struct sock_extended_err *)CMSG_DATA(cm);
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+            zc_mark_done(w, c, serr->ee_info, serr->ee_data,
+                         serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED);
+        }
+    }
+    zc_reap(w, c);
+
+    // EPOLLERR também sinaliza erros reais do socket
+    if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &err_len) == 0 && err != 0) {
+        log_debug("[Worker %d] Erro no FD %d: %s", w->id, c->fd, strerror(err));
+        return -1;
+    }
+    return 0;
+}
+
+void data_path_release(Worker *w, Connection *c) {
+    if (c->pipe.capacity) pipe_release(w, &c->pipe, c->pipe_len == 0);
+    c->pipe_len = 0;
+    if (c->zc) {
+        buffer_pool_free(&w->pool, c->zc, c->zc->chunk_size);
+        c->zc = NULL;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef DATA_PATH_H
+#define DATA_PATH_H
+
+#include "worker.h"
+
+// Caminhos de dados alternativos do echo (motor epoll). O caminho de cópia fica em
+// loop_epoll.c; aqui ficam o splice (socket -> pipe -> socket) e o MSG_ZEROCOPY.
+// Todas as funções retornam -1 em erro fatal, e o chamador fecha a conexão.
+
+// Envios MSG_ZEROCOPY em voo por conexão (acima disso a escrita espera conclusões)
+#define ZC_MAX_INFLIGHT 64
+
+// Um envio aguardando conclusão. Escritas copiadas feitas enquanto há envios em voo
+// também entram na fila (já concluídas) para que a região retida seja liberada em ordem.
+typedef struct {
+    size_t len;
+    uint32_t id;     // Id atribuído pelo kernel (contador por socket)
+    int done;
+} ZcEntry;
+
+// Fila FIFO de envios, emprestada do pool do worker apenas enquanto houver envios em voo
+typedef struct ZcState {
+    size_t chunk_size;
+    int head;
+    int count;
+    ZcEntry entries[ZC_MAX_INFLIGHT];
+} ZcState;
+
+/**
+ * @brief Lê do cliente com splice() para o pipe da conexão e o esvazia no socket.
+ * Pausa a leitura (read_paused) enquanto o pipe não puder ser esvaziado.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int splice_read(Worker *w, Connection *c);
+
+/**
+ * @brief Esvazia o pipe da conexão no socket. O pipe volta ao cache do worker quando esvazia.
+ * @return int 0 em caso de sucesso (inclusive EAGAIN), -1 em caso de falha.
+ */
+int splice_flush(Worker *w, Connection *c);
+
+/**
+ * @brief Habilita SO_ZEROCOPY no socket do cliente.
+ * @return int 0 em caso de sucesso, -1 se o kernel não suporta (o chamador usa o caminho de cópia).
+ */
+int zc_enable(int fd);
+
+/**
+ * @brief Lê do cliente direto para a fila de saída (sem buffer intermediário) e a esvazia.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int zc_read(Worker *w, Connection *c);
+
+/**
+ * @brief Esvazia a fila de saída: send(MSG_ZEROCOPY) para blocos >= ZEROCOPY_MIN_BYTES,
+ * writev() para o restante. Os bytes enviados com MSG_ZEROCOPY ficam retidos até a conclusão.
+ * @return int 0 em caso de sucesso (inclusive EAGAIN), -1 em caso de falha.
+ */
+int zc_flush(Worker *w, Connection *c);
+
+/**
+ * @brief Trata EPOLLERR de uma conexão MSG_ZEROCOPY: drena as conclusões da fila de erros,
+ * libera os bytes retidos e verifica se o socket tem um erro real (SO_ERROR).
+ * @return int 0 em caso de sucesso, -1 se a conexão deve ser fechada.
+ */
+int zc_complete(Worker *w, Connection *c);
+
+/**
+ * @brief Fecha os pipes do cache que não foram usados desde a chamada anterior (manutenção periódica).
+ */
+void pipe_cache_trim(Worker *w);
+
+/**
+ * @brief Devolve o pipe e o estado MSG_ZEROCOPY da conexão (chamado ao fechá-la). Com envios
+ * MSG_ZEROCOPY em voo (out.hold > 0), só depois das conclusões ou de abortar o socket.
+ */
+void data_path_release(Worker *w, Connection *c);
+
+#endif // DATA_PATH_H
@@ -0,0 +1,17 @@
+#include "event_loop.h"
+#include <stddef.h>
+#include <string.h>
+
+static const EventLoopOps *const loops[] = {
+    &epoll_loop_ops,
+#ifdef HAVE_IO_URING
+    &uring_loop_ops,
+#endif
+};
+
+const EventLoopOps *event_loop_find(const char *name) {
+    for (size_t i = 0; i < sizeof(loops) / sizeof(loops[0]); i++) {
+        if (strcmp(loops[i]->name, name) == 0) return loops[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,41 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+struct Worker;
+
+// Interface mínima de um motor de eventos. Cada worker executa exatamente um motor,
+// escolhido em tempo de execução (-e), o que permite comparar os motores (A/B)
+// com a mesma carga, o mesmo modelo de workers e os mesmos contadores.
+typedef struct EventLoopOps {
+    const char *name;
+
+    /**
+     * @brief Cria os recursos do motor para o worker (instância epoll, anel io_uring...).
+     * Os sockets de escuta já foram criados em w->listen_fds.
+     * @return int 0 em caso de sucesso, -1 em caso de falha.
+     */
+    int (*init)(struct Worker *w);
+
+    /**
+     * @brief Loop de eventos do worker (executado na thread do worker).
+     */
+    void (*run)(struct Worker *w);
+
+    /**
+     * @brief Libera os recursos criados em init().
+     */
+    void (*destroy)(struct Worker *w);
+} EventLoopOps;
+
+extern const EventLoopOps epoll_loop_ops;
+#ifdef HAVE_IO_URING
+extern const EventLoopOps uring_loop_ops;
+#endif
+
+/**
+ * @brief Procura um motor pelo nome ("epoll" ou "uring").
+ * @return const EventLoopOps* O motor, ou NULL se não existir ou não foi compilado.
+ */
+const EventLoopOps *event_loop_find(const char *name);
+
+#endif // EVENT_LOOP_H
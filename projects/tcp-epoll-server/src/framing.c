@@ -0,0 +1,77 @@
+#include "framing.h"
+
+static uint32_t read_be32(const unsigned char *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void write_be32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+int frame_parse(const unsigned char *buf, size_t len, uint32_t max_payload, Frame *frames, int max_frames) {
+    size_t off = 0;
+    int count = 0;
+
+    while (count < max_frames && len - off >= FRAME_HEADER_SIZE) {
+        uint32_t payload_len = read_be32(buf + off);
+
+        // Rejeita o tamanho antes de esperar pelo payload: um cabeçalho inválido não pode
+        // prender a conexão aguardando bytes que nunca caberiam no buffer de entrada
+        if (payload_len > max_payload) return -1;
+        if (len - off - FRAME_HEADER_SIZE < payload_len) break;
+
+        frames[count].payload = buf + off + FRAME_HEADER_SIZE;
+        frames[count].len = payload_len;
+        count++;
+        off += FRAME_HEADER_SIZE + payload_len;
+    }
+    return count;
+}
+
+size_t frame_span(const Frame *frames, int count) {
+    const unsigned char *start, *end;
+
+    if (count <= 0) return 0;
+    start = frames[0].payload - FRAME_HEADER_SIZE;
+    end = frames[count - 1].payload + frames[count - 1].len;
+    return (size_t)(end - start);
+}
+
+void frame_writer_init(FrameWriter *fw, size_t limit) {
+    fw->iovcnt = 0;
+    fw->nframes = 0;
+    fw->bytes = 0;
+    fw->limit = limit;
+}
+
+int frame_writer_add(FrameWriter *fw, const void *payload, uint32_t len) {
+    size_t total = FRAME_HEADER_SIZE + (size_t)len;
+
+    if (fw->nframes == FRAME_BATCH_MAX || fw->bytes + total > fw->limit) return -1;
+
+    write_be32(fw->headers[fw->nframes], len);
+    fw->iov[fw->iovcnt].iov_base = fw->headers[fw->nframes];
+    fw->iov[fw->iovcnt].iov_len = FRAME_HEADER_SIZE;
+    fw->iovcnt++;
+    if (len > 0) {
+        fw->iov[fw->iovcnt].iov_base = (void *)payload;
+        fw->iov[fw->iovcnt].iov_len = len;
+        fw->iovcnt++;
+    }
+    fw->nframes++;
+    fw->bytes += total;
+    return 0;
+}
+
+int frame_echo_handler(void *ctx, const Frame *frames, int count, FrameWriter *out) {
+    int i;
+
+    (void)ctx;
+    for (i = 0; i < count; i++) {
+        if (frame_writer_add(out, frames[i].payload, frames[i].len) != 0) break;
+    }
+    return i;
+}
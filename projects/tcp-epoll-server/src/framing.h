@@ -0,0 +1,76 @@
+#ifndef FRAMING_H
+#define FRAMING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+// Quadros binários com prefixo de tamanho: 4 bytes big-endian com o tamanho do payload,
+// seguidos do payload. Usados pelo caminho de dados "framed" (RPC com mensagens pequenas).
+#define FRAME_HEADER_SIZE 4
+
+// Máximo de quadros entregues ao handler por chamada (e de respostas por writev())
+#define FRAME_BATCH_MAX 64
+
+// Um quadro completo recebido; o payload aponta para o buffer de entrada da conexão e
+// só é válido durante a chamada ao handler
+typedef struct {
+    const unsigned char *payload;
+    uint32_t len;
+} Frame;
+
+// Respostas de um lote, acumuladas como iovecs (cabeçalho + payload) para um único writev()
+typedef struct FrameWriter {
+    struct iovec iov[2 * FRAME_BATCH_MAX];
+    unsigned char headers[FRAME_BATCH_MAX][FRAME_HEADER_SIZE];
+    int iovcnt;
+    int nframes;
+    size_t bytes;    // Total de bytes das respostas (cabeçalhos incluídos)
+    size_t limit;    // Máximo de bytes que o lote pode produzir (espaço na fila de saída)
+} FrameWriter;
+
+/**
+ * @brief Handler de quadros: processa um lote de requisições e adiciona as respostas em out.
+ * Os payloads das respostas devem continuar válidos até o retorno (ex.: apontar para a requisição).
+ * @param ctx Contexto registrado junto com o handler.
+ * @param frames Quadros completos recebidos, na ordem.
+ * @param count Número de quadros (1 a FRAME_BATCH_MAX).
+ * @param out Respostas do lote (frame_writer_add()).
+ * @return int Quadros processados (os demais são reentregues depois), -1 para fechar a conexão.
+ */
+typedef int (*FrameHandler)(void *ctx, const Frame *frames, int count, FrameWriter *out);
+
+/**
+ * @brief Localiza os quadros completos em buf numa única passada.
+ * @param buf Bytes recebidos (início de um quadro).
+ * @param len Quantidade de bytes em buf.
+ * @param max_payload Maior payload aceito (proteção contra tamanhos abusivos).
+ * @param frames Saída: quadros encontrados.
+ * @param max_frames Capacidade de frames.
+ * @return int Número de quadros completos encontrados, -1 se um cabeçalho excede max_payload.
+ */
+int frame_parse(const unsigned char *buf, size_t len, uint32_t max_payload, Frame *frames, int max_frames);
+
+/**
+ * @brief Tamanho total (cabeçalho + payload) dos primeiros count quadros retornados por frame_parse().
+ */
+size_t frame_span(const Frame *frames, int count);
+
+/**
+ * @brief Prepara um lote de respostas vazio.
+ * @param limit Máximo de bytes que o lote pode produzir.
+ */
+void frame_writer_init(FrameWriter *fw, size_t limit);
+
+/**
+ * @brief Adiciona uma resposta ao lote (o payload não é copiado).
+ * @return int 0 em caso de sucesso, -1 se o lote está cheio ou a resposta excede o limite.
+ */
+int frame_writer_add(FrameWriter *fw, const void *payload, uint32_t len);
+
+/**
+ * @brief Handler padrão: responde cada quadro com o próprio payload (echo).
+ */
+int frame_echo_handler(void *ctx, const Frame *frames, int count, FrameWriter *out);
+
+#endif // FRAMING_H
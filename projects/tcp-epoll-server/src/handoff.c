@@ -0,0 +1,202 @@
+#include "handoff.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define HANDOFF_MAGIC 0x48414e44u // "HAND"
+#define HANDOFF_ACK_BYTE 'K'
+
+// Cabeçalho de cada mensagem; os fds vão nos dados auxiliares (SCM_RIGHTS)
+typedef struct {
+    uint32_t magic;
+    uint32_t count;             // fds nesta mensagem
+    uint32_t more;              // 1 se há outra mensagem em seguida
+} HandoffHeader;
+
+static int fill_address(struct sockaddr_un *addr, const char *path) {
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "Caminho do socket de handoff longo demais: %s\n", path);
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+int handoff_connect(const char *path) {
+    struct sockaddr_un addr;
+    int fd;
+
+    if (fill_address(&addr, path) != 0) return -1;
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+static int socket_port(int fd) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+
+    if (getsockname(fd, (struct sockaddr *)&addr, &len) < 0 || addr.sin_family != AF_INET) return -1;
+    return ntohs(addr.sin_port);
+}
+
+int handoff_receive(int fd, InheritedSocket *out, int max) {
+    int total = 0;
+    uint32_t more = 1;
+
+    while (more) {
+        char control[CMSG_SPACE(sizeof(int) * HANDOFF_BATCH)];
+        HandoffHeader header;
+        struct iovec iov = { &header, sizeof(header) };
+        struct msghdr msg;
+        struct cmsghdr *cmsg;
+        ssize_t n;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        do {
+            n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+        } while (n < 0 && errno == EINTR);
+        if (n != (ssize_t)sizeof(header) || header.magic != HANDOFF_MAGIC) {
+            fprintf(stderr, "Mensagem de handoff inválida.\n");
+            return -1;
+        }
+        more = header.more;
+
+        for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            int nfds, fds[HANDOFF_BATCH];
+
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+            nfds = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            memcpy(fds, CMSG_DATA(cmsg), (size_t)nfds * sizeof(int));
+            for (int i = 0; i < nfds; i++) {
+                int port = socket_port(fds[i]);
+                if (port < 0 || total == max) {
+                    close(fds[i]);
+                    continue;
+                }
+                out[total].fd = fds[i];
+                out[total].port = port;
+                total++;
+            }
+        }
+    }
+    return total;
+}
+
+int handoff_ack(int fd) {
+    char ack = HANDOFF_ACK_BYTE;
+    int rc = write(fd, &ack, 1) == 1 ? 0 : -1;
+
+    close(fd);
+    return rc;
+}
+
+int handoff_listen(const char *path) {
+    struct sockaddr_un addr;
+    int fd;
+
+    if (fill_address(&addr, path) != 0) return -1;
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("Erro ao criar o socket de handoff");
+        return -1;
+    }
+    unlink(path); // Caminho do processo anterior (que já entregou os sockets) ou de uma execução antiga
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+        perror("Erro no bind/listen do socket de handoff");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int send_batch(int fd, const int *fds, int count, int more) {
+    char control[CMSG_SPACE(sizeof(int) * HANDOFF_BATCH)];
+    HandoffHeader header = { HANDOFF_MAGIC, (uint32_t)count, (uint32_t)more };
+    struct iovec iov = { &header, sizeof(header) };
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    ssize_t n;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (count > 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * count);
+    }
+
+    do {
+        n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n == (ssize_t)sizeof(header) ? 0 : -1;
+}
+
+int handoff_send(int listen_fd, const Worker *workers, int num_workers) {
+    int fds[HANDOFF_MAX_SOCKETS], nfds = 0, client, sent = 0, rc = -1;
+    struct pollfd pfd;
+    char ack = 0;
+
+    client = accept(listen_fd, NULL, NULL);
+    if (client < 0) {
+        perror("Erro no accept do socket de handoff");
+        return -1;
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        for (int j = 0; j < workers[i].config->num_listeners; j++) {
+            if (workers[i].listen_fds[j] >= 0 && nfds < HANDOFF_MAX_SOCKETS) {
+                fds[nfds++] = workers[i].listen_fds[j];
+            }
+        }
+    }
+
+    do {
+        int count = nfds - sent < HANDOFF_BATCH ? nfds - sent : HANDOFF_BATCH;
+        if (send_batch(client, fds + sent, count, sent + count < nfds) != 0) {
+            perror("Erro ao enviar os sockets de escuta");
+            close(client);
+            return -1;
+        }
+        sent += count;
+    } while (sent < nfds);
+
+    // Sem confirmação (o novo processo falhou ao iniciar) este processo continua atendendo
+    pfd.fd = client;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, HANDOFF_ACK_TIMEOUT_MS) == 1 && read(client, &ack, 1) == 1 &&
+        ack == HANDOFF_ACK_BYTE) {
+        rc = 0;
+    } else {
+        fprintf(stderr, "Novo processo não confirmou o handoff; continuando a atender.\n");
+    }
+    close(client);
+    return rc;
+}
@@ -0,0 +1,50 @@
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include "worker.h"
+
+// Hot restart: o processo em execução escuta num socket Unix (-u) e entrega seus sockets de
+// escuta ao novo binário via SCM_RIGHTS. Como os sockets continuam os mesmos, as conexões na
+// fila de accept não se perdem; o processo antigo só drena depois da confirmação do novo.
+#define HANDOFF_MAX_SOCKETS 1024
+#define HANDOFF_BATCH 64        // fds por mensagem (o kernel limita SCM_RIGHTS a 253)
+
+typedef struct {
+    int fd;
+    int port;                   // Porta local (getsockname)
+} InheritedSocket;
+
+/**
+ * @brief Conecta ao socket de handoff de um processo em execução.
+ * @return int fd conectado, ou -1 (errno ENOENT/ECONNREFUSED: não há processo anterior).
+ */
+int handoff_connect(const char *path);
+
+/**
+ * @brief Recebe os sockets de escuta do processo anterior.
+ * @param out Sockets recebidos (fd e porta).
+ * @param max Capacidade de out (os excedentes são fechados).
+ * @return int Número de sockets recebidos, ou -1 em caso de falha.
+ */
+int handoff_receive(int fd, InheritedSocket *out, int max);
+
+/**
+ * @brief Confirma ao processo anterior que os workers já estão rodando (ele então drena) e fecha fd.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int handoff_ack(int fd);
+
+/**
+ * @brief Cria o socket Unix de handoff (substitui o caminho de um processo anterior).
+ * @return int fd de escuta, ou -1 em caso de falha.
+ */
+int handoff_listen(const char *path);
+
+/**
+ * @brief Atende um novo processo: envia os sockets de escuta de todos os workers e espera a confirmação.
+ * @param listen_fd Socket criado por handoff_listen().
+ * @return int 0 se o novo processo confirmou (o chamador deve drenar), -1 caso contrário.
+ */
+int handoff_send(int listen_fd, const Worker *workers, int num_workers);
+
+#endif // HANDOFF_H
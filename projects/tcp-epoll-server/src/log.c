@@ -0,0 +1,221 @@
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Fila MPSC limitada e sem locks (algoritmo de Vyukov): cada entrada carrega um número de
+// sequência que indica se está livre para o produtor da posição atual ou pronta para o
+// consumidor. Produtores (workers) só fazem um CAS e um vsnprintf; a thread de log é a
+// única que toca em stdout/stderr.
+typedef struct {
+    uint64_t seq;
+    int level;
+    struct timespec ts;
+    char msg[LOG_MSG_SIZE];
+} LogSlot;
+
+int log_runtime_level = LOG_LEVEL_INFO;
+
+static LogSlot *slots;
+static uint64_t enqueue_pos __attribute__((aligned(64)));
+static uint64_t dequeue_pos __attribute__((aligned(64)));
+static uint64_t dropped;          // Mensagens descartadas (fila cheia ou limite de taxa)
+static uint32_t rate_limit;
+static uint64_t rate_window;      // Segundo corrente da janela do limite de taxa
+static uint32_t rate_count;       // Mensagens aceitas na janela corrente
+static int running;
+static pthread_t log_thread;
+
+static const char *level_names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+// Limite de taxa por janela de um segundo (relógio grosso: sem syscall no vDSO)
+static int rate_allow(void) {
+    struct timespec now;
+    uint64_t window;
+
+    if (rate_limit == 0) return 1;
+
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    window = (uint64_t)now.tv_sec;
+    if (__atomic_load_n(&rate_window, __ATOMIC_RELAXED) != window) {
+        __atomic_store_n(&rate_window, window, __ATOMIC_RELAXED);
+        __atomic_store_n(&rate_count, 0, __ATOMIC_RELAXED);
+    }
+    return __atomic_fetch_add(&rate_count, 1, __ATOMIC_RELAXED) < rate_limit;
+}
+
+void log_write(int level, const char *fmt, ...) {
+    uint64_t pos;
+    LogSlot *slot;
+    va_list ap;
+
+    if (!slots) {
+        // Logger ainda não iniciado (ou já encerrado): escrita direta, fora do loop de eventos
+        va_start(ap, fmt);
+        vfprintf(level >= LOG_LEVEL_WARN ? stderr : stdout, fmt, ap);
+        va_end(ap);
+        fputc('\n', level >= LOG_LEVEL_WARN ? stderr : stdout);
+        return;
+    }
+    if (!rate_allow()) {
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        slot = &slots[pos & (LOG_QUEUE_SIZE - 1)];
+        int64_t diff = (int64_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (diff < 0) {
+            // Fila cheia: descarta em vez de bloquear o loop de eventos
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->level = level;
+    clock_gettime(CLOCK_REALTIME_COARSE, &slot->ts);
+    va_start(ap, fmt);
+    vsnprintf(slot->msg, sizeof(slot->msg), fmt, ap);
+    va_end(ap);
+
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+// Formata uma entrada no buffer de saída da thread de log
+static size_t format_slot(const LogSlot *slot, char *out, size_t size) {
+    struct tm tm;
+    int n;
+
+    localtime_r(&slot->ts.tv_sec, &tm);
+    n = snprintf(out, size, "%02d:%02d:%02d.%03ld [%s] %s\n", tm.tm_hour, tm.tm_min, tm.tm_sec,
+                 slot->ts.tv_nsec / 1000000, level_names[slot->level], slot->msg);
+    if (n < 0) return 0;
+    return (size_t)n < size ? (size_t)n : size - 1;
+}
+
+// Esvazia a fila; linhas são agrupadas e escritas com um único fwrite por destino
+static int drain_queue(void) {
+    char out[16384], err[4096];
+    size_t out_len = 0, err_len = 0;
+    int count = 0;
+
+    for (;;) {
+        LogSlot *slot = &slots[dequeue_pos & (LOG_QUEUE_SIZE - 1)];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != dequeue_pos + 1) break;
+
+        // Erros e avisos vão para stderr, o restante para stdout
+        if (slot->level >= LOG_LEVEL_WARN) {
+            if (sizeof(err) - err_len < LOG_MSG_SIZE + 64) {
+                fwrite(err, 1, err_len, stderr);
+                err_len = 0;
+            }
+            err_len += format_slot(slot, err + err_len, sizeof(err) - err_len);
+        } else {
+            if (sizeof(out) - out_len < LOG_MSG_SIZE + 64) {
+                fwrite(out, 1, out_len, stdout);
+                out_len = 0;
+            }
+            out_len += format_slot(slot, out + out_len, sizeof(out) - out_len);
+        }
+
+        __atomic_store_n(&slot->seq, dequeue_pos + LOG_QUEUE_SIZE, __ATOMIC_RELEASE);
+        dequeue_pos++;
+        count++;
+    }
+
+    if (out_len) {
+        fwrite(out, 1, out_len, stdout);
+        fflush(stdout);
+    }
+    if (err_len) {
+        fwrite(err, 1, err_len, stderr);
+    }
+    return count;
+}
+
+// Informa (no máximo uma vez por segundo) quantas mensagens foram descartadas
+static void report_dropped(uint64_t *reported, time_t *last_report) {
+    uint64_t d = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+    time_t now = time(NULL);
+
+    if (d != *reported && now != *last_report) {
+        fprintf(stderr, "[log] %llu mensagens descartadas (fila cheia ou limite de taxa)\n",
+                (unsigned long long)(d - *reported));
+        *reported = d;
+        *last_report = now;
+    }
+}
+
+static void *log_main(void *arg) {
+    uint64_t reported = 0;
+    time_t last_report = 0;
+    (void)arg;
+
+    while (__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        if (drain_queue() == 0) {
+            report_dropped(&reported, &last_report);
+            // Fila vazia: dorme um pouco em vez de fazer os produtores sinalizarem
+            usleep(5000);
+        }
+    }
+    drain_queue();
+    last_report = 0;
+    report_dropped(&reported, &last_report);
+    return NULL;
+}
+
+int log_init(int level, uint32_t limit) {
+    slots = calloc(LOG_QUEUE_SIZE, sizeof(LogSlot));
+    if (!slots) {
+        perror("Erro ao alocar a fila de log");
+        return -1;
+    }
+    for (uint64_t i = 0; i < LOG_QUEUE_SIZE; i++) slots[i].seq = i;
+
+    log_set_level(level);
+    rate_limit = limit;
+    running = 1;
+    if (pthread_create(&log_thread, NULL, log_main, NULL) != 0) {
+        perror("Erro ao criar a thread de log");
+        free(slots);
+        slots = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void log_shutdown(void) {
+    if (!slots) return;
+    __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+    pthread_join(log_thread, NULL);
+    free(slots);
+    slots = NULL;
+}
+
+uint64_t log_dropped(void) {
+    return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
+
+void log_set_level(int level) {
+    __atomic_store_n(&log_runtime_level, level, __ATOMIC_RELAXED);
+}
+
+int log_level_from_name(const char *name) {
+    static const char *names[] = { "debug", "info", "warn", "error", "off" };
+
+    for (int i = 0; i <= LOG_LEVEL_OFF; i++) {
+        if (strcmp(name, names[i]) == 0) return i;
+    }
+    return -1;
+}
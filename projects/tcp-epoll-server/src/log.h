@@ -0,0 +1,79 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+// Níveis de log
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF   4
+
+// Nível mínimo compilado: chamadas abaixo dele somem do binário.
+// Builds de debug mantêm os traces; builds com NDEBUG (Release) começam em INFO.
+#ifndef LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+// Tamanho máximo de uma mensagem (truncada além disso) e da fila (potência de 2)
+#define LOG_MSG_SIZE 200
+#define LOG_QUEUE_SIZE 4096
+
+// Nível mínimo em tempo de execução (lido com uma carga relaxada no caminho quente)
+extern int log_runtime_level;
+
+// Verdadeiro se o nível foi compilado e está habilitado (para evitar preparar argumentos caros)
+#define LOG_ENABLED(level) \
+    ((level) >= LOG_COMPILE_LEVEL && (level) >= __atomic_load_n(&log_runtime_level, __ATOMIC_RELAXED))
+
+#define LOG_AT(level, ...)                                                          \
+    do {                                                                            \
+        if (LOG_ENABLED(level)) log_write((level), __VA_ARGS__);                    \
+    } while (0)
+
+#define log_debug(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define log_info(...)  LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define log_warn(...)  LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define log_error(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+/**
+ * @brief Cria a fila de log e inicia a thread que a esvazia.
+ * @param level Nível mínimo em tempo de execução.
+ * @param rate_limit Máximo de mensagens aceitas por segundo (0 = sem limite).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int log_init(int level, uint32_t rate_limit);
+
+/**
+ * @brief Esvazia a fila, encerra a thread de log e libera a fila.
+ */
+void log_shutdown(void);
+
+/**
+ * @brief Altera o nível mínimo em tempo de execução.
+ */
+void log_set_level(int level);
+
+/**
+ * @brief Converte "debug", "info", "warn", "error" ou "off" no nível correspondente.
+ * @return int O nível, ou -1 se o nome for inválido.
+ */
+int log_level_from_name(const char *name);
+
+/**
+ * @brief Total de mensagens descartadas (fila cheia ou limite de taxa).
+ */
+uint64_t log_dropped(void);
+
+/**
+ * @brief Formata a mensagem e a enfileira sem bloquear. Se a fila estiver cheia ou o
+ * limite de taxa for excedido, a mensagem é descartada e contabilizada.
+ */
+void log_write(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#endif // LOG_H
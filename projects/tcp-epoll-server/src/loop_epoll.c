@@ -0,0 +1,751 @@
+#define _GNU_SOURCE
+#include "worker.h"
+#include "data_path.h"
+#include "metrics.h"
+#include "admission.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <errno.h>
+
+// Motor epoll: modo Edge-Triggered, buffers emprestados do pool do worker e fila de saída por conexão.
+// O caminho de dados (cópia, splice ou MSG_ZEROCOPY) é escolhido pelo listener que aceitou a conexão.
+
+// Dados dos eventos (data.u64): o fd nos 32 bits baixos e, nos eventos de clientes, a geração
+// da entrada da tabela nos 32 bits altos (0 para os sockets de escuta e o eventfd)
+static inline uint64_t event_key(int fd, uint32_t generation) {
+    return (uint64_t)generation << 32 | (uint32_t)fd;
+}
+
+static inline int event_fd(const struct epoll_event *e) {
+    return (int)(uint32_t)e->data.u64;
+}
+
+static inline uint32_t event_generation(const struct epoll_event *e) {
+    return (uint32_t)(e->data.u64 >> 32);
+}
+
+static void list_push(Connection **head, Connection *c) {
+    c->prev = NULL;
+    c->next = *head;
+    if (c->next) c->next->prev = c;
+    *head = c;
+}
+
+static void list_remove(Connection **head, Connection *c) {
+    if (c->prev) c->prev->next = c->next;
+    else *head = c->next;
+    if (c->next) c->next->prev = c->prev;
+    c->next = c->prev = NULL;
+}
+
+// Fechamento abortivo (RST): o kernel descarta as filas de envio e de retransmissão do
+// socket no close(), em vez de continuar enviando a partir das páginas do usuário
+static void abort_socket(int fd) {
+    struct linger lg = { .l_onoff = 1, .l_linger = 0 };
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+}
+
+// Remove o cliente do epoll, devolve a entrada e fecha o socket.
+// O fd é fechado por último: a partir do close() outro worker pode receber o mesmo número
+// no accept() e reinicializar a entrada da tabela.
+static void destroy_client(Worker *w, Connection *c) {
+    int fd = c->fd;
+
+    epoll_ctl(w->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    if (c->out.hold > 0) abort_socket(fd);
+    data_path_release(w, c);
+    conn_release(&w->pool, c);
+    close(fd);
+}
+
+// Fim da espera por conclusões MSG_ZEROCOPY: todas chegaram, ou o prazo esgotou (abort)
+static void finish_retired(Worker *w, Connection *c) {
+    timer_cancel(&w->timers, &c->idle_timer);
+    list_remove(&w->zc_retired, c);
+    destroy_client(w, c);
+}
+
+static void retire_expired(TimerNode *t, void *ctx) {
+    Worker *w = ctx;
+    Connection *c = container_of(t, Connection, idle_timer);
+
+    log_warn("[Worker %d] Conclusões MSG_ZEROCOPY não chegaram no FD %d: conexão abortada.", w->id, c->fd);
+    finish_retired(w, c);
+}
+
+// Com envios MSG_ZEROCOPY em voo, o kernel continua lendo as páginas do chunk da fila de
+// saída mesmo depois do close(). Se o chunk voltasse ao pool, outra conexão o reutilizaria
+// e seus bytes sairiam por este socket. A conexão vai para a lista de aposentadas do worker,
+// com o fd aberto apenas para receber as conclusões pela fila de erros.
+// Retorna -1 se a conexão pode ser destruída agora.
+static int retire_client(Worker *w, Connection *c) {
+    struct epoll_event event;
+
+    zc_complete(w, c); // Conclusões que já estão na fila de erros
+    if (c->out.hold == 0) return -1;
+
+    // O que ainda não foi enviado é descartado; o cliente recebe o FIN após os envios em voo
+    ring_consume(&w->pool, &c->out, c->out.len);
+    shutdown(c->fd, SHUT_RDWR);
+
+    // Só EPOLLERR (sempre reportado) interessa; EPOLLET evita repetir o EPOLLHUP
+    event.events = EPOLLET;
+    event.data.u64 = event_key(c->fd, c->generation);
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_MOD, c->fd, &event) == -1) return -1;
+    c->events = event.events;
+    c->retired = 1;
+    c->idle_timer.cb = retire_expired;
+    timer_add(&w->timers, &c->idle_timer, ZC_RETIRE_TIMEOUT_MS);
+    list_push(&w->zc_retired, c);
+    return 0;
+}
+
+// Fecha a conexão do cliente e atualiza o contador de conexões ativas
+static void close_client(Worker *w, Connection *c) {
+    timer_cancel(&w->timers, &c->idle_timer);
+    timer_cancel(&w->timers, &c->read_timer);
+    list_remove(&w->conn_list, c);
+    if (w->config->admission) admission_release(w->config->admission, c->peer_ip);
+    __atomic_fetch_sub(&w->conexoes_ativas, 1, __ATOMIC_RELAXED);
+
+    if (c->out.hold > 0 && retire_client(w, c) == 0) return;
+    destroy_client(w, c);
+}
+
+// Timer de ociosidade: a atividade apenas atualiza last_active (sem mexer no wheel a cada
+// evento); ao expirar, se houve atividade, o timer se rearma pelo tempo restante
+static void idle_expired(TimerNode *t, void *ctx) {
+    Worker *w = ctx;
+    Connection *c = container_of(t, Connection, idle_timer);
+    uint64_t idle = w->timers.now_ms - c->last_active;
+
+    if (idle < w->config->idle_timeout_ms) {
+        timer_add(&w->timers, t, w->config->idle_timeout_ms - idle);
+        return;
+    }
+    log_debug("[Worker %d] Conexão ociosa fechada no FD %d.", w->id, c->fd);
+    COUNTER_ADD(w->idle_timeouts, 1);
+    close_client(w, c);
+}
+
+// O cliente iniciou um quadro e não o completou dentro do prazo
+static void read_expired(TimerNode *t, void *ctx) {
+    Worker *w = ctx;
+    Connection *c = container_of(t, Connection, read_timer);
+
+    log_debug("[Worker %d] Prazo de leitura esgotado no FD %d.", w->id, c->fd);
+    COUNTER_ADD(w->read_timeouts, 1);
+    close_client(w, c);
+}
+
+// Manutenção periódica do worker
+static void housekeeping(TimerNode *t, void *ctx) {
+    (void)t;
+    pipe_cache_trim((Worker *)ctx);
+}
+
+// Bytes ainda sob responsabilidade do servidor: fila de saída, pipe de splice e
+// bytes retidos pelo kernel (MSG_ZEROCOPY)
+static size_t pending_output(const Connection *c) {
+    return c->out.len + c->out.hold + c->pipe_len;
+}
+
+// Atualiza a máscara do epoll: EPOLLOUT apenas enquanto há dados pendentes,
+// EPOLLIN apenas enquanto a leitura não está pausada por backpressure
+static int update_events(Worker *w, Connection *c) {
+    struct epoll_event event;
+    uint32_t events = EPOLLET | EPOLLRDHUP;
+
+    if (!c->read_paused) events |= EPOLLIN;
+    if (c->out.len > 0 || c->pipe_len > 0) events |= EPOLLOUT;
+    if (events == c->events) return 0;
+
+    event.events = events;
+    event.data.u64 = event_key(c->fd, c->generation);
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_MOD, c->fd, &event) == -1) {
+        log_error("Erro ao atualizar eventos do cliente no epoll: %s", strerror(errno));
+        return -1;
+    }
+    c->events = events;
+    return 0;
+}
+
+// Escreve o máximo possível da fila de saída.
+// Retorna 0 se a escrita parou por EAGAIN ou a fila esvaziou, -1 em erro fatal.
+static int flush_output(Worker *w, Connection *c) {
+    struct iovec iov[2];
+    int iovcnt;
+
+    if (c->data_path == DATA_PATH_SPLICE) return splice_flush(w, c);
+    if (c->data_path == DATA_PATH_ZEROCOPY) return zc_flush(w, c);
+
+    while ((iovcnt = ring_peek(&c->out, iov)) > 0) {
+        ssize_t bytes_sent = writev(c->fd, iov, iovcnt);
+        if (bytes_sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                COUNTER_ADD(w->write_eagain, 1);
+                return 0;
+            }
+            if (errno == EINTR) continue;
+            log_warn("Erro ao ecoar dados (write) no FD %d: %s", c->fd, strerror(errno));
+            return -1;
+        }
+        COUNTER_ADD(w->bytes_relayed, (uint64_t)bytes_sent);
+        ring_consume(&w->pool, &c->out, (size_t)bytes_sent);
+    }
+    return 0;
+}
+
+// Envia dados ao cliente preservando a ordem: escreve direto no socket se não há nada
+// pendente e enfileira o que o kernel não aceitou
+static int send_data(Worker *w, Connection *c, const char *data, size_t len) {
+    if (c->out.len == 0) {
+        ssize_t bytes_sent = write(c->fd, data, len);
+        if (bytes_sent == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                log_warn("Erro ao ecoar dados (write) no FD %d: %s", c->fd, strerror(errno));
+                return -1;
+            }
+            if (errno != EINTR) COUNTER_ADD(w->write_eagain, 1);
+            bytes_sent = 0;
+        }
+        COUNTER_ADD(w->bytes_relayed, (uint64_t)bytes_sent);
+        data += bytes_sent;
+        len -= (size_t)bytes_sent;
+    }
+
+    if (len > 0 && ring_push(&w->pool, &c->out, data, len) != len) {
+        // Não deve ocorrer: a leitura é pausada antes de o buffer encher
+        log_error("Buffer de saída cheio no FD %d.", c->fd);
+        return -1;
+    }
+    return 0;
+}
+
+// Aceita até accept_budget conexões do socket de escuta. O socket de escuta é level-triggered:
+// se a fila não esvaziou, o próximo epoll_wait o devolve de novo, depois dos eventos das
+// conexões existentes. accept4() já entrega o socket não-bloqueante (sem fcntl por conexão).
+static void accept_clients(Worker *w, int listener) {
+    const ListenerConfig *lc = &w->config->listeners[listener];
+    Admission *admission = w->config->admission;
+    struct sockaddr_in client_addr;
+    socklen_t client_len;
+    struct epoll_event event;
+    int client_sock;
+    Connection *c;
+
+    for (uint32_t budget = w->config->accept_budget; budget > 0; budget--) {
+        client_len = sizeof(client_addr);
+        client_sock = accept4(w->listen_fds[listener], (struct sockaddr *)&client_addr, &client_len,
+                              SOCK_NONBLOCK | SOCK_CLOEXEC);
+        
+        if (client_sock == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Todas as conexões pendentes foram aceitas
+                break;
+            }
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            // EMFILE/ENFILE/ENOBUFS: a conexão continua na fila e será tentada de novo
+            log_error("Erro no accept: %s", strerror(errno));
+            break;
+        }
+
+        // Controle de admissão: fecha logo a conexão acima do limite global ou do IP
+        if (admission && admission_acquire(admission, client_addr.sin_addr.s_addr) != 0) {
+            COUNTER_ADD(w->conexoes_rejeitadas, 1);
+            log_debug("[Worker %d] Conexão recusada pelo limite de conexões: FD %d", w->id, client_sock);
+            close(client_sock);
+            continue;
+        }
+
+        c = conn_open(w->conns, client_sock, w->id);
+        if (!c) {
+            log_error("FD %d fora da tabela de conexões.", client_sock);
+            if (admission) admission_release(admission, client_addr.sin_addr.s_addr);
+            close(client_sock);
+            continue;
+        }
+        c->peer_ip = client_addr.sin_addr.s_addr;
+        c->data_path = lc->data_path;
+        if (c->data_path == DATA_PATH_ZEROCOPY && zc_enable(client_sock) != 0) {
+            log_debug("[Worker %d] SO_ZEROCOPY indisponível no FD %d: %s (usando cópia)",
+                      w->id, client_sock, strerror(errno));
+            c->data_path = DATA_PATH_COPY;
+        }
+        
+        if (LOG_ENABLED(LOG_LEVEL_DEBUG)) {
+            char ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &client_addr.sin_addr, ip, sizeof(ip));
+            log_debug("[Worker %d] Nova conexão aceita: FD %d (IP: %s)", w->id, client_sock, ip);
+        }
+        
+        // Adiciona o novo socket do cliente ao epoll
+        event.events = EPOLLIN | EPOLLET | EPOLLRDHUP; // EPOLLRDHUP para detecção de desconexão
+        event.data.u64 = event_key(client_sock, c->generation);
+        if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, client_sock, &event) == -1) {
+            log_error("Erro ao adicionar o socket do cliente ao epoll: %s", strerror(errno));
+            if (admission) admission_release(admission, c->peer_ip);
+            conn_release(&w->pool, c);
+            close(client_sock);
+            continue;
+        }
+        c->events = event.events;
+        c->last_active = w->timers.now_ms;
+        c->idle_timer.cb = idle_expired;
+        c->read_timer.cb = read_expired;
+        if (w->config->idle_timeout_ms > 0) {
+            timer_add(&w->timers, &c->idle_timer, w->config->idle_timeout_ms);
+        }
+        list_push(&w->conn_list, c);
+
+        __atomic_fetch_add(&w->conexoes_aceitas, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&w->conexoes_ativas, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Caminho de cópia: lê os dados pendentes do cliente e os ecoa de volta.
+// Retorna -1 em erro fatal (o chamador fecha a conexão).
+static int copy_read(Worker *w, Connection *c) {
+    char *buffer = NULL;
+    size_t buffer_size = 0, max_out = buffer_pool_max_chunk(&w->pool);
+    ssize_t bytes_read;
+
+    // O buffer de leitura (maior chunk do pool) é emprestado apenas durante a rajada de leitura
+    if (!c->read_paused) {
+        buffer = buffer_pool_alloc(&w->pool, max_out, &buffer_size);
+        if (!buffer) return -1;
+    }
+    
+    // Loop de leitura (característica do EPOLLET: garante que todos os dados pendentes sejam lidos).
+    // Com a fila de saída acima do high-water mark a leitura é pausada: o kernel segura os dados
+    // e o controle de fluxo do TCP desacelera o cliente, sem crescer a memória do servidor.
+    while (!c->read_paused) {
+        // Nunca lê mais do que cabe na fila de saída caso o write() não aceite nada
+        size_t to_read = buffer_size;
+        if (c->out.len > 0 && max_out - c->out.len < to_read) to_read = max_out - c->out.len;
+
+        bytes_read = read(c->fd, buffer, to_read);
+        if (bytes_read > 0) {
+            COUNTER_ADD(w->bytes_received, (uint64_t)bytes_read);
+            log_debug("[Worker %d] FD %d: Recebido %zd bytes", w->id, c->fd, bytes_read);
+
+            // Exemplo de Processamento: Ecoar a mensagem de volta
+            if (send_data(w, c, buffer, (size_t)bytes_read) != 0) {
+                buffer_pool_free(&w->pool, buffer, buffer_size);
+                return -1;
+            }
+            if (c->out.len >= w->out_high_water) c->read_paused = 1;
+        } else if (bytes_read == 0) {
+            // O cliente performou um shutdown ordenado (ainda enviamos o que está pendente)
+            c->peer_closed = 1;
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            COUNTER_ADD(w->read_eagain, 1);
+            break;
+        } else {
+            // Erro real, não apenas sem dados disponíveis
+            log_warn("Erro ao ler dados (read) no FD %d: %s", c->fd, strerror(errno));
+            buffer_pool_free(&w->pool, buffer, buffer_size);
+            return -1;
+        }
+    }
+    buffer_pool_free(&w->pool, buffer, buffer_size);
+    return 0;
+}
+
+// Envia as respostas de um lote com um único writev() (ou as enfileira atrás dos dados
+// pendentes). O que o kernel não aceitar vai para a fila de saída.
+static int send_frames(Worker *w, Connection *c, const FrameWriter *fw) {
+    size_t skip = 0;
+
+    if (c->out.len == 0) {
+        ssize_t bytes_sent = writev(c->fd, fw->iov, fw->iovcnt);
+        if (bytes_sent == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                log_warn("Erro ao enviar respostas (writev) no FD %d: %s", c->fd, strerror(errno));
+                return -1;
+            }
+            if (errno != EINTR) COUNTER_ADD(w->write_eagain, 1);
+            bytes_sent = 0;
+        }
+        COUNTER_ADD(w->bytes_relayed, (uint64_t)bytes_sent);
+        skip = (size_t)bytes_sent;
+    }
+
+    for (int i = 0; i < fw->iovcnt; i++) {
+        const unsigned char *base = fw->iov[i].iov_base;
+        size_t len = fw->iov[i].iov_len;
+
+        if (skip >= len) {
+            skip -= len;
+            continue;
+        }
+        // Não deve falhar: o limite do lote é o espaço livre na fila de saída
+        if (ring_push(&w->pool, &c->out, base + skip, len - skip) != len - skip) {
+            log_error("Buffer de saída cheio no FD %d.", c->fd);
+            return -1;
+        }
+        skip = 0;
+    }
+    return 0;
+}
+
+// Despacha em lotes os quadros completos do buffer de entrada e guarda o restante
+// (quadro incompleto) no início do buffer. Para no high-water mark da fila de saída.
+static int dispatch_frames(Worker *w, Connection *c) {
+    Frame frames[FRAME_BATCH_MAX];
+    FrameWriter fw;
+    size_t off = 0, max_out = buffer_pool_max_chunk(&w->pool);
+    int count, handled;
+
+    while (c->out.len < w->out_high_water) {
+        count = frame_parse(c->in.data + off, c->in.len - off, w->frame_max_payload, frames, FRAME_BATCH_MAX);
+        if (count < 0) {
+            log_warn("Quadro acima do limite (%u bytes) no FD %d.", w->frame_max_payload, c->fd);
+            return -1;
+        }
+        if (count == 0) break;
+
+        frame_writer_init(&fw, max_out - c->out.len);
+        handled = w->config->frame_handler(w->config->frame_ctx, frames, count, &fw);
+        if (handled < 0) return -1;
+        if (handled == 0) {
+            // A resposta não coube nem com a fila de saída vazia
+            if (c->out.len == 0) {
+                log_warn("Resposta maior que a fila de saída no FD %d.", c->fd);
+                return -1;
+            }
+            // Espera a fila esvaziar: handle_write despacha os quadros guardados
+            c->read_paused = 1;
+            break;
+        }
+        if (fw.iovcnt > 0 && send_frames(w, c, &fw) != 0) return -1;
+
+        COUNTER_ADD(w->frames, (uint64_t)handled);
+        COUNTER_ADD(w->frame_batches, 1);
+        off += frame_span(frames, handled);
+    }
+
+    if (off > 0) {
+        memmove(c->in.data, c->in.data + off, c->in.len - off);
+        c->in.len -= off;
+    }
+    if (c->out.len >= w->out_high_water) c->read_paused = 1;
+    return 0;
+}
+
+// Caminho framed: lê para o buffer de entrada (que guarda quadros incompletos entre
+// leituras) e despacha todos os quadros completos de cada leitura de uma vez.
+// Retorna -1 em erro fatal (o chamador fecha a conexão).
+static int framed_read(Worker *w, Connection *c) {
+    ssize_t bytes_read;
+
+    // Quadros guardados durante o backpressure são despachados antes de ler mais
+    if (c->in.len > 0 && dispatch_frames(w, c) != 0) return -1;
+
+    while (!c->read_paused) {
+        if (!c->in.data) {
+            c->in.data = buffer_pool_alloc(&w->pool, buffer_pool_max_chunk(&w->pool), &c->in.capacity);
+            if (!c->in.data) return -1;
+            c->in.len = 0;
+        }
+        // Buffer cheio sem nenhum quadro completo (o dispatch teria pausado a leitura): o
+        // quadro não cabe. Um read() de 0 bytes retornaria 0 e pareceria o fim do stream
+        if (c->in.len == c->in.capacity) {
+            log_warn("Quadro maior que o buffer de entrada (%zu bytes) no FD %d.", c->in.capacity, c->fd);
+            return -1;
+        }
+
+        bytes_read = read(c->fd, c->in.data + c->in.len, c->in.capacity - c->in.len);
+        if (bytes_read > 0) {
+            COUNTER_ADD(w->bytes_received, (uint64_t)bytes_read);
+            c->in.len += (size_t)bytes_read;
+            if (dispatch_frames(w, c) != 0) return -1;
+        } else if (bytes_read == 0) {
+            // Um quadro incompleto no fim do stream nunca será completado
+            c->peer_closed = 1;
+            c->in.len = 0;
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            COUNTER_ADD(w->read_eagain, 1);
+            break;
+        } else {
+            log_warn("Erro ao ler dados (read) no FD %d: %s", c->fd, strerror(errno));
+            return -1;
+        }
+    }
+
+    // Conexões sem quadro pendente não mantêm buffer de entrada
+    if (c->in.data && c->in.len == 0) {
+        buffer_pool_free(&w->pool, c->in.data, c->in.capacity);
+        c->in.data = NULL;
+        c->in.capacity = 0;
+    }
+
+    // Prazo de leitura: corre apenas enquanto há um quadro incompleto esperando o cliente
+    // (não durante o backpressure, em que é o servidor que segura os quadros)
+    if (c->in.len > 0 && !c->read_paused) {
+        if (w->config->read_deadline_ms > 0 && !timer_active(&c->read_timer)) {
+            timer_add(&w->timers, &c->read_timer, w->config->read_deadline_ms);
+        }
+    } else {
+        timer_cancel(&w->timers, &c->read_timer);
+    }
+    return 0;
+}
+
+// Lê os dados pendentes do cliente e os ecoa de volta pelo caminho de dados da conexão.
+// Retorna -1 se a conexão foi fechada.
+static int handle_read(Worker *w, Connection *c) {
+    int rc;
+
+    switch (c->data_path) {
+        case DATA_PATH_SPLICE: rc = splice_read(w, c); break;
+        case DATA_PATH_ZEROCOPY: rc = zc_read(w, c); break;
+        case DATA_PATH_FRAMED: rc = framed_read(w, c); break;
+        default: rc = copy_read(w, c); break;
+    }
+    if (rc != 0) {
+        close_client(w, c);
+        return -1;
+    }
+
+    if (c->peer_closed && pending_output(c) == 0) {
+        log_debug("[Worker %d] Conexão fechada por peer no FD %d.", w->id, c->fd);
+        close_client(w, c);
+        return -1;
+    }
+    if (update_events(w, c) != 0) {
+        close_client(w, c);
+        return -1;
+    }
+    return 0;
+}
+
+// O socket voltou a aceitar escrita: esvazia a fila e retoma a leitura se ela estava pausada.
+// Retorna -1 se a conexão foi fechada (ela pode continuar em uso, aposentada, no caminho
+// MSG_ZEROCOPY: o chamador não deve mais tratá-la como aberta).
+static int handle_write(Worker *w, Connection *c) {
+    if (flush_output(w, c) != 0) {
+        close_client(w, c);
+        return -1;
+    }
+
+    if (c->read_paused && !c->peer_closed && pending_output(c) <= w->out_low_water) {
+        // Não haverá nova borda de EPOLLIN para os dados já enfileirados no kernel, nem para os
+        // quadros guardados no buffer de entrada (framed): despacha e lê agora
+        c->read_paused = 0;
+        return handle_read(w, c);
+    }
+
+    if (c->peer_closed && pending_output(c) == 0) {
+        log_debug("[Worker %d] Conexão fechada por peer no FD %d.", w->id, c->fd);
+        close_client(w, c);
+        return -1;
+    }
+    if (update_events(w, c) != 0) {
+        close_client(w, c);
+        return -1;
+    }
+    return 0;
+}
+
+// Desligamento gracioso: para de aceitar e deixa cada conexão apenas esvaziar a fila de
+// saída (fecha na hora as que não têm nada pendente)
+static void begin_drain(Worker *w) {
+    Connection *c, *next;
+
+    // Remoção explícita: após um handoff o socket continua aberto no novo processo,
+    // e o close() sozinho não o tiraria deste epoll
+    for (int i = 0; i < w->config->num_listeners; i++) {
+        epoll_ctl(w->epoll_fd, EPOLL_CTL_DEL, w->listen_fds[i], NULL);
+    }
+    worker_close_listeners(w);
+
+    for (c = w->conn_list; c; c = next) {
+        next = c->next;
+        if (pending_output(c) == 0) {
+            close_client(w, c);
+            continue;
+        }
+        c->peer_closed = 1;
+        c->read_paused = 1;
+        if (update_events(w, c) != 0) close_client(w, c);
+    }
+    log_info("[Worker %d] Drenando: %llu conexões com dados pendentes.", w->id,
+             (unsigned long long)w->conexoes_ativas);
+}
+
+// Prazo do desligamento esgotado: fecha o que restou (e aborta as conexões que ainda
+// aguardam conclusões MSG_ZEROCOPY)
+static void close_all(Worker *w) {
+    uint64_t remaining = w->conexoes_ativas;
+
+    while (w->conn_list) close_client(w, w->conn_list);
+    while (w->zc_retired) finish_retired(w, w->zc_retired);
+    if (remaining > 0) {
+        log_warn("[Worker %d] %llu conexões fechadas à força no desligamento.", w->id,
+                 (unsigned long long)remaining);
+    }
+}
+
+static int epoll_loop_init(Worker *w) {
+    struct epoll_event event;
+
+    w->housekeeping.cb = housekeeping;
+    timer_add_periodic(&w->timers, &w->housekeeping, HOUSEKEEPING_INTERVAL_MS);
+
+    // Criação da Instância epoll (uma por worker)
+    w->epoll_fd = epoll_create1(0);
+    if (w->epoll_fd == -1) {
+        perror("Erro ao criar a instância epoll");
+        return -1;
+    }
+
+    // Adicionar os Sockets de Escuta ao epoll
+    for (int i = 0; i < w->config->num_listeners; i++) {
+        // Level-triggered: com o orçamento de accepts, a fila pode não esvaziar em um despertar
+        event.events = EPOLLIN;
+        event.data.u64 = event_key(w->listen_fds[i], 0);
+        if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->listen_fds[i], &event) == -1) {
+            perror("Erro ao adicionar o socket de escuta ao epoll");
+            close(w->epoll_fd);
+            w->epoll_fd = -1;
+            return -1;
+        }
+    }
+
+    // eventfd de controle (desligamento), em modo level-triggered
+    event.events = EPOLLIN;
+    event.data.u64 = event_key(w->wake_fd, 0);
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->wake_fd, &event) == -1) {
+        perror("Erro ao adicionar o eventfd do worker ao epoll");
+        close(w->epoll_fd);
+        w->epoll_fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void epoll_loop_destroy(Worker *w) {
+    if (w->epoll_fd >= 0) close(w->epoll_fd);
+    w->epoll_fd = -1;
+}
+
+// Loop Principal do Worker (I/O Multiplexada) 
+static void epoll_loop_run(Worker *w) {
+    struct epoll_event events[MAX_EVENTS];
+    int n, i, state = WORKER_RUNNING;
+    uint64_t start_ns;
+
+    while (1) {
+        // Espera por eventos no epoll_fd (bloqueia até um evento ou o próximo timer vencer)
+        n = epoll_wait(w->epoll_fd, events, MAX_EVENTS,
+                       timer_wheel_timeout(&w->timers, monotonic_ms()));
+        if (n == -1) {
+            if (errno == EINTR) continue; // Interrompido por sinal
+            log_error("Erro no epoll_wait: %s", strerror(errno));
+            break;
+        }
+
+        // Atualiza o relógio em cache usado para marcar atividade
+        start_ns = monotonic_ns();
+        timer_wheel_set_clock(&w->timers, start_ns / 1000000);
+
+        // Processa todos os eventos retornados
+        for (i = 0; i < n; i++) {
+            int fd = event_fd(&events[i]);
+            int listener = worker_listener_index(w, fd);
+
+            // Mudança de estado pedida pela thread principal (worker_drain/worker_stop)
+            if (fd == w->wake_fd) {
+                uint64_t value;
+                int new_state = __atomic_load_n(&w->state, __ATOMIC_ACQUIRE);
+
+                while (read(w->wake_fd, &value, sizeof(value)) < 0 && errno == EINTR) {}
+                if (new_state >= WORKER_DRAINING && state == WORKER_RUNNING) begin_drain(w);
+                if (new_state == WORKER_STOPPING) close_all(w);
+                state = new_state;
+                continue;
+            }
+
+            // Novo Evento em um Socket de Escuta (Nova Conexão)
+            if (listener >= 0) {
+                accept_clients(w, listener);
+            }
+            // Evento em um Socket de Cliente (Leitura ou Desconexão)
+            else {
+                // Evento de uma conexão já fechada neste lote (o fd pode ter sido reaceito)
+                Connection *c = conn_get(w->conns, fd, w->id, event_generation(&events[i]));
+                if (!c) continue;
+
+                // Conexão aposentada: só recebe as conclusões MSG_ZEROCOPY que faltam
+                if (c->retired) {
+                    if (events[i].events & EPOLLERR) zc_complete(w, c);
+                    if (c->out.hold == 0) finish_retired(w, c);
+                    continue;
+                }
+                c->last_active = w->timers.now_ms;
+
+                // Conclusões MSG_ZEROCOPY chegam pela fila de erros (EPOLLERR): libera os bytes
+                // retidos e continua a escrita (ou fecha, se o socket tem um erro real)
+                if ((events[i].events & EPOLLERR) && !(events[i].events & EPOLLHUP) &&
+                    c->data_path == DATA_PATH_ZEROCOPY) {
+                    if (zc_complete(w, c) != 0) {
+                        close_client(w, c);
+                        continue;
+                    }
+                    if (handle_write(w, c) != 0) continue;
+                    events[i].events &= ~(uint32_t)(EPOLLERR | EPOLLOUT);
+                }
+
+                // Desconexão (O cliente fechou o socket ou erro)
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    log_debug("[Worker %d] Conexão fechada ou erro no FD %d.", w->id, c->fd);
+                    close_client(w, c);
+                    continue;
+                }
+
+                // Escrita pendente liberada pelo kernel
+                if (events[i].events & EPOLLOUT) {
+                    if (handle_write(w, c) != 0) continue;
+                }
+
+                // Leitura de Dados (EPOLLRDHUP também é tratado aqui: read() retorna 0 após
+                // os dados restantes, e a conexão é fechada quando a fila de saída esvaziar)
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                    handle_read(w, c);
+                }
+            }
+        }
+
+        // Timers vencidos só depois do lote: um timer que fecha uma conexão não deixa eventos
+        // pendentes deste lote apontando para o fd
+        timer_wheel_advance(&w->timers, start_ns / 1000000);
+
+        metrics_record_iteration(w, n, monotonic_ns() - start_ns);
+
+        // Drenagem concluída (ou interrompida pelo prazo)
+        if (state != WORKER_RUNNING && !w->conn_list && !w->zc_retired) break;
+    }
+}
+
+const EventLoopOps epoll_loop_ops = {
+    .name = "epoll",
+    .init = epoll_loop_init,
+    .run = epoll_loop_run,
+    .destroy = epoll_loop_destroy,
+};
@@ -0,0 +1,540 @@
+#include "worker.h"
+#include "uring.h"
+#include "metrics.h"
+#include "admission.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// Motor io_uring: accept multishot, recv com anel de buffers fornecidos e
+// envios encadeados (IOSQE_IO_LINK). Os dados recebidos são ecoados a partir do próprio
+// buffer fornecido pelo kernel, que só volta ao anel quando o envio termina. Em regime,
+// cada mensagem ecoada custa uma fração de um io_uring_enter() em vez de read() + write().
+
+#define URING_BGID 0
+
+enum { OP_ACCEPT = 1, OP_RECV = 2, OP_SEND = 3, OP_WAKE = 4, OP_CANCEL = 5 };
+
+#define UD_MAKE(op, bid, fd) (((uint64_t)(op) << 56) | ((uint64_t)(bid) << 32) | (uint32_t)(fd))
+#define UD_OP(ud) ((int)((ud) >> 56))
+#define UD_BID(ud) ((int)(((ud) >> 32) & 0xffff))
+#define UD_FD(ud) ((int)(uint32_t)(ud))
+
+// Estado de uma conexão no motor io_uring (indexado por fd)
+typedef struct {
+    uint32_t peer_ip;         // IPv4 do cliente (ordem de rede), para o limite por IP
+    int32_t queue_head;       // Buffers recebidos aguardando envio (lista ligada por buf_next)
+    int32_t queue_tail;
+    int32_t requeue_tail;     // Último buffer devolvido à frente da fila pela cadeia em voo
+    int32_t next_starved;     // Próxima conexão sem recv armado por falta de buffers
+    uint16_t sends_in_flight;
+    uint16_t buffers;         // Buffers fornecidos retidos pela conexão (na fila ou em envio)
+    uint8_t in_use;
+    uint8_t recv_armed;
+    uint8_t recv_paused;      // Em URING_CONN_BUFFERS: recv parado até um envio devolver buffer
+    uint8_t starved;
+    uint8_t peer_closed;      // Cliente encerrou: envia o que falta e fecha
+    uint8_t failed;           // Erro: descarta o que falta e fecha
+    uint8_t shutdown_sent;
+} UringConn;
+
+typedef struct {
+    Uring ring;
+    UringBufRing bufs;
+    unsigned char *buf_mem;
+    int32_t *buf_next;
+    uint32_t *buf_len;
+    uint32_t *buf_off;        // Bytes do buffer já enviados (envio parcial)
+    size_t buf_size;          // Tamanho de cada buffer fornecido (menor classe do pool)
+    UringConn *conns;
+    int nconns;
+    int32_t starved_head;
+    unsigned accept_retry;    // Listeners (bit = índice) cujo accept não pôde ser rearmado
+    int state;                // Estado do worker já tratado pelo loop (WORKER_*)
+} UringLoop;
+
+static unsigned char *buf_addr(UringLoop *l, int bid) {
+    return l->buf_mem + (size_t)bid * l->buf_size;
+}
+
+// Devolve o buffer ao anel e rearma as conexões que pararam por falta de buffers
+static void recycle_buffer(UringLoop *l, int bid) {
+    uring_buf_ring_add(&l->bufs, buf_addr(l, bid), (unsigned)l->buf_size, (unsigned short)bid, 0);
+    uring_buf_ring_advance(&l->bufs, 1);
+}
+
+static int arm_accept(UringLoop *l, int listen_fd) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&l->ring);
+    if (!sqe) return -1;
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = UD_MAKE(OP_ACCEPT, 0, listen_fd);
+    return 0;
+}
+
+// Aguarda o eventfd de controle do worker (poll de disparo único, rearmado a cada uso)
+static int arm_wake(UringLoop *l, int wake_fd) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&l->ring);
+    if (!sqe) return -1;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = wake_fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = UD_MAKE(OP_WAKE, 0, wake_fd);
+    return 0;
+}
+
+// Recv de disparo único: cada conclusão consome no máximo um buffer e decide se rearma.
+// Um recv multishot continuaria consumindo buffers do anel por conta própria (até esgotá-lo)
+// enquanto houvesse dados no socket, sem limite por conexão.
+static int arm_recv(UringLoop *l, int fd) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&l->ring);
+    if (!sqe) return -1;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BGID;
+    sqe->user_data = UD_MAKE(OP_RECV, 0, fd);
+    l->conns[fd].recv_armed = 1;
+    return 0;
+}
+
+// Rearma o accept multishot. Sem SQE livre (a submissão do que estava pendente falhou),
+// o listener fica marcado e o loop tenta de novo após o próximo lote de conclusões.
+static void rearm_accept(Worker *w, UringLoop *l, int listen_fd) {
+    int listener = worker_listener_index(w, listen_fd);
+    unsigned bit = listener >= 0 ? 1u << listener : 0;
+
+    if (arm_accept(l, listen_fd) == 0) {
+        l->accept_retry &= ~bit;
+        return;
+    }
+    if (!(l->accept_retry & bit)) {
+        log_error("[Worker %d] Anel de submissão cheio: o accept do FD %d será rearmado depois.", w->id, listen_fd);
+    }
+    l->accept_retry |= bit;
+}
+
+static void rearm_starved(UringLoop *l) {
+    while (l->starved_head >= 0) {
+        int fd = l->starved_head;
+        UringConn *c = &l->conns[fd];
+
+        l->starved_head = c->next_starved;
+        c->starved = 0;
+        if (c->in_use && !c->recv_armed && !c->recv_paused && !c->peer_closed && !c->failed) {
+            arm_recv(l, fd);
+        }
+    }
+}
+
+// Um leitor lento (fila de envio crescendo) reteria buffers até esgotar o anel e deixar
+// todas as outras conexões sem recv (ENOBUFS): com URING_CONN_BUFFERS retidos, o recv da
+// conexão não é rearmado até um envio devolver um buffer
+static void resume_recv(UringLoop *l, int fd) {
+    UringConn *c = &l->conns[fd];
+
+    if (!c->recv_paused || c->buffers >= URING_CONN_BUFFERS) return;
+    c->recv_paused = 0;
+    if (!c->recv_armed && !c->failed && !c->peer_closed && !c->shutdown_sent) arm_recv(l, fd);
+}
+
+// Devolve um buffer da cadeia interrompida à frente da fila, na ordem original
+static void requeue_send(UringLoop *l, UringConn *c, int bid) {
+    if (c->requeue_tail < 0) {
+        l->buf_next[bid] = c->queue_head;
+        c->queue_head = bid;
+    } else {
+        l->buf_next[bid] = l->buf_next[c->requeue_tail];
+        l->buf_next[c->requeue_tail] = bid;
+    }
+    if (l->buf_next[bid] < 0) c->queue_tail = bid;
+    c->requeue_tail = bid;
+}
+
+// Submete os buffers enfileirados da conexão como uma cadeia de envios ligados.
+// Apenas uma cadeia por conexão fica em voo, o que preserva a ordem dos bytes.
+static void flush_sends(UringLoop *l, int fd) {
+    UringConn *c = &l->conns[fd];
+    unsigned count = 0, head, free_sqes;
+    int bid;
+
+    if (c->sends_in_flight > 0 || c->queue_head < 0) return;
+
+    // A cadeia inteira precisa caber na mesma submissão
+    head = __atomic_load_n(l->ring.sq_head, __ATOMIC_ACQUIRE);
+    free_sqes = l->ring.sq_entries - (l->ring.sqe_tail - head);
+    if (free_sqes < URING_MAX_LINKED_SENDS) uring_submit_and_wait(&l->ring, 0);
+
+    while ((bid = c->queue_head) >= 0 && count < URING_MAX_LINKED_SENDS) {
+        struct io_uring_sqe *sqe = uring_get_sqe(&l->ring);
+        if (!sqe) break;
+
+        c->queue_head = l->buf_next[bid];
+        if (c->queue_head < 0) c->queue_tail = -1;
+
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = fd;
+        sqe->addr = (unsigned long)(buf_addr(l, bid) + l->buf_off[bid]);
+        sqe->len = l->buf_len[bid] - l->buf_off[bid];
+        sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL; // Parcial só em erro ou sinal (reenviado)
+        sqe->user_data = UD_MAKE(OP_SEND, bid, fd);
+        if (c->queue_head >= 0 && count + 1 < URING_MAX_LINKED_SENDS) {
+            sqe->flags = IOSQE_IO_LINK;
+        }
+        c->sends_in_flight++;
+        count++;
+    }
+}
+
+// Fecha a conexão quando não há mais operações em voo referenciando o fd
+static void maybe_close(Worker *w, UringLoop *l, int fd) {
+    UringConn *c = &l->conns[fd];
+
+    if (!c->failed && !(c->peer_closed && c->queue_head < 0)) return;
+    if (c->sends_in_flight > 0) return;
+
+    if (c->recv_armed) {
+        // Encerra o recv em voo; o fd é fechado quando sua conclusão chegar
+        if (!c->shutdown_sent) {
+            shutdown(fd, SHUT_RDWR);
+            c->shutdown_sent = 1;
+        }
+        return;
+    }
+
+    while (c->queue_head >= 0) {
+        int bid = c->queue_head;
+        c->queue_head = l->buf_next[bid];
+        recycle_buffer(l, bid);
+        c->buffers--;
+    }
+
+    log_debug("[Worker %d] Conexão fechada no FD %d.", w->id, fd);
+    if (w->config->admission) admission_release(w->config->admission, c->peer_ip);
+    close(fd);
+    c->in_use = 0;
+    __atomic_fetch_sub(&w->conexoes_ativas, 1, __ATOMIC_RELAXED);
+    rearm_starved(l);
+}
+
+// O accept multishot não devolve o endereço do cliente: só é consultado se há limite por IP.
+// Retorna -1 se o endereço não pôde ser lido (ex: o cliente já resetou a conexão); o IP 0
+// marca os slots livres da tabela de admissão e não pode representar um cliente.
+static int peer_ip(const Admission *admission, int fd, uint32_t *ip) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+
+    *ip = 0;
+    if (admission->max_per_ip == 0) return 0;
+    if (getpeername(fd, (struct sockaddr *)&addr, &len) != 0 || addr.sin_family != AF_INET) return -1;
+    *ip = addr.sin_addr.s_addr;
+    return 0;
+}
+
+static void handle_accept(Worker *w, UringLoop *l, int listen_fd, int res, unsigned flags) {
+    Admission *admission = w->config->admission;
+
+    if (res >= 0) {
+        int fd = res;
+        uint32_t ip = 0;
+
+        if (fd >= l->nconns) {
+            log_error("FD %d fora da tabela de conexões.", fd);
+            close(fd);
+        } else if (l->state != WORKER_RUNNING) {
+            // Aceita entre o pedido de drenagem e o cancelamento do accept multishot
+            close(fd);
+        } else if (admission && peer_ip(admission, fd, &ip) != 0) {
+            log_debug("[Worker %d] Endereço do cliente indisponível (%s): FD %d fechado", w->id, strerror(errno), fd);
+            close(fd);
+        } else if (admission && admission_acquire(admission, ip) != 0) {
+            COUNTER_ADD(w->conexoes_rejeitadas, 1);
+            log_debug("[Worker %d] Conexão recusada pelo limite de conexões: FD %d", w->id, fd);
+            close(fd);
+        } else {
+            UringConn *c = &l->conns[fd];
+            memset(c, 0, sizeof(*c));
+            c->in_use = 1;
+            c->peer_ip = ip;
+            c->queue_head = c->queue_tail = -1;
+            c->requeue_tail = -1;
+            c->next_starved = -1;
+
+            log_debug("[Worker %d] Nova conexão aceita: FD %d", w->id, fd);
+            __atomic_fetch_add(&w->conexoes_aceitas, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&w->conexoes_ativas, 1, __ATOMIC_RELAXED);
+            arm_recv(l, fd);
+        }
+    } else if (res != -ECANCELED) {
+        log_error("Erro no accept (io_uring): %s", strerror(-res));
+    }
+
+    // O accept multishot pode terminar (ex.: erro); nesse caso é rearmado
+    if (!(flags & IORING_CQE_F_MORE) && l->state == WORKER_RUNNING) rearm_accept(w, l, listen_fd);
+}
+
+static void handle_recv(Worker *w, UringLoop *l, int fd, int res, unsigned flags) {
+    UringConn *c = &l->conns[fd];
+
+    c->recv_armed = 0;
+
+    if (res > 0) {
+        int bid = (int)(flags >> IORING_CQE_BUFFER_SHIFT);
+
+        COUNTER_ADD(w->bytes_received, (uint64_t)res);
+
+        // Exemplo de Processamento: Ecoar a mensagem de volta (o próprio buffer é enviado)
+        l->buf_len[bid] = (uint32_t)res;
+        l->buf_off[bid] = 0;
+        l->buf_next[bid] = -1;
+        if (c->queue_tail >= 0) l->buf_next[c->queue_tail] = bid;
+        else c->queue_head = bid;
+        c->queue_tail = bid;
+        c->buffers++;
+
+        if (!c->failed) flush_sends(l, fd);
+        if (c->buffers >= URING_CONN_BUFFERS) c->recv_paused = 1;
+        else if (!c->failed && !c->shutdown_sent) arm_recv(l, fd);
+    } else if (res == -ENOBUFS) {
+        // Sem buffers livres: o recv é rearmado quando algum envio devolver um buffer
+        if (!c->starved && !c->recv_paused && !c->failed && !c->peer_closed) {
+            c->starved = 1;
+            c->next_starved = l->starved_head;
+            l->starved_head = fd;
+        }
+    } else if (res == 0) {
+        // O cliente performou um shutdown ordenado
+        c->peer_closed = 1;
+    } else {
+        if (!c->shutdown_sent) log_warn("Erro ao ler dados (recv) no FD %d: %s", fd, strerror(-res));
+        c->failed = 1;
+    }
+
+    maybe_close(w, l, fd);
+}
+
+static void handle_send(Worker *w, UringLoop *l, int fd, int bid, int res) {
+    UringConn *c = &l->conns[fd];
+
+    c->sends_in_flight--;
+    if (res > 0) COUNTER_ADD(w->bytes_relayed, (uint64_t)res);
+
+    if (res > 0 && (uint32_t)res < l->buf_len[bid] - l->buf_off[bid] && !c->failed) {
+        // Envio parcial (socket sob backpressure): o restante volta à frente da fila
+        l->buf_off[bid] += (uint32_t)res;
+        requeue_send(l, c, bid);
+    } else if (res == -ECANCELED && !c->failed) {
+        // Cadeia interrompida por um envio parcial: os envios seguintes voltam atrás dele
+        requeue_send(l, c, bid);
+    } else {
+        // -ECANCELED com a conexão em falha: um envio anterior da cadeia falhou
+        if (res <= 0 && res != -ECANCELED && !c->failed) {
+            log_warn("Erro ao ecoar dados (send) no FD %d: %s", fd, res < 0 ? strerror(-res) : "envio vazio");
+        }
+        if (res <= 0) c->failed = 1;
+        recycle_buffer(l, bid);
+        c->buffers--;
+        rearm_starved(l);
+        resume_recv(l, fd);
+    }
+
+    if (c->sends_in_flight == 0) {
+        c->requeue_tail = -1;
+        if (!c->failed) flush_sends(l, fd);
+    }
+    maybe_close(w, l, fd);
+}
+
+// Desligamento: cancela os accepts e fecha cada conexão depois de enviar o que está na fila
+static void begin_drain(Worker *w, UringLoop *l) {
+    for (int i = 0; i < w->config->num_listeners; i++) {
+        struct io_uring_sqe *sqe = uring_get_sqe(&l->ring);
+        if (!sqe) break;
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = UD_MAKE(OP_ACCEPT, 0, w->listen_fds[i]);
+        sqe->user_data = UD_MAKE(OP_CANCEL, 0, 0);
+    }
+    worker_close_listeners(w);
+
+    for (int fd = 0; fd < l->nconns; fd++) {
+        UringConn *c = &l->conns[fd];
+        if (!c->in_use) continue;
+        c->peer_closed = 1;
+        maybe_close(w, l, fd);
+    }
+    log_info("[Worker %d] Drenando: %llu conexões com dados pendentes.", w->id,
+             (unsigned long long)w->conexoes_ativas);
+}
+
+// Prazo esgotado: fecha as conexões restantes (as operações em voo morrem com o anel)
+static void close_all(Worker *w, UringLoop *l) {
+    uint64_t remaining = w->conexoes_ativas;
+
+    for (int fd = 0; fd < l->nconns; fd++) {
+        if (!l->conns[fd].in_use) continue;
+        if (w->config->admission) admission_release(w->config->admission, l->conns[fd].peer_ip);
+        close(fd);
+        l->conns[fd].in_use = 0;
+        __atomic_fetch_sub(&w->conexoes_ativas, 1, __ATOMIC_RELAXED);
+    }
+    if (remaining > 0) {
+        log_warn("[Worker %d] %llu conexões fechadas à força no desligamento.", w->id,
+                 (unsigned long long)remaining);
+    }
+}
+
+static void handle_wake(Worker *w, UringLoop *l) {
+    int state = __atomic_load_n(&w->state, __ATOMIC_ACQUIRE);
+    uint64_t value;
+
+    while (read(w->wake_fd, &value, sizeof(value)) < 0 && errno == EINTR) {}
+    if (state >= WORKER_DRAINING && l->state == WORKER_RUNNING) {
+        l->state = WORKER_DRAINING;
+        begin_drain(w, l);
+    }
+    if (state == WORKER_STOPPING) close_all(w, l);
+    l->state = state;
+    if (state != WORKER_STOPPING) arm_wake(l, w->wake_fd);
+}
+
+static void uring_loop_destroy(Worker *w) {
+    UringLoop *l = (UringLoop *)w->loop_data;
+
+    if (!l) return;
+    uring_buf_ring_free(&l->ring, &l->bufs);
+    uring_exit(&l->ring);
+    free(l->buf_mem);
+    free(l->buf_next);
+    free(l->buf_len);
+    free(l->buf_off);
+    free(l->conns);
+    free(l);
+    w->loop_data = NULL;
+}
+
+static int uring_loop_init(Worker *w) {
+    UringLoop *l = calloc(1, sizeof(UringLoop));
+    if (!l) {
+        perror("Erro ao alocar o motor io_uring");
+        return -1;
+    }
+    w->loop_data = l;
+    l->ring.fd = -1;
+    l->starved_head = -1;
+
+    // O motor io_uring já ecoa direto dos buffers fornecidos; splice/zerocopy/framed são do motor epoll
+    for (int i = 0; i < w->config->num_listeners; i++) {
+        if (w->id == 0 && w->config->listeners[i].data_path != DATA_PATH_COPY) {
+            log_warn("Porta %d: caminho de dados ignorado no motor io_uring.", w->config->listeners[i].port);
+        }
+    }
+    if (w->id == 0 && (w->config->idle_timeout_ms > 0 || w->config->read_deadline_ms > 0)) {
+        log_warn("Timeouts de conexão (-i/-r) não são aplicados pelo motor io_uring.");
+    }
+
+    if (uring_init(&l->ring, URING_ENTRIES, URING_ENTRIES * 4) != 0) {
+        perror("Erro ao criar o anel io_uring");
+        uring_loop_destroy(w);
+        return -1;
+    }
+
+    if (uring_buf_ring_setup(&l->ring, &l->bufs, URING_BUFFERS, URING_BGID) != 0) {
+        perror("Erro ao registrar o anel de buffers (requer kernel >= 5.19)");
+        uring_loop_destroy(w);
+        return -1;
+    }
+
+    l->nconns = w->conns->size;
+    l->buf_size = w->pool.classes[0].chunk_size;
+    l->buf_mem = malloc((size_t)URING_BUFFERS * l->buf_size);
+    l->buf_next = malloc(URING_BUFFERS * sizeof(int32_t));
+    l->buf_len = malloc(URING_BUFFERS * sizeof(uint32_t));
+    l->buf_off = calloc(URING_BUFFERS, sizeof(uint32_t));
+    l->conns = calloc(l->nconns, sizeof(UringConn));
+    if (!l->buf_mem || !l->buf_next || !l->buf_len || !l->buf_off || !l->conns) {
+        perror("Erro ao alocar os buffers do io_uring");
+        uring_loop_destroy(w);
+        return -1;
+    }
+
+    for (int bid = 0; bid < URING_BUFFERS; bid++) {
+        uring_buf_ring_add(&l->bufs, buf_addr(l, bid), (unsigned)l->buf_size, (unsigned short)bid, (unsigned)bid);
+    }
+    uring_buf_ring_advance(&l->bufs, URING_BUFFERS);
+
+    return 0;
+}
+
+static void uring_loop_run(Worker *w) {
+    UringLoop *l = (UringLoop *)w->loop_data;
+    struct io_uring_cqe *cqe;
+    uint64_t start_ns;
+    int n;
+
+    for (int i = 0; i < w->config->num_listeners; i++) {
+        if (arm_accept(l, w->listen_fds[i]) != 0) {
+            log_error("Erro ao armar o accept multishot.");
+            return;
+        }
+    }
+    if (arm_wake(l, w->wake_fd) != 0) {
+        log_error("Erro ao armar o eventfd de controle.");
+        return;
+    }
+
+    while (1) {
+        // Submete tudo o que foi preparado e espera por pelo menos uma conclusão
+        if (uring_submit_and_wait(&l->ring, 1) < 0) {
+            if (errno == EINTR) continue;
+            log_error("Erro no io_uring_enter: %s", strerror(errno));
+            break;
+        }
+
+        start_ns = monotonic_ns();
+        n = 0;
+        while ((cqe = uring_peek_cqe(&l->ring)) != NULL) {
+            uint64_t ud = cqe->user_data;
+            int res = cqe->res;
+            unsigned flags = cqe->flags;
+
+            uring_cqe_seen(&l->ring);
+            n++;
+            if (l->state == WORKER_STOPPING) continue; // Conexões já fechadas: apenas consome
+
+            switch (UD_OP(ud)) {
+                case OP_ACCEPT: handle_accept(w, l, UD_FD(ud), res, flags); break;
+                case OP_RECV:   handle_recv(w, l, UD_FD(ud), res, flags); break;
+                case OP_SEND:   handle_send(w, l, UD_FD(ud), UD_BID(ud), res); break;
+                case OP_WAKE:   handle_wake(w, l); break;
+                default: break;
+            }
+        }
+
+        for (int i = 0; l->accept_retry && l->state == WORKER_RUNNING && i < w->config->num_listeners; i++) {
+            if (l->accept_retry & (1u << i)) rearm_accept(w, l, w->listen_fds[i]);
+        }
+
+        metrics_record_iteration(w, n, monotonic_ns() - start_ns);
+
+        if (l->state == WORKER_STOPPING) break;
+        if (l->state == WORKER_DRAINING && w->conexoes_ativas == 0) break;
+    }
+}
+
+const EventLoopOps uring_loop_ops = {
+    .name = "uring",
+    .init = uring_loop_init,
+    .run = uring_loop_run,
+    .destroy = uring_loop_destroy,
+};
@@ -0,0 +1,122 @@
+#include "metrics.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+// Limites superiores (µs) dos buckets de duração das iterações do loop
+static const uint64_t loop_time_bounds_us[LOOP_TIME_BUCKETS] = {
+    10, 50, 100, 500, 1000, 5000, 10000, 50000
+};
+
+#define LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+void metrics_record_iteration(Worker *w, int events, uint64_t elapsed_ns) {
+    int b = 0;
+
+    while (b < LOOP_TIME_BUCKETS && elapsed_ns > loop_time_bounds_us[b] * 1000) b++;
+    COUNTER_ADD(w->loop_time_hist[b], 1);
+    COUNTER_ADD(w->loop_wakeups, 1);
+    COUNTER_ADD(w->loop_events, (uint64_t)events);
+    COUNTER_ADD(w->loop_time_ns, elapsed_ns);
+}
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} TextOut;
+
+static void out_printf(TextOut *out, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void out_printf(TextOut *out, const char *fmt, ...) {
+    va_list ap;
+    int n;
+
+    if (out->len + 1 >= out->size) return;
+    va_start(ap, fmt);
+    n = vsnprintf(out->buf + out->len, out->size - out->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    out->len += (size_t)n;
+    if (out->len >= out->size) out->len = out->size - 1;
+}
+
+// Contador somado entre os workers (offset do campo uint64_t dentro de Worker)
+static void counter_sum(TextOut *out, const Worker *workers, int num_workers,
+                        const char *name, const char *help, size_t offset) {
+    uint64_t total = 0;
+
+    for (int i = 0; i < num_workers; i++) {
+        const uint64_t *field = (const uint64_t *)((const char *)&workers[i] + offset);
+        total += __atomic_load_n(field, __ATOMIC_RELAXED);
+    }
+    out_printf(out, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+               name, help, name, name, (unsigned long long)total);
+}
+
+#define COUNTER(name, help, field) \
+    counter_sum(&out, workers, num_workers, "tcp_epoll_" name, help, offsetof(Worker, field))
+
+size_t metrics_render(const Worker *workers, int num_workers, char *buf, size_t size) {
+    TextOut out = { buf, size, 0 };
+    uint64_t cumulative = 0, loop_ns = 0;
+
+    if (size == 0) return 0;
+    buf[0] = '\0';
+
+    COUNTER("connections_accepted_total", "Conexões aceitas.", conexoes_aceitas);
+    COUNTER("connections_rejected_total", "Conexões recusadas pelo limite global ou por IP.", conexoes_rejeitadas);
+    COUNTER("bytes_received_total", "Bytes lidos dos clientes.", bytes_received);
+    COUNTER("bytes_sent_total", "Bytes enviados aos clientes.", bytes_relayed);
+    COUNTER("read_eagain_total", "Leituras encerradas por EAGAIN (socket drenado).", read_eagain);
+    COUNTER("write_eagain_total", "Escritas recusadas pelo kernel (buffer de envio cheio).", write_eagain);
+    COUNTER("loop_wakeups_total", "Retornos do epoll_wait/io_uring_enter.", loop_wakeups);
+    COUNTER("loop_events_total", "Eventos ou conclusões processados.", loop_events);
+    COUNTER("frames_total", "Quadros tratados (portas framed).", frames);
+    COUNTER("frame_batches_total", "Lotes de quadros (um writev por lote).", frame_batches);
+    COUNTER("zerocopy_sends_total", "Envios MSG_ZEROCOPY concluídos.", zc_sends);
+    COUNTER("zerocopy_copied_total", "Envios MSG_ZEROCOPY que o kernel acabou copiando.", zc_copied);
+    COUNTER("idle_timeouts_total", "Conexões fechadas por ociosidade.", idle_timeouts);
+    COUNTER("read_timeouts_total", "Conexões fechadas por prazo de leitura.", read_timeouts);
+
+    out_printf(&out, "# HELP tcp_epoll_log_dropped_total Mensagens de log descartadas.\n"
+                     "# TYPE tcp_epoll_log_dropped_total counter\n"
+                     "tcp_epoll_log_dropped_total %llu\n", (unsigned long long)log_dropped());
+
+    // Gauges por worker: desbalanceamento entre workers também indica saturação
+    out_printf(&out, "# HELP tcp_epoll_connections_active Conexões abertas.\n"
+                     "# TYPE tcp_epoll_connections_active gauge\n");
+    for (int i = 0; i < num_workers; i++) {
+        out_printf(&out, "tcp_epoll_connections_active{worker=\"%d\"} %llu\n", workers[i].id,
+                   (unsigned long long)LOAD(workers[i].conexoes_ativas));
+    }
+
+    out_printf(&out, "# HELP tcp_epoll_buffer_pool_chunks_in_use Chunks do pool emprestados.\n"
+                     "# TYPE tcp_epoll_buffer_pool_chunks_in_use gauge\n");
+    for (int i = 0; i < num_workers; i++) {
+        const BufferPool *pool = &workers[i].pool;
+        for (int c = 0; c < pool->nclasses; c++) {
+            out_printf(&out, "tcp_epoll_buffer_pool_chunks_in_use{worker=\"%d\",size=\"%zu\"} %zu\n",
+                       workers[i].id, pool->classes[c].chunk_size, LOAD(pool->classes[c].in_use));
+        }
+    }
+
+    // Histograma da duração das iterações (buckets cumulativos, como o Prometheus espera)
+    out_printf(&out, "# HELP tcp_epoll_loop_iteration_seconds Tempo processando cada despertar do loop.\n"
+                     "# TYPE tcp_epoll_loop_iteration_seconds histogram\n");
+    for (int b = 0; b <= LOOP_TIME_BUCKETS; b++) {
+        for (int i = 0; i < num_workers; i++) cumulative += LOAD(workers[i].loop_time_hist[b]);
+        if (b < LOOP_TIME_BUCKETS) {
+            out_printf(&out, "tcp_epoll_loop_iteration_seconds_bucket{le=\"%g\"} %llu\n",
+                       (double)loop_time_bounds_us[b] / 1e6, (unsigned long long)cumulative);
+        } else {
+            out_printf(&out, "tcp_epoll_loop_iteration_seconds_bucket{le=\"+Inf\"} %llu\n",
+                       (unsigned long long)cumulative);
+        }
+    }
+    for (int i = 0; i < num_workers; i++) loop_ns += LOAD(workers[i].loop_time_ns);
+    out_printf(&out, "tcp_epoll_loop_iteration_seconds_sum %.9f\n", (double)loop_ns / 1e9);
+    out_printf(&out, "tcp_epoll_loop_iteration_seconds_count %llu\n", (unsigned long long)cumulative);
+
+    return out.len;
+}
@@ -0,0 +1,26 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "worker.h"
+
+// Métricas de execução. Cada worker escreve apenas nos próprios contadores (sem atomics de
+// leitura-modificação-escrita no caminho quente); a soma entre workers é feita na leitura.
+
+/**
+ * @brief Registra uma iteração do loop de eventos (chamado pela thread do worker).
+ * @param events Eventos (ou conclusões) processados na iteração.
+ * @param elapsed_ns Tempo gasto processando a iteração (sem contar a espera).
+ */
+void metrics_record_iteration(Worker *w, int events, uint64_t elapsed_ns);
+
+/**
+ * @brief Agrega os contadores dos workers no formato de texto do Prometheus.
+ * @param buf Buffer de saída (terminado em '\0'; truncado se não couber).
+ * @param size Tamanho do buffer.
+ * @return size_t Bytes escritos (sem o '\0').
+ */
+size_t metrics_render(const Worker *workers, int num_workers, char *buf, size_t size);
+
+#endif // METRICS_H
@@ -2,190 +2,481 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <sys/epoll.h>
-#include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include "config.h"
+#include "worker.h"
+#include "data_path.h"
+#include "event_loop.h"
+#include "admin.h"
+#include "handoff.h"
+#include "admission.h"
+#include "log.h"
 
-#define MAX_EVENTS 64
-#define BUFFER_SIZE 1024
-#define SERVER_PORT 8080
+static void print_usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s [-p porta[:caminho]]... [-w workers] [-c] [-s segundos] [-e motor] [-b tamanhos] [-l nível] [-L msgs/s]\n"
+            "          [-i segundos] [-r ms] [-a endereço] [-g segundos] [-u caminho] [-A n] [-m n] [-I n]\n"
+            "  -p porta[:caminho]\n"
+            "               Porta TCP de escuta (padrão: %d), repetível até %d portas. Caminho de\n"
+            "               dados do echo: copy (padrão), splice, zerocopy (MSG_ZEROCOPY) ou\n"
+            "               framed (quadros com prefixo de tamanho de 4 bytes, em lote)\n"
+            "  -w workers   Número de workers/threads (padrão: 0 = uma por CPU)\n"
+            "  -c           Fixa cada worker em uma CPU (afinidade)\n"
+            "  -s segundos  Imprime periodicamente as conexões por worker\n"
+            "  -e motor     Motor de eventos: epoll (padrão) ou uring\n"
+            "  -b tamanhos  Classes do pool de buffers em bytes, estritamente crescentes (padrão: 4096,16384,65536)\n"
+            "  -l nível     Nível de log: debug, info (padrão), warn, error ou off\n"
+            "  -L msgs/s    Limite de mensagens de log por segundo (padrão: %d, 0 = sem limite)\n"
+            "  -i segundos  Fecha conexões ociosas (padrão: %d, 0 = nunca)\n"
+            "  -r ms        Prazo para completar um quadro iniciado (padrão: %d, 0 = sem prazo)\n"
+            "  -a endereço  Expõe GET /metrics (formato Prometheus) em uma porta local (127.0.0.1)\n"
+            "               ou em um socket Unix (unix:/caminho)\n"
+            "  -g segundos  Prazo para esvaziar as conexões após SIGTERM/SIGINT (padrão: %d)\n"
+            "  -u caminho   Socket Unix do hot restart: herda os sockets de escuta do processo que\n"
+            "               atende nesse caminho (que então drena) e passa a atendê-lo\n"
+            "  -A n         Accepts por despertar em cada socket de escuta (padrão: %d)\n"
+            "  -m n         Máximo de conexões simultâneas no servidor (padrão: 0 = sem limite)\n"
+            "  -I n         Máximo de conexões simultâneas por IP de origem (padrão: 0 = sem limite)\n",
+            prog, SERVER_PORT, MAX_LISTENERS, LOG_DEFAULT_RATE_LIMIT,
+            IDLE_TIMEOUT_DEFAULT_MS / 1000, READ_DEADLINE_DEFAULT_MS, DRAIN_TIMEOUT_DEFAULT_MS / 1000,
+            ACCEPT_BUDGET_DEFAULT);
+}
+
+// Lê a lista de classes do pool no formato "4096,16384,65536". As classes precisam ser
+// estritamente crescentes: um pedido maior que todas recebe um chunk da maior classe, então
+// ela precisa comportar as estruturas de tamanho fixo emprestadas do pool (ZcState).
+static int parse_pool_sizes(const char *arg, ServerConfig *config) {
+    const char *p = arg;
+    char *end;
+    int n = 0;
 
-// Função para configurar um descritor de arquivo como não-bloqueante
-int set_nonblocking(int fd) {
-    int flags;
-    if (-1 == (flags = fcntl(fd, F_GETFL, 0)))
-        flags = 0;
-    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    config->pool_nclasses = 0;
+    while (*p) {
+        unsigned long size = strtoul(p, &end, 10);
+        if (end == p || size < sizeof(void *) || n == POOL_MAX_CLASSES) return -1;
+        if (n > 0 && size <= config->pool_sizes[n - 1]) {
+            fprintf(stderr, "Classes do pool devem ser estritamente crescentes (%lu após %zu).\n",
+                    size, config->pool_sizes[n - 1]);
+            return -1;
+        }
+        config->pool_sizes[n++] = size;
+        p = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0') return -1;
+    }
+    if (n == 0) return -1;
+    if (config->pool_sizes[n - 1] < sizeof(ZcState)) {
+        fprintf(stderr, "A maior classe do pool deve ter pelo menos %zu bytes.\n", sizeof(ZcState));
+        return -1;
+    }
+    config->pool_nclasses = n;
+    return 0;
 }
 
-int main() {
-    int listen_sock, client_sock;
-    struct sockaddr_in server_addr, client_addr;
-    socklen_t client_len;
-    int epoll_fd;
-    struct epoll_event event, events[MAX_EVENTS];
-    int n, i;
+static const char *data_path_name(DataPath path) {
+    switch (path) {
+        case DATA_PATH_SPLICE: return "splice";
+        case DATA_PATH_ZEROCOPY: return "zerocopy";
+        case DATA_PATH_FRAMED: return "framed";
+        default: return "copy";
+    }
+}
 
-    printf("Iniciando o servidor TCP (Porta: %d)...\n", SERVER_PORT);
+// Lê um listener no formato "porta[:copy|splice|zerocopy|framed]"
+static int parse_listener(const char *arg, ListenerConfig *listener) {
+    char *end;
+    long port = strtol(arg, &end, 10);
 
-    //Criação do Socket de Escuta (Listening Socket) 
-    listen_sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (listen_sock < 0) {
-        perror("Erro ao criar o socket de escuta");
-        exit(EXIT_FAILURE);
+    if (end == arg || port <= 0 || port > 65535) return -1;
+    listener->port = (int)port;
+    listener->data_path = DATA_PATH_COPY;
+    if (*end == '\0') return 0;
+    if (*end != ':') return -1;
+
+    end++;
+    if (strcmp(end, "copy") == 0) listener->data_path = DATA_PATH_COPY;
+    else if (strcmp(end, "splice") == 0) listener->data_path = DATA_PATH_SPLICE;
+    else if (strcmp(end, "zerocopy") == 0) listener->data_path = DATA_PATH_ZEROCOPY;
+    else if (strcmp(end, "framed") == 0) listener->data_path = DATA_PATH_FRAMED;
+    else return -1;
+    return 0;
+}
+
+// Tempo de CPU (usuário + sistema) do processo, em segundos
+static double process_cpu_seconds(void) {
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0.0;
+    return (double)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+           (double)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+// Imprime os contadores de cada worker para verificar o balanceamento de carga
+static void print_worker_stats(Worker *workers, int num_workers) {
+    static uint64_t last_bytes;
+    static double last_cpu;
+    uint64_t bytes = 0, zc_sends = 0, zc_copied = 0, frames = 0, frame_batches = 0;
+    uint64_t idle_timeouts = 0, read_timeouts = 0, rejected = 0;
+    double cpu = process_cpu_seconds();
+
+    printf("--- Conexões por worker ---\n");
+    for (int i = 0; i < num_workers; i++) {
+        BufferPool *pool = &workers[i].pool;
+
+        bytes += __atomic_load_n(&workers[i].bytes_relayed, __ATOMIC_RELAXED);
+        zc_sends += __atomic_load_n(&workers[i].zc_sends, __ATOMIC_RELAXED);
+        zc_copied += __atomic_load_n(&workers[i].zc_copied, __ATOMIC_RELAXED);
+        frames += __atomic_load_n(&workers[i].frames, __ATOMIC_RELAXED);
+        frame_batches += __atomic_load_n(&workers[i].frame_batches, __ATOMIC_RELAXED);
+        idle_timeouts += __atomic_load_n(&workers[i].idle_timeouts, __ATOMIC_RELAXED);
+        read_timeouts += __atomic_load_n(&workers[i].read_timeouts, __ATOMIC_RELAXED);
+        rejected += __atomic_load_n(&workers[i].conexoes_rejeitadas, __ATOMIC_RELAXED);
+
+        printf("  Worker %d: %llu ativas, %llu aceitas, buffers em uso:", workers[i].id,
+               (unsigned long long)__atomic_load_n(&workers[i].conexoes_ativas, __ATOMIC_RELAXED),
+               (unsigned long long)__atomic_load_n(&workers[i].conexoes_aceitas, __ATOMIC_RELAXED));
+        for (int c = 0; c < pool->nclasses; c++) {
+            printf(" %zuK=%zu", pool->classes[c].chunk_size / 1024,
+                   __atomic_load_n(&pool->classes[c].in_use, __ATOMIC_RELAXED));
+        }
+        printf("\n");
     }
-    
-    // Reutilizar endereço (para reinício rápido)
-    int optval = 1;
-    setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
 
-    // Configurar o socket como não-bloqueante 
-    if (set_nonblocking(listen_sock) < 0) {
-        perror("Erro ao configurar o socket de escuta como não-bloqueante");
-        close(listen_sock);
-        exit(EXIT_FAILURE);
+    // CPU gasta por GiB ecoado no intervalo: métrica para comparar os caminhos de dados
+    printf("  Ecoados: %.1f MiB (intervalo: %.1f MiB, %.3f s CPU/GiB)",
+           (double)bytes / (1024.0 * 1024.0), (double)(bytes - last_bytes) / (1024.0 * 1024.0),
+           bytes > last_bytes ? (cpu - last_cpu) * (1024.0 * 1024.0 * 1024.0) / (double)(bytes - last_bytes) : 0.0);
+    if (zc_sends > 0) {
+        printf(", MSG_ZEROCOPY: %llu envios (%llu copiados pelo kernel)",
+               (unsigned long long)zc_sends, (unsigned long long)zc_copied);
+    }
+    if (frames > 0) {
+        printf(", quadros: %llu em %llu lotes", (unsigned long long)frames,
+               (unsigned long long)frame_batches);
+    }
+    if (idle_timeouts + read_timeouts > 0) {
+        printf(", timeouts: %llu ociosas, %llu de leitura", (unsigned long long)idle_timeouts,
+               (unsigned long long)read_timeouts);
     }
+    if (rejected > 0) {
+        printf(", recusadas pelo limite: %llu", (unsigned long long)rejected);
+    }
+    printf("\n");
+    last_bytes = bytes;
+    last_cpu = cpu;
+}
 
-    // Configuração do Endereço do Servidor 
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = htonl(INADDR_ANY); // Escuta em todas as interfaces
-    server_addr.sin_port = htons(SERVER_PORT);
+// Espera por SIGTERM/SIGINT ou por um novo processo no socket de handoff, imprimindo as
+// estatísticas periodicamente. Retorna 1 se os sockets de escuta foram entregues (hot restart).
+static int wait_for_shutdown(int sig_fd, int handoff_fd, Worker *workers, const ServerConfig *config) {
+    struct pollfd fds[2];
+    int timeout = config->stats_interval > 0 ? config->stats_interval * 1000 : -1;
 
-    // Bind (Associação) do Socket 
-    if (bind(listen_sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        perror("Erro no bind");
-        close(listen_sock);
-        exit(EXIT_FAILURE);
+    fds[0].fd = sig_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = handoff_fd; // -1 é ignorado pelo poll()
+    fds[1].events = POLLIN;
+
+    while (1) {
+        int n = poll(fds, 2, timeout);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("Erro no poll da thread principal");
+            return 0;
+        }
+        if (n == 0) {
+            print_worker_stats(workers, config->num_workers);
+            continue;
+        }
+        if (fds[0].revents & POLLIN) {
+            struct signalfd_siginfo si;
+            if (read(sig_fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+                printf("Sinal %s recebido: drenando as conexões (prazo de %u s)...\n",
+                       strsignal((int)si.ssi_signo), config->drain_timeout_ms / 1000);
+            }
+            return 0;
+        }
+        if ((fds[1].revents & POLLIN) && handoff_send(handoff_fd, workers, config->num_workers) == 0) {
+            printf("Sockets de escuta entregues ao novo processo: drenando as conexões...\n");
+            return 1;
+        }
     }
+}
 
-    // Listen (Escuta por Conexões) 
-    if (listen(listen_sock, SOMAXCONN) < 0) {
-        perror("Erro no listen");
-        close(listen_sock);
-        exit(EXIT_FAILURE);
+// Drena os workers; quando o prazo esgota (ou chega um segundo sinal) fecha o que restou
+static void drain_workers(int sig_fd, Worker *workers, const ServerConfig *config) {
+    uint64_t deadline = monotonic_ms() + config->drain_timeout_ms;
+    int i;
+
+    for (i = 0; i < config->num_workers; i++) worker_drain(&workers[i]);
+
+    while (1) {
+        struct pollfd pfd = { sig_fd, POLLIN, 0 };
+        uint64_t now = monotonic_ms();
+        int finished = 0;
+
+        for (i = 0; i < config->num_workers; i++) {
+            finished += __atomic_load_n(&workers[i].finished, __ATOMIC_ACQUIRE);
+        }
+        if (finished == config->num_workers) return;
+        if (now >= deadline) {
+            printf("Prazo de drenagem esgotado: fechando as conexões restantes.\n");
+            break;
+        }
+        if (poll(&pfd, 1, deadline - now < 100 ? (int)(deadline - now) : 100) == 1) {
+            struct signalfd_siginfo si;
+            if (read(sig_fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+                printf("Segundo sinal: fechando as conexões restantes.\n");
+            }
+            break;
+        }
     }
 
-    // Criação da Instância epoll 
-    epoll_fd = epoll_create1(0);
-    if (epoll_fd == -1) {
-        perror("Erro ao criar a instância epoll");
-        close(listen_sock);
+    for (i = 0; i < config->num_workers; i++) worker_stop(&workers[i]);
+}
+
+// Hot restart: recebe os sockets do processo anterior e distribui um por (worker, listener)
+// de mesma porta. Retorna o fd para confirmar o handoff, ou -1 se não há processo anterior.
+static int inherit_listeners(const char *path, InheritedSocket *inherited, int *ninherited) {
+    int fd = handoff_connect(path);
+
+    *ninherited = 0;
+    if (fd < 0) {
+        if (errno == ENOENT || errno == ECONNREFUSED) return -1;
+        perror("Erro ao conectar ao socket de handoff");
         exit(EXIT_FAILURE);
     }
+    *ninherited = handoff_receive(fd, inherited, HANDOFF_MAX_SOCKETS);
+    if (*ninherited < 0) exit(EXIT_FAILURE);
+    printf("Herdados %d sockets de escuta do processo anterior.\n", *ninherited);
+    return fd;
+}
 
-    // Adicionar o Socket de Escuta ao epoll
-    event.events = EPOLLIN | EPOLLET; // EPOLLIN: Leitura disponível | EPOLLET: Edge Triggered
-    event.data.fd = listen_sock;
-    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_sock, &event) == -1) {
-        perror("Erro ao adicionar o socket de escuta ao epoll");
-        close(listen_sock);
-        close(epoll_fd);
-        exit(EXIT_FAILURE);
+static int take_inherited(InheritedSocket *inherited, int ninherited, int port) {
+    for (int i = 0; i < ninherited; i++) {
+        if (inherited[i].fd >= 0 && inherited[i].port == port) {
+            int fd = inherited[i].fd;
+            inherited[i].fd = -1;
+            return fd;
+        }
     }
+    return -1;
+}
 
-    printf("Servidor escutando na porta %d...\n", SERVER_PORT);
+int main(int argc, char *argv[]) {
+    ServerConfig config;
+    ConnectionTable conns;
+    Worker *workers;
+    const char *engine = "epoll";
+    const char *admin_address = NULL;
+    static Admission admission;
+    uint32_t max_conns = 0, max_per_ip = 0;
+    int log_level = LOG_LEVEL_INFO;
+    long log_rate_limit = LOG_DEFAULT_RATE_LIMIT;
+    const size_t default_pool_sizes[] = POOL_DEFAULT_SIZES;
+    int opt, i, listeners_set = 0;
+    long ncpus;
+    static InheritedSocket inherited[HANDOFF_MAX_SOCKETS];
+    int ninherited = 0, unused = 0, handoff_client = -1, handoff_fd = -1, sig_fd, upgraded;
+    sigset_t signals;
 
-    // Loop Principal do Servidor (I/O Multiplexada) 
-    while (1) {
-        // Espera por eventos no epoll_fd (bloqueia até que um evento ocorra ou timeout)
-        n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
-        if (n == -1) {
-            if (errno == EINTR) continue; // Interrompido por sinal
-            perror("Erro no epoll_wait");
-            break;
-        }
+    memset(&config, 0, sizeof(config));
+    config.listeners[0].port = SERVER_PORT;
+    config.listeners[0].data_path = DATA_PATH_COPY;
+    config.num_listeners = 1;
+    config.frame_handler = frame_echo_handler;
+    config.idle_timeout_ms = IDLE_TIMEOUT_DEFAULT_MS;
+    config.read_deadline_ms = READ_DEADLINE_DEFAULT_MS;
+    config.drain_timeout_ms = DRAIN_TIMEOUT_DEFAULT_MS;
+    config.accept_budget = ACCEPT_BUDGET_DEFAULT;
+    config.pool_nclasses = (int)(sizeof(default_pool_sizes) / sizeof(default_pool_sizes[0]));
+    memcpy(config.pool_sizes, default_pool_sizes, sizeof(default_pool_sizes));
 
-        // Processa todos os eventos retornados
-        for (i = 0; i < n; i++) {
-            // Novo Evento no Socket de Escuta (Nova Conexão)
-            if (events[i].data.fd == listen_sock) {
-                while (1) {
-                    client_len = sizeof(client_addr);
-                    // Aceita a nova conexão (loop para drenar conexões, característica do EPOLLET)
-                    client_sock = accept(listen_sock, (struct sockaddr *)&client_addr, &client_len);
-                    
-                    if (client_sock == -1) {
-                        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                            // Todas as conexões pendentes foram aceitas
-                            break;
-                        } else {
-                            perror("Erro no accept");
-                            break;
-                        }
-                    }
-
-                    // Configura o novo socket do cliente como não-bloqueante
-                    if (set_nonblocking(client_sock) < 0) {
-                        perror("Erro ao configurar o socket do cliente como não-bloqueante");
-                        close(client_sock);
-                        continue;
-                    }
-                    
-                    printf("Nova conexão aceita: FD %d (IP: %s)\n", client_sock, inet_ntoa(client_addr.sin_addr));
-                    
-                    // Adiciona o novo socket do cliente ao epoll
-                    event.events = EPOLLIN | EPOLLET | EPOLLRDHUP; // EPOLLRDHUP para detecção de desconexão
-                    event.data.fd = client_sock;
-                    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_sock, &event) == -1) {
-                        perror("Erro ao adicionar o socket do cliente ao epoll");
-                        close(client_sock);
-                    }
+    while ((opt = getopt(argc, argv, "p:w:cs:e:b:l:L:i:r:a:g:u:A:m:I:h")) != -1) {
+        switch (opt) {
+            case 'p':
+                // O primeiro -p substitui a porta padrão; os seguintes acrescentam listeners
+                if (listeners_set == MAX_LISTENERS ||
+                    parse_listener(optarg, &config.listeners[listeners_set]) != 0) {
+                    fprintf(stderr, "Listener inválido (ou mais de %d): %s\n", MAX_LISTENERS, optarg);
+                    return EXIT_FAILURE;
                 }
-            }
-            // Evento em um Socket de Cliente (Leitura ou Desconexão)
-            else {
-                int current_fd = events[i].data.fd;
-
-                // Desconexão (O cliente fechou o socket ou erro)
-                if (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) {
-                    printf("Conexão fechada ou erro no FD %d.\n", current_fd);
-                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, current_fd, NULL);
-                    close(current_fd);
-                    continue;
+                config.num_listeners = ++listeners_set;
+                break;
+            case 'w': config.num_workers = atoi(optarg); break;
+            case 'c': config.pin_cpus = 1; break;
+            case 's': config.stats_interval = atoi(optarg); break;
+            case 'e': engine = optarg; break;
+            case 'l':
+                log_level = log_level_from_name(optarg);
+                if (log_level < 0) {
+                    fprintf(stderr, "Nível de log inválido: %s\n", optarg);
+                    return EXIT_FAILURE;
                 }
-                
-                // Leitura de Dados
-                if (events[i].events & EPOLLIN) {
-                    char buffer[BUFFER_SIZE];
-                    ssize_t bytes_read;
-                    
-                    // Loop de leitura (característica do EPOLLET: garante que todos os dados pendentes sejam lidos)
-                    while ((bytes_read = read(current_fd, buffer, BUFFER_SIZE - 1)) > 0) {
-                        buffer[bytes_read] = '\0'; // terminador nulo para printf/strings
-                        printf("FD %d: Recebido '%s' (%zd bytes)\n", current_fd, buffer, bytes_read);
-                        
-                        // Exemplo de Processamento: Ecoar a mensagem de volta
-                        ssize_t bytes_sent = write(current_fd, buffer, bytes_read);
-                        if (bytes_sent == -1) {
-                            perror("Erro ao ecoar dados (write)");
-                            break;
-                        }
-                    }
-                    
-                    // Trata as condições de saída do loop de leitura
-                    if (bytes_read == 0) {
-                        // O cliente performou um shutdown ordenado
-                        printf("Conexão fechada por peer no FD %d.\n", current_fd);
-                        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, current_fd, NULL);
-                        close(current_fd);
-                    } else if (bytes_read == -1 && (errno != EAGAIN && errno != EWOULDBLOCK)) {
-                        // Erro real, não apenas sem dados disponíveis
-                        perror("Erro ao ler dados (read)");
-                        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, current_fd, NULL);
-                        close(current_fd);
-                    }
+                break;
+            case 'L': log_rate_limit = atol(optarg); break;
+            case 'i': config.idle_timeout_ms = (uint32_t)atoi(optarg) * 1000; break;
+            case 'r': config.read_deadline_ms = (uint32_t)atoi(optarg); break;
+            case 'a': admin_address = optarg; break;
+            case 'g': config.drain_timeout_ms = (uint32_t)atoi(optarg) * 1000; break;
+            case 'u': config.handoff_path = optarg; break;
+            case 'A':
+                config.accept_budget = (uint32_t)atoi(optarg);
+                if (config.accept_budget == 0) config.accept_budget = ACCEPT_BUDGET_DEFAULT;
+                break;
+            case 'm': max_conns = (uint32_t)atoi(optarg); break;
+            case 'I': max_per_ip = (uint32_t)atoi(optarg); break;
+            case 'b':
+                if (parse_pool_sizes(optarg, &config) != 0) {
+                    fprintf(stderr, "Lista de tamanhos inválida: %s\n", optarg);
+                    return EXIT_FAILURE;
                 }
-            }
+                break;
+            default:
+                print_usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    config.loop = event_loop_find(engine);
+    if (!config.loop) {
+        fprintf(stderr, "Motor de eventos '%s' indisponível (compilado sem suporte?).\n", engine);
+        return EXIT_FAILURE;
+    }
+
+    // Escritas em conexões resetadas pelo cliente devem falhar com EPIPE, não matar o processo
+    signal(SIGPIPE, SIG_IGN);
+
+    // SIGTERM/SIGINT ficam bloqueados em todas as threads (criadas depois daqui) e são
+    // lidos pela thread principal via signalfd
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    sig_fd = signalfd(-1, &signals, SFD_CLOEXEC);
+    if (sig_fd < 0) {
+        perror("Erro ao criar o signalfd");
+        return EXIT_FAILURE;
+    }
+
+    // Logger assíncrono: os workers apenas enfileiram, uma thread dedicada escreve
+    if (log_init(log_level, log_rate_limit > 0 ? (uint32_t)log_rate_limit : 0) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus < 1) ncpus = 1;
+    if (config.num_workers <= 0) config.num_workers = (int)ncpus;
+
+    printf("Iniciando o servidor TCP (Workers: %d, Motor: %s)...\n",
+           config.num_workers, config.loop->name);
+
+    if (conn_table_init(&conns) != 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    // Sem limites configurados o caminho de accept não consulta o controle de admissão
+    if (max_conns > 0 || max_per_ip > 0) {
+        if (admission_init(&admission, max_conns, max_per_ip) != 0) {
+            exit(EXIT_FAILURE);
+        }
+        config.admission = &admission;
+    }
+
+    workers = calloc(config.num_workers, sizeof(Worker));
+    if (!workers) {
+        perror("Erro ao alocar os workers");
+        exit(EXIT_FAILURE);
+    }
+
+    if (config.handoff_path) {
+        handoff_client = inherit_listeners(config.handoff_path, inherited, &ninherited);
+    }
+
+    // Cada worker cria seu próprio socket de escuta (SO_REUSEPORT) e instância epoll,
+    // ou reaproveita um socket herdado da mesma porta
+    for (i = 0; i < config.num_workers; i++) {
+        int cpu = config.pin_cpus ? (int)(i % ncpus) : -1;
+        int fds[MAX_LISTENERS];
+
+        for (int j = 0; j < config.num_listeners; j++) {
+            fds[j] = take_inherited(inherited, ninherited, config.listeners[j].port);
+        }
+        if (worker_init(&workers[i], i, cpu, &config, &conns, fds) != 0) {
+            while (--i >= 0) worker_destroy(&workers[i]);
+            free(workers);
+            conn_table_destroy(&conns);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Sockets que sobraram (o processo anterior tinha mais workers ou outras portas): as
+    // conexões ainda na fila de accept deles são perdidas
+    for (i = 0; i < ninherited; i++) {
+        if (inherited[i].fd >= 0) {
+            close(inherited[i].fd);
+            unused++;
+        }
+    }
+    if (unused > 0) {
+        fprintf(stderr, "Aviso: %d sockets herdados não usados (use o mesmo -w e as mesmas portas).\n", unused);
+    }
+
+    for (i = 0; i < config.num_workers; i++) {
+        if (worker_start(&workers[i]) != 0) {
+            exit(EXIT_FAILURE);
         }
     }
 
+    for (i = 0; i < config.num_listeners; i++) {
+        printf("Servidor escutando na porta %d (caminho de dados: %s)...\n",
+               config.listeners[i].port, data_path_name(config.listeners[i].data_path));
+    }
+
+    // Endpoint de métricas: thread própria, lê os contadores dos workers sem bloqueá-los
+    if (admin_address) {
+        if (admin_start(admin_address, workers, config.num_workers) != 0) {
+            exit(EXIT_FAILURE);
+        }
+        printf("Métricas disponíveis em %s (GET /metrics)...\n", admin_address);
+    }
+
+    // Hot restart: os workers já estão atendendo, então o processo anterior pode drenar.
+    // Depois este processo assume o caminho do handoff para a próxima atualização.
+    if (handoff_client >= 0 && handoff_ack(handoff_client) != 0) {
+        perror("Erro ao confirmar o handoff");
+    }
+    if (config.handoff_path) {
+        handoff_fd = handoff_listen(config.handoff_path);
+        if (handoff_fd < 0) exit(EXIT_FAILURE);
+    }
+
+    upgraded = wait_for_shutdown(sig_fd, handoff_fd, workers, &config);
+    if (handoff_fd >= 0) {
+        close(handoff_fd);
+        // Após um handoff o caminho pertence ao novo processo
+        if (!upgraded) unlink(config.handoff_path);
+    }
+    drain_workers(sig_fd, workers, &config);
+
+    for (i = 0; i < config.num_workers; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    admin_stop();
+
     // Limpeza (Cleanup) 
-    close(listen_sock);
-    close(epoll_fd);
+    print_worker_stats(workers, config.num_workers);
+    for (i = 0; i < config.num_workers; i++) {
+        worker_destroy(&workers[i]);
+    }
+    free(workers);
+    conn_table_destroy(&conns);
+    if (config.admission) admission_destroy(config.admission);
+    close(sig_fd);
     printf("Servidor encerrado.\n");
+    log_shutdown();
     return 0;
 }
@@ -0,0 +1,160 @@
+#include "timer_wheel.h"
+#include <limits.h>
+#include <time.h>
+
+#define TW_MASK (TW_SLOTS - 1)
+// Maior distância representável (em ticks) a partir do próximo tick
+#define TW_MAX_DELTA ((1ULL << (TW_SLOT_BITS * TW_LEVELS)) - 1)
+
+uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t monotonic_ms(void) {
+    return monotonic_ns() / 1000000;
+}
+
+void timer_wheel_init(TimerWheel *tw, uint32_t tick_ms, void *ctx) {
+    for (int l = 0; l < TW_LEVELS; l++) {
+        for (int s = 0; s < TW_SLOTS; s++) {
+            tw->slots[l][s].next = &tw->slots[l][s];
+            tw->slots[l][s].prev = &tw->slots[l][s];
+        }
+    }
+    tw->now = 0;
+    tw->start_ms = monotonic_ms();
+    tw->now_ms = tw->start_ms;
+    tw->tick_ms = tick_ms > 0 ? tick_ms : 1;
+    tw->count = 0;
+    tw->ctx = ctx;
+}
+
+// Insere no slot do nível cuja faixa contém a distância até a expiração. O nível l cobre
+// distâncias < 64^(l+1) ticks; ao chegar a vez do slot, os timers descem (cascata).
+static void wheel_link(TimerWheel *tw, TimerNode *t) {
+    uint64_t base = tw->now + 1; // Próximo tick a ser processado
+    uint64_t delta;
+    TimerNode *head;
+    int level = 0;
+
+    if (t->expires < base) t->expires = base;
+    delta = t->expires - base;
+    if (delta > TW_MAX_DELTA) {
+        delta = TW_MAX_DELTA;
+        t->expires = base + delta;
+    }
+    while (level < TW_LEVELS - 1 && delta >= (1ULL << (TW_SLOT_BITS * (level + 1)))) level++;
+
+    head = &tw->slots[level][(t->expires >> (TW_SLOT_BITS * level)) & TW_MASK];
+    t->prev = head->prev;
+    t->next = head;
+    head->prev->next = t;
+    head->prev = t;
+}
+
+static void wheel_unlink(TimerNode *t) {
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = NULL;
+    t->prev = NULL;
+}
+
+// Converte milissegundos em ticks, arredondando para cima (um timer nunca dispara cedo)
+static uint64_t ms_to_ticks(const TimerWheel *tw, uint64_t ms) {
+    uint64_t ticks = (ms + tw->tick_ms - 1) / tw->tick_ms;
+    return ticks > 0 ? ticks : 1;
+}
+
+void timer_add(TimerWheel *tw, TimerNode *t, uint64_t delay_ms) {
+    // Conta a partir do fim do tick corrente do relógio em cache (que pode estar à frente
+    // do último tick processado), para que o prazo nunca seja encurtado
+    uint64_t elapsed = (tw->now_ms - tw->start_ms + tw->tick_ms - 1) / tw->tick_ms;
+
+    if (timer_active(t)) wheel_unlink(t);
+    else tw->count++;
+    t->interval = 0;
+    t->expires = elapsed + ms_to_ticks(tw, delay_ms);
+    wheel_link(tw, t);
+}
+
+void timer_add_periodic(TimerWheel *tw, TimerNode *t, uint64_t interval_ms) {
+    timer_add(tw, t, interval_ms);
+    t->interval = ms_to_ticks(tw, interval_ms);
+}
+
+void timer_cancel(TimerWheel *tw, TimerNode *t) {
+    if (!timer_active(t)) return;
+    wheel_unlink(t);
+    tw->count--;
+}
+
+// Redistribui os timers de um slot de nível superior (chamado quando o slot vence)
+static void wheel_cascade(TimerWheel *tw, int level, int slot) {
+    TimerNode *head = &tw->slots[level][slot];
+    TimerNode *t;
+
+    while ((t = head->next) != head) {
+        wheel_unlink(t);
+        wheel_link(tw, t);
+    }
+}
+
+int timer_wheel_timeout(const TimerWheel *tw, uint64_t now_ms) {
+    uint64_t target = tw->now + TW_SLOTS;
+    int64_t ms;
+
+    if (tw->count == 0) return -1;
+
+    // Próximo slot ocupado do nível 0 ou, antes dele, a próxima cascata (múltiplo de 64)
+    for (uint64_t tick = tw->now + 1; tick <= tw->now + TW_SLOTS; tick++) {
+        const TimerNode *head = &tw->slots[0][tick & TW_MASK];
+        if ((tick & TW_MASK) == 0 || head->next != head) {
+            target = tick;
+            break;
+        }
+    }
+
+    ms = (int64_t)(tw->start_ms + target * tw->tick_ms) - (int64_t)now_ms;
+    if (ms < 0) return 0;
+    return ms > INT_MAX ? INT_MAX : (int)ms;
+}
+
+void timer_wheel_advance(TimerWheel *tw, uint64_t now_ms) {
+    uint64_t target;
+
+    if (now_ms < tw->start_ms) return;
+    tw->now_ms = now_ms;
+    target = (now_ms - tw->start_ms) / tw->tick_ms;
+
+    // Sem timers armados não há slots a visitar
+    if (tw->count == 0) {
+        if (target > tw->now) tw->now = target;
+        return;
+    }
+
+    while (tw->now < target) {
+        uint64_t tick = tw->now + 1;
+        TimerNode *head = &tw->slots[0][tick & TW_MASK];
+        TimerNode *t;
+
+        // Cascata: a cada volta de um nível, o slot correspondente do nível acima desce
+        for (int l = 1; l < TW_LEVELS && (tick & ((1ULL << (TW_SLOT_BITS * l)) - 1)) == 0; l++) {
+            wheel_cascade(tw, l, (int)((tick >> (TW_SLOT_BITS * l)) & TW_MASK));
+        }
+        tw->now = tick;
+
+        // O slot do nível 0 contém apenas timers que expiram neste tick
+        while ((t = head->next) != head) {
+            wheel_unlink(t);
+            if (t->interval > 0) {
+                t->expires = tick + t->interval;
+                wheel_link(tw, t);
+            } else {
+                tw->count--;
+            }
+            t->cb(t, tw->ctx);
+        }
+    }
+}
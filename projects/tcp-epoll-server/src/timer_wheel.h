@@ -0,0 +1,104 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Timing wheel hierárquico (4 níveis de 64 slots): inserir, cancelar e rearmar um timer
+// custam O(1), e avançar o relógio só toca os slots vencidos, sem varrer as conexões.
+// Com tick de 10 ms o alcance é de 64^4 ticks (~46 h); prazos maiores são truncados.
+#define TW_LEVELS 4
+#define TW_SLOT_BITS 6
+#define TW_SLOTS (1 << TW_SLOT_BITS)
+
+// Recupera a estrutura que contém um membro (ex.: a Connection de um TimerNode embutido)
+#define container_of(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+
+struct TimerNode;
+
+/**
+ * @brief Callback de expiração. Pode rearmar ou cancelar qualquer timer, inclusive o próprio.
+ * @param t Timer que expirou.
+ * @param ctx Contexto do wheel (ex.: o Worker).
+ */
+typedef void (*TimerCallback)(struct TimerNode *t, void *ctx);
+
+// Timer intrusivo: fica embutido no objeto dono (sem alocação por timer)
+typedef struct TimerNode {
+    struct TimerNode *next;   // NULL enquanto o timer não está armado
+    struct TimerNode *prev;
+    uint64_t expires;         // Tick de expiração
+    uint64_t interval;        // Período em ticks (0 = disparo único)
+    TimerCallback cb;
+} TimerNode;
+
+typedef struct {
+    TimerNode slots[TW_LEVELS][TW_SLOTS]; // Sentinelas das listas circulares de cada slot
+    uint64_t now;             // Último tick processado
+    uint64_t start_ms;        // Relógio monotônico no tick 0
+    uint64_t now_ms;          // Relógio em cache, atualizado a cada avanço (sem syscall por evento)
+    uint32_t tick_ms;
+    int count;                // Timers armados
+    void *ctx;
+} TimerWheel;
+
+/**
+ * @brief Relógio monotônico em nanossegundos.
+ */
+uint64_t monotonic_ns(void);
+
+/**
+ * @brief Relógio monotônico em milissegundos.
+ */
+uint64_t monotonic_ms(void);
+
+/**
+ * @brief Inicializa um wheel vazio com o relógio atual.
+ * @param tick_ms Resolução dos timers.
+ * @param ctx Contexto repassado aos callbacks.
+ */
+void timer_wheel_init(TimerWheel *tw, uint32_t tick_ms, void *ctx);
+
+/**
+ * @brief Arma (ou rearma, se já armado) um timer de disparo único.
+ * @param delay_ms Tempo até a expiração (arredondado para cima em ticks).
+ */
+void timer_add(TimerWheel *tw, TimerNode *t, uint64_t delay_ms);
+
+/**
+ * @brief Arma um timer periódico: após cada disparo ele é rearmado antes do callback.
+ */
+void timer_add_periodic(TimerWheel *tw, TimerNode *t, uint64_t interval_ms);
+
+/**
+ * @brief Desarma o timer (sem efeito se não estiver armado).
+ */
+void timer_cancel(TimerWheel *tw, TimerNode *t);
+
+/**
+ * @brief Retorna 1 se o timer está armado.
+ */
+static inline int timer_active(const TimerNode *t) {
+    return t->next != NULL;
+}
+
+/**
+ * @brief Timeout para o epoll_wait até o próximo tick com trabalho.
+ * @return int Milissegundos (0 se já há ticks vencidos), -1 se não há timers.
+ */
+int timer_wheel_timeout(const TimerWheel *tw, uint64_t now_ms);
+
+/**
+ * @brief Atualiza só o relógio em cache (sem disparar timers), para marcar atividade
+ * antes de timer_wheel_advance().
+ */
+static inline void timer_wheel_set_clock(TimerWheel *tw, uint64_t now_ms) {
+    if (now_ms > tw->now_ms) tw->now_ms = now_ms;
+}
+
+/**
+ * @brief Processa os ticks até now_ms, disparando os timers vencidos.
+ */
+void timer_wheel_advance(TimerWheel *tw, uint64_t now_ms);
+
+#endif // TIMER_WHEEL_H
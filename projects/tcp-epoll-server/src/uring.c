@@ -0,0 +1,185 @@
+#include "uring.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+int uring_init(Uring *r, unsigned entries, unsigned cq_entries) {
+    struct io_uring_params p;
+    int saved_errno;
+
+    memset(r, 0, sizeof(*r));
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = cq_entries;
+
+    r->fd = sys_io_uring_setup(entries, &p);
+    if (r->fd < 0) return -1;
+
+    r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_size > r->sq_size) r->sq_size = r->cq_size;
+        r->cq_size = r->sq_size;
+    }
+
+    r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ptr == MAP_FAILED) goto fail;
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ptr = r->sq_ptr;
+    } else {
+        r->cq_ptr = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ptr == MAP_FAILED) { r->cq_ptr = NULL; goto fail; }
+    }
+
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) { r->sqes = NULL; goto fail; }
+
+    r->sq_head = (unsigned *)((char *)r->sq_ptr + p.sq_off.head);
+    r->sq_tail = (unsigned *)((char *)r->sq_ptr + p.sq_off.tail);
+    r->sq_array = (unsigned *)((char *)r->sq_ptr + p.sq_off.array);
+    r->sq_mask = *(unsigned *)((char *)r->sq_ptr + p.sq_off.ring_mask);
+    r->sq_entries = p.sq_entries;
+    r->sqe_head = r->sqe_tail = *r->sq_tail;
+
+    r->cq_head = (unsigned *)((char *)r->cq_ptr + p.cq_off.head);
+    r->cq_tail = (unsigned *)((char *)r->cq_ptr + p.cq_off.tail);
+    r->cq_mask = *(unsigned *)((char *)r->cq_ptr + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)((char *)r->cq_ptr + p.cq_off.cqes);
+
+    return 0;
+
+fail:
+    saved_errno = errno;
+    uring_exit(r);
+    errno = saved_errno;
+    return -1;
+}
+
+void uring_exit(Uring *r) {
+    if (r->sqes) munmap(r->sqes, r->sqes_size);
+    if (r->cq_ptr && r->cq_ptr != r->sq_ptr) munmap(r->cq_ptr, r->cq_size);
+    if (r->sq_ptr && r->sq_ptr != MAP_FAILED) munmap(r->sq_ptr, r->sq_size);
+    if (r->fd >= 0) close(r->fd);
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+struct io_uring_sqe *uring_get_sqe(Uring *r) {
+    unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    struct io_uring_sqe *sqe;
+
+    if (r->sqe_tail - head >= r->sq_entries) {
+        // Anel cheio: entrega o que está pendente ao kernel e tenta de novo
+        if (uring_submit_and_wait(r, 0) < 0) return NULL;
+        head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+        if (r->sqe_tail - head >= r->sq_entries) return NULL;
+    }
+
+    sqe = &r->sqes[r->sqe_tail & r->sq_mask];
+    r->sq_array[r->sqe_tail & r->sq_mask] = r->sqe_tail & r->sq_mask;
+    r->sqe_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int uring_submit_and_wait(Uring *r, unsigned wait_nr) {
+    unsigned to_submit = r->sqe_tail - r->sqe_head;
+    unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+
+    // Publica a nova cauda depois que os SQEs foram escritos
+    __atomic_store_n(r->sq_tail, r->sqe_tail, __ATOMIC_RELEASE);
+    r->sqe_head = r->sqe_tail;
+
+    if (to_submit == 0 && wait_nr == 0) return 0;
+
+    ret = sys_io_uring_enter(r->fd, to_submit, wait_nr, flags);
+    return ret < 0 ? -1 : ret;
+}
+
+struct io_uring_cqe *uring_peek_cqe(Uring *r) {
+    unsigned head = *r->cq_head;
+    unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+
+    if (head == tail) return NULL;
+    return &r->cqes[head & r->cq_mask];
+}
+
+void uring_cqe_seen(Uring *r) {
+    __atomic_store_n(r->cq_head, *r->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+int uring_buf_ring_setup(Uring *r, UringBufRing *ring, unsigned entries, int bgid) {
+    struct io_uring_buf_reg reg;
+    int saved_errno;
+
+    memset(ring, 0, sizeof(*ring));
+    ring->size = entries * sizeof(struct io_uring_buf);
+    ring->br = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->br == MAP_FAILED) {
+        ring->br = NULL;
+        return -1;
+    }
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long)ring->br;
+    reg.ring_entries = entries;
+    reg.bgid = (unsigned short)bgid;
+    if (sys_io_uring_register(r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        saved_errno = errno;
+        munmap(ring->br, ring->size);
+        ring->br = NULL;
+        errno = saved_errno;
+        return -1;
+    }
+
+    ring->entries = entries;
+    ring->mask = entries - 1;
+    ring->bgid = bgid;
+    ring->tail = 0;
+    return 0;
+}
+
+void uring_buf_ring_free(Uring *r, UringBufRing *ring) {
+    struct io_uring_buf_reg reg;
+
+    if (!ring->br) return;
+    memset(&reg, 0, sizeof(reg));
+    reg.bgid = (unsigned short)ring->bgid;
+    sys_io_uring_register(r->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    munmap(ring->br, ring->size);
+    ring->br = NULL;
+}
+
+void uring_buf_ring_add(UringBufRing *ring, void *addr, unsigned len, unsigned short bid, unsigned offset) {
+    struct io_uring_buf *buf = &ring->br->bufs[(ring->tail + offset) & ring->mask];
+
+    buf->addr = (unsigned long)addr;
+    buf->len = len;
+    buf->bid = bid;
+}
+
+void uring_buf_ring_advance(UringBufRing *ring, unsigned count) {
+    ring->tail = (unsigned short)(ring->tail + count);
+    __atomic_store_n(&ring->br->tail, ring->tail, __ATOMIC_RELEASE);
+}
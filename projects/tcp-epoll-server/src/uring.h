@@ -0,0 +1,103 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+// Acesso mínimo ao io_uring via syscalls (sem dependência da liburing): mapeamento dos
+// anéis de submissão/conclusão, obtenção de SQEs, submissão e anéis de buffers fornecidos.
+typedef struct {
+    int fd;
+
+    // Anel de submissão (SQ)
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    struct io_uring_sqe *sqes;
+    unsigned sqe_head;        // SQEs já entregues ao kernel
+    unsigned sqe_tail;        // SQEs preenchidos localmente
+
+    // Anel de conclusão (CQ)
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ptr;
+    size_t sq_size;
+    void *cq_ptr;
+    size_t cq_size;
+    size_t sqes_size;
+} Uring;
+
+// Anel de buffers fornecidos (IORING_REGISTER_PBUF_RING): o kernel escolhe o buffer no recv
+typedef struct {
+    struct io_uring_buf_ring *br;
+    unsigned entries;
+    unsigned mask;
+    unsigned short tail;      // Cauda local (publicada com uring_buf_ring_advance)
+    int bgid;
+    size_t size;
+} UringBufRing;
+
+/**
+ * @brief Cria o anel e mapeia SQ/CQ/SQEs.
+ * @param entries Tamanho do anel de submissão (potência de 2).
+ * @param cq_entries Tamanho do anel de conclusão (potência de 2, >= entries).
+ * @return int 0 em caso de sucesso, -1 em caso de falha (errno preservado).
+ */
+int uring_init(Uring *r, unsigned entries, unsigned cq_entries);
+
+/**
+ * @brief Desmapeia os anéis e fecha o descritor.
+ */
+void uring_exit(Uring *r);
+
+/**
+ * @brief Obtém um SQE livre (zerado). Se o anel estiver cheio, submete o que há pendente.
+ * @return struct io_uring_sqe* SQE, ou NULL se não foi possível liberar espaço.
+ */
+struct io_uring_sqe *uring_get_sqe(Uring *r);
+
+/**
+ * @brief Submete os SQEs pendentes e espera por pelo menos wait_nr conclusões.
+ * @return int Número de SQEs consumidos pelo kernel, ou -1 em caso de erro (errno preservado).
+ */
+int uring_submit_and_wait(Uring *r, unsigned wait_nr);
+
+/**
+ * @brief Retorna a próxima conclusão disponível sem bloquear (NULL se não houver).
+ */
+struct io_uring_cqe *uring_peek_cqe(Uring *r);
+
+/**
+ * @brief Marca a conclusão retornada por uring_peek_cqe() como consumida.
+ */
+void uring_cqe_seen(Uring *r);
+
+/**
+ * @brief Aloca e registra um anel de buffers fornecidos para o grupo bgid.
+ * @param entries Número de entradas (potência de 2).
+ * @return int 0 em caso de sucesso, -1 em caso de falha (errno preservado).
+ */
+int uring_buf_ring_setup(Uring *r, UringBufRing *ring, unsigned entries, int bgid);
+
+/**
+ * @brief Remove o registro e libera o anel de buffers.
+ */
+void uring_buf_ring_free(Uring *r, UringBufRing *ring);
+
+/**
+ * @brief Adiciona um buffer na posição local (offset a partir da cauda). Visível ao kernel
+ * apenas após uring_buf_ring_advance().
+ */
+void uring_buf_ring_add(UringBufRing *ring, void *addr, unsigned len, unsigned short bid, unsigned offset);
+
+/**
+ * @brief Publica count buffers adicionados para o kernel.
+ */
+void uring_buf_ring_advance(UringBufRing *ring, unsigned count);
+
+#endif // URING_H
@@ -0,0 +1,214 @@
+#define _GNU_SOURCE
+#include "worker.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <errno.h>
+
+// Função para configurar um descritor de arquivo como não-bloqueante
+int set_nonblocking(int fd) {
+    int flags;
+    if (-1 == (flags = fcntl(fd, F_GETFL, 0)))
+        flags = 0;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Cria um socket de escuta próprio do worker. Com SO_REUSEPORT, vários sockets podem
+// fazer bind na mesma porta e o kernel balanceia as conexões entre eles.
+static int create_listen_socket(int port) {
+    struct sockaddr_in server_addr;
+
+    //Criação do Socket de Escuta (Listening Socket) 
+    int listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_sock < 0) {
+        perror("Erro ao criar o socket de escuta");
+        return -1;
+    }
+
+    // Reutilizar endereço (para reinício rápido) e porta (um socket de escuta por worker)
+    int optval = 1;
+    setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+    if (setsockopt(listen_sock, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) < 0) {
+        perror("Erro ao configurar SO_REUSEPORT");
+        close(listen_sock);
+        return -1;
+    }
+
+    // Configurar o socket como não-bloqueante 
+    if (set_nonblocking(listen_sock) < 0) {
+        perror("Erro ao configurar o socket de escuta como não-bloqueante");
+        close(listen_sock);
+        return -1;
+    }
+
+    // Configuração do Endereço do Servidor 
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = htonl(INADDR_ANY); // Escuta em todas as interfaces
+    server_addr.sin_port = htons(port);
+
+    // Bind (Associação) do Socket 
+    if (bind(listen_sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        perror("Erro no bind");
+        close(listen_sock);
+        return -1;
+    }
+
+    // Listen (Escuta por Conexões) 
+    if (listen(listen_sock, SOMAXCONN) < 0) {
+        perror("Erro no listen");
+        close(listen_sock);
+        return -1;
+    }
+
+    return listen_sock;
+}
+
+int worker_listener_index(const Worker *w, int fd) {
+    for (int i = 0; i < w->config->num_listeners; i++) {
+        if (w->listen_fds[i] == fd) return i;
+    }
+    return -1;
+}
+
+void worker_close_listeners(Worker *w) {
+    for (int i = 0; i < MAX_LISTENERS; i++) {
+        if (w->listen_fds[i] >= 0) close(w->listen_fds[i]);
+        w->listen_fds[i] = -1;
+    }
+}
+
+// Desfaz um worker_init incompleto (os sockets herdados continuam com o chamador)
+static void init_failed(Worker *w, const int *inherited) {
+    for (int i = 0; inherited && i < w->config->num_listeners; i++) {
+        if (inherited[i] >= 0) w->listen_fds[i] = -1;
+    }
+    worker_close_listeners(w);
+    buffer_pool_destroy(&w->pool);
+    close(w->wake_fd);
+    w->config = NULL;
+}
+
+int worker_init(Worker *w, int id, int cpu, const ServerConfig *config, ConnectionTable *conns,
+                const int *inherited) {
+    memset(w, 0, sizeof(*w));
+    w->id = id;
+    w->cpu = cpu;
+    w->conns = conns;
+    w->epoll_fd = -1;
+    for (int i = 0; i < MAX_LISTENERS; i++) w->listen_fds[i] = -1;
+
+    w->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (w->wake_fd < 0) {
+        perror("Erro ao criar o eventfd do worker");
+        return -1;
+    }
+    if (buffer_pool_init(&w->pool, config->pool_sizes, config->pool_nclasses) != 0) {
+        close(w->wake_fd);
+        return -1;
+    }
+    w->config = config;
+    w->out_high_water = buffer_pool_max_chunk(&w->pool) * OUTPUT_HIGH_WATER_PCT / 100;
+    w->out_low_water = buffer_pool_max_chunk(&w->pool) * OUTPUT_LOW_WATER_PCT / 100;
+    timer_wheel_init(&w->timers, TIMER_TICK_MS, w);
+    w->frame_max_payload = FRAME_MAX_PAYLOAD;
+    if (buffer_pool_max_chunk(&w->pool) < FRAME_HEADER_SIZE + (size_t)w->frame_max_payload) {
+        w->frame_max_payload = buffer_pool_max_chunk(&w->pool) > FRAME_HEADER_SIZE ?
+            (uint32_t)(buffer_pool_max_chunk(&w->pool) - FRAME_HEADER_SIZE) : 0;
+    }
+
+    // Sockets herdados no hot restart já estão em listen e mantêm as conexões na fila de accept
+    for (int i = 0; i < config->num_listeners; i++) {
+        if (inherited && inherited[i] >= 0) {
+            w->listen_fds[i] = inherited[i];
+        } else {
+            w->listen_fds[i] = create_listen_socket(config->listeners[i].port);
+            if (w->listen_fds[i] < 0) {
+                init_failed(w, inherited);
+                return -1;
+            }
+        }
+    }
+
+    if (config->loop->init(w) != 0) {
+        init_failed(w, inherited);
+        return -1;
+    }
+
+    return 0;
+}
+
+void worker_destroy(Worker *w) {
+    if (w->config) {
+        w->config->loop->destroy(w);
+        worker_close_listeners(w);
+        buffer_pool_destroy(&w->pool);
+        while (w->npipes > 0) {
+            SplicePipe *p = &w->pipe_cache[--w->npipes];
+            close(p->fds[0]);
+            close(p->fds[1]);
+        }
+        close(w->wake_fd);
+        w->config = NULL;
+    }
+}
+
+// Muda o estado e acorda o loop do worker (epoll_wait/io_uring_enter)
+static void worker_signal(Worker *w, int state) {
+    uint64_t one = 1;
+
+    __atomic_store_n(&w->state, state, __ATOMIC_RELEASE);
+    if (write(w->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "Erro ao acordar o worker %d: %s\n", w->id, strerror(errno));
+    }
+}
+
+void worker_drain(Worker *w) {
+    worker_signal(w, WORKER_DRAINING);
+}
+
+void worker_stop(Worker *w) {
+    worker_signal(w, WORKER_STOPPING);
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = (Worker *)arg;
+
+    for (int i = 0; i < w->config->num_listeners; i++) {
+        log_info("[Worker %d] Escutando na porta %d (CPU %d, motor %s)...",
+                 w->id, w->config->listeners[i].port, w->cpu, w->config->loop->name);
+    }
+    w->config->loop->run(w);
+    __atomic_store_n(&w->finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+int worker_start(Worker *w) {
+    pthread_attr_t attr;
+    int rc;
+
+    pthread_attr_init(&attr);
+
+    // Fixa a thread em uma CPU para preservar a localidade de cache (opcional)
+    if (w->cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(w->cpu, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+
+    rc = pthread_create(&w->thread, &attr, worker_main, w);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        fprintf(stderr, "Erro ao criar a thread do worker %d: %s\n", w->id, strerror(rc));
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "config.h"
+#include "connection.h"
+#include "event_loop.h"
+#include "timer_wheel.h"
+
+// Incremento de contador com um único escritor (a thread do worker): sem instrução
+// atômica de leitura-modificação-escrita, mas legível por outras threads sem rasgos
+#define COUNTER_ADD(field, n) __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+
+// Estados do worker no desligamento (worker_drain/worker_stop)
+enum {
+    WORKER_RUNNING = 0,
+    WORKER_DRAINING,          // Não aceita novas conexões; fecha as existentes após esvaziá-las
+    WORKER_STOPPING           // Prazo esgotado: fecha tudo e encerra o loop
+};
+
+// Buckets do histograma de duração das iterações do loop (limites em metrics.c)
+#define LOOP_TIME_BUCKETS 8
+
+// Cada worker possui sua própria thread, motor de eventos e sockets de escuta (SO_REUSEPORT).
+// O kernel distribui as novas conexões entre os sockets de escuta do mesmo grupo de porta,
+// então nenhum estado é compartilhado entre os workers no caminho de accept/echo.
+typedef struct Worker {
+    int id;
+    int cpu;                  // CPU em que a thread é fixada (-1 = sem afinidade)
+    int listen_fds[MAX_LISTENERS]; // Um socket por ListenerConfig (mesmo índice)
+    int epoll_fd;             // Instância epoll (motor epoll)
+    void *loop_data;          // Estado privado do motor (ex.: anel io_uring)
+    pthread_t thread;
+    const ServerConfig *config;
+    ConnectionTable *conns;   // Tabela compartilhada (entradas conferidas por dono e geração)
+    BufferPool pool;          // Buffers de leitura e filas de saída das conexões do worker
+    size_t out_high_water;    // Backpressure (derivados do maior chunk do pool)
+    size_t out_low_water;
+    uint32_t frame_max_payload; // FRAME_MAX_PAYLOAD limitado ao maior chunk do pool
+    SplicePipe pipe_cache[PIPE_CACHE_SIZE]; // Pipes livres para o caminho splice
+    int npipes;
+    int npipes_low;           // Menor npipes desde a última manutenção (pipes não usados)
+    TimerWheel timers;        // Timeouts das conexões e tarefas periódicas (motor epoll)
+    TimerNode housekeeping;   // Manutenção periódica do worker
+    Connection *conn_list;    // Conexões abertas (motor epoll)
+    Connection *zc_retired;   // Conexões fechadas aguardando conclusões MSG_ZEROCOPY
+    int wake_fd;              // eventfd que acorda o loop quando o estado muda
+    int state;                // WORKER_RUNNING/DRAINING/STOPPING (escrito pela thread principal)
+    int finished;             // 1 quando o loop do worker terminou
+
+    // Contadores por worker (escritos apenas pela thread do worker, lidos por outras threads)
+    uint64_t conexoes_aceitas;
+    uint64_t conexoes_ativas;
+    uint64_t conexoes_rejeitadas; // Recusadas pelo limite global ou por IP
+    uint64_t bytes_received;  // Bytes lidos dos clientes
+    uint64_t bytes_relayed;   // Bytes ecoados (para comparar CPU por GiB entre caminhos de dados)
+    uint64_t read_eagain;     // Leituras encerradas por EAGAIN (socket drenado)
+    uint64_t write_eagain;    // Escritas recusadas pelo kernel (buffer de envio cheio)
+    uint64_t zc_sends;        // Envios MSG_ZEROCOPY concluídos
+    uint64_t zc_copied;       // ... dos quais o kernel acabou copiando (ex.: loopback)
+    uint64_t frames;          // Quadros tratados (caminho framed)
+    uint64_t frame_batches;   // ... em quantos lotes (um writev() por lote)
+    uint64_t idle_timeouts;   // Conexões fechadas por ociosidade
+    uint64_t read_timeouts;   // Conexões fechadas por prazo de leitura
+
+    // Saturação do loop: despertares do epoll_wait/io_uring_enter, eventos processados e
+    // duração de cada iteração (histograma cumulativo calculado na leitura)
+    uint64_t loop_wakeups;
+    uint64_t loop_events;
+    uint64_t loop_time_ns;
+    uint64_t loop_time_hist[LOOP_TIME_BUCKETS + 1]; // Última posição: acima do maior limite
+} Worker;
+
+/**
+ * @brief Cria os sockets de escuta (SO_REUSEADDR + SO_REUSEPORT, não-bloqueantes) e o motor de eventos do worker.
+ * @param w Worker a ser inicializado.
+ * @param id Índice do worker.
+ * @param cpu CPU para afinidade (-1 para não fixar).
+ * @param config Configuração do servidor (deve permanecer válida enquanto o worker existir).
+ * @param conns Tabela de conexões indexada por fd.
+ * @param inherited Sockets de escuta herdados de outro processo, um por listener (-1 = criar),
+ * ou NULL. Em caso de falha, os herdados não são fechados.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int worker_init(Worker *w, int id, int cpu, const ServerConfig *config, ConnectionTable *conns,
+                const int *inherited);
+
+/**
+ * @brief Inicia a thread do worker, que executa o loop do motor de eventos (config->loop).
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int worker_start(Worker *w);
+
+/**
+ * @brief Pede ao worker que pare de aceitar conexões e encerre as existentes após esvaziá-las.
+ * O loop termina quando não restarem conexões (chamado por outra thread).
+ */
+void worker_drain(Worker *w);
+
+/**
+ * @brief Pede ao worker que feche todas as conexões imediatamente e encerre o loop.
+ */
+void worker_stop(Worker *w);
+
+/**
+ * @brief Fecha os sockets de escuta do worker (usado pelos motores ao drenar).
+ */
+void worker_close_listeners(Worker *w);
+
+/**
+ * @brief Libera os sockets de escuta, os pipes em cache e os recursos do motor de eventos do worker.
+ */
+void worker_destroy(Worker *w);
+
+/**
+ * @brief Configura um descritor de arquivo como não-bloqueante.
+ * @return int 0 em caso de sucesso, -1 em caso de falha.
+ */
+int set_nonblocking(int fd);
+
+/**
+ * @brief Retorna o índice do listener dono do fd, ou -1 se o fd não é um socket de escuta.
+ */
+int worker_listener_index(const Worker *w, int fd);
+
+#endif // WORKER_H